@@ -1,3 +1,5 @@
 for %%x in (*.vert) do glslc %%x -o %%x.spv
 for %%x in (*.frag) do glslc %%x -o %%x.spv
-for %%x in (*.geom) do glslc %%x -o %%x.spv
\ No newline at end of file
+for %%x in (*.geom) do glslc %%x -o %%x.spv
+glslc -DVIRTUAL_TEXTURE gbuffer.frag -o gbuffer_vt.frag.spv
+glslc -DVIRTUAL_TEXTURE transparent.frag -o transparent_vt.frag.spv
\ No newline at end of file
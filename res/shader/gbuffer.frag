@@ -1,4 +1,5 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
 // #define VULKAN 130
 
 #define MAX_POINT_LIGHT_NUM 16
@@ -30,6 +31,7 @@ layout(push_constant) uniform Push {
     int alphaMode;
     int hasTexture;
     int mtlId;
+    int virtualSlot[6]; // -1 unless the binding is a virtual texture
 } push;
 
 
@@ -60,35 +62,43 @@ layout(set = 1, binding = 2) uniform sampler2D metalnessTex;
 layout(set = 1, binding = 3) uniform sampler2D roughnessTex;
 layout(set = 1, binding = 4) uniform sampler2D occlusionTex;
 layout(set = 1, binding = 5) uniform sampler2D emissionTex;
+
+#ifdef VIRTUAL_TEXTURE
+#define VT_SET 2
+#include "virtual_texture.glsl"
+#else
+// built without -DVIRTUAL_TEXTURE for devices lacking fragmentStoresAndAtomics, where every slot is -1
+#define sampleVirtual(tex, slot, uv) texture(tex, uv)
+#endif
 // layout(set = 1, binding = 6) uniform sampler2D iorTex;
 
 void main() {
     if((push.hasTexture & (1<<1)) != 0) {
         mat3 TBN = mat3(T, B, N);
-        vec3 bump = texture(normalTex, uv).rgb * 2.0 - 1.0;
+        vec3 bump = sampleVirtual(normalTex, push.virtualSlot[1], uv).rgb * 2.0 - 1.0;
         bump.xy = bump.xy * -1;
         bump.z = sqrt(1.0 - clamp(dot(bump.xy, bump.xy), 0, 1));
         outNormalOcclusion.xyz = normalize(TBN * bump);
     } else
         outNormalOcclusion.xyz = N, 1.0;
     if((push.hasTexture & (1<<5)) != 0) {
-        outEmission = texture(emissionTex, uv).rgba;
+        outEmission = sampleVirtual(emissionTex, push.virtualSlot[5], uv).rgba;
     } else
         outEmission = vec4(push.emission.xyz * push.emission.w, 1.0);
     if((push.hasTexture & (1<<0)) != 0)
-        outAlbedo.rgb = vertColor * texture(baseTex, uv).rgb;
+        outAlbedo.rgb = vertColor * sampleVirtual(baseTex, push.virtualSlot[0], uv).rgb;
     else
         outAlbedo.rgb = vertColor;
     if((push.hasTexture & (1<<2)) != 0)
-        outMetalRough.x = texture(metalnessTex, uv).x;
+        outMetalRough.x = sampleVirtual(metalnessTex, push.virtualSlot[2], uv).x;
     else
         outMetalRough.x = push.metalness;
     if((push.hasTexture & (1<<3)) != 0)
-        outMetalRough.y = texture(roughnessTex, uv).x;
+        outMetalRough.y = sampleVirtual(roughnessTex, push.virtualSlot[3], uv).x;
     else
         outMetalRough.y = push.roughness;
     if((push.hasTexture & (1<<4)) != 0) {
-        outNormalOcclusion.w = texture(occlusionTex, uv).r;
+        outNormalOcclusion.w = sampleVirtual(occlusionTex, push.virtualSlot[4], uv).r;
     } else
         outNormalOcclusion.w = 0.0;
     outMtlId = push.mtlId;
@@ -21,6 +21,8 @@ layout(/*input_attachment_index = 3, */set = 1, binding = 3) uniform sampler2D i
 layout(/*input_attachment_index = 5, */set = 1, binding = 4) uniform sampler2D inputDepth;
 layout(set = 1, binding = 5) uniform sampler2DArray normalShadowmaps;
 layout(set = 1, binding = 6) uniform samplerCubeArray omniShadowmaps;
+layout(set = 1, binding = 7) uniform samplerCube specularEnvironment; // ggx prefiltered, a roughness per level
+layout(set = 1, binding = 8) uniform sampler2D brdfLut; // scale and bias to f0 by n.v and roughness
 
 layout(location = 0) out vec4 outColor;
 
@@ -38,6 +40,8 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
     vec3 camDir;
     vec3 clearColor;
     vec4 environment;
+    vec4 environmentMap; // intensity, coarsest level, 1 if one is loaded
+    vec4 sh[9]; // irradiance over pi
 } globalUbo;
 
 struct LightInfo {
@@ -77,6 +81,29 @@ float distZ(float z, float zNear, float zFar) {
     return 2.0 * zNear * zFar / (zFar + zNear - z_n * (zFar - zNear));
 }
 
+vec3 shIrradiance(vec3 n) {
+    vec3 irradiance = globalUbo.sh[0].xyz * 0.282095
+        + globalUbo.sh[1].xyz * 0.488603 * n.y
+        + globalUbo.sh[2].xyz * 0.488603 * n.z
+        + globalUbo.sh[3].xyz * 0.488603 * n.x
+        + globalUbo.sh[4].xyz * 1.092548 * n.x * n.y
+        + globalUbo.sh[5].xyz * 1.092548 * n.y * n.z
+        + globalUbo.sh[6].xyz * 0.315392 * (3.0 * n.z * n.z - 1.0)
+        + globalUbo.sh[7].xyz * 1.092548 * n.x * n.z
+        + globalUbo.sh[8].xyz * 0.546274 * (n.x * n.x - n.y * n.y);
+    return max(irradiance, vec3(0.0));
+}
+
+// split sum image based lighting, everything expensive is baked
+vec3 environmentLight(vec3 n, vec3 v, vec3 albedo, float metalness, float roughness) {
+    float NdotV = clamp(dot(n, v), 1e-4, 1.0);
+    vec3 f0 = mix(vec3(0.04), albedo, metalness);
+    vec2 brdf = texture(brdfLut, vec2(NdotV, roughness)).xy;
+    vec3 specular = textureLod(specularEnvironment, reflect(-v, n), roughness * globalUbo.environmentMap.y).rgb * (f0 * brdf.x + brdf.y);
+    vec3 diffuse = shIrradiance(n) * albedo * (1.0 - metalness);
+    return (diffuse + specular) * globalUbo.environmentMap.x;
+}
+
 const mat4 biasMat = mat4(0.5, 0.0, 0.0, 0.0, 0.0, 0.5, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.5, 0.5, 0.0, 1.0);
 
 void main() {
@@ -170,9 +197,18 @@ void main() {
             }
             diffuseLight += thisLight * contactShadow;
         }
-        diffuseLight += (globalUbo.environment.xyz * globalUbo.environment.w);
-        outColor = vec4(diffuseLight * albedo + emission.xyz, 1.0);
+        vec3 ambient = vec3(0.0);
+        if(globalUbo.environmentMap.z > 0.0) {
+            vec2 metalRough = texture(inputMetalRough, fragUV).xy;
+            ambient = environmentLight(normal, normalize(globalUbo.camPos - worldPos), albedo, metalRough.x, metalRough.y);
+        } else
+            diffuseLight += (globalUbo.environment.xyz * globalUbo.environment.w);
+        outColor = vec4(diffuseLight * albedo + ambient + emission.xyz, 1.0);
         // outColor = vec4(contactShadow, contactShadow, contactShadow, 1.0);
+    } else if(globalUbo.environmentMap.z > 0.0) {
+        // the sky is the finest level, seen along the view ray
+        vec3 dir = normalize(WorldPosFromDepth(1.0) - globalUbo.camPos);
+        outColor = vec4(textureLod(specularEnvironment, dir, 0.0).rgb * globalUbo.environmentMap.x, 1.0);
     } else
         outColor = vec4(globalUbo.clearColor, 1.0);
 }
\ No newline at end of file
@@ -2,11 +2,8 @@
 
 #define MAX_LIGHT_NUM 64
 
+// position only stream. float for full and packed models, unorm16 for quantized ones
 layout(location = 0) in vec3 inPos;
-layout(location = 1) in vec3 normal;
-layout(location = 2) in vec3 tangent;
-layout(location = 3) in vec2 uv;
-layout(location = 4) in vec3 color;
 
 // layout(location = 0) out vec3 outPos;
 // layout(location = 1) out vec3 lightPos;
@@ -1,4 +1,5 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
 // #define VULKAN 130
 
 #define MAX_LIGHT_NUM 64
@@ -35,6 +36,7 @@ layout(push_constant) uniform Push {
     int alphaMode;
     int hasTexture;
     int mtlId;
+    int virtualSlot[6]; // -1 unless the binding is a virtual texture
 } push;
 
 layout(set = 0, binding = 0) uniform GlobalUbo {
@@ -90,6 +92,14 @@ layout(set = 2, binding = 3) uniform sampler2D roughnessTex;
 layout(set = 2, binding = 4) uniform sampler2D occlusionTex;
 layout(set = 2, binding = 5) uniform sampler2D emissionTex;
 
+#ifdef VIRTUAL_TEXTURE
+#define VT_SET 3
+#include "virtual_texture.glsl"
+#else
+// built without -DVIRTUAL_TEXTURE for devices lacking fragmentStoresAndAtomics, where every slot is -1
+#define sampleVirtual(tex, slot, uv) texture(tex, uv)
+#endif
+
 float distZ(float z, float zNear, float zFar) {
     float z_n = 2.0 * z - 1.0;
     return 2.0 * zNear * zFar / (zFar + zNear - z_n * (zFar - zNear));
@@ -102,15 +112,15 @@ void main() {
     vec3 diffuseLight = vec3(0.0, 0.0, 0.0);
     vec3 emission;
     if((push.hasTexture & (1 << 5)) != 0) {
-        emission = texture(emissionTex, uv).rgb;
+        emission = sampleVirtual(emissionTex, push.virtualSlot[5], uv).rgb;
     } else
         emission = push.emission.xyz * push.emission.w;
 
     vec3 normal;
     mat3 TBN = mat3(T, B, N);
     if((push.hasTexture & (1 << 1)) != 0) {
-        vec3 bump = normalize(texture(normalTex, uv).xyz);
-        bump = texture(normalTex, uv).xyz * 2.0 - 1.0;
+        vec3 bump = normalize(sampleVirtual(normalTex, push.virtualSlot[1], uv).xyz);
+        bump = sampleVirtual(normalTex, push.virtualSlot[1], uv).xyz * 2.0 - 1.0;
         bump.xy = bump.xy * -1;
         bump.z = sqrt(1.0 - clamp(dot(bump.xy, bump.xy), 0, 1));
         normal = normalize(TBN * bump);
@@ -120,8 +130,8 @@ void main() {
     if(push.side == 1)
         normal = -normal;
     if((push.hasTexture & (1 << 0)) != 0) {
-        albedo = vertColor.rgb * texture(baseTex, uv).rgb;
-        alpha = vertColor.a * texture(baseTex, uv).a;
+        albedo = vertColor.rgb * sampleVirtual(baseTex, push.virtualSlot[0], uv).rgb;
+        alpha = vertColor.a * sampleVirtual(baseTex, push.virtualSlot[0], uv).a;
     } else {
         albedo = vertColor.rgb;
         alpha = vertColor.a;
@@ -180,15 +190,15 @@ void main() {
     outAlbedo = vec4(albedo, alpha);
     outEmission = vec4(emission, alpha);
     if((push.hasTexture & (1 << 2)) != 0)
-        outMetalRough.x = texture(metalnessTex, uv).x;
+        outMetalRough.x = sampleVirtual(metalnessTex, push.virtualSlot[2], uv).x;
     else
         outMetalRough.x = push.metalness;
     if((push.hasTexture & (1 << 3)) != 0)
-        outMetalRough.y = texture(roughnessTex, uv).x;
+        outMetalRough.y = sampleVirtual(roughnessTex, push.virtualSlot[3], uv).x;
     else
         outMetalRough.y = push.roughness;
     if((push.hasTexture & (1 << 4)) != 0) {
-        outNormalOcclusion.w = texture(occlusionTex, uv).r;
+        outNormalOcclusion.w = sampleVirtual(occlusionTex, push.virtualSlot[4], uv).r;
     } else
         outNormalOcclusion.w = 0.0;
     outObjId = modelUbo.objId;
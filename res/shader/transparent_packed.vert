@@ -0,0 +1,71 @@
+#version 450
+// #define VULKAN 130
+
+// PackedVertex / QuantizedVertex. quantized positions are dequantized by modelUbo.transformMat
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec2 octNormal;
+layout(location = 2) in vec2 octTangent;
+layout(location = 3) in vec2 uv;
+layout(location = 4) in vec4 color;
+
+layout(location = 0) out vec3 T;
+layout(location = 1) out vec3 B;
+layout(location = 2) out vec3 N;
+// layout(location = 3) out vec3 normalTan;
+layout(location = 3) out vec4 worldPos;
+layout(location = 4) out vec4 fragColor;
+layout(location = 5) out vec2 fragUv;
+// layout(location = 4) out mat4 T2W;
+
+layout(push_constant) uniform Push {
+	vec4 albedo;
+	vec4 emission;
+	vec4 offsetTilling;
+    float metalness;
+    float roughness;
+    float ior;
+    int doubleSided;
+    int alphaMode;
+    int hasTexture;
+} push;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    float time;
+    float tanFov;
+	int height;
+	int width;
+    mat4 projectionView;
+    mat4 projectionInv;
+    mat4 viewInv;
+    vec4 viewPort; // x, y, w, h
+    vec4 clip; // min depth, max depth, near clip, far clip
+    vec4 camPos;
+    vec4 camDir;
+} globalUbo;
+
+layout(set = 0, binding = 1) uniform ModelUbo {
+    mat4 transformMat;
+    mat4 normalMat;
+    mat4 rotMat;
+    int objId;
+} modelUbo;
+
+vec3 octDecode(vec2 e) {
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-v.z, 0.0);
+    v.x += v.x >= 0.0 ? -t : t;
+    v.y += v.y >= 0.0 ? -t : t;
+    return normalize(v);
+}
+
+void main() {
+    worldPos = modelUbo.transformMat * vec4(position, 1.0);
+    gl_Position = globalUbo.projectionView * worldPos;
+
+    fragColor = vec4(color.rgb * push.albedo.xyz, push.albedo.w);
+    T = normalize(mat3(modelUbo.rotMat) * octDecode(octTangent));
+    N = normalize(mat3(modelUbo.normalMat) * octDecode(octNormal));
+    B = cross(N, T);
+
+    fragUv = (uv + push.offsetTilling.xy) * push.offsetTilling.zw;
+}
\ No newline at end of file
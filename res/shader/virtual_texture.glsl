@@ -0,0 +1,61 @@
+// software virtual texturing, the gpu side of VirtualTextures. define VT_SET before including.
+// only the -DVIRTUAL_TEXTURE shader variants include it, the feedback writes need fragmentStoresAndAtomics
+// the constants and layouts must match resources/virtual_texture.hpp
+
+#define VT_PAGE_SIZE 128u
+#define VT_PAGE_BORDER 4u
+#define VT_PAGE_PAYLOAD 120u
+#define VT_RESIDENT 0x80000000u
+
+struct VirtualTextureInfo {
+    uvec4 size; // width, height, levels
+    uvec4 levelOffsets[4]; // first page table entry of each level
+};
+
+layout(set = VT_SET, binding = 0) uniform sampler2D vtAtlas;
+layout(std430, set = VT_SET, binding = 1) readonly buffer VtPageTable {
+    uvec4 vtHeader; // frame
+    uint vtEntries[]; // resident bit, level, y, x of the atlas page
+};
+layout(std430, set = VT_SET, binding = 2) readonly buffer VtInfos {
+    VirtualTextureInfo vtInfos[];
+};
+layout(std430, set = VT_SET, binding = 3) buffer VtFeedback {
+    uint vtRequests[]; // a bit per page table entry
+};
+
+// samples tex, or the virtual texture slot when it's not negative. pages that aren't resident
+// fall back to the finest resident level, or to tex while nothing is
+vec4 sampleVirtual(sampler2D tex, int slot, vec2 uv) {
+    if(slot < 0)
+        return texture(tex, uv);
+    VirtualTextureInfo info = vtInfos[slot];
+
+    // the level hardware would pick
+    vec2 dx = dFdx(uv * vec2(info.size.xy));
+    vec2 dy = dFdy(uv * vec2(info.size.xy));
+    float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8));
+    uint level = uint(clamp(int(floor(lod)), 0, int(info.size.z) - 1));
+
+    vec2 wrapped = fract(uv);
+    uvec2 levelSize = max(info.size.xy >> level, uvec2(1));
+    uvec2 pages = (levelSize + VT_PAGE_PAYLOAD - 1u) / VT_PAGE_PAYLOAD;
+    uvec2 page = min(uvec2(wrapped * vec2(levelSize)) / VT_PAGE_PAYLOAD, pages - 1u);
+    uint index = info.levelOffsets[level / 4u][level % 4u] + page.y * pages.x + page.x;
+
+    // one pixel of each 4x4 block asks for its page, a different one every frame
+    uvec2 pixel = uvec2(gl_FragCoord.xy) & 3u;
+    if(pixel.x + pixel.y * 4u == vtHeader.x % 16u)
+        atomicOr(vtRequests[index >> 5], 1u << (index & 31u));
+
+    uint entry = vtEntries[index];
+    if((entry & VT_RESIDENT) == 0u)
+        return texture(tex, uv);
+    uint mapped = (entry >> 20) & 31u;
+    uvec2 atlasPage = uvec2(entry & 1023u, (entry >> 10) & 1023u);
+    uvec2 mappedSize = max(info.size.xy >> mapped, uvec2(1));
+    uvec2 mappedPage = page >> (mapped - level);
+    vec2 local = clamp(wrapped * vec2(mappedSize) - vec2(mappedPage * VT_PAGE_PAYLOAD), vec2(0.0), vec2(VT_PAGE_PAYLOAD));
+    vec2 texel = vec2(atlasPage * VT_PAGE_SIZE + VT_PAGE_BORDER) + local;
+    return textureLod(vtAtlas, texel / vec2(textureSize(vtAtlas, 0)), 0.0);
+}
@@ -4,5 +4,35 @@
 #include <stb_image_resize.h>
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include <stb_image_write.h>
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
\ No newline at end of file
+
+// tinyexr inflates zip compressed exr files through the zlib api, served by stb here
+typedef unsigned char Bytef;
+typedef unsigned long uLong;
+typedef unsigned long uLongf;
+#define Z_OK 0
+#define Z_DATA_ERROR (-3)
+#define Z_BUF_ERROR (-5)
+static uLong compressBound(uLong sourceLen) { return sourceLen + sourceLen / 4 + 64; }
+static int compress(Bytef* dest, uLongf* destLen, const Bytef* source, uLong sourceLen) {
+	int len;
+	unsigned char* data = stbi_zlib_compress(const_cast<Bytef*>(source), static_cast<int>(sourceLen), &len, 8);
+	if (!data) return Z_DATA_ERROR;
+	const bool fits = static_cast<uLongf>(len) <= *destLen;
+	if (fits) {
+		memcpy(dest, data, len);
+		*destLen = len;
+	}
+	free(data);
+	return fits ? Z_OK : Z_BUF_ERROR;
+}
+static int uncompress(Bytef* dest, uLongf* destLen, const Bytef* source, uLong sourceLen) {
+	const int len = stbi_zlib_decode_buffer(reinterpret_cast<char*>(dest), static_cast<int>(*destLen),
+		reinterpret_cast<const char*>(source), static_cast<int>(sourceLen));
+	if (len < 0) return Z_DATA_ERROR;
+	*destLen = len;
+	return Z_OK;
+}
+#define TINYEXR_USE_MINIZ 0
+#define TINYEXR_USE_THREAD 1
+#define TINYEXR_IMPLEMENTATION
+#include <tinyexr.h>
@@ -9,8 +9,8 @@ namespace fileSys = std::filesystem;
 
 namespace naku {
 
-FileBrowser::FileBrowser(bool autoClose, bool showWarning)
-	: _autoClose{ autoClose }, _showWarning{ showWarning } {
+FileBrowser::FileBrowser(bool autoClose, bool showWarning, Thumbnails* thumbnails)
+	: _autoClose{ autoClose }, _showWarning{ showWarning }, _thumbnails{ thumbnails } {
 	_currentPath = fileSys::path{ fileSys::current_path() };
 	_selectedEntry = fileSys::directory_entry{ _currentPath };
 	updateList();
@@ -22,7 +22,9 @@ const char* FileBrowser::getIcon(const std::string& fileName) {
 		strEndWith(fileName, ".jpg") ||
 		strEndWith(fileName, ".jpeg")||
 		strEndWith(fileName, ".bmp") ||
-		strEndWith(fileName, ".webp"))
+		strEndWith(fileName, ".webp")||
+		strEndWith(fileName, ".hdr") ||
+		strEndWith(fileName, ".exr"))
 		return ICON_FA_FILE_IMAGE_O;
 	// video
 	if (strEndWith(fileName, ".mov") ||
@@ -60,7 +62,8 @@ const char* FileBrowser::getIcon(const std::string& fileName) {
 	// mesh
 	if (strEndWith(fileName, ".obj") ||
 		strEndWith(fileName, ".fbx") ||
-		strEndWith(fileName, ".gltf"))
+		strEndWith(fileName, ".gltf") ||
+		strEndWith(fileName, ".glb"))
 		return ICON_FA_CUBE;
 	// miscellenous
 	if (strEndWith(fileName, ".exe"))
@@ -87,23 +90,41 @@ const char* FileBrowser::getIcon(const std::string& fileName) {
 
 void FileBrowser::updateList() {
 	_fileList.clear();
-	fileSys::directory_iterator list{ _currentPath };
-	for (auto& entry : list) {
-		try {
-			const auto& path = fileSys::relative(entry.path(), _currentPath).generic_u8string();
-			if (entry.is_directory())
-				_fileList.push_back({ entry, path, ICON_FA_FOLDER_O });
-			else
-				_fileList.push_back({ entry, path, getIcon(path)});
-		}
-		catch (const std::exception& e) {
-			if (_showWarning)
-				std::cerr << "File Browser Warining: " << e.what() << std::endl;
+	// a scan still running is left to finish on its own
+	_scan = ThreadPool::shared().submit([path = _currentPath, showWarning = _showWarning]() {
+		return scan(path, showWarning);
+	});
+}
+
+std::vector<FileBrowser::FileInfo> FileBrowser::scan(const fileSys::path& currentPath, bool showWarning) {
+	std::vector<FileInfo> fileList;
+	try {
+		fileSys::directory_iterator list{ currentPath };
+		for (auto& entry : list) {
+			try {
+				const auto& path = fileSys::relative(entry.path(), currentPath).generic_u8string();
+				if (entry.is_directory())
+					fileList.push_back({ entry, path, ICON_FA_FOLDER_O });
+				else {
+					fileList.push_back({ entry, path, getIcon(path) });
+					fileList.back().image = Thumbnails::isImage(path);
+				}
+			}
+			catch (const std::exception& e) {
+				if (showWarning)
+					std::cerr << "File Browser Warining: " << e.what() << std::endl;
+			}
 		}
 	}
+	catch (const std::exception& e) {
+		if (showWarning)
+			std::cerr << "File Browser Warining: " << e.what() << std::endl;
+	}
+	return fileList;
 }
 
 bool FileBrowser::showBrowser(char* buf, bool* p_open) {
+	bool selected = false;
 	if (ImGui::Begin("Browser", p_open)) {
 		if (ImGui::Button(ICON_FA_ARROW_UP)) {
 			_currentPath = fileSys::directory_entry(_currentPath.parent_path());
@@ -111,30 +132,48 @@ bool FileBrowser::showBrowser(char* buf, bool* p_open) {
 		}
 		SameLine();
 		ImGui::Text("%s", fileSys::absolute(_currentPath).generic_u8string().c_str());
-		for (auto& file : _fileList) {
-			Text(u8"    "); SameLine();
-			if (ImGui::Selectable(file.fname_with_icon.c_str())) {
-				_selectedEntry = file.entry;
-				if (_selectedEntry.is_directory()) {
-					_currentPath = _selectedEntry.path();
-					updateList();
+		if (_scan.valid()) {
+			if (_scan.wait_for(std::chrono::seconds(0)) == std::future_status::ready) _fileList = _scan.get();
+			else TextDisabled("Scanning...");
+		}
 
-					ImGui::End();
-					return false;
+		// only the visible rows are drawn, folders may hold thousands of files
+		const FileInfo* clicked = nullptr;
+		ImGuiListClipper clipper;
+		clipper.Begin(static_cast<int>(_fileList.size()));
+		while (clipper.Step()) {
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+				auto& file = _fileList[i];
+				Text(u8"    "); SameLine();
+				if (ImGui::Selectable(file.fname_with_icon.c_str())) clicked = &file;
+				if (_thumbnails && file.image && IsItemHovered()) {
+					uint32_t w, h;
+					VkDescriptorSet thumbnail = _thumbnails->get(file.entry.path().generic_u8string(), &w, &h);
+					if (thumbnail != VK_NULL_HANDLE) {
+						BeginTooltip();
+						Image((ImTextureID)thumbnail, { static_cast<float>(w), static_cast<float>(h) });
+						EndTooltip();
+					}
 				}
-				else if (_selectedEntry.is_regular_file()) {
-					strcpy(buf, _selectedEntry.path().generic_u8string().c_str());
+			}
+		}
 
-					ImGui::End();
-					if (_autoClose && p_open) *p_open = false;
-					return true;
-				}
+		if (clicked) {
+			_selectedEntry = clicked->entry;
+			if (_selectedEntry.is_directory()) {
+				_currentPath = _selectedEntry.path();
+				updateList();
+			}
+			else if (_selectedEntry.is_regular_file()) {
+				strcpy(buf, _selectedEntry.path().generic_u8string().c_str());
+				if (_autoClose && p_open) *p_open = false;
+				selected = true;
 			}
 		}
 	}
 
 	ImGui::End();
-	return false;
+	return selected;
 }
 
 }
\ No newline at end of file
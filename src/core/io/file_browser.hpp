@@ -2,9 +2,12 @@
 #define FILE_BROWSER_HPP
 
 #include "naku.hpp"
+#include "io/thumbnails.hpp"
 
 #include <imgui.h>
 
+#include <future>
+
 namespace naku {
 
 class FileBrowser {
@@ -13,6 +16,7 @@ public:
 		std::filesystem::directory_entry entry;
 		std::string fname;
 		std::string fname_with_icon;
+		bool image{ false };
 
 		FileInfo (const std::filesystem::directory_entry& Entry, const std::string& Fname, const char* Icon)
 			: entry{ Entry }, fname{ Fname } {
@@ -21,7 +25,8 @@ public:
 		}
 	};
 
-	FileBrowser(bool autoClose = true, bool showWarning = false);
+	// hovering an image file shows its thumbnail if thumbnails is given
+	FileBrowser(bool autoClose = true, bool showWarning = false, Thumbnails* thumbnails = nullptr);
 	~FileBrowser() {}
 
 	static const char* getIcon(const std::string& fileName);
@@ -33,8 +38,12 @@ private:
 	std::filesystem::path _currentPath;
 	std::filesystem::directory_entry _selectedEntry;
 	std::vector<FileInfo> _fileList;
+	// directories are listed on a worker, the list is empty until it's done
+	std::future<std::vector<FileInfo>> _scan;
+	Thumbnails* _thumbnails;
 
 	void updateList();
+	static std::vector<FileInfo> scan(const std::filesystem::path& path, bool showWarning);
 };
 
 }
@@ -2,6 +2,9 @@
 #include "io/file_browser.hpp"
 #include "io/select_table.hpp"
 #include "io/IconsFontAwesome4.h"
+#include "resources/gltf_parser.hpp"
+#include "resources/texture_streamer.hpp"
+#include "resources/virtual_texture.hpp"
 
 #include <cstring>
 
@@ -24,6 +27,7 @@ GUI::GUI(
 		auto samplerCreateInfo = Sampler::getDefaultSamplerCreateInfo();
 		_defaultSampler = std::make_unique<Sampler>(_device, samplerCreateInfo);
 	}
+	_thumbnails = std::make_unique<Thumbnails>(_engine, _defaultSampler->sampler());
 
 
 	// 2: initialize imgui library
@@ -108,6 +112,7 @@ GUI::GUI(
 }
 
 GUI::~GUI() {
+	_thumbnails.reset();
 	ImGui_ImplVulkan_Shutdown();
 	if (_defaultSampler)
 		_defaultSampler.reset(nullptr);
@@ -161,6 +166,7 @@ void GUI::showMonitor() {
 	if (_firstLaunch) SetNextItemOpen(true);
 	if (CollapsingHeader("System Monitor")) {
 		showFPS();
+		showTextureMemory();
 	}
 }
 
@@ -173,6 +179,14 @@ void GUI::showGraphicsControl() {
 		DragFloat("##gamma", &_engine.gamma, 0.01f, 0.01f, 10.f);
 		LeftLabel("Environment");
 		ColorEdit4("##environment", glm::value_ptr(_engine.globalUbo.environment), ImGuiColorEditFlags_Float | ImGuiColorEditFlags_HDR);
+		if (_engine.globalUbo.environmentMap.z > 0.f) {
+			LeftLabel("Environment Map");
+			DragFloat("##environment_intensity", &_engine.globalUbo.environmentMap.x, 0.01f, 0.f, 100.f);
+		}
+		LeftLabel("Texture Budget");
+		int budget = static_cast<int>(_engine.textureBudget >> 20);
+		if (DragInt("##texture_budget", &budget, 8.f, 0, 1 << 16, budget == 0 ? "No limit" : "%d MiB"))
+			_engine.textureBudget = static_cast<VkDeviceSize>(std::max(budget, 0)) << 20;
 		showPresentModes();
 		showPresentAttachments();
 	}
@@ -210,7 +224,8 @@ void GUI::showObjectSelect() {
 		if (!_highlightedObj) selectedObj = nullptr;
 		else selectedObj = _highlightedObj->ptr.get();
 		PushID("object_list");
-		for (ResId id = 0; id < _resources.size<Object>(); id++) {
+		for (ResId id = 0; id < _resources.idCount<Object>(); id++) {
+			if (!_resources.exist<Object>(id)) continue;
 			auto obj = _resources.get<Object>(id);
 			if (obj->type() == Object::Type::MESH) {
 				if (Selectable(obj->name().c_str(), selectedObj == obj.get())) {
@@ -228,7 +243,8 @@ void GUI::showObjectSelect() {
 		if (!_highlightedObj) selectedObj = nullptr;
 		else selectedObj = _highlightedObj->ptr.get();
 		PushID("light_list");
-		for (ResId id = 0; id < _resources.size<Light>(); id++) {
+		for (ResId id = 0; id < _resources.idCount<Light>(); id++) {
+			if (!_resources.exist<Light>(id)) continue;
 			auto light = _resources.get<Light>(id);
 			auto obj = _resources.get<Object>(light->objId());
 
@@ -246,7 +262,8 @@ void GUI::showObjectSelect() {
 		if (!_highlightedObj) selectedObj = nullptr;
 		else selectedObj = _highlightedObj->ptr.get();
 		PushID("camera_list");
-		for (ResId id = 0; id < _resources.size<Camera>(); id++) {
+		for (ResId id = 0; id < _resources.idCount<Camera>(); id++) {
+			if (!_resources.exist<Camera>(id)) continue;
 			auto cam = _resources.get<Camera>(id);
 			auto obj = _resources.get<Object>(cam->objId());
 
@@ -272,7 +289,7 @@ void GUI::showResourceSelect() {
 	static SelectTable<Material> mtlTable{ _resources.getResource<Material>(), 4, false };
 	static SelectTable<Model> mdlTable{ _resources.getResource<Model>(), 4, false };
 	static SelectTable<Image2D> imgTable{ _resources.getResource<Image2D>(), 4, false };
-	static FileBrowser fileBrowser{};
+	static FileBrowser fileBrowser{ true, false, _thumbnails.get() };
 	static char selectedFile[512];
 	static bool showBrowser{ false };
 	BeginChild("##resource_catogeries", { left_col_width, GetContentRegionAvail().y }, false);
@@ -334,7 +351,23 @@ void GUI::showResourceSelect() {
 		}
 		if (showBrowser) {
 			if (fileBrowser.showBrowser(selectedFile, &showBrowser)) {
-				_engine.createModel(getFileName(selectedFile), selectedFile);
+				if (strEndWith(selectedFile, ".gltf") || strEndWith(selectedFile, ".glb")) {
+					// every primitive becomes a model, named like the ones Scene loads
+					GltfData gltf;
+					std::string warn;
+					if (!GltfData::parse(&gltf, selectedFile, &warn))
+						std::cerr << "Error: Failed to load " << selectedFile << ": " << warn;
+					else {
+						const std::string fileName = getFileName(selectedFile);
+						for (uint32_t mesh = 0; mesh < gltf.meshCount(); mesh++)
+							for (uint32_t i = 0; i < gltf.primitiveCount(mesh); i++)
+								_engine.createModel(
+									fileName + ":" + std::to_string(mesh) + "." + std::to_string(i) + ":" + gltf.meshName(mesh),
+									gltf, mesh, i);
+					}
+				}
+				else
+					_engine.createModel(getFileName(selectedFile), selectedFile);
 			}
 		}
 
@@ -392,8 +425,32 @@ void GUI::showFPS() {
 	}
 }
 
+void GUI::showTextureMemory() {
+	static char usage[32];
+	const float used = static_cast<float>(_engine.pTextureStreamer->textureBytes()) / (1 << 20);
+	LeftLabel("Textures");
+	if (_engine.textureBudget == 0) Text("%.1f MiB", used);
+	else {
+		const float budget = static_cast<float>(_engine.textureBudget) / (1 << 20);
+		sprintf(usage, "%.1f / %.0f MiB", used, budget);
+		ProgressBar(used / budget, ImVec2(-1.f, 0.f), usage);
+	}
+	if (_engine.pTextureStreamer->pendingCount() > 0) {
+		LeftLabel("Streaming");
+		Text("%d images", static_cast<int>(_engine.pTextureStreamer->pendingCount()));
+	}
+	if (_engine.virtualTexturing) {
+		const auto& virtualTextures = *_engine.pVirtualTextures;
+		sprintf(usage, "%u / %u", virtualTextures.residentPages(), virtualTextures.atlasPages());
+		LeftLabel("Virtual Pages");
+		ProgressBar(static_cast<float>(virtualTextures.residentPages()) / virtualTextures.atlasPages(), ImVec2(-1.f, 0.f), usage);
+	}
+}
+
 void GUI::beginFrame() {
 	_refreshTimer += _engine.deltaTime;
+	_thumbnails->update();
+	clearRemovedSelection();
 
 	ImGui_ImplVulkan_NewFrame();
 	ImGui_ImplGlfw_NewFrame();
@@ -401,6 +458,18 @@ void GUI::beginFrame() {
 	NewFrame();
 }
 
+void GUI::clearRemovedSelection() {
+	// scene switches and reloads remove resources, object ids are reused right away
+	if (_highlightedObj && _resources.get<Object>(_highlightedObj->ptr->id()) != _highlightedObj->ptr)
+		clearObjectInspector();
+	if (_highlightedMtl && _resources.get<Material>(_highlightedMtl->ptr->id()) != _highlightedMtl->ptr)
+		clearMaterialInspector();
+	if (_highlightedImg && _resources.get<Image2D>(_highlightedImg->ptr->id()) != _highlightedImg->ptr)
+		_highlightedImg.reset(nullptr);
+	if (_highlightedMdl && _resources.get<Model>(_highlightedMdl->ptr->id()) != _highlightedMdl->ptr)
+		_highlightedMdl.reset(nullptr);
+}
+
 void GUI::draw() {
 
 	Render();
@@ -539,6 +608,8 @@ void GUI::ImageReflect::build(const std::shared_ptr<Image2D>& Image) {
 	name = Image->name();
 	w = Image->width();
 	h = Image->height();
+	// images of a file are previewed through a thumbnail instead
+	if (Thumbnails::isImage(ptr->filePath())) return;
 	if (!ptr->ImGuiImageId) {
 		ptr->ImGuiImageId = std::make_unique<VkDescriptorSet>();
 		*ptr->ImGuiImageId = ImGui_ImplVulkan_AddTexture(_defaultSampler->sampler(), ptr->defaultImageView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
@@ -652,9 +723,20 @@ void GUI::ImageReflect::showInspector(GUI& gui) {
 	Text(strcat(imgName, " \xef\x87\x85"));
 	gui.LeftLabel("Resolution");
 	Text(u8"%d × %d", this->w, this->h);
+	if (uint32_t dropped = gui._engine.pTextureStreamer->droppedLevels(ptr->id())) {
+		gui.LeftLabel("Dropped Mips");
+		Text("%d", static_cast<int>(dropped));
+	}
 	gui.LeftLabel("Path");
 	TextWrapped(ptr->filePath().c_str());
-	ImGui::Image((ImTextureID)*ptr->ImGuiImageId, { gui._thumbnail_width, gui._thumbnail_width });
+	if (Thumbnails::isImage(ptr->filePath())) {
+		uint32_t tw, th;
+		VkDescriptorSet thumbnail = gui._thumbnails->get(ptr->filePath(), &tw, &th);
+		if (thumbnail != VK_NULL_HANDLE)
+			ImGui::Image((ImTextureID)thumbnail, { gui._thumbnail_width, gui._thumbnail_width * th / tw });
+		else TextDisabled("Loading...");
+	}
+	else ImGui::Image((ImTextureID)*ptr->ImGuiImageId, { gui._thumbnail_width, gui._thumbnail_width });
 }
 
 void GUI::ModelReflect::showInspector(GUI& gui) {
@@ -756,8 +838,11 @@ void GUI::ObjectReflect::showInspector(GUI& gui) {
 		if (showMdlTable) {
 			if (mdlTable.showSelectTable(&showMdlTable, true, "Models")) {
 				if (this) {
-					if (this->ptr->model)
+					if (this->ptr->model) {
 						this->ptr->model = gui._resources.get<Model>(mdlTable.selected);
+						// the new model may have a different dequantization transform
+						this->ptr->update();
+					}
 				}
 			}
 		}
@@ -5,6 +5,7 @@
 #include "utils/descriptors.hpp"
 #include "render_systems/renderer.hpp"
 #include "utils/engine.hpp"
+#include "io/thumbnails.hpp"
 
 #define IM_VEC2_CLASS_EXTRA constexpr ImVec2(const glm::vec2& f) : x(f.x), y(f.y) {} operator glm::vec2() const { return glm::vec2(x,y); }
 #define IM_VEC4_CLASS_EXTRA constexpr ImVec4(const glm::vec4& f) : x(f.x), y(f.y), z(f.z), w(f.w) {} operator glm::vec4() const { return glm::vec4(x,y,z,w); }
@@ -33,6 +34,7 @@ public:
 	GUI& operator=(GUI&&) = delete;
 
 	void showFPS();
+	void showTextureMemory();
 	void beginFrame();
 	void draw();
 	void endFrame() { draw(); }
@@ -173,6 +175,7 @@ private:
 	ResourceManager& _resources;
 	Renderer& _renderer;
 	static std::unique_ptr<Sampler> _defaultSampler;
+	std::unique_ptr<Thumbnails> _thumbnails;
 
 	bool _firstLaunch{ true };
 
@@ -191,6 +194,8 @@ private:
 
 	// helpers
 	void HelpMarker(const char* desc);
+	// drops selections of resources removed since the last frame
+	void clearRemovedSelection();
 	void clearObjectInspector() {
 		_highlightedObj.reset(nullptr);
 	}
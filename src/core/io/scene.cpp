@@ -1,6 +1,13 @@
 #include "io/scene.hpp"
+#include "io/scene_package.hpp"
+#include "resources/texture_streamer.hpp"
+#include "resources/virtual_texture.hpp"
+#include "utils/mapped_file.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/upload_batch.hpp"
 
 #include <iostream>
+#include <iomanip>
 
 namespace naku {
 
@@ -12,41 +19,507 @@ Scene::Scene(Engine& engine, std::string path)
 	//TODO
 	_transparentVert = _engine.createShader("res/shader/transparent.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
 	_transparentFrag = _engine.createShader("res/shader/transparent.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
-	InternalMeshs.emplace(std::string("quad"), _engine.createModel("quad", "res/model/quad.obj"));
-	InternalMeshs.emplace(std::string("teapot"), _engine.createModel("teapot", "res/model/teapot.obj"));
-	InternalMeshs.emplace(std::string("sphere"), _engine.createModel("sphere", "res/model/sphere.obj"));
-	InternalMeshs.emplace(std::string("cube"), _engine.createModel("cube", "res/model/cube.obj"));
+	UploadBatch batch{ *_engine.pDevice };
+	std::vector<Engine::PendingModel> internals;
+	for (const char* name : { "quad", "teapot", "sphere", "cube" })
+		internals.push_back(_engine.requestModel(name, std::string("res/model/") + name + ".obj"));
+	for (auto& pending : internals)
+		InternalMeshs.emplace(pending.name, finishModel(pending));
+	// never released, scenes switching in and out don't free them
+	for (auto& pair : InternalMeshs)
+		_engine.resources.hold<Model>(pair.second->id());
 }
 
 void Scene::load() {
 	clear();
-	_j = readJson(filePath+"/scene.json");
+	_loadedFromPackage = false;
+	const std::string jsonPath = filePath + "/scene.json";
+	_sourceHash = doesFileExist(jsonPath) ? MappedFile{ jsonPath }.hash() : 0;
+	std::error_code error;
+	_jsonTime = std::filesystem::last_write_time(jsonPath, error);
+	_engine.sharedContent = {};
+
+	// meshes load on the thread pool while the scene is read and their buffers are filled by
+	// one submit at the end. transforms are written once all objects are there
+	auto start = std::chrono::high_resolution_clock::now();
+	UploadBatch batch{ *_engine.pDevice };
+	_engine.deferObjectWrites = true;
+	try {
+		if (!usePackage || !loadPackage())
+			loadJson(jsonPath);
+		// not lit by the environment map of the last scene
+		if (!MapHas(_j["graphics"], "environment_map"))
+			_engine.resetEnvironment();
+		finishModels();
+	}
+	catch (...) {
+		abandonModels();
+		_engine.deferObjectWrites = false;
+		// so the objects created so far give their models back once cleared
+		holdModels();
+		throw;
+	}
+	batch.submit();
+	_engine.deferObjectWrites = false;
+	_engine.writeObjects();
+	if (echo) {
+		auto end = std::chrono::high_resolution_clock::now();
+		std::cout << "Scene loaded in " << std::chrono::duration<float, std::milli>(end - start).count() << " ms, "
+			<< batch.uploadedBytes() / 1024 << " KiB uploaded in " << batch.submitCount() << " submits." << std::endl;
+	}
+
+	// textures requested above have been decoding all along. virtual textures go first,
+	// what they leave to the streamer is waited for after them
+	if (!_engine.streamTextures) {
+		_engine.pVirtualTextures->finish();
+		_engine.pTextureStreamer->finish();
+	}
+
+	// the materials bound the images they share with the last scene, the rest goes
+	holdModels();
+	_freed = _engine.freeUnused();
+}
+
+void Scene::switchTo(const std::string& path) {
+	auto start = std::chrono::high_resolution_clock::now();
+	// frames in flight may still draw objects whose ids the new scene takes over
+	vkDeviceWaitIdle(_engine.device());
+
+	auto resident = [](const ResourceCollectionBase& res) {
+		std::unordered_set<ResId> ids;
+		for (ResId id = 0; id < res.idCount(); id++) {
+			if (res.exist(id)) ids.insert(id);
+		}
+		return ids;
+	};
+	const auto models = resident(_engine.resources.getResource<Model>());
+	const auto materials = resident(_engine.resources.getResource<Material>());
+	const auto images = resident(_engine.resources.getResource<Image2D>());
+
+	filePath = path;
+	load();
+
+	uint32_t keptModels{ 0 }, keptMaterials{ 0 }, keptImages{ 0 };
+	for (ResId id : _heldModels)
+		keptModels += static_cast<uint32_t>(models.count(id));
+	std::unordered_set<ResId> sampled;
+	for (const auto& pMaterial : _materials) {
+		keptMaterials += static_cast<uint32_t>(materials.count(pMaterial->id()));
+		for (size_t binding = 0; binding < static_cast<size_t>(MaterialTextures::SIZE); binding++) {
+			auto pTex = pMaterial->texture(binding);
+			if (pTex && pTex->image() && pTex->image() != Material::DefaultTexutreImage)
+				sampled.insert(pTex->image()->id());
+		}
+	}
+	for (ResId id : sampled)
+		keptImages += static_cast<uint32_t>(images.count(id));
+
+	auto end = std::chrono::high_resolution_clock::now();
+	std::cout << "Switched to " << path << " in " << std::chrono::duration<float, std::milli>(end - start).count() << " ms: "
+		<< keptModels << " models, " << keptMaterials << " materials and " << keptImages << " images kept, "
+		<< _heldModels.size() - keptModels << " models and " << _materials.size() - keptMaterials << " materials loaded, "
+		<< _freed.models << " models, " << _freed.materials << " materials and " << _freed.images << " images freed ("
+		<< _freed.bytes / 1024 << " KiB)." << std::endl;
+}
+
+void Scene::loadJson(const std::string& jsonPath) {
+	// materials, objects and lights are created as soon as they're parsed and dropped from
+	// the document right after, only the small sections stay in _j. objects read before
+	// their material wait for the end
+	std::vector<std::pair<std::string, nlohmann::json>> waiting;
+	bool created = false;
+	_j = parseJson(jsonPath, [&](const std::string& section, const std::string& name, nlohmann::json& values) {
+		if (hotReload) _entryHashes[section][name] = hashEntry(values);
+		if (section == "materials")
+			loadMaterial(name, values);
+		else if (section == "objects") {
+			if (MapHas(values, "material") && values["material"].is_string() &&
+				!_engine.resources.exist<Material>(values["material"].get<std::string>()))
+				waiting.emplace_back(name, std::move(values));
+			else loadObject(name, values);
+		}
+		else loadLight(name, values, &_importance);
+		created = true;
+		return true;
+	}, [&](nlohmann::json& graphics) {
+		if (created)
+			std::cerr << "Warning: graphics of " << jsonPath << " come after what they load, put them first for that." << std::endl;
+		loadGraphics(graphics);
+	});
 
-	loadGraphics();
 	loadCamera();
-	loadMaterials(); //must load materials before objects
-	loadObjects();
-	loadLights();
+	for (auto& object : waiting)
+		loadObject(object.first, object.second);
+}
+
+nlohmann::json Scene::parseJson(
+	const std::string& jsonPath,
+	const EntryCallback& onEntry,
+	const std::function<void(nlohmann::json& graphics)>& onGraphics) {
+	std::ifstream file{ jsonPath };
+	if (!file.is_open())
+		throw std::runtime_error("failed to open file: " + jsonPath);
+
+	using Event = nlohmann::json::parse_event_t;
+	std::string section, entry;
+	return nlohmann::json::parse(file, [&](int depth, Event event, nlohmann::json& parsed) {
+		if (event == Event::key) {
+			if (depth == 1) section = parsed.get<std::string>();
+			else if (depth == 2) entry = parsed.get<std::string>();
+			return true;
+		}
+		if (event != Event::object_end) return true;
+		if (depth == 1 && section == "graphics") {
+			if (onGraphics) onGraphics(parsed);
+			return true;
+		}
+		if (depth != 2 || (section != "materials" && section != "objects" && section != "lights")) return true;
+		return !onEntry(section, entry, parsed);
+	});
+}
+
+uint64_t Scene::hashEntry(const nlohmann::json& values) {
+	const std::string dump = values.dump();
+	return hashMemory(dump.data(), dump.size());
+}
+
+bool Scene::poll() {
+	const auto now = std::chrono::steady_clock::now();
+	if (now - _lastPoll < std::chrono::milliseconds(POLL_INTERVAL)) return false;
+	_lastPoll = now;
+	std::error_code error;
+	const auto time = std::filesystem::last_write_time(filePath + "/scene.json", error);
+	if (error || time == _jsonTime) return false;
+	_jsonTime = time;
+	return reload();
+}
+
+bool Scene::reload() {
+	const std::string jsonPath = filePath + "/scene.json";
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// parsed whole before anything changes, a file caught half written waits for the next save
+	uint64_t sourceHash;
+	nlohmann::json j;
+	std::unordered_map<std::string, std::unordered_map<std::string, uint64_t>> hashes;
+	std::map<std::string, std::vector<std::pair<std::string, nlohmann::json>>> changed;
+	try {
+		sourceHash = MappedFile{ jsonPath }.hash();
+		if (sourceHash == _sourceHash) return false;
+		j = parseJson(jsonPath, [&](const std::string& section, const std::string& name, nlohmann::json& values) {
+			const uint64_t hash = hashEntry(values);
+			hashes[section][name] = hash;
+			auto& old = _entryHashes[section];
+			auto itr = old.find(name);
+			if (itr == old.end() || itr->second != hash)
+				changed[section].emplace_back(name, std::move(values));
+			return true;
+		}, nullptr);
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Warning: " << jsonPath << " isn't reloaded: " << e.what() << std::endl;
+		return false;
+	}
+	_sourceHash = sourceHash;
+
+	uint32_t loaded{ 0 }, removed{ 0 };
+	// removed object ids are taken again, frames in flight may still draw their objects
+	vkDeviceWaitIdle(_engine.device());
+	UploadBatch batch{ *_engine.pDevice };
+	bool complete = true;
+	try {
+		if (j["graphics"] != _j["graphics"]) {
+			// loading options only apply to models loaded from now on
+			loadGraphics(j["graphics"]);
+			if (!MapHas(j["graphics"], "environment_map"))
+				_engine.resetEnvironment();
+			_j["graphics"] = j["graphics"];
+		}
+
+		// edited materials are made again and given to the objects that had them
+		for (auto& entry : changed["materials"]) {
+			std::list<ResId> users;
+			if (auto pOld = _engine.resources.get<Material>(entry.first)) {
+				users = _engine.resources.getCollect<Material, Object>(pOld->id());
+				removeMaterial(pOld);
+			}
+			loadMaterial(entry.first, entry.second);
+			auto pMaterial = _engine.resources.get<Material>(entry.first);
+			for (ResId id : users) {
+				auto pObject = _engine.resources.get<Object>(id);
+				if (!pObject) continue;
+				pObject->material = pMaterial;
+				_engine.resources.addCollect<Material, Object>(pMaterial->id(), id);
+				if (pMaterial->type() == Material::Type::TRANSPARENT) _engine.transparents.insert(id);
+				else _engine.transparents.erase(id);
+			}
+			_entryHashes["materials"][entry.first] = hashes["materials"][entry.first];
+			loaded++;
+		}
+
+		// edited objects keep their ids, their meshes are found by name
+		for (auto& pair : std::unordered_map<std::string, uint64_t>(_entryHashes["objects"])) {
+			if (MapHas(hashes["objects"], pair.first)) continue;
+			auto pObject = _engine.resources.get<Object>(pair.first);
+			if (pObject && pObject->type() == Object::Type::MESH) removeObject(pObject);
+			_entryHashes["objects"].erase(pair.first);
+			removed++;
+		}
+		for (auto& entry : changed["objects"]) {
+			loadObject(entry.first, entry.second);
+			_entryHashes["objects"][entry.first] = hashes["objects"][entry.first];
+			loaded++;
+		}
+
+		// lights are made again, keeping their importance unless it's given
+		for (auto& pair : std::unordered_map<std::string, uint64_t>(_entryHashes["lights"])) {
+			if (MapHas(hashes["lights"], pair.first)) continue;
+			if (auto pLight = _engine.resources.get<Light>(pair.first)) removeLight(pLight);
+			_entryHashes["lights"].erase(pair.first);
+			removed++;
+		}
+		for (auto& entry : changed["lights"]) {
+			if (auto pOld = _engine.resources.get<Light>(entry.first)) {
+				float importance = pOld->importance;
+				removeLight(pOld);
+				loadLight(entry.first, entry.second, &importance);
+			}
+			else loadLight(entry.first, entry.second, &_importance);
+			_entryHashes["lights"][entry.first] = hashes["lights"][entry.first];
+			loaded++;
+		}
+
+		// materials go last, objects that used them may have been given others above
+		for (auto& pair : std::unordered_map<std::string, uint64_t>(_entryHashes["materials"])) {
+			if (MapHas(hashes["materials"], pair.first)) continue;
+			auto pMaterial = _engine.resources.get<Material>(pair.first);
+			if (pMaterial && !_engine.resources.getCollect<Material, Object>(pMaterial->id()).empty()) {
+				std::cerr << "Warning: Material " << pair.first << " is removed from scene.json but still used, it stays." << std::endl;
+				continue;
+			}
+			if (pMaterial) removeMaterial(pMaterial);
+			_entryHashes["materials"].erase(pair.first);
+			removed++;
+		}
+
+		if (j["cameras"] != _j["cameras"]) {
+			_j["cameras"] = j["cameras"];
+			for (auto itr = _cameras.begin(); itr != _cameras.end();) {
+				if (MapHas(_j["cameras"], (*itr)->name())) {
+					itr++;
+					continue;
+				}
+				_engine.removeCamera(*itr);
+				itr = _cameras.erase(itr);
+			}
+			loadCamera();
+			loaded++;
+		}
+
+		finishModels();
+	}
+	catch (const std::exception& e) {
+		abandonModels();
+		std::cerr << "Warning: " << jsonPath << " is reloaded only in part: " << e.what() << std::endl;
+		complete = false;
+	}
+	batch.submit();
+	if (!_engine.streamTextures) {
+		_engine.pVirtualTextures->finish();
+		_engine.pTextureStreamer->finish();
+	}
+	holdModels();
+	_engine.freeUnused();
+	if (!complete) return true;
+
+	auto end = std::chrono::high_resolution_clock::now();
+	std::cout << "Scene reloaded in " << std::chrono::duration<float, std::milli>(end - start).count() << " ms: "
+		<< loaded << " loaded, " << removed << " removed." << std::endl;
+	return true;
+}
+
+void Scene::detachObject(const std::shared_ptr<Object>& pObject) {
+	auto expanded = _gltfObjects.find(pObject->name());
+	if (expanded != _gltfObjects.end()) {
+		auto children = std::move(expanded->second);
+		_gltfObjects.erase(expanded);
+		for (auto& pChild : children) removeObject(pChild);
+	}
+	if (pObject->model) {
+		_vertCount -= pObject->model->vertexCount();
+		_faceCount -= pObject->model->indexCount() / 3;
+		_modelCount -= 1;
+	}
+	if (pObject->material) {
+		_engine.resources.removeFromCollect<Material, Object>(pObject->material->id(), pObject->id());
+		_engine.transparents.erase(pObject->id());
+	}
+	pObject->model = nullptr;
+	pObject->material = nullptr;
+	_objectCount -= 1;
+}
+
+void Scene::removeObject(const std::shared_ptr<Object>& pObject) {
+	detachObject(pObject);
+	_objects.erase(std::remove(_objects.begin(), _objects.end(), pObject), _objects.end());
+	_engine.removeObject(pObject);
+}
+
+void Scene::removeLight(const std::shared_ptr<Light>& pLight) {
+	_lights.erase(std::remove(_lights.begin(), _lights.end(), pLight), _lights.end());
+	_engine.removeLight(pLight);
+}
+
+void Scene::removeMaterial(const std::shared_ptr<Material>& pMaterial) {
+	_materials.erase(std::remove(_materials.begin(), _materials.end(), pMaterial), _materials.end());
+	_textureRequests.erase(std::remove_if(_textureRequests.begin(), _textureRequests.end(),
+		[&](const TextureRequest& request) { return request.material == pMaterial; }), _textureRequests.end());
+	_engine.resources.release<Material>(pMaterial->id());
+}
+
+void Scene::addMaterial(const std::shared_ptr<Material>& pMaterial) {
+	_materials.push_back(pMaterial);
+	_engine.resources.hold<Material>(pMaterial->id());
+}
+
+std::shared_ptr<Material> Scene::takeMaterial(const std::string& name, uint64_t source) {
+	auto pMaterial = _engine.resources.get<Material>(name);
+	if (!pMaterial) return nullptr;
+	if (pMaterial->sourceHash != source) {
+		if (_engine.resources.holdCount<Material>(pMaterial->id()) == 0) {
+			// its images are freed by the next freeUnused unless the new one samples them
+			_engine.removeMaterial(pMaterial);
+			return nullptr;
+		}
+		std::cerr << "Warning: Material " << name << " is used by another scene with other values, which it keeps." << std::endl;
+	}
+	if (!VectorHas(_materials, pMaterial)) addMaterial(pMaterial);
+	return pMaterial;
+}
+
+void Scene::holdModels() {
+	std::unordered_set<ResId> models;
+	for (const auto& pObject : _objects) {
+		if (pObject->model) models.insert(pObject->model->id());
+	}
+	for (ResId id : models) {
+		if (!_heldModels.count(id)) _engine.resources.hold<Model>(id);
+	}
+	for (ResId id : _heldModels) {
+		if (!models.count(id)) _engine.resources.release<Model>(id);
+	}
+	_heldModels = std::move(models);
+}
+
+std::shared_ptr<Model> Scene::finishModel(Engine::PendingModel& pending) {
+	const bool loading = !pending.pModel;
+	auto pModel = _engine.finishModel(pending);
+	MeshOptimizer::CacheStats before, after;
+	if (echo && loading && pModel->name() == pending.name && pModel->cacheStats(&before, &after)) {
+		const std::ios::fmtflags flags = std::cout.flags();
+		const std::streamsize precision = std::cout.precision();
+		std::cout << std::fixed << std::setprecision(3)
+			<< "\tModel " << pending.name << " optimized. ACMR " << before.acmr << " -> " << after.acmr
+			<< ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+		std::cout.flags(flags);
+		std::cout.precision(precision);
+	}
+	return pModel;
+}
+
+void Scene::finishModels() {
+	for (auto& pair : _modelRequests) {
+		auto pModel = finishModel(pair.second.pending);
+		for (auto& pObject : pair.second.objects) {
+			pObject->model = pModel;
+			_vertCount += pModel->vertexCount();
+			_faceCount += pModel->indexCount() / 3;
+			_modelCount += 1;
+		}
+	}
+	_modelRequests.clear();
+}
 
+void Scene::abandonModels() {
+	// workers still write into the upload batch, and its copies go to buffers of these models
+	for (auto& pair : _modelRequests) {
+		if (pair.second.pending.loading.valid()) pair.second.pending.loading.wait();
+	}
+	if (_engine.pDevice->uploadBatch) _engine.pDevice->uploadBatch->submit();
+	_modelRequests.clear();
+	_engine.loadingModels.clear();
 }
 
-void Scene::loadGraphics() {
-	for (auto& item : _j["graphics"].items()) {
+void Scene::loadGraphics(nlohmann::json& graphics) {
+	for (auto& item : graphics.items()) {
 		if (item.key() == "environment") {
 			_engine.globalUbo.environment = glm::vec4(item.value()[0], item.value()[1], item.value()[2], item.value()[3]);
 		}
+		if (item.key() == "environment_map") { // an equirectangular panorama, lights the scene in place of environment
+			std::string path = item.value();
+			if (doesFileExist(filePath + "/" + path))
+				path = filePath + "/" + path;
+			_engine.loadEnvironment(path);
+		}
+		if (item.key() == "environment_intensity") {
+			_engine.globalUbo.environmentMap.x = item.value();
+		}
 		if (item.key() == "alpha") {
 			_engine.alpha = item.value();
 		}
 		if (item.key() == "gamma") {
 			_engine.gamma = item.value();
 		}
+		if (item.key() == "vertex_format") {
+			const std::string format = item.value();
+			if (format == "packed")
+				_engine.modelOptions.vertexFormat = VertexFormat::PACKED;
+			else if (format == "quantized")
+				_engine.modelOptions.vertexFormat = VertexFormat::QUANTIZED;
+			else
+				_engine.modelOptions.vertexFormat = VertexFormat::FULL;
+		}
+		if (item.key() == "optimize_meshes") {
+			_engine.modelOptions.optimize = item.value();
+		}
+		if (item.key() == "lod_count") {
+			_engine.modelOptions.lodCount = item.value();
+		}
+		if (item.key() == "lod_threshold") {
+			_engine.lodThreshold = item.value();
+		}
+		if (item.key() == "shadow_lod_bias") {
+			_engine.shadowLodBias = item.value();
+		}
+		if (item.key() == "compress_textures") {
+			_engine.compressTextures = item.value();
+		}
+		if (item.key() == "stream_textures") {
+			_engine.streamTextures = item.value();
+		}
+		if (item.key() == "texture_budget") { // in MiB
+			_engine.textureBudget = static_cast<VkDeviceSize>(item.value()) << 20;
+		}
+		if (item.key() == "virtual_texturing") {
+			_engine.virtualTexturing = item.value();
+			if (_engine.virtualTexturing && !_engine.pDevice->fragmentStoresAndAtomics) {
+				std::cerr << "Warning: Virtual texturing needs fragmentStoresAndAtomics, textures are streamed instead." << std::endl;
+				_engine.virtualTexturing = false;
+			}
+		}
+		if (item.key() == "virtual_texture_pages") {
+			_engine.virtualTexturePages = item.value();
+		}
 	}
 }
 void Scene::loadCamera() {
 	int count{ 0 };
 	for (auto& item : _j["cameras"].items()) {
-		auto pCam = _engine.createCamera(item.key());
+		// a reload sets up the ones there already again
+		auto pCam = _engine.resources.exist<Camera>(item.key()) ?
+			_engine.resources.get<Camera>(item.key()) :
+			_engine.createCamera(item.key());
+		if (!VectorHas(_cameras, pCam)) _cameras.push_back(pCam);
 		auto& values = item.value();
 		if (MapHas(values, "active"))
 			pCam->_active = values["active"];
@@ -86,79 +559,112 @@ void Scene::loadCamera() {
 		count++;
 	}
 	if (count == 0) { //create a default camera
-		_engine.pMainCamera = _engine.createCamera("MainCamera");
+		_engine.pMainCamera = _engine.resources.exist<Camera>("MainCamera") ?
+			_engine.resources.get<Camera>("MainCamera") :
+			_engine.createCamera("MainCamera");
+		if (!VectorHas(_cameras, _engine.pMainCamera)) _cameras.push_back(_engine.pMainCamera);
 	}
 }
 
-void Scene::loadObjects() {
-	for (auto& item : _j["objects"].items()) {
-		std::string name = item.key();
-		//std::string type = item.value()["type"];
-		auto& values = item.value();
-		auto pObject = _engine.createObject(name, Object::Type::MESH);
-		ResId id = pObject->id();
+void Scene::loadObject(const std::string& name, nlohmann::json& values) {
+	// one edited since the last load is set up again with its id
+	auto pObject = _engine.resources.get<Object>(name);
+	if (pObject && pObject->type() == Object::Type::MESH)
+		detachObject(pObject);
+	else {
+		pObject = _engine.createObject(name, Object::Type::MESH);
+		_objects.push_back(pObject);
+	}
 
-		if (MapHas(values, "active"))
-			pObject->_active = values["active"];
-		if (MapHas(values, "position"))
-			pObject->setPosition(values["position"][0], values["position"][1], values["position"][2]);
-		if (MapHas(values, "rotation"))
-			pObject->setRotation(values["rotation"][0], values["rotation"][1], values["rotation"][2]);
-		if (MapHas(values, "scale"))
-			pObject->setScale(values["scale"][0], values["scale"][1], values["scale"][2]);
-		if (MapHas(values, "mesh")) {
-			std::string modelPath = values["mesh"];
-			std::string modelName = getFileName(modelPath);
-
-			std::shared_ptr<Model> pModel;
-			if (!MapHas(InternalMeshs, modelName)) {
-				if (!doesFileExist(modelPath)) {
-					if (doesFileExist(filePath + "/" + modelPath))
-						modelPath = filePath + "/" + modelPath;
-					else
-						throw std::runtime_error(std::string("Error: Mesh ") + modelName + " does not exist.");
-				}
-				pModel = _engine.createModel(modelName, modelPath);
+	pObject->_active = MapHas(values, "active") ? values["active"].get<bool>() : true;
+	glm::vec3 position{ 0.f }, rotation{ 0.f }, scale{ 1.f };
+	if (MapHas(values, "position"))
+		position = glm::vec3{ values["position"][0], values["position"][1], values["position"][2] };
+	if (MapHas(values, "rotation"))
+		rotation = glm::vec3{ values["rotation"][0], values["rotation"][1], values["rotation"][2] };
+	if (MapHas(values, "scale"))
+		scale = glm::vec3{ values["scale"][0], values["scale"][1], values["scale"][2] };
+	pObject->setTransform(position, rotation, scale);
+	if (MapHas(values, "mesh")) {
+		std::string modelPath = values["mesh"];
+		std::string modelName = getFileName(modelPath);
+
+		std::shared_ptr<Model> pModel;
+		if (!MapHas(InternalMeshs, modelName)) {
+			if (!doesFileExist(modelPath)) {
+				if (doesFileExist(filePath + "/" + modelPath))
+					modelPath = filePath + "/" + modelPath;
+				else
+					throw std::runtime_error(std::string("Error: Mesh ") + modelName + " does not exist.");
 			}
-			else
-				pModel = InternalMeshs[modelName];
+			if (strEndWith(modelPath, ".gltf") || strEndWith(modelPath, ".glb"))
+				loadGltf(pObject, modelPath, values);
+			else if (_engine.resources.exist<Model>(modelName))
+				pModel = _engine.resources.get<Model>(modelName);
+			else {
+				// the object gets it in finishModels
+				auto itr = _modelRequests.find(modelName);
+				if (itr == _modelRequests.end())
+					itr = _modelRequests.emplace(modelName, ModelRequest{ _engine.requestModel(modelName, modelPath) }).first;
+				itr->second.objects.push_back(pObject);
+			}
+		}
+		else
+			pModel = InternalMeshs[modelName];
+		if (pModel) {
 			pObject->model = pModel;
 			_vertCount += pModel->vertexCount();
 			_faceCount += pModel->indexCount() / 3;
 			_modelCount += 1;
 		}
-		if (MapHas(values, "material")) {
-			std::string mtlName = values["material"];
-			if (!_engine.resources.exist<Material>(mtlName)) {
-				mtlName = "Error: material " + mtlName;
-				mtlName = mtlName + " isn't loaded.";
-				throw std::runtime_error(mtlName);
-			}
-			auto pMaterial = _engine.resources.get<Material>(mtlName);
-			pObject->material = pMaterial;
-			_engine.resources.addCollect<Material, Object>(pMaterial->id(), pObject->id());
-			if (pMaterial->type() == Material::Type::TRANSPARENT)
-				_engine.transparents.insert(pObject->id());
-		}
-		_objectCount += 1;
-		if (echo) {
-			auto pos = pObject->position();
-			auto scale = pObject->scale();
-			auto rotation = pObject->rotation();
-			std::cout << "\tObject " << name << " loaded. position: ("
-				<< pos.x << " " << pos.y << " " << pos.z << "). scale: ("
-				<< scale.x << " " << scale.y << " " << scale.z << "). rotation: "
-				<< rotation.x << " " << rotation.y << " " << rotation.z << ")" << std::endl;
+	}
+	if (MapHas(values, "material")) {
+		std::string mtlName = values["material"];
+		if (!_engine.resources.exist<Material>(mtlName)) {
+			mtlName = "Error: material " + mtlName;
+			mtlName = mtlName + " isn't loaded.";
+			throw std::runtime_error(mtlName);
 		}
+		auto pMaterial = _engine.resources.get<Material>(mtlName);
+		pObject->material = pMaterial;
+		_engine.resources.addCollect<Material, Object>(pMaterial->id(), pObject->id());
+		if (pMaterial->type() == Material::Type::TRANSPARENT)
+			_engine.transparents.insert(pObject->id());
+	}
+	_objectCount += 1;
+	if (echo) {
+		auto pos = pObject->position();
+		auto scale = pObject->scale();
+		auto rotation = pObject->rotation();
+		std::cout << "\tObject " << name << " loaded. position: ("
+			<< pos.x << " " << pos.y << " " << pos.z << "). scale: ("
+			<< scale.x << " " << scale.y << " " << scale.z << "). rotation: "
+			<< rotation.x << " " << rotation.y << " " << rotation.z << ")" << std::endl;
 	}
 }
 
-void Scene::loadMaterials() {
-	for (auto& mtl : _j["materials"].items()) {
-		std::string name = mtl.key();
-		auto& Value = mtl.value();
+void Scene::loadMaterial(const std::string& name, nlohmann::json& Value) {
+	// virtual textures are cut into pages from plain pixels
+	const bool compress = _engine.compressTextures && _engine.pDevice->textureCompressionBC && !_engine.virtualTexturing;
 
-		std::shared_ptr<Material> pMaterial;
+	// texture paths may be relative to the scene, the material is known by the files they name
+	nlohmann::json source = Value;
+	for (const char* key : { "baseTex", "normalTex" }) {
+		if (!MapHas(Value, key)) continue;
+		std::string path = Value[key];
+		if (!doesFileExist(path)) {
+			if (doesFileExist(filePath + "/" + path))
+				path = filePath + "/" + path;
+			else
+				throw std::runtime_error(std::string("Error: ") + path + " does not exist.");
+		}
+		source[key] = path;
+	}
+	const uint64_t sourceHash = hashEntry(source);
+
+	// one the last scene made the same way is taken over with its textures
+	std::shared_ptr<Material> pMaterial = takeMaterial(name, sourceHash);
+	if (!pMaterial) {
 		if (MapHas(Value, "type")) {
 			if (Value["type"] == "Opaque")
 				pMaterial = _engine.createMaterial(name, Material::Type::OPAQUE, _opaqueVert, _opaqueFrag);
@@ -173,6 +679,8 @@ void Scene::loadMaterials() {
 			std::cerr << "Warning: Material type unspecified." << std::endl;
 			pMaterial = _engine.createMaterial(name, Material::Type::OPAQUE, _opaqueVert, _opaqueFrag);
 		}
+		pMaterial->sourceHash = sourceHash;
+		addMaterial(pMaterial);
 		if (MapHas(Value, "offset")) {
 			pMaterial->pushConstants.offsetTilling.x = Value["offset"][0];
 			pMaterial->pushConstants.offsetTilling.y = Value["offset"][1];
@@ -194,103 +702,605 @@ void Scene::loadMaterials() {
 			pMaterial->pushConstants.emission.z = Value["emission"][2];
 			pMaterial->pushConstants.emission.w = Value["emission"][3];
 		}
-		if (MapHas(Value, "baseTex")) {
-			std::string path = Value["baseTex"];
-			if (!doesFileExist(path)) {
-				if (doesFileExist(filePath + "/" + path))
-					path = filePath + "/" + path;
-				else
-					throw std::runtime_error(std::string("Error: ") + path + " does not exist.");
+	}
+	if (MapHas(source, "baseTex")) {
+		const std::string path = source["baseTex"];
+		requestTexture(pMaterial, 0, "base", true, getFileName(path), TextureUsage::COLOR,
+			TextureStreamer::fileDecoder(path, TextureUsage::COLOR, compress));
+	}
+	if (MapHas(source, "normalTex")) {
+		const std::string path = source["normalTex"];
+		requestTexture(pMaterial, 1, "base", false, getFileName(path), TextureUsage::NORMAL,
+			TextureStreamer::fileDecoder(path, TextureUsage::NORMAL, compress));
+	}
+	if (echo) {
+		std::cout << "\tmaterial " << name << " loaded." << std::endl;
+	}
+}
+
+void Scene::loadGltf(std::shared_ptr<Object> pRoot, const std::string& gltfPath, const nlohmann::json& values) {
+	// textures decode after this returns, the file stays mapped until they're done
+	auto pGltf = std::make_shared<GltfData>();
+	GltfData& gltf = *pGltf;
+	std::string warn;
+	if (!GltfData::parse(&gltf, gltfPath, &warn))
+		throw std::runtime_error(std::string("Error: Failed to load ") + gltfPath + ": " + warn);
+	if (!warn.empty())
+		std::cerr << "Warning: " << gltfPath << ": " << warn;
+
+	// a material given in the scene replaces the ones of the file
+	std::shared_ptr<Material> pOverride;
+	if (MapHas(values, "material")) {
+		std::string mtlName = values["material"];
+		if (!_engine.resources.exist<Material>(mtlName))
+			throw std::runtime_error("Error: material " + mtlName + " isn't loaded.");
+		pOverride = _engine.resources.get<Material>(mtlName);
+	}
+
+	const std::string fileName = getFileName(gltfPath);
+	auto modelName = [&](uint32_t mesh, uint32_t primitive) {
+		return fileName + ":" + std::to_string(mesh) + "." + std::to_string(primitive) + ":" + gltf.meshName(mesh);
+	};
+
+	// every primitive is loading before the first one is waited for
+	std::map<std::string, Engine::PendingModel> pending;
+	for (const auto& instance : gltf.instances()) {
+		for (uint32_t i = 0; i < gltf.primitiveCount(instance.mesh); i++) {
+			const std::string name = modelName(instance.mesh, i);
+			if (!MapHas(pending, name) && !_engine.resources.exist<Model>(name))
+				pending.emplace(name, _engine.requestModel(name, gltf, instance.mesh, i));
+		}
+	}
+	try {
+		for (const auto& instance : gltf.instances()) {
+			// nodes are flattened, their transforms are baked into the objects
+			glm::vec3 position, scale, rotation;
+			Object::decomposeTransformMat(pRoot->transformMat() * instance.transform, &position, &scale, &rotation);
+
+			for (uint32_t i = 0; i < gltf.primitiveCount(instance.mesh); i++) {
+				// models are shared by all nodes and scene objects that use the same primitive
+				auto itr = pending.find(modelName(instance.mesh, i));
+				auto pModel = itr != pending.end() ?
+					finishModel(itr->second) :
+					_engine.resources.get<Model>(modelName(instance.mesh, i));
+				if (pModel->indexCount() == 0) continue;
+
+				const std::string name = pRoot->name() + ":" + std::to_string(instance.node) + "." + std::to_string(i) + ":" + instance.name;
+				auto pObject = _engine.createObject(name, Object::Type::MESH);
+				_objects.push_back(pObject);
+				_gltfObjects[pRoot->name()].push_back(pObject);
+				pObject->_active = pRoot->isActive();
+				pObject->setTransform(position, rotation, scale);
+				pObject->model = pModel;
+				_vertCount += pModel->vertexCount();
+				_faceCount += pModel->indexCount() / 3;
+				_modelCount += 1;
+
+				auto pMaterial = pOverride ? pOverride : loadGltfMaterial(pGltf, gltf.primitiveMaterial(instance.mesh, i));
+				pObject->material = pMaterial;
+				_engine.resources.addCollect<Material, Object>(pMaterial->id(), pObject->id());
+				if (pMaterial->type() == Material::Type::TRANSPARENT)
+					_engine.transparents.insert(pObject->id());
+				_objectCount += 1;
 			}
-			auto pImage = _engine.createImage(path);
-			auto pTex = std::make_shared<Texture>(
-				*_engine.pDevice,
-				"base",
-				pImage,
-				true);
-			pMaterial->changeTexture(0, pTex);
-		}
-		if (MapHas(Value, "normalTex")) {
-			std::string path = Value["normalTex"];
-			if (!doesFileExist(path)) {
-				if (doesFileExist(filePath + "/" + path))
-					path = filePath + "/" + path;
-				else
-					throw std::runtime_error(std::string("Error: ") + path + " does not exist.");
+		}
+	}
+	catch (...) {
+		// the workers read the gltf, which goes away with this, and the models copied into
+		// by the upload batch too
+		for (auto& pair : pending) {
+			if (pair.second.loading.valid()) pair.second.loading.wait();
+		}
+		if (_engine.pDevice->uploadBatch) _engine.pDevice->uploadBatch->submit();
+		_engine.loadingModels.clear();
+		throw;
+	}
+	if (echo) {
+		std::cout << "\t" << fileName << " expanded into " << pRoot->name() << "." << std::endl;
+	}
+}
+
+std::shared_ptr<Material> Scene::loadGltfMaterial(std::shared_ptr<const GltfData> pGltf, int32_t material) {
+	const GltfData& gltf = *pGltf;
+	const std::string fileName = getFileName(gltf.filePath);
+	const std::string name = material < 0 ?
+		fileName + ":default" :
+		fileName + ":" + std::to_string(material) + ":" + gltf.materialName(material);
+	// shared by the objects of the file, and by the scenes that load the same file
+	const uint64_t sourceHash = hashMemory(gltf.filePath.data(), gltf.filePath.size(), static_cast<uint64_t>(material) + 1);
+	if (auto pShared = takeMaterial(name, sourceHash))
+		return pShared;
+	if (material < 0) {
+		auto pDefault = _engine.createMaterial(name, Material::Type::OPAQUE, _opaqueVert, _opaqueFrag);
+		pDefault->sourceHash = sourceHash;
+		addMaterial(pDefault);
+		return pDefault;
+	}
+
+	const auto& value = gltf.json["materials"][material];
+	std::shared_ptr<Material> pMaterial;
+	if (value.value("alphaMode", "OPAQUE") == "BLEND")
+		pMaterial = _engine.createMaterial(name, Material::Type::TRANSPARENT, _transparentVert, _transparentFrag);
+	else
+		pMaterial = _engine.createMaterial(name, Material::Type::OPAQUE, _opaqueVert, _opaqueFrag);
+	pMaterial->sourceHash = sourceHash;
+	addMaterial(pMaterial);
+	auto& push = pMaterial->pushConstants;
+	push.side = value.value("doubleSided", false) ? -1 : 0;
+
+	const auto pbr = value.value("pbrMetallicRoughness", nlohmann::json::object());
+	if (MapHas(pbr, "baseColorFactor")) {
+		const auto& factor = pbr["baseColorFactor"];
+		push.albedo = glm::vec4{ factor[0], factor[1], factor[2], factor[3] };
+	}
+	push.metalness = pbr.value("metallicFactor", 1.f);
+	push.roughness = pbr.value("roughnessFactor", 1.f);
+	if (MapHas(value, "emissiveFactor")) {
+		const auto& factor = value["emissiveFactor"];
+		const glm::vec3 emission{ factor[0], factor[1], factor[2] };
+		float strength = 1.f;
+		if (MapHas(value, "extensions") && MapHas(value["extensions"], "KHR_materials_emissive_strength"))
+			strength = value["extensions"]["KHR_materials_emissive_strength"].value("emissiveStrength", 1.f);
+		if (emission != glm::vec3{ 0.f })
+			push.emission = glm::vec4{ emission, strength };
+	}
+
+	if (MapHas(pbr, "baseColorTexture"))
+		loadGltfTexture(pGltf, pbr["baseColorTexture"], pMaterial, 0, "base", true, TextureUsage::COLOR);
+	if (MapHas(value, "normalTexture"))
+		loadGltfTexture(pGltf, value["normalTexture"], pMaterial, 1, "normal", false, TextureUsage::NORMAL);
+	// gltf packs roughness into green and metalness into blue, the shaders read them from red
+	if (MapHas(pbr, "metallicRoughnessTexture")) {
+		loadGltfTexture(pGltf, pbr["metallicRoughnessTexture"], pMaterial, 2, "metalness", false, TextureUsage::MASK, 2);
+		loadGltfTexture(pGltf, pbr["metallicRoughnessTexture"], pMaterial, 3, "roughness", false, TextureUsage::MASK, 1);
+	}
+	if (MapHas(value, "occlusionTexture"))
+		loadGltfTexture(pGltf, value["occlusionTexture"], pMaterial, 4, "occlusion", false, TextureUsage::MASK);
+	if (push.emission.w > 0.f && MapHas(value, "emissiveTexture"))
+		loadGltfTexture(pGltf, value["emissiveTexture"], pMaterial, 5, "emission", true, TextureUsage::COLOR);
+
+	if (echo) {
+		std::cout << "\tmaterial " << name << " loaded." << std::endl;
+	}
+	return pMaterial;
+}
+
+void Scene::loadGltfTexture(
+	std::shared_ptr<const GltfData> pGltf,
+	const nlohmann::json& textureInfo,
+	std::shared_ptr<Material> pMaterial,
+	uint32_t binding,
+	const std::string& name,
+	bool anisotropic,
+	TextureUsage usage,
+	int channel) {
+	const GltfData& gltf = *pGltf;
+	const int32_t image = gltf.textureImage(textureInfo.value("index", 0u));
+	if (image < 0) return;
+	if (textureInfo.value("texCoord", 0) != 0)
+		std::cerr << "Warning: " << gltf.filePath << ": only the first uv set is supported." << std::endl;
+
+	std::string imageName = getFileName(gltf.filePath) + ":" + std::to_string(image) + ":" + gltf.imageName(image);
+	if (channel >= 0) imageName += std::string(".") + "rgba"[channel];
+
+	const bool compress = _engine.compressTextures && _engine.pDevice->textureCompressionBC && !_engine.virtualTexturing;
+	auto decoder = [pGltf, image, usage, channel, compress](TextureStreamer::Payload* payload) {
+		// a cooked image is found by its encoded bytes, so it loads without decoding the source
+		const uint32_t usageKey = static_cast<uint32_t>(usage);
+		const int32_t key[2]{ image, channel };
+		const uint64_t sourceHash = compress ? hashMemory(key, sizeof(key), pGltf->imageHash(image)) : 0;
+		std::string cookedPath;
+		if (compress && doesFileExist(cookedPath = TextureCooker::cachePath(sourceHash, usage))) {
+			payload->ktx2 = std::make_unique<Ktx2>(cookedPath);
+			payload->hash = hashMemory(&usageKey, sizeof(usageKey), sourceHash);
+			return true;
+		}
+		std::string warn;
+		if (!pGltf->loadImage(image, &payload->pixels, &payload->width, &payload->height, &warn)) {
+			std::cerr << "Warning: " << pGltf->filePath << ": " << warn;
+			return false;
+		}
+		auto& pixels = payload->pixels;
+		if (channel >= 0) {
+			for (size_t i = 0; i < pixels.size(); i += 4) {
+				const unsigned char v = pixels[i + channel];
+				pixels[i] = pixels[i + 1] = pixels[i + 2] = v;
+				pixels[i + 3] = 255;
 			}
-			auto pImage = _engine.createImage(path);
-			auto pTex = std::make_shared<Texture>(
-				*_engine.pDevice,
-				"base",
-				pImage,
-				false);
-			pMaterial->changeTexture(1, pTex);
 		}
-		if (echo) {
-			std::cout << "\tmaterial " << name << " loaded." << std::endl;
+		if (compress && !(cookedPath = TextureCooker::cook(pixels.data(), payload->width, payload->height, usage, sourceHash)).empty()) {
+			payload->ktx2 = std::make_unique<Ktx2>(cookedPath);
+			payload->hash = hashMemory(&usageKey, sizeof(usageKey), sourceHash);
+			pixels.clear();
+			return true;
 		}
+		payload->hash = hashMemory(pixels.data(), pixels.size(), 4);
+		return true;
+	};
+	requestTexture(pMaterial, binding, name, anisotropic, imageName, usage, decoder);
+}
+
+void Scene::requestTexture(
+	std::shared_ptr<Material> pMaterial,
+	uint32_t binding,
+	const std::string& textureName,
+	bool anisotropic,
+	const std::string& imageName,
+	TextureUsage usage,
+	TextureStreamer::Decoder decoder) {
+	_textureRequests.push_back({ pMaterial, binding, textureName, anisotropic, imageName, usage, decoder });
+	// a material taken over from another scene samples it already
+	const auto& pTex = pMaterial->_textures[binding];
+	if (pMaterial->pushConstants.virtualSlot[binding] >= 0 || (pTex && pTex->_pImage && pTex->_pImage->name() == imageName))
+		return;
+	if (_engine.virtualTexturing)
+		_engine.pVirtualTextures->request(pMaterial, binding, textureName, anisotropic, imageName, decoder);
+	else
+		_engine.pTextureStreamer->request(pMaterial, binding, textureName, anisotropic, imageName, decoder);
+}
+
+void Scene::loadLight(const std::string& name, nlohmann::json& values, float* importance) {
+	std::string type = values["type"];
+	std::shared_ptr<Light> pLight;
+	if (type == "point") {
+		pLight = _engine.createLight(name, Light::Type::POINT);
+	}
+	if (type == "spot") {
+		pLight = _engine.createLight(name, Light::Type::SPOT);
+	}
+	if (type == "directional") {
+		pLight = _engine.createLight(name, Light::Type::DIRECTIONAL);
+	}
+	_lights.push_back(pLight);
+	if (MapHas(values, "shadowmap")) {
+		if (values["shadowmap"]) {
+			pLight->lightInfo.shadowmap = 1;
+		}
+		else pLight->lightInfo.shadowmap = -1;
+	}
+	if (MapHas(values, "contact shadow")) {
+		pLight->lightInfo.contactShadow = values["contact shadow"];
+	}
+	if (MapHas(values, "importance")) {
+		pLight->importance = values["importance"];
+	}
+	else pLight->importance = (*importance)--;
+	if (MapHas(values, "active"))
+		pLight->_active = values["active"];
+	if (MapHas(values, "radius")) {
+		pLight->setRadius(values["radius"]);
+	}
+	if (MapHas(values, "outer angle")) {
+		pLight->setOuterAngle(values["outer angle"]);
+		if (MapHas(values, "inner angle"))
+			pLight->lightInfo.innerAngleRatio = glm::clamp((float)values["inner angle"] / (float)values["outer angle"], 0.f, 1.f);
+	}
+	if (MapHas(values, "inner angle ratio"))
+		pLight->lightInfo.innerAngleRatio = values["innerAngleRatio"];
+	if (MapHas(values, "position"))
+		pLight->setPosition(values["position"][0], values["position"][1], values["position"][2]);
+	if (MapHas(values, "rotation"))
+		pLight->setRotation(values["rotation"][0], values["rotation"][1], values["rotation"][2]);
+	if (MapHas(values, "direction"))
+		pLight->setDirection(values["direction"][0], values["direction"][1], values["direction"][2]);
+	if (MapHas(values, "emission"))
+		pLight->setEmission(values["emission"][0], values["emission"][1], values["emission"][2], values["emission"][3]);
+	if (echo) {
+		auto pos = pLight->position();
+		std::cout << "\tLight " << name << " loaded. position: ("
+			<< pos.x << " " << pos.y << " " << pos.z << ")." << std::endl;
 	}
 }
 
-void Scene::loadLights() {
-	float importance = MAX_LIGHT_NUM;
-	for (auto& item : _j["lights"].items()) {
-		std::string name = item.key();
-		std::string type = item.value()["type"];
-		auto& values = item.value();
-		std::shared_ptr<Light> pLight;
-		if (type == "point") {
-			pLight = _engine.createLight(name, Light::Type::POINT);
+bool Scene::loadPackage() {
+	const std::string path = packagePath();
+	if (!doesFileExist(path)) return false;
+	// shared by the decoders, the file stays mapped until the last texture is read
+	std::shared_ptr<const ScenePackage> pPackage;
+	try {
+		pPackage = std::make_shared<const ScenePackage>(path);
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Warning: " << e.what() << " scene.json is loaded instead." << std::endl;
+		return false;
+	}
+	const ScenePackage& package = *pPackage;
+	if (_sourceHash != 0 && package.header().sourceHash != _sourceHash) {
+		std::cerr << "Warning: " << path << " wasn't cooked from the current scene.json, which is loaded instead." << std::endl;
+		return false;
+	}
+	_loadedFromPackage = true;
+
+	_j = nlohmann::json::parse(package.settings());
+	loadGraphics(_j["graphics"]);
+	loadCamera();
+	if (hotReload) {
+		parseJson(filePath + "/scene.json", [this](const std::string& section, const std::string& name, nlohmann::json& values) {
+			_entryHashes[section][name] = hashEntry(values);
+			return true;
+		}, nullptr);
+	}
+
+	// vertices and indices are copied from the mapping into the staging buffers
+	std::vector<std::shared_ptr<Model>> models(package.modelCount());
+	for (uint32_t i = 0; i < package.modelCount(); i++) {
+		const std::string name = package.string(package.model(i).name);
+		models[i] = _engine.resources.exist<Model>(name) ?
+			_engine.resources.get<Model>(name) :
+			_engine.createModel(name, *package.loadMesh(i));
+	}
+
+	// so are the mips, by the streamer. virtual textures are cut from plain pixels, which the
+	// finest level of an uncompressed texture is
+	const bool virtualTexturing = _engine.virtualTexturing;
+	std::vector<std::shared_ptr<Material>> materials(package.materialCount());
+	for (uint32_t i = 0; i < package.materialCount(); i++) {
+		const auto& record = package.material(i);
+		const std::string name = package.string(record.name);
+		// the record without its offsets into this package, and the contents it samples
+		ScenePackage::MaterialRecord key = record;
+		key.name = key.firstBinding = 0;
+		uint64_t sourceHash = hashMemory(&key, sizeof(key));
+		for (uint32_t b = record.firstBinding; b < record.firstBinding + record.bindingCount; b++) {
+			const auto& binding = package.binding(b);
+			const uint64_t bindingKey[3]{ binding.binding, binding.anisotropic, package.texture(binding.texture).hash };
+			sourceHash = hashMemory(bindingKey, sizeof(bindingKey), sourceHash);
+		}
+		auto pMaterial = takeMaterial(name, sourceHash);
+		if (!pMaterial) {
+			pMaterial = record.type == Material::Type::TRANSPARENT ?
+				_engine.createMaterial(name, Material::Type::TRANSPARENT, _transparentVert, _transparentFrag) :
+				_engine.createMaterial(name, Material::Type::OPAQUE, _opaqueVert, _opaqueFrag);
+			pMaterial->sourceHash = sourceHash;
+			addMaterial(pMaterial);
+			auto& push = pMaterial->pushConstants;
+			push.albedo = record.albedo;
+			push.emission = record.emission;
+			push.offsetTilling = record.offsetTilling;
+			push.metalness = record.metalness;
+			push.roughness = record.roughness;
+			push.ior = record.ior;
+			push.side = record.side;
+			push.alphaMode = record.alphaMode;
 		}
-		if (type == "spot") {
-			pLight = _engine.createLight(name, Light::Type::SPOT);
+		for (uint32_t b = record.firstBinding; b < record.firstBinding + record.bindingCount; b++) {
+			const auto& binding = package.binding(b);
+			const uint32_t texture = binding.texture;
+			requestTexture(pMaterial, binding.binding, package.string(binding.name), binding.anisotropic != 0,
+				package.string(package.texture(texture).name),
+				static_cast<TextureUsage>(package.texture(texture).usage),
+				[pPackage, texture, virtualTexturing](TextureStreamer::Payload* payload) {
+					payload->ktx2 = pPackage->loadTexture(texture);
+					payload->hash = pPackage->texture(texture).hash;
+					const Ktx2& ktx2 = *payload->ktx2;
+					if (virtualTexturing && ktx2.format() == VK_FORMAT_R8G8B8A8_UNORM) {
+						payload->pixels.assign(ktx2.level(0), ktx2.level(0) + ktx2.levelSize(0));
+						payload->width = static_cast<int>(ktx2.width());
+						payload->height = static_cast<int>(ktx2.height());
+						payload->ktx2.reset();
+					}
+					return true;
+				});
 		}
-		if (type == "directional") {
-			pLight = _engine.createLight(name, Light::Type::DIRECTIONAL);
+		materials[i] = pMaterial;
+	}
+
+	for (uint32_t i = 0; i < package.objectCount(); i++) {
+		const auto& record = package.object(i);
+		auto pObject = _engine.createObject(package.string(record.name), Object::Type::MESH);
+		_objects.push_back(pObject);
+		// objects expanded from a gltf file are named after the object that has it
+		const std::string& name = pObject->name();
+		const size_t colon = name.find(':');
+		if (colon != std::string::npos && _engine.resources.exist<Object>(name.substr(0, colon)))
+			_gltfObjects[name.substr(0, colon)].push_back(pObject);
+		pObject->_active = record.active != 0;
+		pObject->setTransform(record.position, record.rotation, record.scale);
+		if (record.model != ScenePackage::NONE) {
+			auto& pModel = models[record.model];
+			pObject->model = pModel;
+			_vertCount += pModel->vertexCount();
+			_faceCount += pModel->indexCount() / 3;
+			_modelCount += 1;
 		}
-		if (MapHas(values, "shadowmap")) {
-			if (values["shadowmap"]) {
-				pLight->lightInfo.shadowmap = 1;
+		if (record.material != ScenePackage::NONE) {
+			auto& pMaterial = materials[record.material];
+			pObject->material = pMaterial;
+			_engine.resources.addCollect<Material, Object>(pMaterial->id(), pObject->id());
+			if (pMaterial->type() == Material::Type::TRANSPARENT)
+				_engine.transparents.insert(pObject->id());
+		}
+		_objectCount += 1;
+	}
+
+	for (uint32_t i = 0; i < package.lightCount(); i++) {
+		const auto& record = package.light(i);
+		auto pLight = _engine.createLight(package.string(record.name), static_cast<Light::Type>(record.type));
+		_lights.push_back(pLight);
+		pLight->lightInfo = record.info;
+		pLight->importance = record.importance;
+		pLight->_active = record.active != 0;
+		pLight->updateProjection();
+		pLight->setPosition(record.position);
+		pLight->setRotation(record.rotation);
+	}
+
+	if (echo) {
+		std::cout << "\tPackage " << path << ": " << package.modelCount() << " models, "
+			<< package.textureCount() << " textures, " << package.materialCount() << " materials, "
+			<< package.objectCount() << " objects, " << package.lightCount() << " lights." << std::endl;
+	}
+	return true;
+}
+
+bool Scene::save(bool forceWrite) {
+	const std::string path = packagePath();
+	if (_loadedFromPackage) {
+		std::cerr << "Warning: " << filePath << " was loaded from its package, load scene.json to cook it again." << std::endl;
+		return false;
+	}
+	if (_sourceHash == 0) {
+		std::cerr << "Error: Failed to save scene " << filePath << ". It isn't loaded from a scene.json." << std::endl;
+		return false;
+	}
+	if (!forceWrite && doesFileExist(path)) {
+		try {
+			if (ScenePackage{ path }.header().sourceHash == _sourceHash) return true;
+		}
+		catch (const std::exception&) {} // cooked again below
+	}
+
+	try {
+		ScenePackage::Writer writer{ path };
+
+		// the processed meshes are the mesh cache files the models were loaded from
+		std::unordered_map<const Model*, uint32_t> models;
+		for (const auto& pObject : _objects) {
+			const Model* pModel = pObject->model.get();
+			if (!pModel || MapHas(models, pModel)) continue;
+			const std::string cachePath = pModel->cachePath();
+			if (cachePath.empty() || !doesFileExist(cachePath)) {
+				std::cerr << "Error: Failed to save scene " << filePath << ". Model " << pModel->name() << " has no mesh cache." << std::endl;
+				return false;
 			}
-			else pLight->lightInfo.shadowmap = -1;
+			MappedFile cache{ cachePath };
+			models[pModel] = writer.addModel(pModel->name(), cache.data(), cache.size());
 		}
-		if (MapHas(values, "contact shadow")) {
-			pLight->lightInfo.contactShadow = values["contact shadow"];
+
+		// requested images are decoded again on the pool and stored as ktx2 files, a batch at a
+		// time so only a few are held at once
+		const bool compress = _engine.compressTextures && _engine.pDevice->textureCompressionBC && !_engine.virtualTexturing;
+		std::unordered_map<std::string, uint32_t> textures;
+		std::vector<const TextureRequest*> images;
+		for (const auto& request : _textureRequests) {
+			if (MapHas(textures, request.imageName)) continue;
+			textures[request.imageName] = ScenePackage::NONE;
+			images.push_back(&request);
 		}
-		if (MapHas(values, "importance")) {
-			pLight->importance = values["importance"];
+		ThreadPool& pool = ThreadPool::shared();
+		const size_t batchSize = std::max<size_t>(pool.threadCount(), 1);
+		for (size_t first = 0; first < images.size(); first += batchSize) {
+			const size_t count = std::min(batchSize, images.size() - first);
+			std::vector<std::string> encoded(count);
+			std::vector<uint64_t> hashes(count);
+			std::vector<std::future<bool>> done;
+			for (size_t i = 0; i < count; i++) {
+				done.push_back(pool.submit([&, i]() {
+					const TextureRequest& request = *images[first + i];
+					TextureStreamer::Payload payload;
+					try {
+						if (!request.decoder(&payload)) return false;
+					}
+					catch (const std::exception& e) {
+						std::cerr << "Warning: " << e.what() << std::endl;
+						return false;
+					}
+					hashes[i] = payload.hash;
+					return ScenePackage::encodeTexture(payload, request.usage, compress, &encoded[i]);
+				}));
+			}
+			for (size_t i = 0; i < count; i++) {
+				const TextureRequest& request = *images[first + i];
+				if (!done[i].get()) {
+					std::cerr << "Warning: Image " << request.imageName << " can not be loaded, it's left out of the package." << std::endl;
+					continue;
+				}
+				textures[request.imageName] = writer.addTexture(
+					request.imageName, request.usage, hashes[i], encoded[i].data(), encoded[i].size());
+			}
 		}
-		else pLight->importance = importance--;
-		if (MapHas(values, "active"))
-			pLight->_active = values["active"];
-		if (MapHas(values, "radius")) {
-			pLight->setRadius(values["radius"]);
-		}
-		if (MapHas(values, "outer angle")) {
-			pLight->setOuterAngle(values["outer angle"]);
-			if (MapHas(values, "inner angle"))
-				pLight->lightInfo.innerAngleRatio = glm::clamp((float)values["inner angle"] / (float)values["outer angle"], 0.f, 1.f);
-		}
-		if (MapHas(values, "inner angle ratio"))
-			pLight->lightInfo.innerAngleRatio = values["innerAngleRatio"];
-		if (MapHas(values, "position"))
-			pLight->setPosition(values["position"][0], values["position"][1], values["position"][2]);
-		if (MapHas(values, "rotation"))
-			pLight->setRotation(values["rotation"][0], values["rotation"][1], values["rotation"][2]);
-		if (MapHas(values, "direction"))
-			pLight->setDirection(values["direction"][0], values["direction"][1], values["direction"][2]);
-		if (MapHas(values, "emission"))
-			pLight->setEmission(values["emission"][0], values["emission"][1], values["emission"][2], values["emission"][3]);
-		if (echo) {
-			auto pos = pLight->position();
-			std::cout << "\tLight " << name << " loaded. position: ("
-				<< pos.x << " " << pos.y << " " << pos.z << ")." << std::endl;
+
+		std::unordered_map<const Material*, uint32_t> materials;
+		for (const auto& pMaterial : _materials) {
+			if (MapHas(materials, pMaterial.get())) continue;
+			std::vector<ScenePackage::BindingRecord> bindings;
+			for (const auto& request : _textureRequests) {
+				const uint32_t texture = textures[request.imageName];
+				if (request.material != pMaterial || texture == ScenePackage::NONE) continue;
+				bindings.push_back({ request.binding, writer.addString(request.textureName), texture, request.anisotropic ? 1u : 0u });
+			}
+			const auto& push = pMaterial->pushConstants;
+			ScenePackage::MaterialRecord record{};
+			record.name = writer.addString(pMaterial->name());
+			record.type = pMaterial->type();
+			record.albedo = push.albedo;
+			record.emission = push.emission;
+			record.offsetTilling = push.offsetTilling;
+			record.metalness = push.metalness;
+			record.roughness = push.roughness;
+			record.ior = push.ior;
+			record.side = push.side;
+			record.alphaMode = push.alphaMode;
+			materials[pMaterial.get()] = writer.addMaterial(record, bindings);
+		}
+
+		for (const auto& pObject : _objects) {
+			ScenePackage::ObjectRecord record{};
+			record.name = writer.addString(pObject->name());
+			record.model = pObject->model ? models[pObject->model.get()] : ScenePackage::NONE;
+			record.material = ScenePackage::NONE;
+			if (pObject->material) {
+				auto itr = materials.find(pObject->material.get());
+				if (itr != materials.end()) record.material = itr->second;
+				else std::cerr << "Warning: Material of object " << pObject->name() << " isn't part of the scene, it's left out." << std::endl;
+			}
+			record.active = pObject->isActive() ? 1 : 0;
+			record.position = pObject->position();
+			record.rotation = pObject->rotation();
+			record.scale = pObject->scale();
+			writer.addObject(record);
+		}
+
+		for (const auto& pLight : _lights) {
+			if (!pLight) continue;
+			ScenePackage::LightRecord record{};
+			record.name = writer.addString(pLight->name());
+			record.type = pLight->type();
+			record.active = pLight->isActive() ? 1 : 0;
+			record.importance = pLight->importance;
+			record.position = pLight->position();
+			record.rotation = pLight->rotation();
+			record.info = pLight->lightInfo;
+			writer.addLight(record);
 		}
+
+		// what the package doesn't hold records of is read from json as before
+		nlohmann::json settings = nlohmann::json::object();
+		if (MapHas(_j, "graphics")) settings["graphics"] = _j["graphics"];
+		if (MapHas(_j, "cameras")) settings["cameras"] = _j["cameras"];
+		if (!writer.finish(_sourceHash, settings.dump())) return false;
 	}
+	catch (const std::exception& e) {
+		std::cerr << "Error: Failed to save scene " << filePath << ". " << e.what() << std::endl;
+		return false;
+	}
+	return true;
 }
 
 void Scene::clear() {
-	//TODO
+	for (auto& pObject : _objects) _engine.removeObject(pObject);
+	for (auto& pLight : _lights) _engine.removeLight(pLight);
+	for (auto& pCamera : _cameras) _engine.removeCamera(pCamera);
+	for (auto& pMaterial : _materials) _engine.resources.release<Material>(pMaterial->id());
+	for (ResId id : _heldModels) _engine.resources.release<Model>(id);
+	_heldModels.clear();
+	_objects.clear();
+	_lights.clear();
+	_cameras.clear();
+	_materials.clear();
+	_textureRequests.clear();
+	_gltfObjects.clear();
+	_entryHashes.clear();
+	_modelCount = _objectCount = _vertCount = _faceCount = 0;
+	_importance = MAX_LIGHT_NUM;
+	_j = nlohmann::json{};
+}
+
+void Scene::unload() {
+	vkDeviceWaitIdle(_engine.device());
+	clear();
+	_engine.resetEnvironment();
+	_freed = _engine.freeUnused();
 }
 
 }
\ No newline at end of file
@@ -2,9 +2,13 @@
 #define SCENE_HPP
 
 #include "utils/engine.hpp"
+#include "resources/gltf_parser.hpp"
+#include "resources/texture_streamer.hpp"
 
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <functional>
 
 namespace naku {
 
@@ -15,18 +19,47 @@ public:
 	Scene(const Scene&) = delete;
 	void operator=(const Scene&) = delete;
 
+	static constexpr char PACKAGE_NAME[] = "scene.pack";
+
+	// loads the package next to scene.json if it was cooked from it, else scene.json. what
+	// the scene held before and the new one doesn't use is freed afterwards
 	void load();
-	void save(bool forceWrite = true);
+	// loads the scene at path in place of this one and reports how long it took. models,
+	// materials and images both scenes use stay resident, only the rest is freed or loaded
+	void switchTo(const std::string& path);
+	// cooks the scene loaded from scene.json into its package. without forceWrite a package
+	// cooked from the same scene.json is kept. false if it can't be written
+	bool save(bool forceWrite = true);
+	std::string packagePath() const { return filePath + "/" + PACKAGE_NAME; }
+	bool loadedFromPackage() const { return _loadedFromPackage; }
 
 	uint32_t modelCount() const { return _modelCount; }
 	uint32_t objectCount() const { return _objectCount; }
 	uint32_t vertexCount() const { return _vertCount; }
 	uint32_t faceCount() const { return _faceCount; }
 
+	// removes the objects, lights and cameras of the scene and releases the models and
+	// materials it held. they stay resident for the next load to take up
 	void clear();
+	// clears the scene and frees what no other scene holds
+	void unload();
+	// looks at scene.json at most this often, in milliseconds
+	static constexpr uint32_t POLL_INTERVAL = 250;
+	// applies the edits of scene.json once its time changes. call it every frame, true if the
+	// scene changed
+	bool poll();
+	// adds, removes and loads again the materials, objects and lights whose entries changed
+	// since scene.json was read, and the cameras if they did. models and images in use stay
+	// resident. a file that doesn't parse leaves the scene as it is, false then
+	bool reload();
 
 	std::string filePath;
 	bool echo{ false };
+	// off to always read scene.json
+	bool usePackage{ true };
+	// remembers what each entry of scene.json held, which poll and reload compare against.
+	// set before load
+	bool hotReload{ false };
 	std::unordered_map<std::string, std::shared_ptr<Model>> InternalMeshs;
 
 private:
@@ -38,12 +71,99 @@ private:
 	nlohmann::json _j;
 	uint32_t _modelCount{ 0 }, _objectCount{ 0 }, _vertCount{ 0 }, _faceCount{ 0 };
 
+	// what the last load created, in order. save writes the package from it
+	struct TextureRequest {
+		std::shared_ptr<Material> material;
+		uint32_t binding;
+		std::string textureName;
+		bool anisotropic;
+		std::string imageName;
+		TextureUsage usage;
+		TextureStreamer::Decoder decoder;
+	};
+	std::vector<std::shared_ptr<Material>> _materials;
+	std::vector<std::shared_ptr<Object>> _objects;
+	std::vector<std::shared_ptr<Light>> _lights;
+	std::vector<TextureRequest> _textureRequests;
+	uint64_t _sourceHash{ 0 };
+	bool _loadedFromPackage{ false };
+	// obj models loading on the thread pool while the rest is read, by name, with their objects
+	struct ModelRequest {
+		Engine::PendingModel pending{};
+		std::vector<std::shared_ptr<Object>> objects{};
+	};
+	std::map<std::string, ModelRequest> _modelRequests;
+	std::vector<std::shared_ptr<Camera>> _cameras;
+	// models of _objects, each held once. the materials held are _materials
+	std::unordered_set<ResId> _heldModels;
+	Engine::FreedContent _freed;
+	// objects expanded from the gltf file of an object, by its name
+	std::unordered_map<std::string, std::vector<std::shared_ptr<Object>>> _gltfObjects;
+	// of the materials, objects and lights of scene.json, by section and name
+	std::unordered_map<std::string, std::unordered_map<std::string, uint64_t>> _entryHashes;
+	// given to lights without one, counting down
+	float _importance{ MAX_LIGHT_NUM };
+	std::filesystem::file_time_type _jsonTime;
+	std::chrono::steady_clock::time_point _lastPoll;
 
-	void loadGraphics();
+	// streams scene.json, creating what it describes entry by entry
+	void loadJson(const std::string& jsonPath);
+	// calls onEntry with every material, object and light as it's parsed, and onGraphics with
+	// the graphics. the entries onEntry returns true for are dropped from the result
+	using EntryCallback = std::function<bool(const std::string& section, const std::string& name, nlohmann::json& values)>;
+	static nlohmann::json parseJson(
+		const std::string& jsonPath,
+		const EntryCallback& onEntry,
+		const std::function<void(nlohmann::json& graphics)>& onGraphics);
+	static uint64_t hashEntry(const nlohmann::json& values);
+	void loadGraphics(nlohmann::json& graphics);
 	void loadCamera();
-	void loadObjects();
-	void loadLights();
-	void loadMaterials();
+	void loadObject(const std::string& name, nlohmann::json& values);
+	void loadLight(const std::string& name, nlohmann::json& values, float* importance);
+	void loadMaterial(const std::string& name, nlohmann::json& Value);
+	// gives the requested models to their objects
+	void finishModels();
+	// finishes one request. with echo on, a model that was just optimized reports its stats
+	std::shared_ptr<Model> finishModel(Engine::PendingModel& pending);
+	// waits for what's still loading after a failure, without registering it
+	void abandonModels();
+	// takes the model, material and gltf objects from an object about to be loaded again
+	void detachObject(const std::shared_ptr<Object>& pObject);
+	void removeObject(const std::shared_ptr<Object>& pObject);
+	void removeLight(const std::shared_ptr<Light>& pLight);
+	void removeMaterial(const std::shared_ptr<Material>& pMaterial);
+	// holds the material for the scene
+	void addMaterial(const std::shared_ptr<Material>& pMaterial);
+	// the material of this name if it was made from source, held for the scene. null if
+	// there's none, one made from something else is freed if nobody holds it
+	std::shared_ptr<Material> takeMaterial(const std::string& name, uint64_t source);
+	// holds the models the objects use now and releases the others
+	void holdModels();
+	// false if there's no package cooked from the current scene.json, nothing is loaded then
+	bool loadPackage();
+	// expands the nodes of a gltf file into objects placed relative to pRoot
+	void loadGltf(std::shared_ptr<Object> pRoot, const std::string& gltfPath, const nlohmann::json& values);
+	std::shared_ptr<Material> loadGltfMaterial(std::shared_ptr<const GltfData> pGltf, int32_t material);
+	// streams an image of the file into a binding of the material.
+	// channel >= 0 spreads that channel of the image over rgb, for the packed metallic roughness maps
+	void loadGltfTexture(
+		std::shared_ptr<const GltfData> pGltf,
+		const nlohmann::json& textureInfo,
+		std::shared_ptr<Material> pMaterial,
+		uint32_t binding,
+		const std::string& name,
+		bool anisotropic,
+		TextureUsage usage,
+		int channel = -1);
+	// loads a material texture through the virtual textures when they're on, else the streamer
+	void requestTexture(
+		std::shared_ptr<Material> pMaterial,
+		uint32_t binding,
+		const std::string& textureName,
+		bool anisotropic,
+		const std::string& imageName,
+		TextureUsage usage,
+		TextureStreamer::Decoder decoder);
 };
 
 }
@@ -0,0 +1,257 @@
+#include "io/scene_package.hpp"
+
+#include <glm/gtc/packing.hpp>
+
+namespace naku {
+
+namespace {
+
+// rgba halfs box filtered level by level, finest first
+std::vector<std::vector<char>> halfMipChain(const std::vector<uint16_t>& pixels, int width, int height) {
+	std::vector<glm::vec4> level(static_cast<size_t>(width) * height);
+	for (size_t i = 0; i < level.size(); i++) {
+		uint64_t packed;
+		memcpy(&packed, pixels.data() + i * 4, sizeof(packed));
+		level[i] = glm::unpackHalf4x16(packed);
+	}
+
+	std::vector<std::vector<char>> levels;
+	std::vector<glm::vec4> next;
+	int w = width, h = height;
+	while (true) {
+		std::vector<char> bytes(level.size() * sizeof(uint64_t));
+		for (size_t i = 0; i < level.size(); i++) {
+			const uint64_t packed = glm::packHalf4x16(level[i]);
+			memcpy(bytes.data() + i * sizeof(packed), &packed, sizeof(packed));
+		}
+		levels.push_back(std::move(bytes));
+		if (w == 1 && h == 1) break;
+
+		const int nw = std::max(w / 2, 1), nh = std::max(h / 2, 1);
+		next.resize(static_cast<size_t>(nw) * nh);
+		for (int y = 0; y < nh; y++) {
+			const int y0 = std::min(y * 2, h - 1), y1 = std::min(y * 2 + 1, h - 1);
+			for (int x = 0; x < nw; x++) {
+				const int x0 = std::min(x * 2, w - 1), x1 = std::min(x * 2 + 1, w - 1);
+				next[static_cast<size_t>(y) * nw + x] = 0.25f * (
+					level[static_cast<size_t>(y0) * w + x0] + level[static_cast<size_t>(y0) * w + x1] +
+					level[static_cast<size_t>(y1) * w + x0] + level[static_cast<size_t>(y1) * w + x1]);
+			}
+		}
+		level.swap(next);
+		w = nw;
+		h = nh;
+	}
+	return levels;
+}
+
+}
+
+ScenePackage::Writer::Writer(const std::string& filePath)
+	: _filePath{ filePath }, _tmpPath{ filePath + ".tmp" } {
+	_file.open(_tmpPath, std::ios::binary | std::ios::trunc);
+	if (!_file.is_open())
+		throw std::runtime_error("Error: Failed to open file: " + _tmpPath);
+	// filled in by finish
+	const Header header{};
+	write(&header, sizeof(header));
+	// offset 0 is the empty string
+	_strings.push_back('\0');
+	_stringOffsets[""] = 0;
+}
+
+ScenePackage::Writer::~Writer() {
+	if (_finished) return;
+	_file.close();
+	std::error_code error;
+	std::filesystem::remove(_tmpPath, error);
+}
+
+uint64_t ScenePackage::Writer::write(const void* data, size_t size) {
+	const char zeros[ALIGNMENT]{};
+	const uint64_t offset = (_position + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	_file.write(zeros, offset - _position);
+	_file.write(reinterpret_cast<const char*>(data), size);
+	_position = offset + size;
+	return offset;
+}
+
+uint32_t ScenePackage::Writer::addString(const std::string& str) {
+	auto itr = _stringOffsets.find(str);
+	if (itr != _stringOffsets.end()) return itr->second;
+	const uint32_t offset = static_cast<uint32_t>(_strings.size());
+	_strings.append(str);
+	_strings.push_back('\0');
+	_stringOffsets.emplace(str, offset);
+	return offset;
+}
+
+uint32_t ScenePackage::Writer::addModel(const std::string& name, const char* data, size_t size) {
+	ModelRecord model{};
+	model.name = addString(name);
+	model.offset = write(data, size);
+	model.size = size;
+	_models.push_back(model);
+	return static_cast<uint32_t>(_models.size() - 1);
+}
+
+uint32_t ScenePackage::Writer::addTexture(const std::string& name, TextureUsage usage, uint64_t hash, const char* data, size_t size) {
+	TextureRecord texture{};
+	texture.name = addString(name);
+	texture.usage = static_cast<uint32_t>(usage);
+	texture.hash = hash;
+	texture.offset = write(data, size);
+	texture.size = size;
+	_textures.push_back(texture);
+	return static_cast<uint32_t>(_textures.size() - 1);
+}
+
+uint32_t ScenePackage::Writer::addMaterial(MaterialRecord material, const std::vector<BindingRecord>& bindings) {
+	material.firstBinding = static_cast<uint32_t>(_bindings.size());
+	material.bindingCount = static_cast<uint32_t>(bindings.size());
+	_bindings.insert(_bindings.end(), bindings.begin(), bindings.end());
+	_materials.push_back(material);
+	return static_cast<uint32_t>(_materials.size() - 1);
+}
+
+void ScenePackage::Writer::addObject(const ObjectRecord& object) {
+	_objects.push_back(object);
+}
+
+void ScenePackage::Writer::addLight(const LightRecord& light) {
+	_lights.push_back(light);
+}
+
+bool ScenePackage::Writer::finish(uint64_t sourceHash, const std::string& settings) {
+	Header header{};
+	header.sourceHash = sourceHash;
+	header.settings = Range{ write(settings.data(), settings.size()), settings.size() };
+	header.strings = Range{ write(_strings.data(), _strings.size()), _strings.size() };
+	header.models = writeTable(_models);
+	header.textures = writeTable(_textures);
+	header.materials = writeTable(_materials);
+	header.bindings = writeTable(_bindings);
+	header.objects = writeTable(_objects);
+	header.lights = writeTable(_lights);
+	_file.seekp(0);
+	_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	_file.close();
+	if (!_file.good()) {
+		std::cerr << "Error: Failed to write file: " << _tmpPath << std::endl;
+		return false;
+	}
+	try {
+		std::filesystem::rename(_tmpPath, _filePath);
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Error: " << e.what() << std::endl;
+		return false;
+	}
+	_finished = true;
+	return true;
+}
+
+ScenePackage::ScenePackage(const std::string& filePath) {
+	_file = std::make_shared<MappedFile>(filePath);
+	if (_file->size() < sizeof(Header))
+		throw std::runtime_error("Error: " + filePath + " is too small for a scene package.");
+	_header = reinterpret_cast<const Header*>(_file->data());
+	if (memcmp(_header->magic, Header{}.magic, sizeof(_header->magic)) != 0)
+		throw std::runtime_error("Error: " + filePath + " isn't a scene package.");
+	if (_header->version != VERSION)
+		throw std::runtime_error("Error: " + filePath + " was cooked by another version.");
+
+	// everything the loader follows is checked here, so it can trust the records
+	checkRange(_header->settings, 1);
+	checkRange(_header->strings, 1);
+	checkRange(_header->models, sizeof(ModelRecord));
+	checkRange(_header->textures, sizeof(TextureRecord));
+	checkRange(_header->materials, sizeof(MaterialRecord));
+	checkRange(_header->bindings, sizeof(BindingRecord));
+	checkRange(_header->objects, sizeof(ObjectRecord));
+	checkRange(_header->lights, sizeof(LightRecord));
+	if (_header->strings.count == 0 || _file->data()[_header->strings.offset + _header->strings.count - 1] != '\0')
+		throw std::runtime_error("Error: Scene package " + filePath + " is broken.");
+
+	for (uint32_t i = 0; i < modelCount(); i++) {
+		checkString(model(i).name);
+		checkBlob(model(i).offset, model(i).size);
+	}
+	for (uint32_t i = 0; i < textureCount(); i++) {
+		checkString(texture(i).name);
+		checkBlob(texture(i).offset, texture(i).size);
+	}
+	for (uint32_t i = 0; i < materialCount(); i++) {
+		const auto& record = material(i);
+		checkString(record.name);
+		if (static_cast<uint64_t>(record.firstBinding) + record.bindingCount > _header->bindings.count)
+			throw std::runtime_error("Error: Scene package " + filePath + " is broken.");
+	}
+	for (uint32_t i = 0; i < _header->bindings.count; i++) {
+		checkString(binding(i).name);
+		if (binding(i).texture >= textureCount())
+			throw std::runtime_error("Error: Scene package " + filePath + " is broken.");
+	}
+	for (uint32_t i = 0; i < objectCount(); i++) {
+		const auto& record = object(i);
+		checkString(record.name);
+		if ((record.model != NONE && record.model >= modelCount()) ||
+			(record.material != NONE && record.material >= materialCount()))
+			throw std::runtime_error("Error: Scene package " + filePath + " is broken.");
+	}
+	for (uint32_t i = 0; i < lightCount(); i++)
+		checkString(light(i).name);
+}
+
+void ScenePackage::checkRange(const Range& range, size_t recordSize) const {
+	if (range.count == 0) return;
+	if (range.offset % ALIGNMENT != 0 ||
+		range.offset > _file->size() ||
+		range.count > (_file->size() - range.offset) / recordSize)
+		throw std::runtime_error("Error: Scene package " + filePath() + " is broken.");
+}
+
+void ScenePackage::checkString(uint32_t offset) const {
+	if (offset >= _header->strings.count)
+		throw std::runtime_error("Error: Scene package " + filePath() + " is broken.");
+}
+
+void ScenePackage::checkBlob(uint64_t offset, uint64_t size) const {
+	if (offset % ALIGNMENT != 0 || offset > _file->size() || size > _file->size() - offset)
+		throw std::runtime_error("Error: Scene package " + filePath() + " is broken.");
+}
+
+std::unique_ptr<MeshCache> ScenePackage::loadMesh(uint32_t i) const {
+	const auto& record = model(i);
+	return std::make_unique<MeshCache>(_file, static_cast<size_t>(record.offset), static_cast<size_t>(record.size));
+}
+
+std::unique_ptr<Ktx2> ScenePackage::loadTexture(uint32_t i) const {
+	const auto& record = texture(i);
+	return std::make_unique<Ktx2>(_file, static_cast<size_t>(record.offset), static_cast<size_t>(record.size));
+}
+
+bool ScenePackage::encodeTexture(const TextureStreamer::Payload& payload, TextureUsage usage, bool compress, std::string* ktx2) {
+	if (payload.ktx2) {
+		ktx2->assign(payload.ktx2->data(), payload.ktx2->size());
+		return true;
+	}
+	VkFormat format;
+	std::vector<std::vector<char>> levels;
+	if (!payload.hdrPixels.empty()) {
+		format = VK_FORMAT_R16G16B16A16_SFLOAT;
+		levels = halfMipChain(payload.hdrPixels, payload.width, payload.height);
+	}
+	else if (!payload.pixels.empty()) {
+		format = compress ? TextureCooker::format(usage) : VK_FORMAT_R8G8B8A8_UNORM;
+		levels = TextureCooker::mipChain(payload.pixels.data(), payload.width, payload.height, usage, compress);
+	}
+	else return false;
+
+	std::ostringstream stream;
+	if (!Ktx2::write(stream, format, payload.width, payload.height, levels)) return false;
+	*ktx2 = stream.str();
+	return true;
+}
+
+}
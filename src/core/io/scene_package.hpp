@@ -0,0 +1,195 @@
+#ifndef SCENE_PACKAGE_HPP
+#define SCENE_PACKAGE_HPP
+
+#include "naku.hpp"
+#include "resources/ktx2.hpp"
+#include "resources/light.hpp"
+#include "resources/mesh_cache.hpp"
+#include "resources/texture_streamer.hpp"
+#include "utils/mapped_file.hpp"
+
+namespace naku {
+
+// a cooked scene in one file, mapped whole when it's loaded. meshes are stored as mesh cache
+// files and textures as ktx2 files with all their mips, each at an aligned offset, so they go
+// from the mapping into staging buffers without being parsed or decoded. materials, objects
+// and lights are flat records that refer to each other by index, their names are offsets into
+// a table of strings. the graphics and cameras of scene.json come along as json.
+class ScenePackage {
+public:
+	static constexpr uint32_t VERSION = 1;
+	static constexpr uint64_t ALIGNMENT = 16;
+	// index of a record that isn't there
+	static constexpr uint32_t NONE = 0xFFFFFFFF;
+
+	// records, or bytes for the settings and strings
+	struct Range {
+		uint64_t offset{ 0 };
+		uint64_t count{ 0 };
+	};
+
+	struct Header {
+		char magic[4]{ 'N', 'K', 'S', 'P' };
+		uint32_t version{ VERSION };
+		uint64_t sourceHash{ 0 }; // of the scene.json it was cooked from
+		Range settings;
+		Range strings;
+		Range models;
+		Range textures;
+		Range materials;
+		Range bindings;
+		Range objects;
+		Range lights;
+	};
+
+	struct ModelRecord {
+		uint32_t name;
+		uint32_t reserved;
+		uint64_t offset; // of a mesh cache file
+		uint64_t size;
+	};
+
+	struct TextureRecord {
+		uint32_t name;
+		uint32_t usage;
+		uint64_t hash; // content the engine shares the image by
+		uint64_t offset; // of a ktx2 file
+		uint64_t size;
+	};
+
+	struct MaterialRecord {
+		uint32_t name;
+		uint32_t type;
+		uint32_t firstBinding;
+		uint32_t bindingCount;
+		glm::vec4 albedo;
+		glm::vec4 emission;
+		glm::vec4 offsetTilling;
+		float metalness;
+		float roughness;
+		float ior;
+		int32_t side;
+		int32_t alphaMode;
+		uint32_t reserved[3];
+	};
+
+	struct BindingRecord {
+		uint32_t binding;
+		uint32_t name; // of the texture in the material
+		uint32_t texture;
+		uint32_t anisotropic;
+	};
+
+	struct ObjectRecord {
+		uint32_t name;
+		uint32_t model; // NONE for objects without one
+		uint32_t material;
+		uint32_t active;
+		glm::vec3 position;
+		glm::vec3 rotation;
+		glm::vec3 scale;
+		uint32_t reserved;
+	};
+
+	struct LightRecord {
+		uint32_t name;
+		uint32_t type;
+		uint32_t active;
+		float importance;
+		glm::vec3 position;
+		uint32_t reserved0;
+		glm::vec3 rotation;
+		uint32_t reserved1;
+		Light::LightInfo info;
+	};
+
+	// writes the records as they're added, blobs go to the file right away. finish appends
+	// the tables and the header, then the file takes the place of filePath
+	class Writer {
+	public:
+		// throws if the file can't be created
+		Writer(const std::string& filePath);
+		// removes the temporary file if finish wasn't reached
+		~Writer();
+		Writer(const Writer&) = delete;
+		Writer& operator=(const Writer&) = delete;
+
+		uint32_t addString(const std::string& str);
+		uint32_t addModel(const std::string& name, const char* data, size_t size);
+		uint32_t addTexture(const std::string& name, TextureUsage usage, uint64_t hash, const char* data, size_t size);
+		// bindings refer to textures added before
+		uint32_t addMaterial(MaterialRecord material, const std::vector<BindingRecord>& bindings);
+		void addObject(const ObjectRecord& object);
+		void addLight(const LightRecord& light);
+		// false if anything failed to write
+		bool finish(uint64_t sourceHash, const std::string& settings);
+
+	private:
+		std::string _filePath;
+		std::string _tmpPath;
+		std::ofstream _file;
+		uint64_t _position{ 0 };
+		bool _finished{ false };
+		std::string _strings;
+		std::unordered_map<std::string, uint32_t> _stringOffsets;
+		std::vector<ModelRecord> _models;
+		std::vector<TextureRecord> _textures;
+		std::vector<MaterialRecord> _materials;
+		std::vector<BindingRecord> _bindings;
+		std::vector<ObjectRecord> _objects;
+		std::vector<LightRecord> _lights;
+
+		// pads to ALIGNMENT first, returns where the data starts
+		uint64_t write(const void* data, size_t size);
+		template<typename T>
+		Range writeTable(const std::vector<T>& records) {
+			return Range{ write(records.data(), sizeof(T) * records.size()), records.size() };
+		}
+	};
+
+	// maps the file and checks every table and reference. throws if it isn't a valid package
+	ScenePackage(const std::string& filePath);
+	ScenePackage(const ScenePackage&) = delete;
+	ScenePackage& operator=(const ScenePackage&) = delete;
+
+	std::string filePath() const { return _file->filePath(); }
+	const Header& header() const { return *_header; }
+	std::string settings() const { return std::string(_file->data() + _header->settings.offset, _header->settings.count); }
+	const char* string(uint32_t offset) const { return _file->data() + _header->strings.offset + offset; }
+
+	uint32_t modelCount() const { return static_cast<uint32_t>(_header->models.count); }
+	uint32_t textureCount() const { return static_cast<uint32_t>(_header->textures.count); }
+	uint32_t materialCount() const { return static_cast<uint32_t>(_header->materials.count); }
+	uint32_t objectCount() const { return static_cast<uint32_t>(_header->objects.count); }
+	uint32_t lightCount() const { return static_cast<uint32_t>(_header->lights.count); }
+	const ModelRecord& model(uint32_t i) const { return records<ModelRecord>(_header->models)[i]; }
+	const TextureRecord& texture(uint32_t i) const { return records<TextureRecord>(_header->textures)[i]; }
+	const MaterialRecord& material(uint32_t i) const { return records<MaterialRecord>(_header->materials)[i]; }
+	const BindingRecord& binding(uint32_t i) const { return records<BindingRecord>(_header->bindings)[i]; }
+	const ObjectRecord& object(uint32_t i) const { return records<ObjectRecord>(_header->objects)[i]; }
+	const LightRecord& light(uint32_t i) const { return records<LightRecord>(_header->lights)[i]; }
+
+	// views into the mapping, which they keep alive
+	std::unique_ptr<MeshCache> loadMesh(uint32_t model) const;
+	std::unique_ptr<Ktx2> loadTexture(uint32_t texture) const;
+
+	// the ktx2 file a decoded texture is stored as: its own mips for a ktx2, else a mip chain
+	// made on the cpu, block compressed for 8 bit pixels if compress is set
+	static bool encodeTexture(const TextureStreamer::Payload& payload, TextureUsage usage, bool compress, std::string* ktx2);
+
+private:
+	std::shared_ptr<MappedFile> _file;
+	const Header* _header{ nullptr };
+
+	template<typename T>
+	const T* records(const Range& range) const {
+		return reinterpret_cast<const T*>(_file->data() + range.offset);
+	}
+	void checkRange(const Range& range, size_t recordSize) const;
+	void checkString(uint32_t offset) const;
+	void checkBlob(uint64_t offset, uint64_t size) const;
+};
+
+}
+
+#endif
@@ -27,7 +27,8 @@ public:
 		int col{ 0 };
 		if (ImGui::BeginTable("select_table", _columns)) {
 			ImGui::TableNextRow();
-			for (ResId id = 0; id < items.size(); id++) {
+			for (ResId id = 0; id < items.idCount(); id++) {
+				if (!items.exist(id)) continue;
 				if (col == _columns) {
 					ImGui::TableNextRow();
 					col = 0;
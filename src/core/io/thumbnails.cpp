@@ -0,0 +1,182 @@
+#include "io/thumbnails.hpp"
+#include "resources/hdr_decoder.hpp"
+#include "utils/engine.hpp"
+#include "utils/mapped_file.hpp"
+
+#include <imgui_impl_vulkan.h>
+#include <glm/gtc/packing.hpp>
+
+#include <stb_image.h>
+#include <stb_image_resize.h>
+#include <stb_image_write.h>
+
+namespace naku {
+
+Thumbnails::Thumbnails(Engine& engine, VkSampler sampler)
+	: _engine{ engine }, _sampler{ sampler },
+	_pool{ std::max(std::thread::hardware_concurrency() / 4, 1u) },
+	_cancelled{ std::make_shared<std::atomic<bool>>(false) } {}
+
+Thumbnails::~Thumbnails() {
+	// queued decodes return right away, running ones are waited for
+	_cancelled->store(true);
+	for (auto& pair : _entries) {
+		if (pair.second.done.valid()) pair.second.done.wait();
+	}
+}
+
+bool Thumbnails::isImage(const std::string& filePath) {
+	return strEndWith(filePath, ".png") ||
+		strEndWith(filePath, ".jpg") ||
+		strEndWith(filePath, ".jpeg") ||
+		strEndWith(filePath, ".bmp") ||
+		strEndWith(filePath, ".tga") ||
+		HdrDecoder::isHdr(filePath);
+}
+
+std::string Thumbnails::cachePath(uint64_t sourceHash) {
+	const uint32_t options[3]{ VERSION, THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT };
+	return std::string(THUMBNAIL_CACHE_DIR) + "/" + hashToString(hashMemory(options, sizeof(options), sourceHash)) + ".png";
+}
+
+VkDescriptorSet Thumbnails::get(const std::string& filePath, uint32_t* width, uint32_t* height) {
+	auto itr = _entries.find(filePath);
+	if (itr == _entries.end()) {
+		Entry entry{};
+		entry.decoded = std::make_shared<Decoded>();
+		entry.done = _pool.submit([filePath, decoded = entry.decoded, cancelled = _cancelled]() {
+			if (cancelled->load() || decoded->abandoned.load()) return false;
+			return generate(filePath, &decoded->pixels, &decoded->width, &decoded->height);
+		});
+		itr = _entries.emplace(filePath, std::move(entry)).first;
+	}
+
+	Entry& entry = itr->second;
+	entry.lastUsed = _frame;
+	if (!entry.uploaded) return VK_NULL_HANDLE;
+	if (width) *width = entry.uploaded->image->width();
+	if (height) *height = entry.uploaded->image->height();
+	return entry.uploaded->set;
+}
+
+void Thumbnails::update() {
+	uint32_t uploads = 0;
+	for (auto& pair : _entries) {
+		Entry& entry = pair.second;
+		if (uploads >= uploadsPerFrame) break;
+		if (!entry.done.valid() || entry.done.wait_for(std::chrono::seconds(0)) != std::future_status::ready) continue;
+
+		if (entry.done.get()) {
+			upload(pair.first, entry);
+			uploads++;
+		}
+		else entry.failed = true;
+		entry.decoded.reset();
+	}
+	release();
+	_frame++;
+}
+
+void Thumbnails::upload(const std::string& filePath, Entry& entry) {
+	auto& decoded = *entry.decoded;
+	auto image = Image2D::loadImageFromPixels(
+		*_engine.pDevice, "thumbnail:" + filePath, decoded.pixels.data(), decoded.width, decoded.height, 4, false, 0, false);
+	entry.uploaded = std::make_shared<Uploaded>();
+	entry.uploaded->device = _engine.device();
+	entry.uploaded->pool = _engine.pDescriptorSetPool->getPool();
+	entry.uploaded->image = image;
+	entry.uploaded->set = ImGui_ImplVulkan_AddTexture(_sampler, image->defaultImageView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+void Thumbnails::release() {
+	// pending ones not asked for last frame have scrolled out of view
+	uint32_t uploaded = 0;
+	for (auto itr = _entries.begin(); itr != _entries.end();) {
+		Entry& entry = itr->second;
+		if (entry.decoded && entry.lastUsed + 1 < _frame) {
+			entry.decoded->abandoned.store(true);
+			itr = _entries.erase(itr);
+			continue;
+		}
+		if (entry.uploaded) uploaded++;
+		itr++;
+	}
+
+	while (uploaded > capacity) {
+		auto oldest = _entries.end();
+		for (auto itr = _entries.begin(); itr != _entries.end(); itr++) {
+			if (itr->second.uploaded && (oldest == _entries.end() || itr->second.lastUsed < oldest->second.lastUsed))
+				oldest = itr;
+		}
+		// the frames in flight may still draw it
+		_engine.addGarbage(oldest->second.uploaded);
+		_entries.erase(oldest);
+		uploaded--;
+	}
+}
+
+bool Thumbnails::generate(const std::string& filePath, std::vector<unsigned char>* pixels, int* width, int* height) {
+	try {
+		const std::string path = cachePath(MappedFile{ filePath }.hash());
+		int w, h, c;
+		if (doesFileExist(path)) {
+			unsigned char* data = stbi_load(path.c_str(), &w, &h, &c, STBI_rgb_alpha);
+			if (data) {
+				pixels->assign(data, data + static_cast<size_t>(w) * h * 4);
+				stbi_image_free(data);
+				*width = w;
+				*height = h;
+				return true;
+			}
+		}
+
+		std::vector<unsigned char> source;
+		if (HdrDecoder::isHdr(filePath)) {
+			// reinhard and gamma, good enough to recognize the image
+			std::vector<uint16_t> halfs;
+			std::string warn;
+			if (!HdrDecoder::decode(filePath, &halfs, &w, &h, &warn)) {
+				std::cerr << "Warning: Thumbnails: can not decode " << filePath << ": " << warn << std::endl;
+				return false;
+			}
+			source.resize(halfs.size());
+			for (size_t i = 0; i < halfs.size(); i++) {
+				float v = std::max(glm::unpackHalf1x16(halfs[i]), 0.f);
+				if (i % 4 != 3) v = std::pow(v / (1.f + v), 1.f / 2.2f);
+				source[i] = static_cast<unsigned char>(std::min(v, 1.f) * 255.f + 0.5f);
+			}
+		}
+		else {
+			unsigned char* data = stbi_load(filePath.c_str(), &w, &h, &c, STBI_rgb_alpha);
+			if (!data) {
+				std::cerr << "Warning: Thumbnails: can not decode " << filePath << std::endl;
+				return false;
+			}
+			source.assign(data, data + static_cast<size_t>(w) * h * 4);
+			stbi_image_free(data);
+		}
+
+		// fits the box, keeping the aspect. smaller images stay as they are
+		const float scale = std::min(1.f, std::min(
+			static_cast<float>(THUMBNAIL_WIDTH) / w,
+			static_cast<float>(THUMBNAIL_HEIGHT) / h));
+		*width = std::max(static_cast<int>(w * scale + 0.5f), 1);
+		*height = std::max(static_cast<int>(h * scale + 0.5f), 1);
+		pixels->resize(static_cast<size_t>(*width) * *height * 4);
+		stbir_resize_uint8(source.data(), w, h, 0, pixels->data(), *width, *height, 0, 4);
+
+		// written to a temporary file first so a half written thumbnail is never picked up
+		const std::string tmpPath = path + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+		std::filesystem::create_directories(THUMBNAIL_CACHE_DIR);
+		if (stbi_write_png(tmpPath.c_str(), *width, *height, 4, pixels->data(), *width * 4))
+			std::filesystem::rename(tmpPath, path);
+		else std::cerr << "Warning: Thumbnails: failed to write file: " << tmpPath << std::endl;
+		return true;
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Warning: Thumbnails: " << e.what() << std::endl;
+		return false;
+	}
+}
+
+}
@@ -0,0 +1,81 @@
+#ifndef THUMBNAILS_HPP
+#define THUMBNAILS_HPP
+
+#include "naku.hpp"
+#include "resources/image.hpp"
+#include "utils/thread_pool.hpp"
+
+#include <atomic>
+
+namespace naku {
+
+class Engine;
+
+// downscaled previews of image files for the editor. a file is decoded and shrunk to fit
+// THUMBNAIL_WIDTH x THUMBNAIL_HEIGHT on a worker, then cached as a png named after its
+// content hash, so showing a folder again only reads small files. a few thumbnails are
+// uploaded per frame, and past capacity the least recently shown ones are released.
+class Thumbnails {
+public:
+	static constexpr uint32_t VERSION = 1;
+
+	Thumbnails(Engine& engine, VkSampler sampler);
+	~Thumbnails();
+	Thumbnails(const Thumbnails&) = delete;
+	Thumbnails& operator=(const Thumbnails&) = delete;
+
+	static bool isImage(const std::string& filePath);
+	// imgui texture of the thumbnail of an image file, generated first if it isn't cached.
+	// VK_NULL_HANDLE until it's uploaded, or if the file can't be decoded
+	VkDescriptorSet get(const std::string& filePath, uint32_t* width = nullptr, uint32_t* height = nullptr);
+	// uploads finished thumbnails and releases stale ones. called once per frame
+	void update();
+
+	// runs on a worker. rgba8 pixels of the thumbnail, read from the cache if it's there
+	static bool generate(const std::string& filePath, std::vector<unsigned char>* pixels, int* width, int* height);
+	static std::string cachePath(uint64_t sourceHash);
+
+	uint32_t uploadsPerFrame{ 4 };
+	// uploaded thumbnails kept at most, each holds a set of the engine's descriptor pool
+	uint32_t capacity{ 128 };
+
+private:
+	struct Decoded {
+		std::vector<unsigned char> pixels;
+		int width{ 0 };
+		int height{ 0 };
+		// set once nobody asks for it anymore, a queued decode then returns right away
+		std::atomic<bool> abandoned{ false };
+	};
+
+	// freed through the engine's garbage once the frames drawing it are done
+	struct Uploaded {
+		VkDevice device;
+		VkDescriptorPool pool;
+		VkDescriptorSet set;
+		std::shared_ptr<Image2D> image;
+		~Uploaded() { vkFreeDescriptorSets(device, pool, 1, &set); }
+	};
+
+	struct Entry {
+		std::shared_ptr<Decoded> decoded;
+		std::future<bool> done;
+		std::shared_ptr<Uploaded> uploaded;
+		uint64_t lastUsed{ 0 };
+		bool failed{ false };
+	};
+
+	Engine& _engine;
+	VkSampler _sampler;
+	ThreadPool _pool;
+	std::shared_ptr<std::atomic<bool>> _cancelled;
+	std::unordered_map<std::string, Entry> _entries;
+	uint64_t _frame{ 0 };
+
+	void upload(const std::string& filePath, Entry& entry);
+	void release();
+};
+
+}
+
+#endif
@@ -14,10 +14,16 @@
 static constexpr char NAKU_VERSION[] = { "0.01" };
 
 int main(int argc, char* argv[]) {
-    std::string scenePath{ "res/scene/Box" };
-    if (argc >= 2) {
-        scenePath = argv[1];
+    // more than one scene are cycled through with page down, the first is loaded
+    std::vector<std::string> scenePaths;
+    // loads scene.json and writes the scene package next to it
+    bool cook = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--cook") cook = true;
+        else scenePaths.push_back(argv[i]);
     }
+    if (scenePaths.empty()) scenePaths.push_back("res/scene/Box");
+    std::string scenePath = scenePaths.front();
     std::string wName{"Naku"};
     wName = wName;
     naku::Engine engine(1600, 900, wName, 1.25f);
@@ -26,6 +32,9 @@ int main(int argc, char* argv[]) {
 #ifndef NDEBUG
     scene.echo = true;
 #endif // !NDEBUG
+    scene.usePackage = !cook;
+    // edits to scene.json show up while it runs
+    scene.hotReload = !cook;
 
     try {
         std::cout << "Loading scene: " << scenePath << std::endl;
@@ -35,9 +44,38 @@ int main(int argc, char* argv[]) {
         float deltaTime = std::chrono::duration<float>(t_end - t_start).count();
         std::cout << "\tVertices: " << scene.vertexCount() << std::endl;
         std::cout << "\tTriangles: " << scene.faceCount() << std::endl;
+        std::cout << "\tShared: " << engine.sharedContent.images << " images, " << engine.sharedContent.models
+            << " models, " << engine.sharedContent.bytes / 1024 << " KiB of device memory saved." << std::endl;
         std::cout.setf(std::ios::fixed);
-        std::cout << "\tScene loaded in " << std::setprecision(3) << deltaTime << " seconds." << std::endl;
+        std::cout << "\tScene loaded" << (scene.loadedFromPackage() ? " from its package" : "")
+            << " in " << std::setprecision(3) << deltaTime << " seconds." << std::endl;
+        if (cook) {
+            t_start = std::chrono::high_resolution_clock::now();
+            if (!scene.save()) return EXIT_FAILURE;
+            t_end = std::chrono::high_resolution_clock::now();
+            deltaTime = std::chrono::duration<float>(t_end - t_start).count();
+            std::cout << "\tScene cooked into " << scene.packagePath() << " in " << std::setprecision(3) << deltaTime << " seconds." << std::endl;
+        }
         engine.pWindow->setWindowName(wName + " - " + scenePath);
+        size_t sceneIdx{ 0 };
+        bool switchKeyPressed{ false };
+        engine.onFrame = [&]() {
+            if (scene.hotReload) scene.poll();
+            if (scenePaths.size() < 2) return;
+            const int key = glfwGetKey(engine.pWindow->pWindow(), GLFW_KEY_PAGE_DOWN);
+            if (key == GLFW_PRESS) switchKeyPressed = true;
+            if (!switchKeyPressed || key != GLFW_RELEASE) return;
+            switchKeyPressed = false;
+            sceneIdx = (sceneIdx + 1) % scenePaths.size();
+            try {
+                scene.switchTo(scenePaths[sceneIdx]);
+            }
+            catch (const std::exception& e) {
+                // what loaded of it stays, the next switch clears it
+                std::cerr << e.what() << std::endl;
+            }
+            engine.pWindow->setWindowName(wName + " - " + scenePaths[sceneIdx]);
+        };
 
         while (true) {
             int i = engine.run();
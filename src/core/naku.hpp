@@ -66,6 +66,10 @@ static constexpr uint32_t SHADOWMAP_WIDTH               = 1024;
 static constexpr uint32_t SHADOWMAP_HEIGHT              = 1024;
 static constexpr float LIGHT_PROJECT_NEAR               = 0.01f;
 
+static constexpr char MESH_CACHE_DIR[]                  = "cache/mesh";
+static constexpr char TEXTURE_CACHE_DIR[]               = "cache/texture";
+static constexpr char THUMBNAIL_CACHE_DIR[]             = "cache/thumbnail";
+
 // base texture, normal texture, pbr texture, occlusion texture, emission texture
 enum class MaterialTextures {
 	BASE = 0,
@@ -400,6 +404,19 @@ inline int getFormatBit(VkFormat format) {
 	case VK_FORMAT_D32_SFLOAT:
 		return FormatBit::D | FormatBit::BIT32 | FormatBit::SFLOAT;
 		break;
+	// block compressed, the bit depth doesn't apply
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+		return FormatBit::R | FormatBit::UNORM;
+		break;
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+		return FormatBit::RG | FormatBit::UNORM;
+		break;
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+		return FormatBit::RGBA | FormatBit::UNORM;
+		break;
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		return FormatBit::RGBA | FormatBit::SRGB;
+		break;
 	default:
 		return FormatBit::UNDEFINED;
 		break;
@@ -578,6 +595,51 @@ inline void hashCombine(std::size_t& seed, const T& v, Rest... rest) {
 	hashCombine(seed, rest...);
 }
 
+// 64-bit MurmurHash2 (MurmurHash64A). used as content hash for cached assets.
+inline uint64_t hashMemory(const void* data, size_t size, uint64_t seed = 0) {
+	const uint64_t m = 0xc6a4a7935bd1e995ULL;
+	const int r = 47;
+	uint64_t h = seed ^ (size * m);
+
+	const unsigned char* p = static_cast<const unsigned char*>(data);
+	const unsigned char* end = p + (size / 8) * 8;
+	for (; p != end; p += 8) {
+		uint64_t k;
+		memcpy(&k, p, sizeof(k));
+		k *= m;
+		k ^= k >> r;
+		k *= m;
+		h ^= k;
+		h *= m;
+	}
+
+	switch (size & 7) {
+	case 7: h ^= uint64_t(p[6]) << 48; [[fallthrough]];
+	case 6: h ^= uint64_t(p[5]) << 40; [[fallthrough]];
+	case 5: h ^= uint64_t(p[4]) << 32; [[fallthrough]];
+	case 4: h ^= uint64_t(p[3]) << 24; [[fallthrough]];
+	case 3: h ^= uint64_t(p[2]) << 16; [[fallthrough]];
+	case 2: h ^= uint64_t(p[1]) << 8; [[fallthrough]];
+	case 1: h ^= uint64_t(p[0]);
+		h *= m;
+	};
+
+	h ^= h >> r;
+	h *= m;
+	h ^= h >> r;
+	return h;
+}
+
+inline std::string hashToString(uint64_t hash) {
+	static const char digits[] = "0123456789abcdef";
+	std::string str(16, '0');
+	for (int i = 15; i >= 0; i--) {
+		str[i] = digits[hash & 0xF];
+		hash >>= 4;
+	}
+	return str;
+}
+
 template<typename T>
 inline bool isZero(const T& num) {
 	return abs(num) <= std::numeric_limits<T>::epsilon();
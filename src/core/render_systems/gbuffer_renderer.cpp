@@ -1,5 +1,6 @@
 #include "render_systems/gbuffer_renderer.hpp"
 #include "utils/engine.hpp"
+#include "resources/virtual_texture.hpp"
 
 namespace naku {
 
@@ -21,10 +22,20 @@ naku::GbufferRenderer::GbufferRenderer(
 		_vert = _engine.resources.get<Shader>("gbuffer.vert.spv");
 	else
 		_vert = _engine.createShader("res/shader/gbuffer.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
-	if (_engine.resources.exist<Shader>("gbuffer.frag.spv"))
-		_frag = _engine.resources.get<Shader>("gbuffer.frag.spv");
+	// the virtual texturing variant writes page feedback, which needs fragmentStoresAndAtomics.
+	// it falls back to plain textures for slots that aren't virtual, so it serves every scene
+	const std::string fragName = _device.fragmentStoresAndAtomics ? "gbuffer_vt.frag.spv" : "gbuffer.frag.spv";
+	if (_engine.resources.exist<Shader>(fragName))
+		_frag = _engine.resources.get<Shader>(fragName);
 	else
-		_frag = _engine.createShader("res/shader/gbuffer.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+		_frag = _engine.createShader("res/shader/" + fragName, VK_SHADER_STAGE_FRAGMENT_BIT);
+	_packedFormat = _engine.modelOptions.vertexFormat;
+	if (_packedFormat != VertexFormat::FULL) {
+		if (_engine.resources.exist<Shader>("gbuffer_packed.vert.spv"))
+			_packedVert = _engine.resources.get<Shader>("gbuffer_packed.vert.spv");
+		else
+			_packedVert = _engine.createShader("res/shader/gbuffer_packed.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+	}
 
 	//DescriptorWriter writer(*Material::textureInputSetLayout, *_engine.pDescriptorSetPool);
 	//writer.build(_textureInputSet);
@@ -49,9 +60,10 @@ void GbufferRenderer::createPipeline()
 	_config.colorBlendInfo.pAttachments = colorBlendAttachments.data();
 	
 	std::vector<VkDescriptorSetLayout> layouts;
-	layouts.reserve(2);
+	layouts.reserve(3);
 	layouts.push_back(_engine.pGlobalSetLayout->getDescriptorSetLayout());
 	layouts.push_back(Material::textureInputSetLayout->getDescriptorSetLayout());
+	layouts.push_back(_engine.pVirtualTextures->setLayout().getDescriptorSetLayout());
 
 	//prepare pipeline layout
 	{
@@ -74,15 +86,40 @@ void GbufferRenderer::createPipeline()
 	// create pipeline
 	_config.pipelineLayout = _pipelineLayout;
 	_pipeline = std::make_unique<GraphicsPipeline>(_device, _config);
+
+	if (_packedVert) {
+		_config.bindingDescriptions = getBindingDescriptions(_packedFormat);
+		_config.attributeDescriptions = getAttributeDescriptions(_packedFormat);
+		_config.vertStageCreateInfo = _packedVert->getCreateInfo();
+		_packedPipeline = std::make_unique<GraphicsPipeline>(_device, _config);
+	}
+}
+
+GraphicsPipeline* GbufferRenderer::pipeline(VertexFormat format) {
+	if (format == VertexFormat::FULL) return _pipeline.get();
+	if (format == _packedFormat) return _packedPipeline.get();
+	return nullptr;
 }
 
 void GbufferRenderer::render(FrameInfo& frameInfo)
 {
 	_pipeline->cmdBind(frameInfo.commandBuffer);
+	GraphicsPipeline* boundPipeline = _pipeline.get();
+	// virtual textures are the same for every draw, after the material set
+	VkDescriptorSet virtualSet = _engine.pVirtualTextures->set(frameInfo.frameIndex);
+	vkCmdBindDescriptorSets(
+		frameInfo.commandBuffer,
+		VK_PIPELINE_BIND_POINT_GRAPHICS,
+		_pipelineLayout,
+		static_cast<uint32_t>(frameInfo.globalSets.size()) + 1,
+		1,
+		&virtualSet,
+		0,
+		nullptr);
 	auto& Materials = _resources.getResource<Material>();
 	auto& Objects = _resources.getResource<Object>();
 
-	for (ResId mtlId = 0; mtlId < Materials.size(); mtlId++) {
+	for (ResId mtlId = 0; mtlId < Materials.idCount(); mtlId++) {
 		if (!Materials.exist(mtlId)) continue;
 		auto material = Materials[mtlId];
 		if (material->type() != Material::Type::OPAQUE) continue;
@@ -93,6 +130,18 @@ void GbufferRenderer::render(FrameInfo& frameInfo)
 			auto obj = Objects[objId];
 			if (obj->isActive()) {
 				if (obj->model) {
+					// both pipelines share the layout, so bound sets stay valid
+					GraphicsPipeline* modelPipeline = pipeline(obj->model->vertexFormat());
+					if (!modelPipeline) continue;
+					const float uvPerPixel = obj->model->uvPerPixel(
+						obj->transformMat(),
+						_engine.globalUbo.projView,
+						static_cast<float>(_engine.globalUbo.height));
+					if (uvPerPixel >= 0.f) material->markDrawn(frameInfo.runningTime, uvPerPixel);
+					if (modelPipeline != boundPipeline) {
+						modelPipeline->cmdBind(frameInfo.commandBuffer);
+						boundPipeline = modelPipeline;
+					}
 					const uint32_t offsets = obj->getOffset();
 					vkCmdBindDescriptorSets(
 						frameInfo.commandBuffer,
@@ -111,8 +160,19 @@ void GbufferRenderer::render(FrameInfo& frameInfo)
 						sizeof(Material::PushConstants),
 						&material->pushConstants);
 					auto model = obj->model;
+					const uint32_t lod = model->selectLod(
+						obj->transformMat(),
+						_engine.globalUbo.projView,
+						static_cast<float>(_engine.globalUbo.height),
+						_engine.lodThreshold);
 					model->cmdBind(frameInfo.commandBuffer);
-					model->cmdDraw(frameInfo.commandBuffer);
+					if (lod == 0) {
+						const glm::vec3 camPos{ _engine.globalUbo.camPos };
+						model->cmdDrawMeshlets(frameInfo.commandBuffer, obj->transformMat(), _engine.globalUbo.projView, &camPos);
+					}
+					else {
+						model->cmdDraw(frameInfo.commandBuffer, lod);
+					}
 				}
 			}
 		}
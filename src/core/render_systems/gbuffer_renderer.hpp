@@ -42,6 +42,7 @@ private:
 	size_t _imageCount;
 	std::shared_ptr<Shader> _vert;
 	std::shared_ptr<Shader> _frag;
+	std::shared_ptr<Shader> _packedVert;
 	//std::unique_ptr<DescriptorSetLayout> _setLayout;
 	//std::vector<std::unique_ptr<DescriptorWriter>> _writers;
 	//std::vector<VkDescriptorSet> _sets;
@@ -49,7 +50,11 @@ private:
 	VkPipelineLayout _pipelineLayout;
 	PipelineConfig _config{};
 	std::unique_ptr<GraphicsPipeline> _pipeline;
+	// for models in the engine's packed vertex format
+	VertexFormat _packedFormat{ VertexFormat::FULL };
+	std::unique_ptr<GraphicsPipeline> _packedPipeline;
 
+	GraphicsPipeline* pipeline(VertexFormat format);
 };
 
 }
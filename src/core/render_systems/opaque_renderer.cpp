@@ -1,5 +1,6 @@
 #include "render_systems/opaque_renderer.hpp"
 #include "utils/engine.hpp"
+#include "resources/environment.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -42,6 +43,10 @@ OpaqueRenderer::OpaqueRenderer(
     samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
     samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
     _sampler = std::make_unique<Sampler>(_device, samplerCreateInfo);
+    // roughness picks a level of the prefiltered environment
+    samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;
+    _environmentSampler = std::make_unique<Sampler>(_device, samplerCreateInfo);
+    _environmentBinding = static_cast<uint32_t>(inputGbufferAttachments.size()) + 2;
 
     // create descriptor set
     {
@@ -50,6 +55,8 @@ OpaqueRenderer::OpaqueRenderer(
             layoutBuilder.addBinding(i, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
         layoutBuilder.addBinding(inputGbufferAttachments.size(), VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT); //shadowmap
         layoutBuilder.addBinding(inputGbufferAttachments.size()+1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT); //shadowmap
+        layoutBuilder.addBinding(_environmentBinding, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT); //environment
+        layoutBuilder.addBinding(_environmentBinding + 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT); //brdf lut
         _setLayout = layoutBuilder.build();
         _writers.reserve(_imageCount);
         for (size_t i = 0; i < _imageCount; i++) {
@@ -68,15 +75,29 @@ OpaqueRenderer::OpaqueRenderer(
             imgInfo.imageView = Light::omniShadowmaps->defaultImageView();
             writer->writeImage(inputGbufferAttachments.size()+1, imgInfo);
 
+            writeEnvironment(*writer);
+
             _writers.push_back(std::move(writer));
         }
         _sets.resize(_imageCount);
         for (size_t i = 0; i < _imageCount; i++) {
             _writers[i]->build(_sets[i]);
         }
+        _environments.assign(_imageCount, _engine.pEnvironment);
     }
 }
 
+void OpaqueRenderer::writeEnvironment(DescriptorWriter& writer) {
+    VkDescriptorImageInfo imgInfo{};
+    imgInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imgInfo.imageView = _engine.pEnvironment->specular().defaultImageView();
+    imgInfo.sampler = _environmentSampler->sampler();
+    writer.writeImage(_environmentBinding, imgInfo);
+
+    imgInfo.imageView = _engine.pEnvironment->brdfLut().defaultImageView();
+    writer.writeImage(_environmentBinding + 1, imgInfo);
+}
+
 OpaqueRenderer::~OpaqueRenderer() {
     vkDestroyPipelineLayout(device(), _pipelineLayout, nullptr);
 }
@@ -116,6 +137,14 @@ void OpaqueRenderer::createPipeline() {
 void OpaqueRenderer::render(FrameInfo frameInfo) {
     _pipeline->cmdBind(frameInfo.commandBuffer);
 
+    // the environment was replaced. frames that sampled the old one through this image's set are
+    // done by now, so the set is rewritten and lets go of it
+    if (_environments[frameInfo.imageIndex] != _engine.pEnvironment) {
+        writeEnvironment(*_writers[frameInfo.imageIndex]);
+        _writers[frameInfo.imageIndex]->overwrite(_sets[frameInfo.imageIndex]);
+        _environments[frameInfo.imageIndex] = _engine.pEnvironment;
+    }
+
     auto sets = frameInfo.globalSets;
     sets.push_back(_sets[frameInfo.imageIndex]);
     
@@ -16,6 +16,7 @@
 namespace naku {
 
 extern class Engine;
+class Environment;
 
 class OpaqueRenderer {
 public:
@@ -57,9 +58,15 @@ private:
 	size_t _imageCount;
 
 	std::unique_ptr<Sampler> _sampler;
+	std::unique_ptr<Sampler> _environmentSampler;
+	uint32_t _environmentBinding;
 	std::unique_ptr<DescriptorSetLayout> _setLayout;
 	std::vector<std::unique_ptr<DescriptorWriter>> _writers;
 	std::vector<VkDescriptorSet> _sets;
+	// the environment each set samples, kept alive until the set is rewritten
+	std::vector<std::shared_ptr<Environment>> _environments;
+
+	void writeEnvironment(DescriptorWriter& writer);
 
 	//std::unordered_map<std::string, std::unique_ptr<GraphicsPipeline>> _pipelines;
 	//std::map<std::string, VkPipelineLayout> _pipelineLayouts;
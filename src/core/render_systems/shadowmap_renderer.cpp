@@ -73,13 +73,26 @@ void ShadowmapRenderer::createPipeline()
 	}
 
 	// create pipeline
+	// shadowmap.vert only reads the position, so it's fed from the position only stream of the models
 	_config.pipelineLayout = _pipelineLayout;
+	_config.bindingDescriptions = getPositionBindingDescriptions(VertexFormat::FULL);
+	_config.attributeDescriptions = getPositionAttributeDescriptions(VertexFormat::FULL);
 	_pipeline = std::make_unique<GraphicsPipeline>(_device, _config);
+
+	_config.bindingDescriptions = getPositionBindingDescriptions(VertexFormat::QUANTIZED);
+	_config.attributeDescriptions = getPositionAttributeDescriptions(VertexFormat::QUANTIZED);
+	_quantizedPipeline = std::make_unique<GraphicsPipeline>(_device, _config);
+}
+
+GraphicsPipeline* ShadowmapRenderer::pipeline(VertexFormat format) {
+	if (format == VertexFormat::QUANTIZED) return _quantizedPipeline.get();
+	return _pipeline.get();
 }
 
 void ShadowmapRenderer::render(FrameInfo& frameInfo, Light& light, int cubeFace)
 {
 	_pipeline->cmdBind(frameInfo.commandBuffer);
+	GraphicsPipeline* boundPipeline = _pipeline.get();
 
 	auto& Objects = _resources.getResource<Object>();
 	if (!light.isActive())
@@ -131,11 +144,17 @@ void ShadowmapRenderer::render(FrameInfo& frameInfo, Light& light, int cubeFace)
 		0,
 		sizeof(PushConstants),
 		&push);
-	for (ResId objId = 0; objId < Objects.size(); objId++) {
+	for (ResId objId = 0; objId < Objects.idCount(); objId++) {
 		if (!Objects.exist(objId)) continue;
 		auto obj = Objects[objId];
 		if (obj->type() != Object::Type::MESH) continue;
 		if (obj->isActive() && obj->model && obj->castShadow()) {
+			// both pipelines share the layout, so the push constants and bound sets stay valid
+			GraphicsPipeline* modelPipeline = pipeline(obj->model->vertexFormat());
+			if (modelPipeline != boundPipeline) {
+				modelPipeline->cmdBind(frameInfo.commandBuffer);
+				boundPipeline = modelPipeline;
+			}
 			const uint32_t offsets = obj->getOffset();
 			vkCmdBindDescriptorSets(
 				frameInfo.commandBuffer,
@@ -147,8 +166,18 @@ void ShadowmapRenderer::render(FrameInfo& frameInfo, Light& light, int cubeFace)
 				1,
 				&offsets);
 			auto model = obj->model;
-			model->cmdBind(frameInfo.commandBuffer);
-			model->cmdDraw(frameInfo.commandBuffer);
+			const uint32_t lod = model->selectLod(
+				obj->transformMat(),
+				push.depthPV,
+				static_cast<float>(SHADOWMAP_HEIGHT),
+				_engine.lodThreshold,
+				_engine.shadowLodBias);
+			model->cmdBindPositions(frameInfo.commandBuffer);
+			// shadows come from the back faces, so only the frustum culls meshlets here
+			if (lod == 0)
+				model->cmdDrawMeshlets(frameInfo.commandBuffer, obj->transformMat(), push.depthPV);
+			else
+				model->cmdDraw(frameInfo.commandBuffer, lod);
 		}
 	}
 }
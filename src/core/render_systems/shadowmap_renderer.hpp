@@ -49,7 +49,12 @@ private:
 
 	VkPipelineLayout _pipelineLayout;
 	PipelineConfig _config{};
+	// float positions of full and packed models
 	std::unique_ptr<GraphicsPipeline> _pipeline;
+	// unorm16 positions of quantized models
+	std::unique_ptr<GraphicsPipeline> _quantizedPipeline;
+
+	GraphicsPipeline* pipeline(VertexFormat format);
 };
 
 }
@@ -1,5 +1,6 @@
 #include "render_systems/transparent_renderer.hpp"
 #include "utils/engine.hpp"
+#include "resources/virtual_texture.hpp"
 
 #include <map>
 
@@ -20,10 +21,19 @@ TransparentRenderer::TransparentRenderer(
 		_vert = _engine.resources.get<Shader>("transparent.vert.spv");
 	else
 		_vert = _engine.createShader("res/shader/transparent.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
-	if (_engine.resources.exist<Shader>("transparent.frag.spv"))
-		_frag = _engine.resources.get<Shader>("transparent.frag.spv");
+	// picks the fragment variant the same way GbufferRenderer does
+	const std::string fragName = _device.fragmentStoresAndAtomics ? "transparent_vt.frag.spv" : "transparent.frag.spv";
+	if (_engine.resources.exist<Shader>(fragName))
+		_frag = _engine.resources.get<Shader>(fragName);
 	else
-		_frag = _engine.createShader("res/shader/transparent.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+		_frag = _engine.createShader("res/shader/" + fragName, VK_SHADER_STAGE_FRAGMENT_BIT);
+	_packedFormat = _engine.modelOptions.vertexFormat;
+	if (_packedFormat != VertexFormat::FULL) {
+		if (_engine.resources.exist<Shader>("transparent_packed.vert.spv"))
+			_packedVert = _engine.resources.get<Shader>("transparent_packed.vert.spv");
+		else
+			_packedVert = _engine.createShader("res/shader/transparent_packed.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+	}
 
 	{
 		auto samplerCreateInfo = Sampler::getDefaultSamplerCreateInfo();
@@ -91,10 +101,11 @@ void TransparentRenderer::createPipeline()
 
 	//prepare pipeline layout
 	std::vector<VkDescriptorSetLayout> layouts;
-	layouts.reserve(3);
+	layouts.reserve(4);
 	layouts.push_back(_engine.pGlobalSetLayout->getDescriptorSetLayout());
 	layouts.push_back(_setLayout->getDescriptorSetLayout());
 	layouts.push_back(Material::textureInputSetLayout->getDescriptorSetLayout());
+	layouts.push_back(_engine.pVirtualTextures->setLayout().getDescriptorSetLayout());
 
 
 	VkPushConstantRange pushConstantRange{};
@@ -115,13 +126,28 @@ void TransparentRenderer::createPipeline()
 	// create pipeline
 	_config.pipelineLayout = _pipelineLayout;
 	_pipeline = std::make_unique<GraphicsPipeline>(_device, _config);
+
+	if (_packedVert) {
+		_config.bindingDescriptions = getBindingDescriptions(_packedFormat);
+		_config.attributeDescriptions = getAttributeDescriptions(_packedFormat);
+		_config.vertStageCreateInfo = _packedVert->getCreateInfo();
+		_packedPipeline = std::make_unique<GraphicsPipeline>(_device, _config);
+	}
+}
+
+GraphicsPipeline* TransparentRenderer::pipeline(VertexFormat format) {
+	if (format == VertexFormat::FULL) return _pipeline.get();
+	if (format == _packedFormat) return _packedPipeline.get();
+	return nullptr;
 }
 
 void TransparentRenderer::render(
 	FrameInfo& frameInfo,
 	const Object& obj)
 {
-	_pipeline->cmdBind(frameInfo.commandBuffer);
+	GraphicsPipeline* objPipeline = obj.model ? pipeline(obj.model->vertexFormat()) : _pipeline.get();
+	if (!objPipeline) return;
+	objPipeline->cmdBind(frameInfo.commandBuffer);
 	auto& Materials = _resources.getResource<Material>();
 	auto& Objects = _resources.getResource<Object>();
 
@@ -132,6 +158,21 @@ void TransparentRenderer::render(
 	if (obj.isActive()) {
 		if (obj.model) {
 			obj.material->cmdBindSet(frameInfo.commandBuffer, _pipelineLayout, sets.size());
+			VkDescriptorSet virtualSet = _engine.pVirtualTextures->set(frameInfo.frameIndex);
+			vkCmdBindDescriptorSets(
+				frameInfo.commandBuffer,
+				VK_PIPELINE_BIND_POINT_GRAPHICS,
+				_pipelineLayout,
+				static_cast<uint32_t>(sets.size()) + 1,
+				1,
+				&virtualSet,
+				0,
+				nullptr);
+			const float uvPerPixel = obj.model->uvPerPixel(
+				obj.transformMat(),
+				_engine.globalUbo.projView,
+				static_cast<float>(_engine.globalUbo.height));
+			if (uvPerPixel >= 0.f) obj.material->markDrawn(frameInfo.runningTime, uvPerPixel);
 			const uint32_t offsets = obj.getOffset();
 			auto pushConstants = obj.material->pushConstants;
 			vkCmdBindDescriptorSets(
@@ -49,11 +49,16 @@ private:
 
 	std::shared_ptr<Shader> _vert;
 	std::shared_ptr<Shader> _frag;
+	std::shared_ptr<Shader> _packedVert;
 
 	VkPipelineLayout _pipelineLayout;
 	PipelineConfig _config{};
 	std::unique_ptr<GraphicsPipeline> _pipeline;
+	// for models in the engine's packed vertex format
+	VertexFormat _packedFormat{ VertexFormat::FULL };
+	std::unique_ptr<GraphicsPipeline> _packedPipeline;
 
+	GraphicsPipeline* pipeline(VertexFormat format);
 };
 
 }
@@ -0,0 +1,496 @@
+#include "resources/environment.hpp"
+#include "resources/hdr_decoder.hpp"
+#include "utils/engine.hpp"
+#include "utils/mapped_file.hpp"
+#include "utils/thread_pool.hpp"
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <stb_image.h>
+
+namespace naku {
+
+namespace {
+
+struct CacheHeader {
+	char magic[4]{ 'N', 'K', 'I', 'B' };
+	uint32_t version{ Environment::VERSION };
+	uint32_t faceSize{ 0 };
+	uint32_t levels{ 0 };
+	glm::vec4 sh[9]{};
+};
+
+// a float cube, the faces one after another
+struct Cube {
+	uint32_t size{ 0 };
+	std::vector<glm::vec4> texels;
+
+	const glm::vec4& texel(uint32_t face, uint32_t x, uint32_t y) const {
+		return texels[(static_cast<size_t>(face) * size + y) * size + x];
+	}
+};
+
+uint16_t toHalf(float value) {
+	return static_cast<uint16_t>(glm::packHalf1x16(glm::clamp(value, -65504.f, 65504.f)));
+}
+
+// face and u, v in [0, 1] of a direction, the inverse of Environment::cubeDirection
+uint32_t cubeFace(const glm::vec3& dir, float* u, float* v) {
+	const glm::vec3 a = glm::abs(dir);
+	uint32_t face;
+	float sc, tc, ma;
+	if (a.x >= a.y && a.x >= a.z) {
+		face = dir.x > 0.f ? 0 : 1;
+		ma = a.x;
+		sc = dir.x > 0.f ? -dir.z : dir.z;
+		tc = -dir.y;
+	}
+	else if (a.y >= a.z) {
+		face = dir.y > 0.f ? 2 : 3;
+		ma = a.y;
+		sc = dir.x;
+		tc = dir.y > 0.f ? dir.z : -dir.z;
+	}
+	else {
+		face = dir.z > 0.f ? 4 : 5;
+		ma = a.z;
+		sc = dir.z > 0.f ? dir.x : -dir.x;
+		tc = -dir.y;
+	}
+	*u = 0.5f * (sc / ma + 1.f);
+	*v = 0.5f * (tc / ma + 1.f);
+	return face;
+}
+
+// bilinear within a face, the edges are clamped
+glm::vec4 sampleCube(const Cube& cube, const glm::vec3& dir) {
+	float u, v;
+	const uint32_t face = cubeFace(dir, &u, &v);
+	const float x = glm::clamp(u * cube.size - 0.5f, 0.f, cube.size - 1.f);
+	const float y = glm::clamp(v * cube.size - 0.5f, 0.f, cube.size - 1.f);
+	const uint32_t x0 = static_cast<uint32_t>(x), y0 = static_cast<uint32_t>(y);
+	const uint32_t x1 = std::min(x0 + 1, cube.size - 1), y1 = std::min(y0 + 1, cube.size - 1);
+	const float fx = x - x0, fy = y - y0;
+	return glm::mix(
+		glm::mix(cube.texel(face, x0, y0), cube.texel(face, x1, y0), fx),
+		glm::mix(cube.texel(face, x0, y1), cube.texel(face, x1, y1), fx), fy);
+}
+
+Cube downsample(const Cube& cube) {
+	Cube next;
+	next.size = std::max(cube.size / 2, 1u);
+	next.texels.resize(6 * static_cast<size_t>(next.size) * next.size);
+	for (uint32_t face = 0; face < 6; face++) {
+		for (uint32_t y = 0; y < next.size; y++) {
+			for (uint32_t x = 0; x < next.size; x++) {
+				const uint32_t x0 = std::min(2 * x, cube.size - 1), x1 = std::min(2 * x + 1, cube.size - 1);
+				const uint32_t y0 = std::min(2 * y, cube.size - 1), y1 = std::min(2 * y + 1, cube.size - 1);
+				next.texels[(static_cast<size_t>(face) * next.size + y) * next.size + x] = 0.25f * (
+					cube.texel(face, x0, y0) + cube.texel(face, x1, y0) + cube.texel(face, x0, y1) + cube.texel(face, x1, y1));
+			}
+		}
+	}
+	return next;
+}
+
+glm::vec2 hammersley(uint32_t i, uint32_t count) {
+	uint32_t bits = i;
+	bits = (bits << 16u) | (bits >> 16u);
+	bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+	bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+	bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+	bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+	return { static_cast<float>(i) / count, bits * 2.3283064365386963e-10f };
+}
+
+// a half vector around n, distributed like the ggx lobe of roughness
+glm::vec3 sampleGGX(const glm::vec2& xi, const glm::vec3& n, float roughness) {
+	const float a = roughness * roughness;
+	const float phi = 2.f * glm::pi<float>() * xi.x;
+	const float cosTheta = std::sqrt((1.f - xi.y) / (1.f + (a * a - 1.f) * xi.y));
+	const float sinTheta = std::sqrt(1.f - cosTheta * cosTheta);
+	const glm::vec3 up = std::abs(n.z) < 0.999f ? glm::vec3{ 0.f, 0.f, 1.f } : glm::vec3{ 1.f, 0.f, 0.f };
+	const glm::vec3 tangent = glm::normalize(glm::cross(up, n));
+	const glm::vec3 bitangent = glm::cross(n, tangent);
+	return glm::normalize(tangent * (sinTheta * std::cos(phi)) + bitangent * (sinTheta * std::sin(phi)) + n * cosTheta);
+}
+
+float distributionGGX(float NdotH, float roughness) {
+	const float a2 = roughness * roughness * roughness * roughness;
+	const float d = NdotH * NdotH * (a2 - 1.f) + 1.f;
+	return a2 / (glm::pi<float>() * d * d);
+}
+
+// one level of the specular cube. a sample is read from the mip of the source whose texels
+// cover about its solid angle, so a few of them don't alias
+void prefilter(const std::vector<Cube>& chain, float roughness, uint32_t size, glm::vec4* out) {
+	const float texelSolidAngle = 4.f * glm::pi<float>() / (6.f * chain[0].size * chain[0].size);
+	const float coarsest = static_cast<float>(chain.size() - 1);
+	ThreadPool::shared().parallelFor(6 * size, [&](size_t first, size_t last) {
+		for (size_t row = first; row < last; row++) {
+			const uint32_t face = static_cast<uint32_t>(row / size), y = static_cast<uint32_t>(row % size);
+			for (uint32_t x = 0; x < size; x++) {
+				// the view is taken along the normal, as split sum prefiltering does
+				const glm::vec3 n = Environment::cubeDirection(face, (x + 0.5f) / size, (y + 0.5f) / size);
+				glm::vec3 color{ 0.f };
+				float weight = 0.f;
+				for (uint32_t i = 0; i < Environment::SAMPLE_COUNT; i++) {
+					const glm::vec3 h = sampleGGX(hammersley(i, Environment::SAMPLE_COUNT), n, roughness);
+					const float NdotH = glm::dot(n, h);
+					const glm::vec3 l = 2.f * NdotH * h - n;
+					const float NdotL = glm::dot(n, l);
+					if (NdotL <= 0.f) continue;
+
+					const float pdf = distributionGGX(NdotH, roughness) / 4.f + 1e-4f;
+					const float sampleSolidAngle = 1.f / (Environment::SAMPLE_COUNT * pdf);
+					const float mip = glm::clamp(0.5f * std::log2(sampleSolidAngle / texelSolidAngle) + 1.f, 0.f, coarsest);
+					const uint32_t m0 = static_cast<uint32_t>(mip);
+					const uint32_t m1 = std::min(m0 + 1, static_cast<uint32_t>(coarsest));
+					color += glm::vec3(glm::mix(sampleCube(chain[m0], l), sampleCube(chain[m1], l), mip - m0)) * NdotL;
+					weight += NdotL;
+				}
+				out[row * size + x] = glm::vec4(color / std::max(weight, 1e-4f), 1.f);
+			}
+		}
+	});
+}
+
+void shBasis(const glm::vec3& d, float* basis) {
+	basis[0] = 0.282095f;
+	basis[1] = 0.488603f * d.y;
+	basis[2] = 0.488603f * d.z;
+	basis[3] = 0.488603f * d.x;
+	basis[4] = 1.092548f * d.x * d.y;
+	basis[5] = 1.092548f * d.y * d.z;
+	basis[6] = 0.315392f * (3.f * d.z * d.z - 1.f);
+	basis[7] = 1.092548f * d.x * d.z;
+	basis[8] = 0.546274f * (d.x * d.x - d.y * d.y);
+}
+
+// irradiance over pi as 9 coefficients, the radiance projected and convolved with the cosine lobe
+void projectSH(const Cube& cube, glm::vec4* sh) {
+	glm::vec3 sum[9]{};
+	float basis[9];
+	for (uint32_t face = 0; face < 6; face++) {
+		for (uint32_t y = 0; y < cube.size; y++) {
+			for (uint32_t x = 0; x < cube.size; x++) {
+				const float u = (x + 0.5f) / cube.size, v = (y + 0.5f) / cube.size;
+				const float s = 2.f * u - 1.f, t = 2.f * v - 1.f;
+				const float solidAngle = 4.f / (cube.size * cube.size * std::pow(1.f + s * s + t * t, 1.5f));
+				shBasis(Environment::cubeDirection(face, u, v), basis);
+				const glm::vec3 radiance = cube.texel(face, x, y);
+				for (uint32_t i = 0; i < 9; i++) sum[i] += radiance * basis[i] * solidAngle;
+			}
+		}
+	}
+	// pi, 2pi/3 and pi/4 of the cosine lobe per band, over pi
+	const float bands[9]{ 1.f, 2.f / 3.f, 2.f / 3.f, 2.f / 3.f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+	for (uint32_t i = 0; i < 9; i++) sh[i] = glm::vec4(sum[i] * bands[i], 0.f);
+}
+
+std::vector<glm::vec4> halvePanorama(const std::vector<glm::vec4>& panorama, int* width, int* height) {
+	const int w = std::max(*width / 2, 1), h = std::max(*height / 2, 1);
+	std::vector<glm::vec4> half(static_cast<size_t>(w) * h);
+	for (int y = 0; y < h; y++) {
+		for (int x = 0; x < w; x++) {
+			const int x0 = std::min(2 * x, *width - 1), x1 = std::min(2 * x + 1, *width - 1);
+			const int y0 = std::min(2 * y, *height - 1), y1 = std::min(2 * y + 1, *height - 1);
+			half[static_cast<size_t>(y) * w + x] = 0.25f * (
+				panorama[static_cast<size_t>(y0) * *width + x0] + panorama[static_cast<size_t>(y0) * *width + x1] +
+				panorama[static_cast<size_t>(y1) * *width + x0] + panorama[static_cast<size_t>(y1) * *width + x1]);
+		}
+	}
+	*width = w;
+	*height = h;
+	return half;
+}
+
+size_t texelCount(uint32_t faceSize, uint32_t levels) {
+	size_t count = 0;
+	for (uint32_t level = 0; level < levels; level++) {
+		const size_t size = std::max(faceSize >> level, 1u);
+		count += 6 * size * size * 4;
+	}
+	return count;
+}
+
+bool readCache(const std::string& path, Environment::Baked* baked) {
+	MappedFile file{ path };
+	CacheHeader header;
+	if (file.size() < sizeof(header)) return false;
+	memcpy(&header, file.data(), sizeof(header));
+	if (memcmp(header.magic, "NKIB", 4) != 0 || header.version != Environment::VERSION) return false;
+	const size_t count = texelCount(header.faceSize, header.levels);
+	if (file.size() != sizeof(header) + count * sizeof(uint16_t)) {
+		std::cerr << "Warning: Environment cache " << path << " is truncated." << std::endl;
+		return false;
+	}
+	baked->faceSize = header.faceSize;
+	baked->levels = header.levels;
+	memcpy(baked->sh, header.sh, sizeof(header.sh));
+	baked->texels.resize(count);
+	memcpy(baked->texels.data(), file.data() + sizeof(header), count * sizeof(uint16_t));
+	return true;
+}
+
+// written to a temporary file first so a half written one is never picked up
+void writeCache(const std::string& path, const void* header, size_t headerSize, const void* data, size_t size) {
+	const std::string tmpPath = path + ".tmp";
+	try {
+		std::filesystem::create_directories(TEXTURE_CACHE_DIR);
+		{
+			std::ofstream file{ tmpPath, std::ios::binary };
+			if (headerSize) file.write(static_cast<const char*>(header), headerSize);
+			file.write(static_cast<const char*>(data), size);
+			if (!file) {
+				std::cerr << "Warning: Environment: failed to write file: " << tmpPath << std::endl;
+				return;
+			}
+		}
+		std::filesystem::rename(tmpPath, path);
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Warning: Environment: " << e.what() << std::endl;
+	}
+}
+
+}
+
+Environment::Environment(Engine& engine) : _engine{ engine } {
+	Baked baked{};
+	baked.texels.resize(texelCount(1, 1), 0);
+	createSpecular(baked);
+	createBrdfLut({ 0, 0 }, 1);
+}
+
+Environment::Environment(Engine& engine, const std::string& filePath) : _engine{ engine } {
+	Baked baked{};
+	if (!bake(filePath, &baked))
+		throw std::runtime_error("Error: Can not load environment map: " + filePath);
+	createSpecular(baked);
+	createBrdfLut(bakeBrdfLut(), LUT_SIZE);
+	memcpy(_sh, baked.sh, sizeof(_sh));
+	_loaded = true;
+}
+
+glm::vec3 Environment::cubeDirection(uint32_t face, float u, float v) {
+	const float sc = 2.f * u - 1.f, tc = 2.f * v - 1.f;
+	switch (face) {
+	case 0: return glm::normalize(glm::vec3{ 1.f, -tc, -sc });
+	case 1: return glm::normalize(glm::vec3{ -1.f, -tc, sc });
+	case 2: return glm::normalize(glm::vec3{ sc, 1.f, tc });
+	case 3: return glm::normalize(glm::vec3{ sc, -1.f, -tc });
+	case 4: return glm::normalize(glm::vec3{ sc, -tc, 1.f });
+	default: return glm::normalize(glm::vec3{ -sc, -tc, -1.f });
+	}
+}
+
+bool Environment::loadPanorama(const std::string& filePath, std::vector<glm::vec4>* texels, int* width, int* height) {
+	if (HdrDecoder::isHdr(filePath)) {
+		std::vector<uint16_t> halfs;
+		std::string warn;
+		if (!HdrDecoder::decode(filePath, &halfs, width, height, &warn)) {
+			std::cerr << "Error: Can not load image file at: " << filePath << ": " << warn;
+			return false;
+		}
+		texels->resize(halfs.size() / 4);
+		for (size_t i = 0; i < texels->size(); i++) {
+			(*texels)[i] = {
+				glm::unpackHalf1x16(halfs[4 * i]), glm::unpackHalf1x16(halfs[4 * i + 1]),
+				glm::unpackHalf1x16(halfs[4 * i + 2]), glm::unpackHalf1x16(halfs[4 * i + 3]) };
+		}
+		return true;
+	}
+
+	// stb converts 8 bit files to linear
+	int c;
+	float* data = stbi_loadf(filePath.c_str(), width, height, &c, STBI_rgb_alpha);
+	if (data == nullptr) {
+		std::cerr << "Error: Can not load image file at: " << filePath << std::endl;
+		return false;
+	}
+	texels->resize(static_cast<size_t>(*width) * *height);
+	memcpy(texels->data(), data, texels->size() * sizeof(glm::vec4));
+	stbi_image_free(data);
+	return true;
+}
+
+std::vector<glm::vec4> Environment::panoramaToCube(const std::vector<glm::vec4>& panorama, int width, int height, uint32_t faceSize) {
+	// a face texel spans about 4 panorama texels across at most, coarser sources would alias
+	std::vector<glm::vec4> source;
+	const std::vector<glm::vec4>* pSource = &panorama;
+	while (static_cast<uint32_t>(width) > 8 * faceSize) {
+		source = halvePanorama(*pSource, &width, &height);
+		pSource = &source;
+	}
+
+	std::vector<glm::vec4> faces(6 * static_cast<size_t>(faceSize) * faceSize);
+	ThreadPool::shared().parallelFor(6 * faceSize, [&](size_t first, size_t last) {
+		for (size_t row = first; row < last; row++) {
+			const uint32_t face = static_cast<uint32_t>(row / faceSize), y = static_cast<uint32_t>(row % faceSize);
+			for (uint32_t x = 0; x < faceSize; x++) {
+				const glm::vec3 dir = cubeDirection(face, (x + 0.5f) / faceSize, (y + 0.5f) / faceSize);
+				// -y is up in the scenes
+				const float u = 0.5f + std::atan2(dir.z, dir.x) / (2.f * glm::pi<float>());
+				const float v = std::acos(glm::clamp(-dir.y, -1.f, 1.f)) / glm::pi<float>();
+
+				const float px = u * width - 0.5f;
+				const float py = glm::clamp(v * height - 0.5f, 0.f, height - 1.f);
+				const int x0 = static_cast<int>(std::floor(px)), y0 = static_cast<int>(py);
+				const int y1 = std::min(y0 + 1, height - 1);
+				const float fx = px - x0, fy = py - y0;
+				// wraps around horizontally
+				const int wx0 = (x0 % width + width) % width, wx1 = (wx0 + 1) % width;
+				const auto& p = *pSource;
+				faces[row * faceSize + x] = glm::mix(
+					glm::mix(p[static_cast<size_t>(y0) * width + wx0], p[static_cast<size_t>(y0) * width + wx1], fx),
+					glm::mix(p[static_cast<size_t>(y1) * width + wx0], p[static_cast<size_t>(y1) * width + wx1], fx), fy);
+			}
+		}
+	});
+	return faces;
+}
+
+bool Environment::bake(const std::string& filePath, Baked* baked) {
+	try {
+		const uint32_t options[4]{ VERSION, MAX_FACE_SIZE, MAX_LEVELS, SAMPLE_COUNT };
+		const uint64_t sourceHash = MappedFile{ filePath }.hash();
+		const std::string path = std::string(TEXTURE_CACHE_DIR) + "/" + hashToString(hashMemory(options, sizeof(options), sourceHash)) + ".ibl";
+		if (doesFileExist(path) && readCache(path, baked)) return true;
+
+		std::vector<glm::vec4> panorama;
+		int width, height;
+		if (!loadPanorama(filePath, &panorama, &width, &height)) return false;
+
+		// a power of two about as sharp as the panorama
+		uint32_t faceSize = 1;
+		while (faceSize * 2 <= std::min(static_cast<uint32_t>(width) / 4, MAX_FACE_SIZE)) faceSize *= 2;
+		std::vector<Cube> chain(1);
+		chain[0].size = faceSize;
+		chain[0].texels = panoramaToCube(panorama, width, height, faceSize);
+		while (chain.back().size > 1) chain.push_back(downsample(chain.back()));
+
+		baked->faceSize = faceSize;
+		baked->levels = std::min(MAX_LEVELS, static_cast<uint32_t>(chain.size()));
+		baked->texels.clear();
+		baked->texels.reserve(texelCount(faceSize, baked->levels));
+		std::vector<glm::vec4> level;
+		for (uint32_t l = 0; l < baked->levels; l++) {
+			const uint32_t size = faceSize >> l;
+			if (l == 0) level = chain[0].texels;
+			else {
+				level.resize(6 * static_cast<size_t>(size) * size);
+				prefilter(chain, static_cast<float>(l) / (baked->levels - 1), size, level.data());
+			}
+			for (const auto& texel : level) {
+				for (int c = 0; c < 4; c++) baked->texels.push_back(toHalf(texel[c]));
+			}
+		}
+
+		// irradiance is smooth, a coarse mip is plenty
+		size_t coarse = 0;
+		while (chain[coarse].size > 32) coarse++;
+		projectSH(chain[coarse], baked->sh);
+
+		CacheHeader header;
+		header.faceSize = baked->faceSize;
+		header.levels = baked->levels;
+		memcpy(header.sh, baked->sh, sizeof(header.sh));
+		writeCache(path, &header, sizeof(header), baked->texels.data(), baked->texels.size() * sizeof(uint16_t));
+		return true;
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Error: Environment: " << e.what() << std::endl;
+		return false;
+	}
+}
+
+std::vector<uint16_t> Environment::bakeBrdfLut() {
+	const uint32_t options[3]{ VERSION, LUT_SIZE, LUT_SAMPLE_COUNT };
+	const std::string path = std::string(TEXTURE_CACHE_DIR) + "/" + hashToString(hashMemory(options, sizeof(options))) + ".lut";
+	std::vector<uint16_t> texels(LUT_SIZE * LUT_SIZE * 2);
+	if (doesFileExist(path)) {
+		try {
+			MappedFile file{ path };
+			if (file.size() == texels.size() * sizeof(uint16_t)) {
+				memcpy(texels.data(), file.data(), file.size());
+				return texels;
+			}
+		}
+		catch (const std::exception& e) {
+			std::cerr << "Warning: Environment: " << e.what() << std::endl;
+		}
+	}
+
+	ThreadPool::shared().parallelFor(LUT_SIZE, [&](size_t first, size_t last) {
+		for (size_t y = first; y < last; y++) {
+			const float roughness = (y + 0.5f) / LUT_SIZE;
+			// schlick ggx with k for image based lighting
+			const float k = roughness * roughness / 2.f;
+			for (uint32_t x = 0; x < LUT_SIZE; x++) {
+				const float NdotV = (x + 0.5f) / LUT_SIZE;
+				const glm::vec3 v{ std::sqrt(1.f - NdotV * NdotV), 0.f, NdotV };
+				float scale = 0.f, bias = 0.f;
+				for (uint32_t i = 0; i < LUT_SAMPLE_COUNT; i++) {
+					const glm::vec3 h = sampleGGX(hammersley(i, LUT_SAMPLE_COUNT), { 0.f, 0.f, 1.f }, roughness);
+					const glm::vec3 l = 2.f * glm::dot(v, h) * h - v;
+					const float NdotL = l.z, NdotH = std::max(h.z, 0.f), VdotH = std::max(glm::dot(v, h), 0.f);
+					if (NdotL <= 0.f) continue;
+					const float g = NdotV / (NdotV * (1.f - k) + k) * NdotL / (NdotL * (1.f - k) + k);
+					const float visibility = g * VdotH / (NdotH * NdotV);
+					const float fresnel = std::pow(1.f - VdotH, 5.f);
+					scale += (1.f - fresnel) * visibility;
+					bias += fresnel * visibility;
+				}
+				texels[(y * LUT_SIZE + x) * 2] = toHalf(scale / LUT_SAMPLE_COUNT);
+				texels[(y * LUT_SIZE + x) * 2 + 1] = toHalf(bias / LUT_SAMPLE_COUNT);
+			}
+		}
+	});
+	writeCache(path, nullptr, 0, texels.data(), texels.size() * sizeof(uint16_t));
+	return texels;
+}
+
+void Environment::createSpecular(const Baked& baked) {
+	Device& device = *_engine.pDevice;
+	auto createInfo = Image2D::getDefaultCubeMapCreateInfo({ baked.faceSize, baked.faceSize });
+	createInfo.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+	createInfo.mipLevels = baked.levels;
+	_specular = std::make_shared<Image2D>(device, "environment", createInfo);
+
+	Buffer stagingBuffer{
+		device,
+		sizeof(uint16_t),
+		static_cast<uint32_t>(baked.texels.size()),
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+	};
+	stagingBuffer.writeToBuffer(const_cast<uint16_t*>(baked.texels.data()), baked.texels.size() * sizeof(uint16_t));
+
+	// the prefiltered levels go up as they are, each with its 6 faces
+	std::vector<VkBufferImageCopy> regions(baked.levels);
+	VkDeviceSize offset = 0;
+	for (uint32_t level = 0; level < baked.levels; level++) {
+		const uint32_t size = std::max(baked.faceSize >> level, 1u);
+		regions[level].bufferOffset = offset;
+		regions[level].imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 6 };
+		regions[level].imageExtent = { size, size, 1 };
+		offset += 6ull * size * size * 4 * sizeof(uint16_t);
+	}
+
+	auto cmd = device.beginSingleTimeCommands();
+	Image2D::transitImageLayout(device, cmd, _specular->image(), _specular->format(),
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, baked.levels, 0, 6);
+	vkCmdCopyBufferToImage(cmd, stagingBuffer.getBuffer(), _specular->image(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		static_cast<uint32_t>(regions.size()), regions.data());
+	Image2D::transitImageLayout(device, cmd, _specular->image(), _specular->format(),
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, baked.levels, 0, 6);
+	device.endSingleTimeCommands(cmd);
+}
+
+void Environment::createBrdfLut(const std::vector<uint16_t>& texels, uint32_t size) {
+	_brdfLut = Image2D::loadImageFromPixels(*_engine.pDevice, "brdf_lut", texels.data(), size, size, 2, true, 0, false);
+}
+
+}
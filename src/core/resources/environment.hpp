@@ -0,0 +1,71 @@
+#ifndef ENVIRONMENT_HPP
+#define ENVIRONMENT_HPP
+
+#include "naku.hpp"
+#include "resources/image.hpp"
+
+namespace naku {
+
+class Engine;
+
+// image based lighting from an equirectangular panorama. the expensive parts are baked once on
+// the thread pool and cached like textures, named after the content hash of the source: a half
+// float cubemap prefiltered with ggx, one roughness per mip, and the irradiance as 9 sh
+// coefficients. the split sum brdf lut doesn't depend on the source and has a cache file of
+// its own. opaque.frag only samples them.
+class Environment {
+public:
+	static constexpr uint32_t VERSION = 1;
+	static constexpr uint32_t MAX_FACE_SIZE = 256;
+	static constexpr uint32_t MAX_LEVELS = 6; // roughness 0, 0.2 ... 1
+	static constexpr uint32_t SAMPLE_COUNT = 64; // ggx samples per prefiltered texel
+	static constexpr uint32_t LUT_SIZE = 128;
+	static constexpr uint32_t LUT_SAMPLE_COUNT = 256;
+
+	// what's baked from a source, also the layout of the cache file after its header
+	struct Baked {
+		uint32_t faceSize{ 1 };
+		uint32_t levels{ 1 };
+		glm::vec4 sh[9]{}; // irradiance over pi, xyz
+		std::vector<uint16_t> texels; // rgba halfs, level by level, 6 faces each
+	};
+
+	// an environment that lights nothing, bound until one is loaded
+	Environment(Engine& engine);
+	// throws if the panorama can't be loaded
+	Environment(Engine& engine, const std::string& filePath);
+	Environment(const Environment&) = delete;
+	Environment& operator=(const Environment&) = delete;
+
+	Image2D& specular() const { return *_specular; }
+	Image2D& brdfLut() const { return *_brdfLut; }
+	const glm::vec4* sh() const { return _sh; }
+	uint32_t levels() const { return _specular->mipLevels(); }
+	bool loaded() const { return _loaded; }
+
+	// the baked lighting of a panorama, read from the cache if it's there. false on failure
+	static bool bake(const std::string& filePath, Baked* baked);
+	// rg halfs of LUT_SIZE x LUT_SIZE, scale and bias to f0 by n.v along x and roughness along y
+	static std::vector<uint16_t> bakeBrdfLut();
+
+	// linear rgba of a panorama, ldr files are taken as srgb
+	static bool loadPanorama(const std::string& filePath, std::vector<glm::vec4>* texels, int* width, int* height);
+	// resamples a panorama into the 6 faces of a cube, in vulkan's face order
+	static std::vector<glm::vec4> panoramaToCube(const std::vector<glm::vec4>& panorama, int width, int height, uint32_t faceSize);
+	// direction through u, v in [0, 1] of a face
+	static glm::vec3 cubeDirection(uint32_t face, float u, float v);
+
+private:
+	Engine& _engine;
+	std::shared_ptr<Image2D> _specular;
+	std::shared_ptr<Image2D> _brdfLut;
+	glm::vec4 _sh[9]{};
+	bool _loaded{ false };
+
+	void createSpecular(const Baked& baked);
+	void createBrdfLut(const std::vector<uint16_t>& texels, uint32_t size);
+};
+
+}
+
+#endif
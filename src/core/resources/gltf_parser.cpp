@@ -0,0 +1,585 @@
+#include "resources/gltf_parser.hpp"
+
+#include <glm/gtc/quaternion.hpp>
+#include <stb_image.h>
+
+namespace naku {
+
+namespace {
+
+constexpr uint32_t GLB_MAGIC = 0x46546C67;      // "glTF"
+constexpr uint32_t GLB_CHUNK_JSON = 0x4E4F534A; // "JSON"
+constexpr uint32_t GLB_CHUNK_BIN = 0x004E4942;  // "BIN\0"
+
+enum ComponentType : uint32_t {
+	BYTE = 5120,
+	UNSIGNED_BYTE = 5121,
+	SHORT = 5122,
+	UNSIGNED_SHORT = 5123,
+	UNSIGNED_INT = 5125,
+	FLOAT = 5126,
+};
+
+enum PrimitiveMode : uint32_t {
+	TRIANGLES = 4,
+	TRIANGLE_STRIP = 5,
+	TRIANGLE_FAN = 6,
+};
+
+uint32_t componentSize(uint32_t componentType) {
+	switch (componentType) {
+	case BYTE: case UNSIGNED_BYTE: return 1;
+	case SHORT: case UNSIGNED_SHORT: return 2;
+	case UNSIGNED_INT: case FLOAT: return 4;
+	default: return 0;
+	}
+}
+
+uint32_t componentCount(const std::string& type) {
+	if (type == "SCALAR") return 1;
+	if (type == "VEC2") return 2;
+	if (type == "VEC3") return 3;
+	if (type == "VEC4") return 4;
+	if (type == "MAT2") return 4;
+	if (type == "MAT3") return 9;
+	if (type == "MAT4") return 16;
+	return 0;
+}
+
+template<typename T>
+T load(const char* p) {
+	T value;
+	memcpy(&value, p, sizeof(T));
+	return value;
+}
+
+float readComponent(const char* p, uint32_t componentType, bool normalized) {
+	switch (componentType) {
+	case BYTE: {
+		const float v = load<int8_t>(p);
+		return normalized ? std::max(v / 127.f, -1.f) : v;
+	}
+	case UNSIGNED_BYTE: {
+		const float v = load<uint8_t>(p);
+		return normalized ? v / 255.f : v;
+	}
+	case SHORT: {
+		const float v = load<int16_t>(p);
+		return normalized ? std::max(v / 32767.f, -1.f) : v;
+	}
+	case UNSIGNED_SHORT: {
+		const float v = load<uint16_t>(p);
+		return normalized ? v / 65535.f : v;
+	}
+	case UNSIGNED_INT: return static_cast<float>(load<uint32_t>(p));
+	case FLOAT: return load<float>(p);
+	default: return 0.f;
+	}
+}
+
+bool decodeBase64(const char* str, size_t size, std::vector<char>* out) {
+	static const auto table = [] {
+		std::array<int8_t, 256> t;
+		t.fill(-1);
+		const char* digits = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		for (int8_t i = 0; i < 64; i++) t[static_cast<unsigned char>(digits[i])] = i;
+		return t;
+	}();
+	out->clear();
+	out->reserve(size / 4 * 3);
+	uint32_t bits = 0;
+	int count = 0;
+	for (size_t i = 0; i < size; i++) {
+		const unsigned char c = str[i];
+		if (c == '=') break;
+		if (table[c] < 0) return false;
+		bits = (bits << 6) | table[c];
+		count += 6;
+		if (count >= 8) {
+			count -= 8;
+			out->push_back(static_cast<char>((bits >> count) & 0xFF));
+		}
+	}
+	return true;
+}
+
+// matrix of a node relative to its parent
+glm::mat4 nodeMatrix(const nlohmann::json& node) {
+	if (node.contains("matrix")) {
+		std::array<float, 16> m;
+		for (int i = 0; i < 16; i++) m[i] = node["matrix"][i];
+		return glm::make_mat4(m.data()); // column major in both
+	}
+	glm::vec3 t{ 0.f }, s{ 1.f };
+	glm::quat r{ 1.f, 0.f, 0.f, 0.f };
+	if (node.contains("translation")) t = glm::vec3{ node["translation"][0], node["translation"][1], node["translation"][2] };
+	if (node.contains("rotation")) r = glm::quat{ node["rotation"][3], node["rotation"][0], node["rotation"][1], node["rotation"][2] };
+	if (node.contains("scale")) s = glm::vec3{ node["scale"][0], node["scale"][1], node["scale"][2] };
+	return glm::translate(glm::mat4{ 1.f }, t) * glm::mat4_cast(r) * glm::scale(glm::mat4{ 1.f }, s);
+}
+
+}
+
+bool GltfData::parse(GltfData* data, const std::string& filePath, std::string* warn) {
+	data->filePath = filePath;
+	data->json = nlohmann::json{};
+	data->_files.clear();
+	data->_decoded.clear();
+	data->_buffers.clear();
+
+	std::unique_ptr<MappedFile> file;
+	try {
+		file = std::make_unique<MappedFile>(filePath);
+	}
+	catch (const std::exception& e) {
+		if (warn) *warn += std::string(e.what()) + "\n";
+		return false;
+	}
+
+	// a glb is a 12 byte header followed by a json chunk and an optional binary chunk
+	Span jsonChunk{ file->data(), file->size() };
+	Span binChunk{};
+	if (file->size() >= 12 && load<uint32_t>(file->data()) == GLB_MAGIC) {
+		const char* p = file->data() + 12;
+		const char* end = file->data() + std::min<size_t>(file->size(), load<uint32_t>(file->data() + 8));
+		jsonChunk = {};
+		while (p + 8 <= end) {
+			const uint32_t chunkSize = load<uint32_t>(p);
+			const uint32_t chunkType = load<uint32_t>(p + 4);
+			p += 8;
+			if (chunkSize > static_cast<size_t>(end - p)) break;
+			if (chunkType == GLB_CHUNK_JSON && !jsonChunk.data) jsonChunk = { p, chunkSize };
+			if (chunkType == GLB_CHUNK_BIN && !binChunk.data) binChunk = { p, chunkSize };
+			p += (chunkSize + 3) & ~3u;
+		}
+		if (!jsonChunk.data) {
+			if (warn) *warn += "glb file has no json chunk.\n";
+			return false;
+		}
+	}
+
+	try {
+		data->json = nlohmann::json::parse(jsonChunk.data, jsonChunk.data + jsonChunk.size);
+	}
+	catch (const std::exception& e) {
+		if (warn) *warn += std::string(e.what()) + "\n";
+		return false;
+	}
+	const std::string version = data->json["asset"].value("version", "");
+	if (version.empty() || version[0] != '2') {
+		if (warn) *warn += "unsupported glTF version " + version + ".\n";
+		return false;
+	}
+	data->hash = hashMemory(jsonChunk.data, jsonChunk.size);
+
+	if (data->json.contains("buffers")) {
+		const auto& buffers = data->json["buffers"];
+		data->_buffers.resize(buffers.size());
+		for (size_t i = 0; i < buffers.size(); i++) {
+			Span& span = data->_buffers[i];
+			const std::string uri = buffers[i].value("uri", "");
+			if (uri.empty()) {
+				// only the first buffer may live in the glb binary chunk
+				if (i == 0 && binChunk.data) span = binChunk;
+				else if (warn) *warn += "buffer " + std::to_string(i) + " has no data.\n";
+			}
+			else if (strStartWith(uri, "data:")) {
+				const size_t comma = uri.find(',');
+				std::vector<char> decoded;
+				if (comma == std::string::npos || comma < 7 ||
+					uri.compare(comma - 7, 7, ";base64") != 0 ||
+					!decodeBase64(uri.data() + comma + 1, uri.size() - comma - 1, &decoded)) {
+					if (warn) *warn += "buffer " + std::to_string(i) + " has an invalid data uri.\n";
+				}
+				else {
+					data->_decoded.push_back(std::move(decoded));
+					span = { data->_decoded.back().data(), data->_decoded.back().size() };
+				}
+			}
+			else {
+				try {
+					data->_files.push_back(std::make_unique<MappedFile>(data->resolveUri(uri)));
+					span = { data->_files.back()->data(), data->_files.back()->size() };
+				}
+				catch (const std::exception& e) {
+					if (warn) *warn += std::string(e.what()) + "\n";
+				}
+			}
+			const size_t byteLength = buffers[i].value("byteLength", size_t(0));
+			if (span.size < byteLength) {
+				if (warn && span.data) *warn += "buffer " + std::to_string(i) + " is truncated.\n";
+				span = {};
+			}
+			else span.size = byteLength;
+			data->hash = hashMemory(span.data, span.size, data->hash);
+		}
+	}
+	// the binary chunk is read from the mapping, so it stays open with the external buffers
+	data->_files.push_back(std::move(file));
+	return true;
+}
+
+uint32_t GltfData::meshCount() const {
+	return json.contains("meshes") ? static_cast<uint32_t>(json["meshes"].size()) : 0;
+}
+
+uint32_t GltfData::primitiveCount(uint32_t mesh) const {
+	return static_cast<uint32_t>(json["meshes"][mesh]["primitives"].size());
+}
+
+int32_t GltfData::primitiveMaterial(uint32_t mesh, uint32_t primitive) const {
+	return json["meshes"][mesh]["primitives"][primitive].value("material", -1);
+}
+
+std::string GltfData::meshName(uint32_t mesh) const {
+	return json["meshes"][mesh].value("name", "mesh" + std::to_string(mesh));
+}
+
+std::string GltfData::materialName(uint32_t material) const {
+	return json["materials"][material].value("name", "material" + std::to_string(material));
+}
+
+std::string GltfData::imageName(uint32_t image) const {
+	return json["images"][image].value("name", "image" + std::to_string(image));
+}
+
+int32_t GltfData::textureImage(uint32_t texture) const {
+	if (!json.contains("textures") || texture >= json["textures"].size()) return -1;
+	return json["textures"][texture].value("source", -1);
+}
+
+std::string GltfData::resolveUri(const std::string& uri) const {
+	// relative to the gltf file, with percent encoded characters
+	std::string path;
+	for (size_t i = 0; i < uri.size(); i++) {
+		if (uri[i] == '%' && i + 2 < uri.size()) {
+			path += static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16));
+			i += 2;
+		}
+		else path += uri[i];
+	}
+	return (std::filesystem::path(filePath).parent_path() / path).string();
+}
+
+bool GltfData::bufferView(uint32_t index, Span* view, size_t* stride, std::string* warn) const {
+	if (!json.contains("bufferViews") || index >= json["bufferViews"].size()) {
+		if (warn) *warn += "buffer view " + std::to_string(index) + " doesn't exist.\n";
+		return false;
+	}
+	const auto& bufferView = json["bufferViews"][index];
+	const uint32_t buffer = bufferView.value("buffer", 0u);
+	const size_t offset = bufferView.value("byteOffset", size_t(0));
+	const size_t length = bufferView.value("byteLength", size_t(0));
+	if (buffer >= _buffers.size() || !_buffers[buffer].data || offset + length > _buffers[buffer].size) {
+		if (warn) *warn += "buffer view " + std::to_string(index) + " is out of range.\n";
+		return false;
+	}
+	*view = { _buffers[buffer].data + offset, length };
+	if (stride) *stride = bufferView.value("byteStride", size_t(0));
+	return true;
+}
+
+bool GltfData::accessor(uint32_t index, Accessor* accessor, std::string* warn) const {
+	if (!json.contains("accessors") || index >= json["accessors"].size()) {
+		if (warn) *warn += "accessor " + std::to_string(index) + " doesn't exist.\n";
+		return false;
+	}
+	const auto& a = json["accessors"][index];
+	*accessor = {};
+	accessor->count = a.value("count", size_t(0));
+	accessor->componentType = a.value("componentType", 0u);
+	accessor->components = componentCount(a.value("type", ""));
+	accessor->normalized = a.value("normalized", false);
+	const size_t elementSize = componentSize(accessor->componentType) * accessor->components;
+	if (elementSize == 0) {
+		if (warn) *warn += "accessor " + std::to_string(index) + " has an invalid type.\n";
+		return false;
+	}
+	if (a.contains("sparse") && warn) *warn += "sparse accessor " + std::to_string(index) + " read without its substitutions.\n";
+	// accessors without a buffer view are all zeros
+	if (!a.contains("bufferView")) return true;
+
+	Span view;
+	size_t stride;
+	if (!bufferView(a["bufferView"], &view, &stride, warn)) return false;
+	const size_t offset = a.value("byteOffset", size_t(0));
+	accessor->stride = stride != 0 ? stride : elementSize;
+	if (accessor->count > 0 && offset + accessor->stride * (accessor->count - 1) + elementSize > view.size) {
+		if (warn) *warn += "accessor " + std::to_string(index) + " is out of range.\n";
+		return false;
+	}
+	accessor->data = view.data + offset;
+	return true;
+}
+
+void GltfData::readFloats(const Accessor& accessor, uint32_t components, void* destination, size_t destinationStride) {
+	if (!accessor.data) return;
+	const uint32_t n = std::min(components, accessor.components);
+	const char* src = accessor.data;
+	char* dst = static_cast<char*>(destination);
+	// float attributes are copied as they are, one memcpy per vertex
+	if (accessor.componentType == FLOAT) {
+		for (size_t i = 0; i < accessor.count; i++, src += accessor.stride, dst += destinationStride)
+			memcpy(dst, src, sizeof(float) * n);
+		return;
+	}
+	const uint32_t size = componentSize(accessor.componentType);
+	for (size_t i = 0; i < accessor.count; i++, src += accessor.stride, dst += destinationStride) {
+		for (uint32_t c = 0; c < n; c++) {
+			const float value = readComponent(src + c * size, accessor.componentType, accessor.normalized);
+			memcpy(dst + c * sizeof(float), &value, sizeof(float));
+		}
+	}
+}
+
+void GltfData::readIndices(const Accessor& accessor, uint32_t* destination) {
+	if (!accessor.data) {
+		std::fill(destination, destination + accessor.count, 0u);
+		return;
+	}
+	if (accessor.componentType == UNSIGNED_INT && accessor.stride == sizeof(uint32_t)) {
+		memcpy(destination, accessor.data, sizeof(uint32_t) * accessor.count);
+		return;
+	}
+	const char* src = accessor.data;
+	for (size_t i = 0; i < accessor.count; i++, src += accessor.stride) {
+		switch (accessor.componentType) {
+		case UNSIGNED_BYTE: destination[i] = load<uint8_t>(src); break;
+		case UNSIGNED_SHORT: destination[i] = load<uint16_t>(src); break;
+		default: destination[i] = load<uint32_t>(src); break;
+		}
+	}
+}
+
+bool GltfData::loadPrimitive(Mesh* mesh, uint32_t meshIndex, uint32_t primitiveIndex, std::string* warn) const {
+	mesh->vertices.clear();
+	mesh->indices.clear();
+	mesh->lods.clear();
+	mesh->meshlets.clear();
+	mesh->filePath = filePath;
+
+	const auto& primitive = json["meshes"][meshIndex]["primitives"][primitiveIndex];
+	const std::string label = meshName(meshIndex) + "[" + std::to_string(primitiveIndex) + "]";
+	const uint32_t mode = primitive.value("mode", static_cast<uint32_t>(TRIANGLES));
+	if (mode != TRIANGLES && mode != TRIANGLE_STRIP && mode != TRIANGLE_FAN) {
+		if (warn) *warn += label + " isn't made of triangles.\n";
+		return false;
+	}
+	const auto& attributes = primitive["attributes"];
+	Accessor position;
+	if (!attributes.contains("POSITION") || !accessor(attributes["POSITION"], &position, warn) ||
+		position.components != 3 || position.count < 3) {
+		if (warn) *warn += label + " has no valid positions.\n";
+		return false;
+	}
+
+	Vertex defaultVertex{};
+	defaultVertex.position = glm::vec3{ 0.f };
+	defaultVertex.normal = glm::vec3{ 0.f };
+	defaultVertex.tangent = glm::vec3{ 0.f };
+	defaultVertex.uv = glm::vec2{ 0.f };
+	defaultVertex.color = glm::vec3{ 1.f };
+	mesh->vertices.assign(position.count, defaultVertex);
+	Vertex* vertices = mesh->vertices.data();
+	readFloats(position, 3, &vertices->position, sizeof(Vertex));
+
+	// optional attributes are ignored if they don't match the positions
+	auto readAttribute = [&](const char* name, uint32_t components, void* destination) {
+		Accessor attribute;
+		if (!attributes.contains(name)) return false;
+		if (!accessor(attributes[name], &attribute, warn) || attribute.count != position.count) {
+			if (warn) *warn += label + " attribute " + name + " ignored.\n";
+			return false;
+		}
+		readFloats(attribute, components, destination, sizeof(Vertex));
+		return true;
+	};
+	const bool hasNormals = readAttribute("NORMAL", 3, &vertices->normal);
+	const bool hasTangents = readAttribute("TANGENT", 3, &vertices->tangent);
+	readAttribute("TEXCOORD_0", 2, &vertices->uv);
+	readAttribute("COLOR_0", 3, &vertices->color);
+
+	std::vector<uint32_t> indices;
+	if (primitive.contains("indices")) {
+		Accessor indexAccessor;
+		if (!accessor(primitive["indices"], &indexAccessor, warn) || indexAccessor.components != 1 ||
+			(indexAccessor.componentType != UNSIGNED_BYTE &&
+			indexAccessor.componentType != UNSIGNED_SHORT &&
+			indexAccessor.componentType != UNSIGNED_INT)) {
+			if (warn) *warn += label + " has invalid indices.\n";
+			mesh->vertices.clear();
+			return false;
+		}
+		indices.resize(indexAccessor.count);
+		readIndices(indexAccessor, indices.data());
+		for (uint32_t index : indices) {
+			if (index >= position.count) {
+				if (warn) *warn += label + " has an index out of range.\n";
+				mesh->vertices.clear();
+				return false;
+			}
+		}
+	}
+	else {
+		indices.resize(position.count);
+		for (uint32_t i = 0; i < indices.size(); i++) indices[i] = i;
+	}
+
+	if (mode == TRIANGLES) {
+		indices.resize(indices.size() / 3 * 3);
+		mesh->indices = std::move(indices);
+	}
+	else {
+		const size_t triangleCount = indices.size() >= 3 ? indices.size() - 2 : 0;
+		mesh->indices.reserve(triangleCount * 3);
+		for (size_t i = 0; i < triangleCount; i++) {
+			if (mode == TRIANGLE_STRIP) {
+				// every other triangle of a strip is flipped to keep the winding
+				mesh->indices.push_back(indices[i + (i & 1)]);
+				mesh->indices.push_back(indices[i + 1 - (i & 1)]);
+				mesh->indices.push_back(indices[i + 2]);
+			}
+			else {
+				mesh->indices.push_back(indices[i + 1]);
+				mesh->indices.push_back(indices[i + 2]);
+				mesh->indices.push_back(indices[0]);
+			}
+		}
+	}
+
+	// gltf faces are counter clockwise
+	for (size_t i = 0; i + 2 < mesh->indices.size(); i += 3)
+		std::swap(mesh->indices[i + 1], mesh->indices[i + 2]);
+
+	if (!hasNormals) {
+		// area weighted normals of the shared vertices, outward for clockwise faces
+		for (size_t i = 0; i + 2 < mesh->indices.size(); i += 3) {
+			Vertex& v0 = vertices[mesh->indices[i]];
+			Vertex& v1 = vertices[mesh->indices[i + 1]];
+			Vertex& v2 = vertices[mesh->indices[i + 2]];
+			const glm::vec3 n = glm::cross(v2.position - v0.position, v1.position - v0.position);
+			v0.normal += n;
+			v1.normal += n;
+			v2.normal += n;
+		}
+		for (auto& vertex : mesh->vertices) {
+			const float length = glm::length(vertex.normal);
+			vertex.normal = length > 0.f ? vertex.normal / length : glm::vec3{ 0.f, 1.f, 0.f };
+		}
+	}
+	if (!hasTangents) Mesh::generateTangents(mesh);
+	return true;
+}
+
+bool GltfData::encodedImage(
+	uint32_t image,
+	Span* encoded,
+	std::vector<char>* decoded,
+	std::unique_ptr<MappedFile>* file,
+	std::string* warn) const {
+	if (!json.contains("images") || image >= json["images"].size()) {
+		if (warn) *warn += "image " + std::to_string(image) + " doesn't exist.\n";
+		return false;
+	}
+	const auto& entry = json["images"][image];
+
+	// encoded bytes come from a buffer view, a data uri or a mapped file
+	if (entry.contains("bufferView")) return bufferView(entry["bufferView"], encoded, nullptr, warn);
+	const std::string uri = entry.value("uri", "");
+	if (strStartWith(uri, "data:")) {
+		const size_t comma = uri.find(',');
+		if (comma == std::string::npos || !decodeBase64(uri.data() + comma + 1, uri.size() - comma - 1, decoded)) {
+			if (warn) *warn += "image " + std::to_string(image) + " has an invalid data uri.\n";
+			return false;
+		}
+		*encoded = { decoded->data(), decoded->size() };
+		return true;
+	}
+	try {
+		*file = std::make_unique<MappedFile>(resolveUri(uri));
+	}
+	catch (const std::exception& e) {
+		if (warn) *warn += std::string(e.what()) + "\n";
+		return false;
+	}
+	*encoded = { (*file)->data(), (*file)->size() };
+	return true;
+}
+
+uint64_t GltfData::imageHash(uint32_t image) const {
+	Span encoded{};
+	std::vector<char> decoded;
+	std::unique_ptr<MappedFile> file;
+	if (!encodedImage(image, &encoded, &decoded, &file, nullptr)) return 0;
+	return hashMemory(encoded.data, encoded.size);
+}
+
+bool GltfData::loadImage(uint32_t image, std::vector<unsigned char>* pixels, int* width, int* height, std::string* warn) const {
+	Span encoded{};
+	std::vector<char> decoded;
+	std::unique_ptr<MappedFile> file;
+	if (!encodedImage(image, &encoded, &decoded, &file, warn)) return false;
+
+	int channels;
+	unsigned char* data = stbi_load_from_memory(
+		reinterpret_cast<const stbi_uc*>(encoded.data),
+		static_cast<int>(encoded.size),
+		width, height, &channels, STBI_rgb_alpha);
+	if (!data) {
+		if (warn) *warn += "image " + imageName(image) + ": " + stbi_failure_reason() + "\n";
+		return false;
+	}
+	pixels->assign(data, data + static_cast<size_t>(*width) * *height * 4);
+	stbi_image_free(data);
+	return true;
+}
+
+std::vector<GltfInstance> GltfData::instances() const {
+	std::vector<GltfInstance> instances;
+	if (!json.contains("nodes")) return instances;
+	const auto& nodes = json["nodes"];
+
+	// roots of the default scene, or every node that isn't a child if there are no scenes
+	std::vector<uint32_t> roots;
+	if (json.contains("scenes") && !json["scenes"].empty()) {
+		const uint32_t scene = std::min<uint32_t>(json.value("scene", 0u), static_cast<uint32_t>(json["scenes"].size()) - 1);
+		for (const auto& node : json["scenes"][scene].value("nodes", nlohmann::json::array()))
+			roots.push_back(node);
+	}
+	else {
+		std::vector<bool> isChild(nodes.size(), false);
+		for (const auto& node : nodes)
+			for (const auto& child : node.value("children", nlohmann::json::array()))
+				if (child < nodes.size()) isChild[child] = true;
+		for (uint32_t i = 0; i < nodes.size(); i++)
+			if (!isChild[i]) roots.push_back(i);
+	}
+
+	// a node is visited once even if the file has cycles
+	std::vector<bool> visited(nodes.size(), false);
+	std::vector<std::pair<uint32_t, glm::mat4>> stack;
+	for (auto it = roots.rbegin(); it != roots.rend(); it++) stack.emplace_back(*it, glm::mat4{ 1.f });
+	while (!stack.empty()) {
+		const auto [index, parent] = stack.back();
+		stack.pop_back();
+		if (index >= nodes.size() || visited[index]) continue;
+		visited[index] = true;
+
+		const auto& node = nodes[index];
+		const glm::mat4 transform = parent * nodeMatrix(node);
+		if (node.contains("mesh") && node["mesh"] < meshCount()) {
+			GltfInstance instance;
+			instance.name = node.value("name", "node" + std::to_string(index));
+			instance.node = index;
+			instance.mesh = node["mesh"];
+			instance.transform = transform;
+			instances.push_back(instance);
+		}
+		const auto children = node.value("children", nlohmann::json::array());
+		for (auto it = children.rbegin(); it != children.rend(); it++)
+			stack.emplace_back(static_cast<uint32_t>(*it), transform);
+	}
+	return instances;
+}
+
+}
@@ -0,0 +1,88 @@
+#ifndef GLTF_PARSER_HPP
+#define GLTF_PARSER_HPP
+
+#include "naku.hpp"
+#include "resources/mesh.hpp"
+#include "utils/mapped_file.hpp"
+
+namespace naku {
+
+// a node of the default scene that references a mesh
+struct GltfInstance {
+	std::string name;
+	uint32_t node{ 0 };
+	uint32_t mesh{ 0 };
+	glm::mat4 transform{ 1.f }; // node to scene root
+};
+
+// contents of a .gltf or .glb file. binary buffers stay memory mapped, data uris are decoded once,
+// and accessors are copied out of them directly into the interleaved vertices.
+class GltfData {
+public:
+	nlohmann::json json;
+	std::string filePath;
+	uint64_t hash{ 0 }; // content hash of the json and every buffer
+
+	GltfData() = default;
+	GltfData(const GltfData&) = delete;
+	GltfData& operator=(const GltfData&) = delete;
+
+	// returns false if the file can't be read or isn't glTF 2.0. recoverable problems go to warn.
+	static bool parse(GltfData* data, const std::string& filePath, std::string* warn = nullptr);
+
+	uint32_t meshCount() const;
+	uint32_t primitiveCount(uint32_t mesh) const;
+	// -1 if the primitive uses the default material
+	int32_t primitiveMaterial(uint32_t mesh, uint32_t primitive) const;
+	std::string meshName(uint32_t mesh) const;
+	std::string materialName(uint32_t material) const;
+	std::string imageName(uint32_t image) const;
+
+	// reads a primitive as a triangle list in the engine's winding order. returns false for
+	// points and lines, and for primitives with broken accessors.
+	bool loadPrimitive(Mesh* mesh, uint32_t meshIndex, uint32_t primitive, std::string* warn = nullptr) const;
+	// decodes an image to rgba8. returns false if it can't be read.
+	bool loadImage(uint32_t image, std::vector<unsigned char>* pixels, int* width, int* height, std::string* warn = nullptr) const;
+	// content hash of the encoded image, wherever it's stored. 0 if it can't be read.
+	uint64_t imageHash(uint32_t image) const;
+	// image index of a texture, -1 if it has none
+	int32_t textureImage(uint32_t texture) const;
+
+	std::vector<GltfInstance> instances() const;
+
+private:
+	struct Span {
+		const char* data{ nullptr };
+		size_t size{ 0 };
+	};
+
+	struct Accessor {
+		const char* data{ nullptr }; // first element. null for accessors without a buffer view
+		size_t count{ 0 };
+		size_t stride{ 0 };
+		uint32_t componentType{ 0 };
+		uint32_t components{ 0 };
+		bool normalized{ false };
+	};
+
+	std::vector<std::unique_ptr<MappedFile>> _files;
+	std::vector<std::vector<char>> _decoded;
+	std::vector<Span> _buffers;
+
+	bool bufferView(uint32_t index, Span* view, size_t* stride, std::string* warn) const;
+	bool accessor(uint32_t index, Accessor* accessor, std::string* warn) const;
+	static void readFloats(const Accessor& accessor, uint32_t components, void* destination, size_t destinationStride);
+	static void readIndices(const Accessor& accessor, uint32_t* destination);
+	std::string resolveUri(const std::string& uri) const;
+	// file keeps a mapped image alive, decoded a data uri one
+	bool encodedImage(
+		uint32_t image,
+		Span* encoded,
+		std::vector<char>* decoded,
+		std::unique_ptr<MappedFile>* file,
+		std::string* warn) const;
+};
+
+}
+
+#endif
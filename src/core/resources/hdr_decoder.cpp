@@ -0,0 +1,330 @@
+#include "resources/hdr_decoder.hpp"
+#include "utils/mapped_file.hpp"
+#include "utils/thread_pool.hpp"
+
+#include <glm/gtc/packing.hpp>
+#include <tinyexr.h>
+
+namespace naku {
+
+namespace {
+
+constexpr uint16_t HALF_ONE = 0x3C00;
+
+// where the r, g, b and a values of an exr part are, -1 if it lacks a channel
+struct ExrChannels {
+	int rgba[4]{ -1, -1, -1, -1 };
+	bool found() const { return rgba[0] >= 0; }
+};
+
+ExrChannels findChannels(const EXRHeader& header) {
+	ExrChannels channels;
+	int luminance = -1;
+	for (int c = 0; c < header.num_channels; c++) {
+		const std::string name = header.channels[c].name;
+		if (name == "R") channels.rgba[0] = c;
+		else if (name == "G") channels.rgba[1] = c;
+		else if (name == "B") channels.rgba[2] = c;
+		else if (name == "A") channels.rgba[3] = c;
+		else if (name == "Y") luminance = c;
+	}
+	// grey images spread luminance over rgb, a missing green or blue reads red
+	if (channels.rgba[0] < 0) channels.rgba[0] = luminance;
+	if (channels.rgba[1] < 0) channels.rgba[1] = channels.rgba[0];
+	if (channels.rgba[2] < 0) channels.rgba[2] = channels.rgba[0];
+	return channels;
+}
+
+// copies width texels of planar rows into interleaved rgba halves
+void interleave(unsigned char** planes, const int* pixelTypes, const ExrChannels& channels, size_t source, uint16_t* destination, int width) {
+	for (int c = 0; c < 4; c++) {
+		uint16_t* out = destination + c;
+		const int channel = channels.rgba[c];
+		if (channel < 0) {
+			for (int x = 0; x < width; x++, out += 4) *out = HALF_ONE;
+		}
+		else if (pixelTypes[channel] == TINYEXR_PIXELTYPE_HALF) {
+			const uint16_t* in = reinterpret_cast<const uint16_t*>(planes[channel]) + source;
+			for (int x = 0; x < width; x++, out += 4) *out = in[x];
+		}
+		else if (pixelTypes[channel] == TINYEXR_PIXELTYPE_FLOAT) {
+			const float* in = reinterpret_cast<const float*>(planes[channel]) + source;
+			for (int x = 0; x < width; x++, out += 4) *out = glm::packHalf1x16(in[x]);
+		}
+		else {
+			const uint32_t* in = reinterpret_cast<const uint32_t*>(planes[channel]) + source;
+			for (int x = 0; x < width; x++, out += 4) *out = glm::packHalf1x16(static_cast<float>(in[x]));
+		}
+	}
+}
+
+void copyExrImage(const EXRHeader& header, const EXRImage& image, const ExrChannels& channels, std::vector<uint16_t>* pixels) {
+	const int width = image.width;
+	pixels->resize(static_cast<size_t>(width) * image.height * 4);
+	if (!header.tiled) {
+		ThreadPool::shared().parallelFor(image.height, [&](size_t first, size_t last) {
+			for (size_t y = first; y < last; y++)
+				interleave(image.images, header.requested_pixel_types, channels, y * width, pixels->data() + y * width * 4, width);
+		}, 64);
+		return;
+	}
+	// only the finest level of mipmapped files is used
+	ThreadPool::shared().parallelFor(image.num_tiles, [&](size_t first, size_t last) {
+		for (size_t t = first; t < last; t++) {
+			const EXRTile& tile = image.tiles[t];
+			const size_t x0 = static_cast<size_t>(tile.offset_x) * header.tile_size_x;
+			const size_t y0 = static_cast<size_t>(tile.offset_y) * header.tile_size_y;
+			for (int y = 0; y < tile.height; y++) {
+				interleave(tile.images, header.requested_pixel_types, channels, static_cast<size_t>(y) * header.tile_size_x,
+					pixels->data() + ((y0 + y) * width + x0) * 4, tile.width);
+			}
+		}
+	});
+}
+
+std::string exrError(const char* err) {
+	std::string message = err ? err : "unknown error";
+	if (err) FreeEXRErrorMessage(err);
+	return message;
+}
+
+// reads the next text line of a header, without the line break
+bool readLine(const char* data, size_t size, size_t* position, std::string* line) {
+	if (*position >= size) return false;
+	const char* begin = data + *position;
+	const char* end = static_cast<const char*>(memchr(begin, '\n', size - *position));
+	if (!end) end = data + size;
+	line->assign(begin, end);
+	*position = end - data + 1;
+	return true;
+}
+
+uint16_t rgbeToHalf(uint8_t mantissa, uint8_t exponent) {
+	if (exponent == 0) return 0;
+	return glm::packHalf1x16(std::ldexp(static_cast<float>(mantissa), static_cast<int>(exponent) - 136));
+}
+
+}
+
+bool HdrDecoder::isHdr(const std::string& filePath) {
+	return strEndWith(filePath, ".exr") || strEndWith(filePath, ".hdr") || strEndWith(filePath, ".pfm");
+}
+
+bool HdrDecoder::decode(
+	const std::string& filePath,
+	std::vector<uint16_t>* pixels,
+	int* width,
+	int* height,
+	std::string* warn) {
+	try {
+		MappedFile file{ filePath };
+		if (strEndWith(filePath, ".exr"))
+			return decodeExr(file.data(), file.size(), pixels, width, height, warn);
+		if (strEndWith(filePath, ".pfm"))
+			return decodePfm(file.data(), file.size(), pixels, width, height, warn);
+		return decodeRadiance(file.data(), file.size(), pixels, width, height, warn);
+	}
+	catch (const std::exception& e) {
+		if (warn) *warn += std::string(e.what()) + "\n";
+		return false;
+	}
+}
+
+bool HdrDecoder::decodeExr(const char* data, size_t size, std::vector<uint16_t>* pixels, int* width, int* height, std::string* warn) {
+	const unsigned char* memory = reinterpret_cast<const unsigned char*>(data);
+	EXRVersion version;
+	if (ParseEXRVersionFromMemory(&version, memory, size) != TINYEXR_SUCCESS) {
+		if (warn) *warn += "not an exr file.\n";
+		return false;
+	}
+	if (version.non_image) {
+		if (warn) *warn += "deep exr images aren't supported.\n";
+		return false;
+	}
+
+	// every part of a multi-part file has to be decoded, tinyexr can't skip to one
+	std::vector<EXRHeader*> headers;
+	EXRHeader singleHeader;
+	const char* err = nullptr;
+	if (version.multipart) {
+		EXRHeader** partHeaders = nullptr;
+		int partCount = 0;
+		if (ParseEXRMultipartHeaderFromMemory(&partHeaders, &partCount, &version, memory, size, &err) != TINYEXR_SUCCESS) {
+			if (warn) *warn += exrError(err) + "\n";
+			return false;
+		}
+		headers.assign(partHeaders, partHeaders + partCount);
+		free(partHeaders);
+	}
+	else {
+		InitEXRHeader(&singleHeader);
+		if (ParseEXRHeaderFromMemory(&singleHeader, &version, memory, size, &err) != TINYEXR_SUCCESS) {
+			if (warn) *warn += exrError(err) + "\n";
+			return false;
+		}
+		headers.push_back(&singleHeader);
+	}
+
+	// tinyexr only converts half channels, they stay half. float and uint ones are narrowed
+	// row by row while interleaving
+	for (EXRHeader* header : headers) {
+		for (int c = 0; c < header->num_channels; c++) {
+			if (header->pixel_types[c] == TINYEXR_PIXELTYPE_HALF)
+				header->requested_pixel_types[c] = TINYEXR_PIXELTYPE_HALF;
+		}
+	}
+
+	std::vector<EXRImage> images(headers.size());
+	for (EXRImage& image : images) InitEXRImage(&image);
+	int result;
+	if (version.multipart)
+		result = LoadEXRMultipartImageFromMemory(images.data(), const_cast<const EXRHeader**>(headers.data()),
+			static_cast<unsigned int>(headers.size()), memory, size, &err);
+	else
+		result = LoadEXRImageFromMemory(&images[0], headers[0], memory, size, &err);
+
+	bool success = false;
+	if (result != TINYEXR_SUCCESS) {
+		if (warn) *warn += exrError(err) + "\n";
+	}
+	else {
+		// the first part with color is the image
+		for (size_t i = 0; i < headers.size(); i++) {
+			const ExrChannels channels = findChannels(*headers[i]);
+			if (!channels.found()) continue;
+			copyExrImage(*headers[i], images[i], channels, pixels);
+			*width = images[i].width;
+			*height = images[i].height;
+			success = true;
+			break;
+		}
+		if (!success && warn) *warn += "no part has R, G, B or Y channels.\n";
+	}
+
+	for (EXRImage& image : images) FreeEXRImage(&image);
+	for (EXRHeader* header : headers) {
+		FreeEXRHeader(header);
+		if (header != &singleHeader) free(header);
+	}
+	return success;
+}
+
+bool HdrDecoder::decodeRadiance(const char* data, size_t size, std::vector<uint16_t>* pixels, int* width, int* height, std::string* warn) {
+	size_t position = 0;
+	std::string line;
+	if (!readLine(data, size, &position, &line) || (!strStartWith(line, "#?RADIANCE") && !strStartWith(line, "#?RGBE"))) {
+		if (warn) *warn += "not a radiance file.\n";
+		return false;
+	}
+	while (readLine(data, size, &position, &line) && !line.empty()) {
+		if (strStartWith(line, "FORMAT=") && line != "FORMAT=32-bit_rle_rgbe") {
+			if (warn) *warn += "only rgbe radiance files are supported.\n";
+			return false;
+		}
+	}
+	int w = 0, h = 0;
+	if (!readLine(data, size, &position, &line) || sscanf(line.c_str(), "-Y %d +X %d", &h, &w) != 2 || w <= 0 || h <= 0) {
+		if (warn) *warn += "only top down radiance files are supported.\n";
+		return false;
+	}
+
+	pixels->resize(static_cast<size_t>(w) * h * 4);
+	const uint8_t* in = reinterpret_cast<const uint8_t*>(data);
+	std::vector<uint8_t> scanline(static_cast<size_t>(w) * 4);
+	for (int y = 0; y < h; y++) {
+		const bool rle = w >= 8 && w < 32768 && position + 4 <= size &&
+			in[position] == 2 && in[position + 1] == 2 && ((in[position + 2] << 8) | in[position + 3]) == w;
+		if (rle) {
+			// each component is run length encoded separately
+			position += 4;
+			for (int c = 0; c < 4; c++) {
+				int x = 0;
+				while (x < w) {
+					if (position >= size) break;
+					int count = in[position++];
+					const bool run = count > 128;
+					if (run) count -= 128;
+					if (count == 0 || x + count > w || position + (run ? 1 : count) > size) {
+						if (warn) *warn += "corrupt radiance scanline.\n";
+						return false;
+					}
+					for (int i = 0; i < count; i++, x++)
+						scanline[x * 4 + c] = run ? in[position] : in[position + i];
+					position += run ? 1 : count;
+				}
+				if (x < w) {
+					if (warn) *warn += "truncated radiance file.\n";
+					return false;
+				}
+			}
+		}
+		else {
+			if (position + scanline.size() > size) {
+				if (warn) *warn += "truncated radiance file.\n";
+				return false;
+			}
+			memcpy(scanline.data(), in + position, scanline.size());
+			position += scanline.size();
+		}
+		uint16_t* out = pixels->data() + static_cast<size_t>(y) * w * 4;
+		for (int x = 0; x < w; x++) {
+			const uint8_t* rgbe = scanline.data() + x * 4;
+			out[x * 4 + 0] = rgbeToHalf(rgbe[0], rgbe[3]);
+			out[x * 4 + 1] = rgbeToHalf(rgbe[1], rgbe[3]);
+			out[x * 4 + 2] = rgbeToHalf(rgbe[2], rgbe[3]);
+			out[x * 4 + 3] = HALF_ONE;
+		}
+	}
+	*width = w;
+	*height = h;
+	return true;
+}
+
+bool HdrDecoder::decodePfm(const char* data, size_t size, std::vector<uint16_t>* pixels, int* width, int* height, std::string* warn) {
+	size_t position = 0;
+	std::string type, dimensions, scale;
+	if (!readLine(data, size, &position, &type) || (type != "PF" && type != "Pf") ||
+		!readLine(data, size, &position, &dimensions) ||
+		!readLine(data, size, &position, &scale)) {
+		if (warn) *warn += "not a pfm file.\n";
+		return false;
+	}
+	int w = 0, h = 0;
+	if (sscanf(dimensions.c_str(), "%d %d", &w, &h) != 2 || w <= 0 || h <= 0) {
+		if (warn) *warn += "invalid pfm size.\n";
+		return false;
+	}
+	// a negative scale means little endian, the only kind read here
+	if (std::stof(scale) >= 0.f) {
+		if (warn) *warn += "big endian pfm files aren't supported.\n";
+		return false;
+	}
+	const int channels = type == "PF" ? 3 : 1;
+	if (position + sizeof(float) * w * h * channels > size) {
+		if (warn) *warn += "truncated pfm file.\n";
+		return false;
+	}
+
+	// rows are stored bottom up
+	pixels->resize(static_cast<size_t>(w) * h * 4);
+	const char* floats = data + position;
+	ThreadPool::shared().parallelFor(h, [&](size_t first, size_t last) {
+		for (size_t y = first; y < last; y++) {
+			const char* row = floats + (h - 1 - y) * w * channels * sizeof(float);
+			uint16_t* out = pixels->data() + y * w * 4;
+			for (int x = 0; x < w; x++) {
+				for (int c = 0; c < 3; c++) {
+					float value;
+					memcpy(&value, row + (x * channels + (channels == 3 ? c : 0)) * sizeof(float), sizeof(float));
+					out[x * 4 + c] = glm::packHalf1x16(value);
+				}
+				out[x * 4 + 3] = HALF_ONE;
+			}
+		}
+	}, 64);
+	*width = w;
+	*height = h;
+	return true;
+}
+
+}
@@ -0,0 +1,31 @@
+#ifndef HDR_DECODER_HPP
+#define HDR_DECODER_HPP
+
+#include "naku.hpp"
+
+namespace naku {
+
+// decodes high dynamic range images straight to rgba half floats, the layout of
+// R16G16B16A16_SFLOAT. exr goes through tinyexr, which decodes chunks on several threads,
+// radiance and pfm files are read here. no full float copy of the image is made,
+// float exr channels are narrowed to half while they are interleaved.
+class HdrDecoder {
+public:
+	static bool isHdr(const std::string& filePath);
+
+	// returns false if the file can't be read. the reason goes to warn.
+	static bool decode(
+		const std::string& filePath,
+		std::vector<uint16_t>* pixels,
+		int* width,
+		int* height,
+		std::string* warn = nullptr);
+
+	static bool decodeExr(const char* data, size_t size, std::vector<uint16_t>* pixels, int* width, int* height, std::string* warn);
+	static bool decodeRadiance(const char* data, size_t size, std::vector<uint16_t>* pixels, int* width, int* height, std::string* warn);
+	static bool decodePfm(const char* data, size_t size, std::vector<uint16_t>* pixels, int* width, int* height, std::string* warn);
+};
+
+}
+
+#endif
@@ -1,4 +1,6 @@
 #include "resources/image.hpp"
+#include "resources/hdr_decoder.hpp"
+#include "resources/ktx2.hpp"
 
 #include <imgui_impl_vulkan.h>
 
@@ -71,8 +73,12 @@ VkImage Image2D::createImage(
 	vkGetImageMemoryRequirements(device.device(), image, &memRequirements);*/
 
 	VmaAllocationCreateInfo allocCreateInfo{};
-	if ((memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0)
+	if ((memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0) {
 		allocCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+		// device local too only on unified memory, where it's written in place of a staging copy
+		if ((memoryPropertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0)
+			allocCreateInfo.requiredFlags = memoryPropertyFlags;
+	}
 	else if ((memoryPropertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0)
 		allocCreateInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
 	allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
@@ -124,41 +130,61 @@ std::shared_ptr<Image2D> Image2D::loadImageFromFile(
 	bool mipmap,
 	bool forceRGBA)
 {
-	void* data = nullptr;
-	int w, h, c;
-	bool hdr{ false };
-	hdr = strEndWith(filePath, ".exr") || strEndWith(filePath, ".hdr") || strEndWith(filePath, ".pfm");
-	if (forceRGBA) {
-		if (hdr) {
-			//TODO
-		}
-		else {
-			data = stbi_load(filePath.c_str(), &w, &h, &c, STBI_rgb_alpha); 
-		}
+	if (strEndWith(filePath, ".ktx2")) {
+		auto image = loadImageFromKtx2(device, name, filePath);
+		if (image) image->_filePath = filePath;
+		return image;
 	}
-	else {
-		if (hdr) {
-			//TODO
-		}
-		else {
-			data = stbi_load(filePath.c_str(), &w, &h, &c, STBI_default);
+
+	int w, h, c;
+	if (HdrDecoder::isHdr(filePath)) {
+		// always rgba, three channel half formats can rarely be sampled
+		std::vector<uint16_t> pixels;
+		std::string warn;
+		if (!HdrDecoder::decode(filePath, &pixels, &w, &h, &warn)) {
+			std::cerr << "Error: Can not load image file at: " << filePath << ": " << warn;
+			return nullptr;
 		}
+		auto image = loadImageFromPixels(device, name, pixels.data(), w, h, 4, true, layer, mipmap);
+		image->_filePath = filePath;
+		return image;
 	}
 
+	void* data = nullptr;
+	if (forceRGBA) data = stbi_load(filePath.c_str(), &w, &h, &c, STBI_rgb_alpha);
+	else data = stbi_load(filePath.c_str(), &w, &h, &c, STBI_default);
+
 	if (data == nullptr) {
 		std::cerr << "Error: Can not load image file at: " << filePath << std::endl;
 		return nullptr;
 	}
 	if (forceRGBA) c = 4;
 
+	auto image = loadImageFromPixels(device, name, data, w, h, c, false, layer, mipmap);
+	image->_filePath = filePath;
+	stbi_image_free(data);
+	return image;
+}
+
+std::shared_ptr<Image2D> Image2D::loadImageFromPixels(
+	Device& device,
+	const std::string& name,
+	const void* data,
+	int w,
+	int h,
+	int c,
+	bool hdr,
+	uint32_t layer,
+	bool mipmap)
+{
 	int format;
-	if (c == 1 && hdr) format = FormatBit::R | FormatBit::BIT16 | FormatBit::UNORM;
+	if (c == 1 && hdr) format = FormatBit::R | FormatBit::BIT16 | FormatBit::SFLOAT;
 	if (c == 1 && !hdr) format = FormatBit::R | FormatBit::BIT8 | FormatBit::UNORM;
-	if (c == 2 && hdr) format = FormatBit::RG | FormatBit::BIT16 | FormatBit::UNORM;
+	if (c == 2 && hdr) format = FormatBit::RG | FormatBit::BIT16 | FormatBit::SFLOAT;
 	if (c == 2 && !hdr) format = FormatBit::RG | FormatBit::BIT8 | FormatBit::UNORM;
-	if (c == 3 && hdr) format = FormatBit::RGB | FormatBit::BIT16 | FormatBit::UNORM;
+	if (c == 3 && hdr) format = FormatBit::RGB | FormatBit::BIT16 | FormatBit::SFLOAT;
 	if (c == 3 && !hdr) format = FormatBit::RGB | FormatBit::BIT8 | FormatBit::UNORM;
-	if (c == 4 && hdr) format = FormatBit::RGBA | FormatBit::BIT16 | FormatBit::UNORM;
+	if (c == 4 && hdr) format = FormatBit::RGBA | FormatBit::BIT16 | FormatBit::SFLOAT;
 	if (c == 4 && !hdr) format = FormatBit::RGBA | FormatBit::BIT8 | FormatBit::UNORM;
 
 	auto imageCreateInfo = getDefaultImageCreateInfo({ static_cast<uint32_t>(w), static_cast<uint32_t>(h) });
@@ -169,13 +195,40 @@ std::shared_ptr<Image2D> Image2D::loadImageFromFile(
 	}
 	else imageCreateInfo.mipLevels = 1;
 
-	auto image = std::make_shared<Image2D>(device, name, imageCreateInfo);
-
 	size_t size;
 	if (hdr) {
 		size = sizeof(char) * 2;
 	}
 	else size = sizeof(char);
+
+	if (layer == 0 && canWriteLinear(device, imageCreateInfo)) {
+		// unified memory: the rows go straight into a linear image, no staging buffer or copy.
+		// only the layout transition is left to submit
+		imageCreateInfo.tiling = VK_IMAGE_TILING_LINEAR;
+		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_PREINITIALIZED;
+		imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT;
+		auto image = std::make_shared<Image2D>(device, name, imageCreateInfo);
+
+		VmaAllocationInfo allocInfo;
+		vmaGetAllocationInfo(device.allocator(), image->_allocation, &allocInfo);
+		VkImageSubresource subresource{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 0 };
+		VkSubresourceLayout subresourceLayout;
+		vkGetImageSubresourceLayout(device.device(), image->_image, &subresource, &subresourceLayout);
+		const size_t rowSize = size * w * c;
+		auto dst = static_cast<char*>(allocInfo.pMappedData) + subresourceLayout.offset;
+		for (int y = 0; y < h; y++) {
+			memcpy(dst + y * subresourceLayout.rowPitch, static_cast<const char*>(data) + y * rowSize, rowSize);
+		}
+
+		transitImageLayout(device,
+			image->_image,
+			image->_format,
+			VK_IMAGE_LAYOUT_PREINITIALIZED,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		return image;
+	}
+
+	auto image = std::make_shared<Image2D>(device, name, imageCreateInfo);
 	Buffer stagingBuffer{
 		device,
 		size,
@@ -185,7 +238,7 @@ std::shared_ptr<Image2D> Image2D::loadImageFromFile(
 	};
 
 	//stagingBuffer.map();
-	stagingBuffer.writeToBuffer(data);
+	stagingBuffer.writeToBuffer(const_cast<void*>(data));
 
 	// The image was created with the VK_IMAGE_LAYOUT_UNDEFINED layout, 
 	// so that one should be specified as old layout when transitioning image
@@ -201,6 +254,100 @@ std::shared_ptr<Image2D> Image2D::loadImageFromFile(
 	return image;
 }
 
+bool Image2D::canWriteLinear(Device& device, const VkImageCreateInfo& imageInfo) {
+	// mips are blitted and layers copied, which linear images can't take part in
+	if (!device.unifiedMemory || imageInfo.mipLevels != 1 || imageInfo.arrayLayers != 1 || imageInfo.flags != 0)
+		return false;
+
+	const VkFormatFeatureFlags features = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(device.physicalDevice(), imageInfo.format, &formatProperties);
+	if ((formatProperties.linearTilingFeatures & features) != features) return false;
+
+	VkImageFormatProperties imageFormatProperties;
+	if (vkGetPhysicalDeviceImageFormatProperties(device.physicalDevice(), imageInfo.format, VK_IMAGE_TYPE_2D,
+		VK_IMAGE_TILING_LINEAR, VK_IMAGE_USAGE_SAMPLED_BIT, 0, &imageFormatProperties) != VK_SUCCESS)
+		return false;
+	return imageInfo.extent.width <= imageFormatProperties.maxExtent.width &&
+		imageInfo.extent.height <= imageFormatProperties.maxExtent.height;
+}
+
+std::shared_ptr<Image2D> Image2D::loadImageFromKtx2(
+	Device& device,
+	const std::string& name,
+	const std::string& filePath)
+{
+	std::unique_ptr<Ktx2> ktx2;
+	try {
+		ktx2 = std::make_unique<Ktx2>(filePath);
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return nullptr;
+	}
+
+	auto imageCreateInfo = getDefaultImageCreateInfo({ ktx2->width(), ktx2->height() });
+	imageCreateInfo.format = ktx2->format();
+	imageCreateInfo.mipLevels = ktx2->levelCount();
+
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(device.physicalDevice(), imageCreateInfo.format, &formatProperties);
+	if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+		std::cerr << "Error: The format of " << filePath << " can not be sampled on this device." << std::endl;
+		return nullptr;
+	}
+
+	auto image = std::make_shared<Image2D>(device, name, imageCreateInfo);
+
+	// every level goes into one staging buffer, the mips are baked so nothing is blitted
+	std::vector<VkBufferImageCopy> regions(ktx2->levelCount());
+	VkDeviceSize size = 0;
+	for (uint32_t i = 0; i < ktx2->levelCount(); i++) {
+		VkBufferImageCopy& region = regions[i];
+		region.bufferOffset = size;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = i;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageExtent = { std::max(ktx2->width() >> i, 1u), std::max(ktx2->height() >> i, 1u), 1 };
+		size += ktx2->levelSize(i);
+	}
+	Buffer stagingBuffer{
+		device,
+		1,
+		static_cast<uint32_t>(size),
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+	};
+	for (uint32_t i = 0; i < ktx2->levelCount(); i++)
+		stagingBuffer.writeToBuffer(const_cast<char*>(ktx2->level(i)), ktx2->levelSize(i), regions[i].bufferOffset);
+
+	VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+	transitImageLayout(device,
+		commandBuffer,
+		image->_image,
+		image->_format,
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		0, image->_mipLevels);
+	vkCmdCopyBufferToImage(
+		commandBuffer,
+		stagingBuffer.getBuffer(),
+		image->_image,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		static_cast<uint32_t>(regions.size()),
+		regions.data());
+	transitImageLayout(device,
+		commandBuffer,
+		image->_image,
+		image->_format,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		0, image->_mipLevels);
+	device.endSingleTimeCommands(commandBuffer);
+	return image;
+}
+
 Image2D::Image2D(
 	Device& device,
 	const std::string& name,
@@ -226,7 +373,11 @@ Image2D::Image2D(
 	_tiling = imageCreateInfo.tiling;
 	_mipLevels = imageCreateInfo.mipLevels;
 
-	_image = createImage(_device, imageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &_allocation);
+	// linear images are written by the host, see canWriteLinear
+	VkMemoryPropertyFlags memoryPropertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	if (_tiling == VK_IMAGE_TILING_LINEAR)
+		memoryPropertyFlags |= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	_image = createImage(_device, imageCreateInfo, memoryPropertyFlags, &_allocation);
 	auto imageViewCreateInfo = getDefaultImageViewCreateInfo(_image, imageCreateInfo.format);
 	VkImageAspectFlags aspectMask = 0;
 	//if (imageCreateInfo.usage & VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT) {
@@ -253,6 +404,12 @@ Image2D::~Image2D() {
 	vmaDestroyImage(_device.allocator(), _image, _allocation);
 }
 
+VkDeviceSize Image2D::memorySize() const {
+	VmaAllocationInfo info;
+	vmaGetAllocationInfo(_device.allocator(), _allocation, &info);
+	return info.size;
+}
+
 void Image2D::generateMipmaps() {
 	generateMipmaps(_device, _image, _format, _width, _height, _mipLevels);
 }
@@ -265,14 +422,22 @@ void Image2D::generateMipmaps(
 	int32_t texHeight,
 	uint32_t mipLevels,
 	uint32_t imageLayers) {
-	// Check if image format supports linear blitting
+	// nothing to blit, the only level just becomes readable
+	if (mipLevels <= 1) {
+		transitImageLayout(device, image, imageFormat,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, 1, 0, imageLayers);
+		return;
+	}
+
+	// Check if image format supports blitting, float formats without linear filtering fall back to nearest
 	VkFormatProperties formatProperties;
 	vkGetPhysicalDeviceFormatProperties(device.physicalDevice(), imageFormat, &formatProperties);
-	if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
-		throw std::runtime_error("Error: The image format does not support linear blitting!");
+	const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+	if ((formatProperties.optimalTilingFeatures & blitFeatures) != blitFeatures) {
+		throw std::runtime_error("Error: The image format does not support blitting!");
 	}
-	
-	if (mipLevels <= 1) return;
+	const VkFilter filter = formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT ?
+		VK_FILTER_LINEAR : VK_FILTER_NEAREST;
 
 	VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
 
@@ -323,7 +488,7 @@ void Image2D::generateMipmaps(
 				image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
 				image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 				1, &blit,
-				VK_FILTER_LINEAR);
+				filter);
 
 			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
 			barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -438,6 +603,7 @@ void Image2D::transitImageLayout(
 
 		// The memory referenced is mapped and will be written to by the host.
 		barrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
+		sourceStage = VK_PIPELINE_STAGE_HOST_BIT;
 		break;
 
 	case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
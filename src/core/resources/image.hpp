@@ -44,7 +44,22 @@ public:
 		uint32_t layer = 0,
 		bool mipmap = true,
 		bool forceRGBA = true);
-	static std::shared_ptr<Image2D> loadCubeMapFromFile(std::string filePath, int formatBit, bool mipmap = true, bool forceRGBA=true);
+	// uploads decoded pixels, tightly packed rows of channels values of 8 bits, or half floats if hdr
+	static std::shared_ptr<Image2D> loadImageFromPixels(
+		Device& device,
+		const std::string& name,
+		const void* data,
+		int width,
+		int height,
+		int channels,
+		bool hdr = false,
+		uint32_t layer = 0,
+		bool mipmap = true);
+	// uploads the blocks and baked mips of a cooked ktx2 file as they are
+	static std::shared_ptr<Image2D> loadImageFromKtx2(
+		Device& device,
+		const std::string& name,
+		const std::string& filePath);
 	static VkImageCreateInfo getDefaultImageCreateInfo(VkExtent2D extent);
 	static VkImageCreateInfo getDefaultCubeMapCreateInfo(VkExtent2D extent);
 	static VkImageViewCreateInfo getDefaultImageViewCreateInfo(VkImage image, VkFormat format);
@@ -105,6 +120,8 @@ public:
 	uint32_t mipLevels() const {return _mipLevels;}
 	uint32_t layers() const { return _layers; }
 	VkFormat format() const { return _format; }
+	// bytes of device memory behind the image
+	VkDeviceSize memorySize() const;
 
 	friend class GUI;
 	friend class Texture;
@@ -112,6 +129,9 @@ public:
 	std::unique_ptr<VkDescriptorSet> ImGuiImageId;
 
 private:
+	// whether an image can be a host written linear one on unified memory
+	static bool canWriteLinear(Device& device, const VkImageCreateInfo& imageInfo);
+
 	uint32_t _width, _height, _channel;
 	//unsigned char _thumbnail[THUMBNAIL_WIDTH* THUMBNAIL_HEIGHT*4];
 	std::string _filePath;
@@ -0,0 +1,166 @@
+#include "resources/ktx2.hpp"
+
+namespace naku {
+
+namespace {
+
+// khronos data format descriptor values
+constexpr uint32_t KHR_DF_VERSION = 2;
+constexpr uint8_t KHR_DF_MODEL_BC4 = 131;
+constexpr uint8_t KHR_DF_MODEL_BC5 = 132;
+constexpr uint8_t KHR_DF_MODEL_BC7 = 134;
+constexpr uint8_t KHR_DF_PRIMARIES_BT709 = 1;
+constexpr uint8_t KHR_DF_TRANSFER_LINEAR = 1;
+constexpr uint8_t KHR_DF_TRANSFER_SRGB = 2;
+
+// a basic descriptor block with one sample per block channel
+std::vector<uint32_t> dataFormatDescriptor(VkFormat format) {
+	uint8_t model;
+	uint8_t transfer = KHR_DF_TRANSFER_LINEAR;
+	uint32_t sampleCount = 1;
+	switch (format) {
+	case VK_FORMAT_BC4_UNORM_BLOCK: model = KHR_DF_MODEL_BC4; break;
+	case VK_FORMAT_BC5_UNORM_BLOCK: model = KHR_DF_MODEL_BC5; sampleCount = 2; break;
+	case VK_FORMAT_BC7_UNORM_BLOCK: model = KHR_DF_MODEL_BC7; break;
+	case VK_FORMAT_BC7_SRGB_BLOCK: model = KHR_DF_MODEL_BC7; transfer = KHR_DF_TRANSFER_SRGB; break;
+	default: return {};
+	}
+	const uint32_t blockBytes = Ktx2::blockSize(format);
+	const uint32_t blockSize = 24 + 16 * sampleCount;
+
+	std::vector<uint32_t> dfd;
+	dfd.push_back(4 + blockSize);                       // total size
+	dfd.push_back(0);                                   // vendor khronos, type basic
+	dfd.push_back(KHR_DF_VERSION | (blockSize << 16));
+	dfd.push_back(model | (KHR_DF_PRIMARIES_BT709 << 8) | (transfer << 16));
+	dfd.push_back(3 | (3 << 8));                        // 4x4x1x1 texel block, minus one
+	dfd.push_back(blockBytes);                          // bytes of plane 0
+	dfd.push_back(0);
+	const uint32_t bitLength = blockBytes * 8 / sampleCount;
+	for (uint32_t i = 0; i < sampleCount; i++) {
+		// channel 0 is red or color, 1 is green
+		dfd.push_back((i * bitLength) | ((bitLength - 1) << 16) | (i << 24));
+		dfd.push_back(0);
+		dfd.push_back(0);
+		dfd.push_back(0xFFFFFFFF);
+	}
+	return dfd;
+}
+
+}
+
+uint32_t Ktx2::blockSize(VkFormat format) {
+	switch (format) {
+	case VK_FORMAT_BC4_UNORM_BLOCK: return 8;
+	case VK_FORMAT_BC5_UNORM_BLOCK: return 16;
+	case VK_FORMAT_BC7_UNORM_BLOCK: return 16;
+	case VK_FORMAT_BC7_SRGB_BLOCK: return 16;
+	case VK_FORMAT_R8_UNORM: return 1;
+	case VK_FORMAT_R8G8_UNORM: return 2;
+	case VK_FORMAT_R8G8B8A8_UNORM: return 4;
+	case VK_FORMAT_R8G8B8A8_SRGB: return 4;
+	case VK_FORMAT_R16G16B16A16_SFLOAT: return 8;
+	default: return 0;
+	}
+}
+
+bool Ktx2::isBlockCompressed(VkFormat format) {
+	return format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK;
+}
+
+Ktx2::Ktx2(const std::string& filePath) {
+	auto file = std::make_shared<MappedFile>(filePath);
+	const size_t size = file->size();
+	open(std::move(file), 0, size);
+}
+
+Ktx2::Ktx2(std::shared_ptr<const MappedFile> file, size_t offset, size_t size) {
+	if (offset + size > file->size())
+		throw std::runtime_error("Error: " + file->filePath() + " is too small for the ktx2 file it holds.");
+	open(std::move(file), offset, size);
+}
+
+void Ktx2::open(std::shared_ptr<const MappedFile> file, size_t offset, size_t size) {
+	_file = std::move(file);
+	_offset = offset;
+	_size = size;
+	const std::string& filePath = _file->filePath();
+	if (_size < sizeof(Header))
+		throw std::runtime_error("Error: " + filePath + " is too small for a ktx2 file.");
+	_header = reinterpret_cast<const Header*>(data());
+	if (memcmp(_header->identifier, IDENTIFIER, sizeof(IDENTIFIER)) != 0)
+		throw std::runtime_error("Error: " + filePath + " isn't a ktx2 file.");
+	if (_header->supercompressionScheme != 0)
+		throw std::runtime_error("Error: " + filePath + " is supercompressed.");
+	if (_header->pixelDepth > 1 || _header->layerCount > 1 || _header->faceCount != 1 || _header->levelCount == 0)
+		throw std::runtime_error("Error: " + filePath + " isn't a single 2d image.");
+	if (blockSize(format()) == 0)
+		throw std::runtime_error("Error: " + filePath + " has an unsupported format.");
+
+	const size_t levelIndexEnd = sizeof(Header) + sizeof(LevelIndex) * static_cast<size_t>(_header->levelCount);
+	if (_size < levelIndexEnd)
+		throw std::runtime_error("Error: " + filePath + " is truncated.");
+	_levels = reinterpret_cast<const LevelIndex*>(data() + sizeof(Header));
+	for (uint32_t i = 0; i < _header->levelCount; i++) {
+		if (_levels[i].byteOffset + _levels[i].byteLength > _size)
+			throw std::runtime_error("Error: " + filePath + " is truncated.");
+	}
+}
+
+bool Ktx2::write(
+	const std::string& filePath,
+	VkFormat format,
+	uint32_t width,
+	uint32_t height,
+	const std::vector<std::vector<char>>& levels) {
+	std::ofstream file{ filePath, std::ios::binary | std::ios::trunc };
+	if (!file.is_open()) return false;
+	return write(file, format, width, height, levels);
+}
+
+bool Ktx2::write(
+	std::ostream& file,
+	VkFormat format,
+	uint32_t width,
+	uint32_t height,
+	const std::vector<std::vector<char>>& levels) {
+	const std::vector<uint32_t> dfd = dataFormatDescriptor(format);
+
+	Header header{};
+	memcpy(header.identifier, IDENTIFIER, sizeof(IDENTIFIER));
+	header.vkFormat = format;
+	header.typeSize = 1;
+	header.pixelWidth = width;
+	header.pixelHeight = height;
+	header.faceCount = 1;
+	header.levelCount = static_cast<uint32_t>(levels.size());
+	const size_t levelIndexEnd = sizeof(Header) + sizeof(LevelIndex) * levels.size();
+	header.dfdByteOffset = dfd.empty() ? 0 : static_cast<uint32_t>(levelIndexEnd);
+	header.dfdByteLength = static_cast<uint32_t>(sizeof(uint32_t) * dfd.size());
+
+	// every level starts at a multiple of the block size, which is a multiple of 4 here
+	const size_t alignment = std::max<size_t>(blockSize(format), 4);
+	std::vector<LevelIndex> levelIndex(levels.size());
+	size_t offset = levelIndexEnd + header.dfdByteLength;
+	for (size_t i = levels.size(); i-- > 0;) {
+		offset = (offset + alignment - 1) / alignment * alignment;
+		levelIndex[i].byteOffset = offset;
+		levelIndex[i].byteLength = levels[i].size();
+		levelIndex[i].uncompressedByteLength = levels[i].size();
+		offset += levels[i].size();
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(levelIndex.data()), sizeof(LevelIndex) * levelIndex.size());
+	file.write(reinterpret_cast<const char*>(dfd.data()), sizeof(uint32_t) * dfd.size());
+	size_t position = levelIndexEnd + header.dfdByteLength;
+	const char zeros[16]{};
+	for (size_t i = levels.size(); i-- > 0;) {
+		file.write(zeros, levelIndex[i].byteOffset - position);
+		file.write(levels[i].data(), levels[i].size());
+		position = levelIndex[i].byteOffset + levels[i].size();
+	}
+	return file.good();
+}
+
+}
@@ -0,0 +1,91 @@
+#ifndef KTX2_HPP
+#define KTX2_HPP
+
+#include "naku.hpp"
+#include "utils/mapped_file.hpp"
+
+namespace naku {
+
+// the subset of KTX 2.0 the engine cooks and loads: one 2d image with its mip chain,
+// block compressed or not, without supercompression.
+class Ktx2 {
+public:
+	static constexpr uint8_t IDENTIFIER[12]{ 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+	struct Header {
+		uint8_t identifier[12];
+		uint32_t vkFormat;
+		uint32_t typeSize;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t layerCount;
+		uint32_t faceCount;
+		uint32_t levelCount;
+		uint32_t supercompressionScheme;
+		uint32_t dfdByteOffset;
+		uint32_t dfdByteLength;
+		uint32_t kvdByteOffset;
+		uint32_t kvdByteLength;
+		uint64_t sgdByteOffset;
+		uint64_t sgdByteLength;
+	};
+
+	struct LevelIndex {
+		uint64_t byteOffset;
+		uint64_t byteLength;
+		uint64_t uncompressedByteLength;
+	};
+
+	// maps the file and checks that it holds a single 2d image. throws if it doesn't.
+	Ktx2(const std::string& filePath);
+	// a ktx2 file stored at offset of a larger mapped file, which it keeps mapped
+	Ktx2(std::shared_ptr<const MappedFile> file, size_t offset, size_t size);
+	~Ktx2() {}
+	Ktx2(const Ktx2&) = delete;
+	Ktx2& operator=(const Ktx2&) = delete;
+
+	std::string filePath() const { return _file->filePath(); }
+	// where the ktx2 starts in filePath(), and its bytes from there
+	size_t offset() const { return _offset; }
+	size_t size() const { return _size; }
+	const char* data() const { return _file->data() + _offset; }
+	VkFormat format() const { return static_cast<VkFormat>(_header->vkFormat); }
+	uint32_t width() const { return _header->pixelWidth; }
+	uint32_t height() const { return _header->pixelHeight; }
+	uint32_t levelCount() const { return _header->levelCount; }
+	const char* level(uint32_t level) const { return data() + _levels[level].byteOffset; }
+	size_t levelSize(uint32_t level) const { return static_cast<size_t>(_levels[level].byteLength); }
+
+	// levels are given finest first and stored coarsest first, as the spec recommends.
+	// only BC4, BC5 and BC7 get a data format descriptor. returns false on io errors.
+	static bool write(
+		const std::string& filePath,
+		VkFormat format,
+		uint32_t width,
+		uint32_t height,
+		const std::vector<std::vector<char>>& levels);
+	static bool write(
+		std::ostream& file,
+		VkFormat format,
+		uint32_t width,
+		uint32_t height,
+		const std::vector<std::vector<char>>& levels);
+
+	// bytes of a 4x4 block, or of a texel for uncompressed formats. 0 if unknown.
+	static uint32_t blockSize(VkFormat format);
+	static bool isBlockCompressed(VkFormat format);
+
+private:
+	std::shared_ptr<const MappedFile> _file;
+	size_t _offset{ 0 };
+	size_t _size{ 0 };
+	const Header* _header{ nullptr };
+	const LevelIndex* _levels{ nullptr };
+
+	void open(std::shared_ptr<const MappedFile> file, size_t offset, size_t size);
+};
+
+}
+
+#endif
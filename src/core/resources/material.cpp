@@ -14,8 +14,18 @@ Texture::Texture(
 	bool anisotropic_filtering,
 	VkFilter filterType,
 	VkSamplerAddressMode addresType,
-	VkSamplerMipmapMode mipmapMode)
+	VkSamplerMipmapMode mipmapMode,
+	uint32_t baseMipLevel)
 	: _device{ device }, _name{ name }, _pImage{ pImage }, _anisotropic_filtering{ anisotropic_filtering }, _filterType{ filterType }, _addressType{ addresType }, _mipmapMode{ mipmapMode }{
+	_baseMipLevel = std::min(baseMipLevel, pImage->_mipLevels - 1);
+	if (_baseMipLevel > 0) {
+		auto viewInfo = Image2D::getDefaultImageViewCreateInfo(pImage->_image, pImage->_format);
+		viewInfo.subresourceRange.baseMipLevel = _baseMipLevel;
+		viewInfo.subresourceRange.levelCount = pImage->_mipLevels - _baseMipLevel;
+		if (vkCreateImageView(_device.device(), &viewInfo, nullptr, &_view) != VK_SUCCESS)
+			throw std::runtime_error("Error: Failed to create image view.");
+	}
+
 	auto createInfo = Sampler::getDefaultSamplerCreateInfo();
 	createInfo.maxAnisotropy = _device.properties.limits.maxSamplerAnisotropy;
 	createInfo.magFilter = _filterType;
@@ -25,7 +35,7 @@ Texture::Texture(
 	createInfo.addressModeW = _addressType;
 
 	if (_anisotropic_filtering)
-		createInfo.maxLod = static_cast<float>(pImage->_mipLevels);
+		createInfo.maxLod = static_cast<float>(pImage->_mipLevels - _baseMipLevel);
 	else createInfo.maxLod = 1;
 	createInfo.mipmapMode = _mipmapMode;
 	_pSampler = std::make_unique<Sampler>(device, createInfo);
@@ -40,12 +50,15 @@ Texture::Texture(
 	_pSampler = std::make_unique<Sampler>(device, samplerInfo);
 }
 
-Texture::~Texture() {}
+Texture::~Texture() {
+	if (_view != VK_NULL_HANDLE)
+		vkDestroyImageView(_device.device(), _view, nullptr);
+}
 
 VkDescriptorImageInfo Texture::descriptorInfo() const {
 	VkDescriptorImageInfo imageInfo{};
 	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	imageInfo.imageView = _pImage->_defaultImageView;
+	imageInfo.imageView = _view != VK_NULL_HANDLE ? _view : _pImage->_defaultImageView;
 	imageInfo.sampler = _pSampler->sampler();
 
 	return imageInfo;
@@ -105,15 +118,23 @@ Material::Material(
 void Material::changeTexture(size_t binding, std::shared_ptr<Texture> newTex, bool Update) {
 	_textures[binding] = newTex;
 	pushConstants.hasTexture = pushConstants.hasTexture | (1 << binding);
+	pushConstants.virtualSlot[binding] = -1;
 	this->update(Update);
 }
 
 void Material::removeTexture(size_t binding, bool Update) {
 	_textures[binding] = DefaultTexture;
 	pushConstants.hasTexture = pushConstants.hasTexture & ~(1 << binding);
+	pushConstants.virtualSlot[binding] = -1;
 	this->update(Update);
 }
 
+void Material::changeVirtualTexture(size_t binding, int32_t slot) {
+	// push constants are recorded with every draw, no descriptor changes
+	pushConstants.virtualSlot[binding] = slot;
+	pushConstants.hasTexture = pushConstants.hasTexture | (1 << binding);
+}
+
 Material::~Material() {
 	if (--_instanceCount == 0) {
 		if (DefaultTexture)
@@ -133,6 +154,14 @@ void Material::update(bool overwrite) {
 	if (overwrite) _writer->overwrite(_set);
 }
 
+void Material::markDrawn(float time, float objectUvPerPixel) {
+	// tilled uvs pack more texels into a pixel
+	const float tilling = std::max(std::abs(pushConstants.offsetTilling.z), std::abs(pushConstants.offsetTilling.w));
+	const float scaled = objectUvPerPixel * tilling;
+	uvPerPixel = lastUsed == time ? std::min(uvPerPixel, scaled) : scaled;
+	lastUsed = time;
+}
+
 void Material::cmdBindSet(VkCommandBuffer cmd, VkPipelineLayout pipelineLayout, uint32_t firstset) {
 	vkCmdBindDescriptorSets(
 		cmd,
@@ -15,6 +15,8 @@ namespace naku {
 class Texture {
 public:
 
+	// a baseMipLevel above 0 samples the image through a view of its coarser mips only,
+	// for images whose finer mips are still being uploaded
 	Texture(
 		Device& device,
 		const std::string& name,
@@ -22,7 +24,8 @@ public:
 		bool anisotropic_filtering = false,
 		VkFilter filterType = VK_FILTER_LINEAR,
 		VkSamplerAddressMode addresType = VK_SAMPLER_ADDRESS_MODE_REPEAT,
-		VkSamplerMipmapMode mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR);
+		VkSamplerMipmapMode mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+		uint32_t baseMipLevel = 0);
 	Texture(
 		Device& device,
 		const std::string& name,
@@ -37,14 +40,19 @@ public:
 	std::string name() const { return _name; }
 	std::string fileName() const { return _pImage->_name; }
 	std::string filePath() const { return _pImage->filePath(); }
+	uint32_t baseMipLevel() const { return _baseMipLevel; }
+	std::shared_ptr<Image2D> image() const { return _pImage; }
 
 	friend class GUI;
 	friend class Scene;
+	friend class TextureStreamer;
 
 private:
 	Device& _device;
 	std::string _name;
 	std::shared_ptr<Image2D> _pImage;
+	uint32_t _baseMipLevel{ 0 };
+	VkImageView _view{ VK_NULL_HANDLE };
 	bool _anisotropic_filtering;
 	std::unique_ptr<Sampler> _pSampler;
 	VkSamplerAddressMode _addressType;
@@ -76,6 +84,8 @@ public:
 		int alphaMode{ 0 };
 		int hasTexture;
 		int mtlId;
+		// slot of VirtualTextures a binding samples instead of its texture, -1 if none
+		int virtualSlot[static_cast<size_t>(MaterialTextures::SIZE)]{ -1, -1, -1, -1, -1, -1 };
 	};
 
 	static std::shared_ptr<DescriptorSetLayout> textureInputSetLayout;
@@ -95,15 +105,27 @@ public:
 	
 	friend class GUI;
 	friend class Scene;
+	friend class TextureStreamer;
 
 	PushConstants pushConstants{};
+	// running time of the last frame that drew a visible object with it, -1 if none has
+	float lastUsed{ -1.f };
+	// smallest Model::uvPerPixel of the objects that frame drew with it, tilling included
+	float uvPerPixel{ 0.f };
+	// of what a scene made it from, another scene takes it over only if that's the same
+	uint64_t sourceHash{ 0 };
+	// called by the renderers for every visible object drawn with it
+	void markDrawn(float time, float objectUvPerPixel);
 	void allocateSet(DescriptorPool& descriptorPool);
 	void cmdBindSet(VkCommandBuffer cmd, VkPipelineLayout pipelineLayout, uint32_t firstset = 0);
 	void update(size_t set, bool overwrite=true);
 	void update(bool overwrite=true);
 
+	std::shared_ptr<Texture> texture(size_t binding) const { return _textures[binding]; }
 	void changeTexture(size_t binding, std::shared_ptr<Texture> newTex, bool update = true);
 	void removeTexture(size_t binding, bool update = true);
+	// samples the binding from a virtual texture slot. its texture stays the default one
+	void changeVirtualTexture(size_t binding, int32_t slot);
 
 	PipelineConfig& getConfig() { return _config; }
 	VkDescriptorSet getDescriptorSet() const{ return _set; }
@@ -1,10 +1,15 @@
 #include "resources/mesh.hpp"
 
-#include <tiny_obj_loader.h>
+#include "resources/obj_parser.hpp"
+#include "utils/thread_pool.hpp"
 
 #include <string>
 #include <iostream>
 #include <unordered_map>
+#include <limits>
+#include <cmath>
+
+#include <glm/gtc/packing.hpp>
 
 namespace naku {
 
@@ -45,6 +50,154 @@ std::vector<VkVertexInputAttributeDescription> Vertex::getAttributeDescriptions(
 	return attributeDescriptions;
 }
 
+namespace {
+
+// octahedral encoding of a unit vector into two snorm16 values
+void octEncode(const glm::vec3& v, int16_t out[2]) {
+	const float l1 = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+	glm::vec2 e = l1 > 0.f ? glm::vec2{ v.x, v.y } / l1 : glm::vec2{ 0.f };
+	if (v.z < 0.f) {
+		e = glm::vec2{
+			(1.f - std::abs(e.y)) * (e.x >= 0.f ? 1.f : -1.f),
+			(1.f - std::abs(e.x)) * (e.y >= 0.f ? 1.f : -1.f) };
+	}
+	out[0] = static_cast<int16_t>(glm::packSnorm1x16(e.x));
+	out[1] = static_cast<int16_t>(glm::packSnorm1x16(e.y));
+}
+
+uint8_t packUnorm8(float v) {
+	return static_cast<uint8_t>(std::round(glm::clamp(v, 0.f, 1.f) * 255.f));
+}
+
+std::vector<VkVertexInputAttributeDescription> getPackedAttributeDescriptions(
+	VkFormat positionFormat,
+	uint32_t positionOffset,
+	uint32_t normalOffset,
+	uint32_t tangentOffset,
+	uint32_t uvOffset,
+	uint32_t colorOffset) {
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions(5);
+	attributeDescriptions[0] = { 0, 0, positionFormat, positionOffset };
+	attributeDescriptions[1] = { 1, 0, VK_FORMAT_R16G16_SNORM, normalOffset };
+	attributeDescriptions[2] = { 2, 0, VK_FORMAT_R16G16_SNORM, tangentOffset };
+	attributeDescriptions[3] = { 3, 0, VK_FORMAT_R16G16_SFLOAT, uvOffset };
+	attributeDescriptions[4] = { 4, 0, VK_FORMAT_R8G8B8A8_UNORM, colorOffset };
+	return attributeDescriptions;
+}
+
+}
+
+std::vector<VkVertexInputBindingDescription> PackedVertex::getBindingDescriptions() {
+	std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+	bindingDescriptions[0].binding = 0;
+	bindingDescriptions[0].stride = sizeof(PackedVertex);
+	bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	return bindingDescriptions;
+}
+
+std::vector<VkVertexInputAttributeDescription> PackedVertex::getAttributeDescriptions() {
+	return getPackedAttributeDescriptions(
+		VK_FORMAT_R32G32B32_SFLOAT,
+		offsetof(PackedVertex, position),
+		offsetof(PackedVertex, normal),
+		offsetof(PackedVertex, tangent),
+		offsetof(PackedVertex, uv),
+		offsetof(PackedVertex, color));
+}
+
+PackedVertex PackedVertex::pack(const Vertex& vertex) {
+	PackedVertex packed{};
+	packed.position = vertex.position;
+	octEncode(vertex.normal, packed.normal);
+	octEncode(vertex.tangent, packed.tangent);
+	packed.uv[0] = glm::packHalf1x16(vertex.uv.x);
+	packed.uv[1] = glm::packHalf1x16(vertex.uv.y);
+	packed.color[0] = packUnorm8(vertex.color.r);
+	packed.color[1] = packUnorm8(vertex.color.g);
+	packed.color[2] = packUnorm8(vertex.color.b);
+	packed.color[3] = 255;
+	return packed;
+}
+
+std::vector<VkVertexInputBindingDescription> QuantizedVertex::getBindingDescriptions() {
+	std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+	bindingDescriptions[0].binding = 0;
+	bindingDescriptions[0].stride = sizeof(QuantizedVertex);
+	bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	return bindingDescriptions;
+}
+
+std::vector<VkVertexInputAttributeDescription> QuantizedVertex::getAttributeDescriptions() {
+	return getPackedAttributeDescriptions(
+		VK_FORMAT_R16G16B16A16_UNORM,
+		offsetof(QuantizedVertex, position),
+		offsetof(QuantizedVertex, normal),
+		offsetof(QuantizedVertex, tangent),
+		offsetof(QuantizedVertex, uv),
+		offsetof(QuantizedVertex, color));
+}
+
+QuantizedVertex QuantizedVertex::pack(const Vertex& vertex, const glm::vec3& boundsMin, const glm::vec3& boundsExtent) {
+	const PackedVertex packed = PackedVertex::pack(vertex);
+	QuantizedVertex quantized{};
+	for (int i = 0; i < 3; i++) {
+		const float t = boundsExtent[i] > 0.f ? (vertex.position[i] - boundsMin[i]) / boundsExtent[i] : 0.f;
+		quantized.position[i] = glm::packUnorm1x16(t);
+	}
+	quantized.position[3] = 0;
+	memcpy(quantized.normal, packed.normal, sizeof(quantized.normal));
+	memcpy(quantized.tangent, packed.tangent, sizeof(quantized.tangent));
+	memcpy(quantized.uv, packed.uv, sizeof(quantized.uv));
+	memcpy(quantized.color, packed.color, sizeof(quantized.color));
+	return quantized;
+}
+
+uint32_t vertexStride(VertexFormat format) {
+	switch (format) {
+	case VertexFormat::PACKED: return sizeof(PackedVertex);
+	case VertexFormat::QUANTIZED: return sizeof(QuantizedVertex);
+	default: return sizeof(Vertex);
+	}
+}
+
+std::vector<VkVertexInputBindingDescription> getBindingDescriptions(VertexFormat format) {
+	switch (format) {
+	case VertexFormat::PACKED: return PackedVertex::getBindingDescriptions();
+	case VertexFormat::QUANTIZED: return QuantizedVertex::getBindingDescriptions();
+	default: return Vertex::getBindingDescriptions();
+	}
+}
+
+std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(VertexFormat format) {
+	switch (format) {
+	case VertexFormat::PACKED: return PackedVertex::getAttributeDescriptions();
+	case VertexFormat::QUANTIZED: return QuantizedVertex::getAttributeDescriptions();
+	default: return Vertex::getAttributeDescriptions();
+	}
+}
+
+uint32_t positionStride(VertexFormat format) {
+	if (format == VertexFormat::QUANTIZED) return sizeof(QuantizedVertex::position);
+	return sizeof(Vertex::position);
+}
+
+std::vector<VkVertexInputBindingDescription> getPositionBindingDescriptions(VertexFormat format) {
+	std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+	bindingDescriptions[0].binding = 0;
+	bindingDescriptions[0].stride = positionStride(format);
+	bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	return bindingDescriptions;
+}
+
+std::vector<VkVertexInputAttributeDescription> getPositionAttributeDescriptions(VertexFormat format) {
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions(1);
+	attributeDescriptions[0].binding = 0;
+	attributeDescriptions[0].location = 0;
+	attributeDescriptions[0].format = format == VertexFormat::QUANTIZED ? VK_FORMAT_R16G16B16A16_UNORM : VK_FORMAT_R32G32B32_SFLOAT;
+	attributeDescriptions[0].offset = 0;
+	return attributeDescriptions;
+}
+
 size_t Vertex::hash() const {
 	size_t seed = 0;
 	hashCombine(
@@ -91,112 +244,269 @@ std::array<glm::vec3, 2> Mesh::calcTangent(
 	return { T, B };
 }
 
+namespace {
+
+// open addressing tables for welding obj corners, so importing doesn't allocate per vertex.
+// the first table maps obj index triples to vertices, the second one dedups vertices by value.
+class VertexWelder {
+public:
+	static constexpr uint32_t NOT_FOUND = std::numeric_limits<uint32_t>::max();
+
+	VertexWelder(std::vector<Vertex>& vertices, size_t cornerCount) : _vertices{ vertices } {
+		// most meshes share a vertex between several faces, so start well below the corner count
+		size_t capacity = 64;
+		while (capacity < cornerCount / 2) capacity <<= 1;
+		_indexSlots.resize(capacity);
+		_valueSlots.resize(capacity);
+	}
+
+	uint32_t find(const ObjIndex& index) const {
+		const size_t mask = _indexSlots.size() - 1;
+		for (size_t i = hashIndex(index) & mask; ; i = (i + 1) & mask) {
+			const IndexSlot& slot = _indexSlots[i];
+			if (slot.vertex == NOT_FOUND) return NOT_FOUND;
+			if (slot.key.vertex == index.vertex && slot.key.normal == index.normal && slot.key.texcoord == index.texcoord)
+				return slot.vertex;
+		}
+	}
+
+	// called for triples that find() didn't know yet
+	uint32_t insert(const ObjIndex& index, const Vertex& vertex) {
+		// nan never compares equal, so such a vertex is never shared
+		if (!(vertex == vertex)) {
+			_vertices.push_back(vertex);
+			return static_cast<uint32_t>(_vertices.size() - 1);
+		}
+
+		const uint32_t hash = hashValue(vertex);
+		uint32_t vertIdx = NOT_FOUND;
+		const size_t valueMask = _valueSlots.size() - 1;
+		size_t i = hash & valueMask;
+		for (; _valueSlots[i].vertex != NOT_FOUND; i = (i + 1) & valueMask) {
+			const ValueSlot& slot = _valueSlots[i];
+			if (slot.hash == hash && _vertices[slot.vertex] == vertex) {
+				vertIdx = slot.vertex;
+				break;
+			}
+		}
+		if (vertIdx == NOT_FOUND) {
+			vertIdx = static_cast<uint32_t>(_vertices.size());
+			_vertices.push_back(vertex);
+			_valueSlots[i] = { hash, vertIdx };
+			if (++_valueCount * 2 > _valueSlots.size()) growValues();
+		}
+
+		const size_t indexMask = _indexSlots.size() - 1;
+		size_t j = hashIndex(index) & indexMask;
+		while (_indexSlots[j].vertex != NOT_FOUND) j = (j + 1) & indexMask;
+		_indexSlots[j] = { index, vertIdx };
+		if (++_indexCount * 2 > _indexSlots.size()) growIndices();
+		return vertIdx;
+	}
+
+private:
+	struct IndexSlot {
+		ObjIndex key;
+		uint32_t vertex{ NOT_FOUND };
+	};
+	struct ValueSlot {
+		uint32_t hash;
+		uint32_t vertex{ NOT_FOUND };
+	};
+
+	static uint32_t hashIndex(const ObjIndex& index) {
+		return static_cast<uint32_t>(hashMemory(&index, sizeof(index)));
+	}
+
+	// hashes what Vertex::operator== compares. adding 0 turns -0 into 0, which compare equal.
+	static uint32_t hashValue(const Vertex& vertex) {
+		const float key[11]{
+			vertex.position.x + 0.f, vertex.position.y + 0.f, vertex.position.z + 0.f,
+			vertex.normal.x + 0.f, vertex.normal.y + 0.f, vertex.normal.z + 0.f,
+			vertex.uv.x + 0.f, vertex.uv.y + 0.f,
+			vertex.color.x + 0.f, vertex.color.y + 0.f, vertex.color.z + 0.f,
+		};
+		return static_cast<uint32_t>(hashMemory(key, sizeof(key)));
+	}
+
+	void growIndices() {
+		std::vector<IndexSlot> old(_indexSlots.size() * 2);
+		old.swap(_indexSlots);
+		const size_t mask = _indexSlots.size() - 1;
+		for (const auto& slot : old) {
+			if (slot.vertex == NOT_FOUND) continue;
+			size_t i = hashIndex(slot.key) & mask;
+			while (_indexSlots[i].vertex != NOT_FOUND) i = (i + 1) & mask;
+			_indexSlots[i] = slot;
+		}
+	}
+
+	void growValues() {
+		std::vector<ValueSlot> old(_valueSlots.size() * 2);
+		old.swap(_valueSlots);
+		const size_t mask = _valueSlots.size() - 1;
+		for (const auto& slot : old) {
+			if (slot.vertex == NOT_FOUND) continue;
+			size_t i = slot.hash & mask;
+			while (_valueSlots[i].vertex != NOT_FOUND) i = (i + 1) & mask;
+			_valueSlots[i] = slot;
+		}
+	}
+
+	std::vector<Vertex>& _vertices;
+	std::vector<IndexSlot> _indexSlots;
+	std::vector<ValueSlot> _valueSlots;
+	size_t _indexCount{ 0 };
+	size_t _valueCount{ 0 };
+};
+
+}
+
 void Mesh::loadObjFile(Mesh* mesh, const std::string& ObjFilePath, const glm::vec3* colorOverwrite, bool reverseWindingOrder) {
 	mesh->filePath = ObjFilePath;
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string warn, err;
-
-	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, ObjFilePath.c_str())) {
-		//throw std::runtime_error(warn + err);
-		std::cerr << "Error: Failed to load obj file: " << warn + err << std::endl;
+	ObjData obj;
+	std::string warn;
+
+	if (!ObjData::parse(&obj, ObjFilePath, &warn)) {
+		//throw std::runtime_error(warn);
+		std::cerr << "Error: Failed to load obj file: " << warn << std::endl;
+	}
+	else if (!warn.empty()) {
+		std::cerr << "Warning: " << ObjFilePath << ": " << warn;
 	}
 
-	//std::map<Vertex, uint32_t> uniqueVertices{};
-	std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-	std::unordered_map<uint32_t, std::vector<uint32_t>> vert2face;
-	std::unordered_map<uint32_t, std::array<glm::vec3, 2>> tangents;
-	for (const auto& shape : shapes) {
-		uint32_t faceIdx{ 0 };
-		for (uint32_t i = 0; i < shape.mesh.indices.size(); i++) {
-			const auto& vertInfo = shape.mesh.indices[i];
+	// corners are welded by value. a corner whose obj index triple was seen before
+	// is the same vertex, so only new triples need to be compared by value.
+	VertexWelder welder{ mesh->vertices, obj.indices.size() };
+	mesh->indices.resize(obj.indices.size());
+	for (uint32_t i = 0; i < obj.indices.size(); i++) {
+		const auto& vertInfo = obj.indices[i];
+		uint32_t vertIdx = welder.find(vertInfo);
+		if (vertIdx == VertexWelder::NOT_FOUND) {
 			Vertex vertex{};
 
-			if (vertInfo.vertex_index >= 0) {
+			if (vertInfo.vertex >= 0) {
 				vertex.position = {
-					attrib.vertices[3 * vertInfo.vertex_index + 0],
-					attrib.vertices[3 * vertInfo.vertex_index + 1],
-					attrib.vertices[3 * vertInfo.vertex_index + 2],
+					obj.positions[3 * vertInfo.vertex + 0],
+					obj.positions[3 * vertInfo.vertex + 1],
+					obj.positions[3 * vertInfo.vertex + 2],
 				};
 				if (colorOverwrite) {
 					vertex.color = *colorOverwrite;
 				}
 				else {
 					vertex.color = {
-						attrib.colors[3 * vertInfo.vertex_index + 0],
-						attrib.colors[3 * vertInfo.vertex_index + 1],
-						attrib.colors[3 * vertInfo.vertex_index + 2],
+						obj.colors[3 * vertInfo.vertex + 0],
+						obj.colors[3 * vertInfo.vertex + 1],
+						obj.colors[3 * vertInfo.vertex + 2],
 					};
 				}
 			}
 
-			if (vertInfo.normal_index >= 0) {
+			if (vertInfo.normal >= 0) {
 				vertex.normal = {
-					attrib.normals[3 * vertInfo.normal_index + 0],
-					attrib.normals[3 * vertInfo.normal_index + 1],
-					attrib.normals[3 * vertInfo.normal_index + 2],
+					obj.normals[3 * vertInfo.normal + 0],
+					obj.normals[3 * vertInfo.normal + 1],
+					obj.normals[3 * vertInfo.normal + 2],
 				};
 			}
 
-			if (vertInfo.texcoord_index >= 0) {
+			if (vertInfo.texcoord >= 0) {
 				vertex.uv = {
-					attrib.texcoords[2 * vertInfo.texcoord_index + 0],
-					attrib.texcoords[2 * vertInfo.texcoord_index + 1],
+					obj.texcoords[2 * vertInfo.texcoord + 0],
+					obj.texcoords[2 * vertInfo.texcoord + 1],
 				};
 			}
 
-			auto pair = uniqueVertices.find(vertex);
-			uint32_t vertIdx;
-			if (pair == uniqueVertices.end()) {
-				vertIdx = mesh->vertices.size();
-				uniqueVertices[vertex] = vertIdx;
-				mesh->vertices.push_back(vertex);
-			}
-			else vertIdx = pair->second;
+			vertIdx = welder.insert(vertInfo, vertex);
+		}
+		mesh->indices[i] = vertIdx;
+	}
 
-			if ((mesh->indices.size()) % 3 == 0) { // begining of a face
-				faceIdx = mesh->indices.size();
-			}
-			mesh->indices.push_back(vertIdx);
-			if (!MapHas(vert2face, vertIdx))
-				vert2face.emplace(vertIdx, std::move(std::vector<uint32_t>{}));
-			vert2face[vertIdx].push_back(faceIdx);
-
-			if (reverseWindingOrder) {
-				if ((mesh->indices.size()) % 3 == 0) { // end of a face
-					auto tmp = mesh->indices[faceIdx];
-					mesh->indices[faceIdx] = mesh->indices[faceIdx + 2];
-					mesh->indices[faceIdx + 2] = tmp;
-				}
+	if (reverseWindingOrder) {
+		for (uint32_t i = 0; i < mesh->indices.size(); i += 3) {
+			std::swap(mesh->indices[i], mesh->indices[i + 2]);
+		}
+	}
+
+	generateTangents(mesh);
+}
+
+void Mesh::generateTangents(Mesh* mesh) {
+	const uint32_t faceCount = static_cast<uint32_t>(mesh->indices.size() / 3);
+	const uint32_t vertexCount = static_cast<uint32_t>(mesh->vertices.size());
+	if (faceCount == 0) return;
+	ThreadPool& pool = ThreadPool::shared();
+	const uint32_t* indices = mesh->indices.data();
+	Vertex* vertices = mesh->vertices.data();
+
+	// per face tangent and bitangent, one array per component
+	std::vector<float> tx(faceCount), ty(faceCount), tz(faceCount);
+	std::vector<float> bx(faceCount), by(faceCount), bz(faceCount);
+	pool.parallelFor(faceCount, [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) {
+			const Vertex& v0 = vertices[indices[3 * i]];
+			const Vertex& v1 = vertices[indices[3 * i + 1]];
+			const Vertex& v2 = vertices[indices[3 * i + 2]];
+			const glm::vec3 E1 = v1.position - v0.position;
+			const glm::vec3 E2 = v2.position - v0.position;
+			const glm::vec2 dUV1 = v1.uv - v0.uv;
+			const glm::vec2 dUV2 = v2.uv - v0.uv;
+			const float det = dUV1.x * dUV2.y - dUV2.x * dUV1.y;
+
+			// faces without a proper uv mapping don't contribute
+			glm::vec3 T{ 0.f }, B{ 0.f };
+			if (std::abs(det) > std::numeric_limits<float>::min()) {
+				T = dUV2.y * E1 - dUV1.y * E2;
+				B = dUV1.x * E2 - dUV2.x * E1;
+				const float lenT = glm::length(T), lenB = glm::length(B);
+				T = lenT > 0.f ? T / (det > 0.f ? lenT : -lenT) : glm::vec3{ 0.f };
+				B = lenB > 0.f ? B / (det > 0.f ? lenB : -lenB) : glm::vec3{ 0.f };
 			}
+			tx[i] = T.x; ty[i] = T.y; tz[i] = T.z;
+			bx[i] = B.x; by[i] = B.y; bz[i] = B.z;
 		}
+	}, 4096);
 
-		// calculate tangent
-		for (uint32_t i = 0; i < mesh->indices.size(); i+=3) {
-			const Vertex& v0 = mesh->vertices[mesh->indices[i]];
-			const Vertex& v1 = mesh->vertices[mesh->indices[i+1]];
-			const Vertex& v2 = mesh->vertices[mesh->indices[i+2]];
-			tangents.emplace(i, calcTangent(v0, v1, v2));
+	// faces around each vertex, stored as offsets into one flat list (CSR).
+	// faces are in ascending order, so the sums below don't depend on the thread count.
+	std::vector<uint32_t> vert2faceOffsets(vertexCount + 1, 0);
+	std::vector<uint32_t> vert2face(mesh->indices.size());
+	for (uint32_t i = 0; i < mesh->indices.size(); i++) {
+		vert2faceOffsets[indices[i] + 1]++;
+	}
+	for (uint32_t i = 1; i <= vertexCount; i++) {
+		vert2faceOffsets[i] += vert2faceOffsets[i - 1];
+	}
+	{
+		std::vector<uint32_t> cursor(vert2faceOffsets.begin(), vert2faceOffsets.end() - 1);
+		for (uint32_t i = 0; i < mesh->indices.size(); i++) {
+			vert2face[cursor[indices[i]]++] = i / 3;
 		}
+	}
 
-		for (auto& pair : vert2face) {
-			Vertex& vertex = mesh->vertices[pair.first];
+	pool.parallelFor(vertexCount, [&](size_t first, size_t last) {
+		for (size_t vertIdx = first; vertIdx < last; vertIdx++) {
+			Vertex& vertex = vertices[vertIdx];
+			const glm::vec3 N = vertex.normal;
 			glm::vec3 tangent{ 0.f };
-			//glm::vec3 bitangent{ 0.f };
-			for (auto i : pair.second) {
-				auto t = tangents[i][0];
-				auto b = tangents[i][1];
-				if (glm::dot(glm::cross(vertex.normal, t), b) < 0.0f)
+			for (uint32_t j = vert2faceOffsets[vertIdx]; j < vert2faceOffsets[vertIdx + 1]; j++) {
+				const uint32_t face = vert2face[j];
+				glm::vec3 t{ tx[face], ty[face], tz[face] };
+				const glm::vec3 b{ bx[face], by[face], bz[face] };
+				if (glm::dot(glm::cross(N, t), b) < 0.0f)
 					t = t * -1.0f;
 				tangent += t;
-				//bitangent += b;
 			}
-			tangent = glm::normalize(tangent - vertex.normal * glm::dot(vertex.normal, tangent));
-			vertex.tangent = tangent;
-			//vertex.bitangent = bitangent;
+			tangent = tangent - N * glm::dot(N, tangent);
+			// no usable uvs around this vertex. any direction perpendicular to the normal will do
+			if (glm::dot(tangent, tangent) < 1e-12f) {
+				const glm::vec3 axis = std::abs(N.x) < 0.9f ? glm::vec3{ 1.f, 0.f, 0.f } : glm::vec3{ 0.f, 1.f, 0.f };
+				tangent = axis - N * glm::dot(N, axis);
+			}
+			vertex.tangent = glm::normalize(tangent);
 		}
-	}
+	}, 4096);
 }
 /*
 bool Vertex::operator < (const Vertex& other) const {
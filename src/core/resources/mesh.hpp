@@ -25,9 +25,72 @@ struct Vertex {
 	size_t hash() const;
 };
 
+enum class VertexFormat {
+	FULL = 0,      // Vertex
+	PACKED = 1,    // PackedVertex
+	QUANTIZED = 2, // QuantizedVertex
+};
+
+// 28 bytes. normal and tangent are octahedral encoded and decoded in the vertex shader.
+struct PackedVertex {
+	glm::vec3 position;
+	int16_t normal[2];   // snorm16
+	int16_t tangent[2];  // snorm16
+	uint16_t uv[2];      // half float
+	uint8_t color[4];    // unorm8
+	static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+	static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+
+	static PackedVertex pack(const Vertex& vertex);
+};
+
+// 24 bytes. same as PackedVertex, but the position is quantized to the bounding box of
+// the model. Model::dequantMat() maps it back and is folded into the object transform.
+struct QuantizedVertex {
+	uint16_t position[4]; // unorm16, w unused
+	int16_t normal[2];    // snorm16
+	int16_t tangent[2];   // snorm16
+	uint16_t uv[2];       // half float
+	uint8_t color[4];     // unorm8
+	static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+	static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+
+	static QuantizedVertex pack(const Vertex& vertex, const glm::vec3& boundsMin, const glm::vec3& boundsExtent);
+};
+
+uint32_t vertexStride(VertexFormat format);
+std::vector<VkVertexInputBindingDescription> getBindingDescriptions(VertexFormat format);
+std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(VertexFormat format);
+// the position only stream read by depth passes. vec3 floats, except for quantized models which keep
+// their unorm16 positions, so the dequantizing object transform applies to both streams.
+uint32_t positionStride(VertexFormat format);
+std::vector<VkVertexInputBindingDescription> getPositionBindingDescriptions(VertexFormat format);
+std::vector<VkVertexInputAttributeDescription> getPositionAttributeDescriptions(VertexFormat format);
+
+// one level of detail, a range of Mesh::indices drawn with the shared vertices
+struct MeshLod {
+	uint32_t indexOffset{ 0 };
+	uint32_t indexCount{ 0 };
+	float error{ 0.f }; // geometric error relative to the bounding sphere radius
+};
+
+// a small cluster of consecutive triangles of the full detail level with its culling data.
+// laid out for std430 so the array can be read by shaders as is.
+struct Meshlet {
+	glm::vec4 sphere{ 0.f }; // xyz center, w radius
+	glm::vec4 cone{ 0.f, 0.f, 0.f, 1.f }; // xyz mean normal, w sine of the normals' spread. 1 never culls
+	uint32_t indexOffset{ 0 };
+	uint32_t indexCount{ 0 };
+	uint32_t vertexCount{ 0 };
+	uint32_t padding{ 0 };
+};
+
 struct Mesh {
 	std::vector<Vertex> vertices;
 	std::vector<uint32_t> indices;
+	// empty if the mesh has a single level of detail made of all indices
+	std::vector<MeshLod> lods;
+	std::vector<Meshlet> meshlets;
 	std::string filePath;
 
 	static void loadObjFile(
@@ -35,6 +98,9 @@ struct Mesh {
 		const std::string& ObjFilePath,
 		const glm::vec3* colorOverwrite = nullptr,
 		bool reverseWindingOrder = false);
+	// fills in the tangent of every vertex from the positions, normals and uvs.
+	// loadObjFile calls it, meshes built in code should call it before Engine::createModel.
+	static void generateTangents(Mesh* mesh);
 	static std::array<glm::vec3, 2> calcTangent(
 		const Vertex& v0,
 		const Vertex& v1,
@@ -0,0 +1,182 @@
+#include "resources/mesh_cache.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <thread>
+
+namespace naku {
+
+MeshCache::MeshCache(
+	const std::string& objFilePath,
+	const glm::vec3* colorOverwrite,
+	bool reverseWindingOrder,
+	bool optimized,
+	uint32_t lodCount) {
+	// loading options change the output, so they are part of the key
+	struct {
+		uint32_t version{ VERSION };
+		uint32_t vertexStride{ sizeof(Vertex) };
+		uint32_t reverseWindingOrder;
+		uint32_t hasColorOverwrite;
+		glm::vec3 colorOverwrite{ 0.f };
+		uint32_t optimized;
+		uint32_t lodCount;
+	} options;
+	options.reverseWindingOrder = reverseWindingOrder ? 1 : 0;
+	options.optimized = optimized ? 1 : 0;
+	options.lodCount = lodCount;
+	options.hasColorOverwrite = colorOverwrite ? 1 : 0;
+	if (colorOverwrite) options.colorOverwrite = *colorOverwrite;
+
+	try {
+		MappedFile source{ objFilePath };
+		_sourceSize = source.size();
+		_key = source.hash(hashMemory(&options, sizeof(options)));
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Warning: Mesh cache: " << e.what() << std::endl;
+		return;
+	}
+	open();
+}
+
+MeshCache::MeshCache(uint64_t sourceHash, uint64_t sourceSize, bool optimized, uint32_t lodCount) {
+	struct {
+		uint32_t version{ VERSION };
+		uint32_t vertexStride{ sizeof(Vertex) };
+		uint32_t optimized;
+		uint32_t lodCount;
+	} options;
+	options.optimized = optimized ? 1 : 0;
+	options.lodCount = lodCount;
+
+	_sourceSize = sourceSize;
+	_key = hashMemory(&options, sizeof(options), sourceHash);
+	open();
+}
+
+MeshCache::MeshCache(std::shared_ptr<const MappedFile> file, size_t offset, size_t size) {
+	// no cache path, a miss must not be written over the package
+	_pFile = std::move(file);
+	_offset = offset;
+	_size = size;
+	// the header only needs to agree with itself
+	if (_offset + _size > _pFile->size() || _size < sizeof(Header)) {
+		std::cerr << "Warning: Mesh cache in " << _pFile->filePath() << " is truncated." << std::endl;
+		_pFile.reset();
+		return;
+	}
+	auto header = reinterpret_cast<const Header*>(_pFile->data() + _offset);
+	_key = header->key;
+	_sourceSize = header->sourceSize;
+	validate();
+}
+
+void MeshCache::open() {
+	_cachePath = std::string(MESH_CACHE_DIR) + "/" + hashToString(_key) + ".mesh";
+
+	if (!doesFileExist(_cachePath)) return;
+	try {
+		_pFile = std::make_shared<MappedFile>(_cachePath);
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Warning: Mesh cache: " << e.what() << std::endl;
+		return;
+	}
+	_offset = 0;
+	_size = _pFile->size();
+	validate();
+}
+
+void MeshCache::validate() {
+	// a stale or broken cache file is unmapped so that it can be overwritten
+	if (_size < sizeof(Header)) {
+		_pFile.reset();
+		return;
+	}
+	auto header = reinterpret_cast<const Header*>(_pFile->data() + _offset);
+	if (memcmp(header->magic, Header{}.magic, sizeof(header->magic)) != 0 ||
+		header->version != VERSION ||
+		header->key != _key ||
+		header->sourceSize != _sourceSize ||
+		header->vertexStride != sizeof(Vertex)) {
+		_pFile.reset();
+		return;
+	}
+	const size_t expectedSize = sizeof(Header) +
+		sizeof(Vertex) * static_cast<size_t>(header->vertexCount) +
+		sizeof(uint32_t) * static_cast<size_t>(header->indexCount) +
+		sizeof(MeshLod) * static_cast<size_t>(header->lodCount) +
+		sizeof(Meshlet) * static_cast<size_t>(header->meshletCount);
+	if (_size != expectedSize) {
+		std::cerr << "Warning: Mesh cache " << _pFile->filePath() << " is truncated." << std::endl;
+		_pFile.reset();
+		return;
+	}
+	_header = header;
+}
+
+const Vertex* MeshCache::vertices() const {
+	assert(_header && "Cannot read vertices from an invalid mesh cache.");
+	return reinterpret_cast<const Vertex*>(_pFile->data() + _offset + sizeof(Header));
+}
+
+const uint32_t* MeshCache::indices() const {
+	assert(_header && "Cannot read indices from an invalid mesh cache.");
+	return reinterpret_cast<const uint32_t*>(
+		_pFile->data() + _offset + sizeof(Header) + sizeof(Vertex) * static_cast<size_t>(_header->vertexCount));
+}
+
+const MeshLod* MeshCache::lods() const {
+	assert(_header && "Cannot read lods from an invalid mesh cache.");
+	return reinterpret_cast<const MeshLod*>(
+		reinterpret_cast<const char*>(indices()) + sizeof(uint32_t) * static_cast<size_t>(_header->indexCount));
+}
+
+const Meshlet* MeshCache::meshlets() const {
+	assert(_header && "Cannot read meshlets from an invalid mesh cache.");
+	return reinterpret_cast<const Meshlet*>(
+		reinterpret_cast<const char*>(lods()) + sizeof(MeshLod) * static_cast<size_t>(_header->lodCount));
+}
+
+void MeshCache::write(const Mesh& mesh) const {
+	if (_cachePath.empty()) return;
+
+	Header header{};
+	header.key = _key;
+	header.sourceSize = _sourceSize;
+	header.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+	header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+	header.lodCount = static_cast<uint32_t>(mesh.lods.size());
+	header.meshletCount = static_cast<uint32_t>(mesh.meshlets.size());
+
+	// write to a temporary file first so a half written cache is never picked up.
+	// models load on the pool, threads writing the same mesh each write their own
+	const std::string tmpPath = _cachePath + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+	try {
+		std::filesystem::create_directories(MESH_CACHE_DIR);
+		{
+			std::ofstream file{ tmpPath, std::ios::binary | std::ios::trunc };
+			if (!file.is_open()) {
+				std::cerr << "Warning: Mesh cache: failed to open file: " << tmpPath << std::endl;
+				return;
+			}
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(mesh.vertices.data()), sizeof(Vertex) * mesh.vertices.size());
+			file.write(reinterpret_cast<const char*>(mesh.indices.data()), sizeof(uint32_t) * mesh.indices.size());
+			file.write(reinterpret_cast<const char*>(mesh.lods.data()), sizeof(MeshLod) * mesh.lods.size());
+			file.write(reinterpret_cast<const char*>(mesh.meshlets.data()), sizeof(Meshlet) * mesh.meshlets.size());
+			if (!file.good()) {
+				std::cerr << "Warning: Mesh cache: failed to write file: " << tmpPath << std::endl;
+				return;
+			}
+		}
+		std::filesystem::rename(tmpPath, _cachePath);
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Warning: Mesh cache: " << e.what() << std::endl;
+	}
+}
+
+}
@@ -0,0 +1,76 @@
+#ifndef MESH_CACHE_HPP
+#define MESH_CACHE_HPP
+
+#include "naku.hpp"
+#include "resources/mesh.hpp"
+#include "utils/mapped_file.hpp"
+
+namespace naku {
+
+// on-disk cache of the processed vertices and indices of an obj file, or of a mesh from any other source.
+// cache files are named after the content hash of the source file and the
+// loading options, so editing the source automatically invalidates the cache.
+class MeshCache {
+public:
+	static constexpr uint32_t VERSION = 5;
+
+	struct Header {
+		char magic[4]{ 'N', 'K', 'M', 'S' };
+		uint32_t version{ VERSION };
+		uint64_t key{ 0 };
+		uint64_t sourceSize{ 0 };
+		uint32_t vertexStride{ sizeof(Vertex) };
+		uint32_t vertexCount{ 0 };
+		uint32_t indexCount{ 0 };
+		uint32_t lodCount{ 0 };
+		uint32_t meshletCount{ 0 };
+		uint32_t reserved[5]{};
+	};
+
+	MeshCache(
+		const std::string& objFilePath,
+		const glm::vec3* colorOverwrite = nullptr,
+		bool reverseWindingOrder = false,
+		bool optimized = false,
+		uint32_t lodCount = 0);
+	// for meshes that aren't a whole file. sourceHash must change whenever the mesh does.
+	MeshCache(uint64_t sourceHash, uint64_t sourceSize, bool optimized = false, uint32_t lodCount = 0);
+	// a cache file stored at offset of a larger mapped file, a scene package. it's taken as it is,
+	// whatever it was made from
+	MeshCache(std::shared_ptr<const MappedFile> file, size_t offset, size_t size);
+	~MeshCache() {}
+	MeshCache(const MeshCache&) = delete;
+	MeshCache& operator=(const MeshCache&) = delete;
+
+	bool isValid() const { return _header != nullptr; }
+	std::string cachePath() const { return _cachePath; }
+	uint64_t key() const { return _key; }
+
+	// pointers into the mapped cache file. only valid when isValid() returns true.
+	const Vertex* vertices() const;
+	const uint32_t* indices() const;
+	const MeshLod* lods() const;
+	const Meshlet* meshlets() const;
+	uint32_t vertexCount() const { return _header->vertexCount; }
+	uint32_t indexCount() const { return _header->indexCount; }
+	uint32_t lodCount() const { return _header->lodCount; }
+	uint32_t meshletCount() const { return _header->meshletCount; }
+
+	void write(const Mesh& mesh) const;
+
+private:
+	std::string _cachePath;
+	uint64_t _key{ 0 };
+	uint64_t _sourceSize{ 0 };
+	std::shared_ptr<const MappedFile> _pFile;
+	size_t _offset{ 0 };
+	size_t _size{ 0 };
+	const Header* _header{ nullptr };
+
+	void open();
+	void validate();
+};
+
+}
+
+#endif
@@ -0,0 +1,501 @@
+#include "resources/mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+namespace naku {
+
+namespace {
+
+constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+
+// forsyth's scoring parameters
+constexpr uint32_t FORSYTH_CACHE_SIZE = 32;
+constexpr float CACHE_DECAY_POWER = 1.5f;
+constexpr float LAST_TRI_SCORE = 0.75f;
+constexpr float VALENCE_BOOST_SCALE = 2.0f;
+constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+// how much a meshlet candidate's distance grows when its normal is off the meshlet's
+constexpr float MESHLET_CONE_WEIGHT = 2.f;
+
+float vertexScore(int cachePosition, uint32_t remainingValence) {
+	// vertices without triangles left don't matter anymore
+	if (remainingValence == 0) return -1.f;
+	float score = 0.f;
+	if (cachePosition >= 0) {
+		if (cachePosition < 3) {
+			// the last triangle's vertices get a fixed score so the next one doesn't just reuse them
+			score = LAST_TRI_SCORE;
+		}
+		else {
+			const float scaler = 1.f / (FORSYTH_CACHE_SIZE - 3);
+			score = std::pow(1.f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+		}
+	}
+	// finish off vertices with few triangles left
+	score += VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingValence), -VALENCE_BOOST_POWER);
+	return score;
+}
+
+// fifo cache like the one in the post-transform stage of the gpu
+class FifoCache {
+public:
+	FifoCache(size_t vertexCount, uint32_t cacheSize)
+		: _timestamps(vertexCount, 0), _cacheSize{ cacheSize } {}
+
+	// returns true on a miss
+	bool access(uint32_t vertex) {
+		if (_time - _timestamps[vertex] >= _cacheSize || _timestamps[vertex] == 0) {
+			_timestamps[vertex] = ++_time;
+			return true;
+		}
+		return false;
+	}
+	// invalidates every entry without touching the timestamps
+	void reset() { _time += _cacheSize + 1; }
+
+private:
+	std::vector<uint32_t> _timestamps;
+	uint32_t _time{ 0 };
+	uint32_t _cacheSize;
+};
+
+// front faces are clockwise (VK_FRONT_FACE_CLOCKWISE), so this points out of their front side
+glm::vec3 frontNormal(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2) {
+	return glm::cross(p2 - p0, p1 - p0);
+}
+
+// sphere around the center of the bounding box and a cone around the mean face normal
+void computeMeshletBounds(Meshlet* meshlet, const uint32_t* indices, const std::vector<Vertex>& vertices) {
+	const uint32_t first = meshlet->indexOffset;
+	const uint32_t last = meshlet->indexOffset + meshlet->indexCount;
+	glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+	glm::vec3 boundsMax{ std::numeric_limits<float>::lowest() };
+	for (uint32_t i = first; i < last; i++) {
+		boundsMin = glm::min(boundsMin, vertices[indices[i]].position);
+		boundsMax = glm::max(boundsMax, vertices[indices[i]].position);
+	}
+	const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	float radius{ 0.f };
+	for (uint32_t i = first; i < last; i++) radius = std::max(radius, glm::length(vertices[indices[i]].position - center));
+	meshlet->sphere = glm::vec4(center, radius);
+
+	// degenerate triangles don't count
+	glm::vec3 sum{ 0.f };
+	for (uint32_t i = first; i < last; i += 3) {
+		const glm::vec3 normal = frontNormal(
+			vertices[indices[i + 0]].position, vertices[indices[i + 1]].position, vertices[indices[i + 2]].position);
+		const float length = glm::length(normal);
+		if (length > 0.f) sum += normal / length;
+	}
+	meshlet->cone = glm::vec4(0.f, 0.f, 0.f, 1.f);
+	const float sumLength = glm::length(sum);
+	if (sumLength <= 0.f) return;
+	const glm::vec3 axis = sum / sumLength;
+	float minDot{ 1.f };
+	for (uint32_t i = first; i < last; i += 3) {
+		const glm::vec3 normal = frontNormal(
+			vertices[indices[i + 0]].position, vertices[indices[i + 1]].position, vertices[indices[i + 2]].position);
+		const float length = glm::length(normal);
+		if (length > 0.f) minDot = std::min(minDot, glm::dot(axis, normal / length));
+	}
+	// cones wider than a hemisphere can always be seen from somewhere in front
+	if (minDot > 0.f) meshlet->cone = glm::vec4(axis, std::sqrt(1.f - minDot * minDot));
+}
+
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount) {
+	CacheStats stats{};
+	if (indexCount < 3 || vertexCount == 0) return stats;
+
+	FifoCache cache{ vertexCount, STATS_CACHE_SIZE };
+	size_t misses{ 0 };
+	std::vector<bool> used(vertexCount, false);
+	size_t usedCount{ 0 };
+	for (size_t i = 0; i < indexCount; i++) {
+		if (cache.access(indices[i])) misses++;
+		if (!used[indices[i]]) {
+			used[indices[i]] = true;
+			usedCount++;
+		}
+	}
+	stats.acmr = static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+	stats.atvr = static_cast<float>(misses) / static_cast<float>(usedCount);
+	return stats;
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::optimize(Mesh* mesh) {
+	if (mesh->indices.size() < 3 || mesh->vertices.empty()) return {};
+	const CacheStats before = analyzeVertexCache(mesh->indices.data(), mesh->indices.size(), mesh->vertices.size());
+
+	optimizeVertexCache(mesh->indices.data(), mesh->indices.size(), mesh->vertices.size());
+	optimizeOverdraw(mesh->indices.data(), mesh->indices.size(), mesh->vertices);
+	optimizeVertexFetch(mesh);
+	return before;
+}
+
+void MeshOptimizer::optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount) {
+	const size_t triCount = indexCount / 3;
+	if (triCount == 0) return;
+
+	// triangles around each vertex (CSR). emitted triangles are swapped out of the live range
+	std::vector<uint32_t> valence(vertexCount, 0);
+	for (size_t i = 0; i < triCount * 3; i++) valence[indices[i]]++;
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++) adjacencyOffsets[v + 1] = adjacencyOffsets[v] + valence[v];
+	std::vector<uint32_t> adjacency(triCount * 3);
+	{
+		std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < triCount * 3; i++) adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	std::vector<float> scores(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++) scores[v] = vertexScore(-1, valence[v]);
+
+	std::vector<float> triScores(triCount);
+	for (size_t t = 0; t < triCount; t++) {
+		triScores[t] = scores[indices[3 * t]] + scores[indices[3 * t + 1]] + scores[indices[3 * t + 2]];
+	}
+	std::vector<bool> emitted(triCount, false);
+
+	std::vector<uint32_t> output(triCount * 3);
+	std::vector<uint32_t> cache, newCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+	uint32_t bestTri = static_cast<uint32_t>(std::max_element(triScores.begin(), triScores.end()) - triScores.begin());
+	size_t scanCursor{ 0 };
+	for (size_t emittedCount = 0; emittedCount < triCount; emittedCount++) {
+		if (bestTri == INVALID_INDEX) {
+			// nothing in the cache has triangles left, take the next one in input order
+			while (emitted[scanCursor]) scanCursor++;
+			bestTri = static_cast<uint32_t>(scanCursor);
+		}
+		const uint32_t* tri = indices + 3 * bestTri;
+		output[3 * emittedCount + 0] = tri[0];
+		output[3 * emittedCount + 1] = tri[1];
+		output[3 * emittedCount + 2] = tri[2];
+		emitted[bestTri] = true;
+
+		// remove the triangle from the live adjacency of its vertices
+		for (int k = 0; k < 3; k++) {
+			const uint32_t v = tri[k];
+			uint32_t* begin = adjacency.data() + adjacencyOffsets[v];
+			uint32_t* end = begin + valence[v];
+			uint32_t* it = std::find(begin, end, bestTri);
+			if (it != end) {
+				std::swap(*it, *(end - 1));
+				valence[v]--;
+			}
+		}
+
+		// the triangle's vertices move to the front of the lru cache
+		newCache.clear();
+		newCache.push_back(tri[0]);
+		if (tri[1] != tri[0]) newCache.push_back(tri[1]);
+		if (tri[2] != tri[0] && tri[2] != tri[1]) newCache.push_back(tri[2]);
+		const size_t frontCount = newCache.size();
+		for (uint32_t v : cache) {
+			if (std::find(newCache.begin(), newCache.begin() + frontCount, v) == newCache.begin() + frontCount)
+				newCache.push_back(v);
+		}
+
+		// rescore everything that was or is in the cache and the triangles around it
+		for (size_t i = 0; i < newCache.size(); i++) {
+			const uint32_t v = newCache[i];
+			const int position = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+			const float score = vertexScore(position, valence[v]);
+			const float delta = score - scores[v];
+			scores[v] = score;
+			const uint32_t* begin = adjacency.data() + adjacencyOffsets[v];
+			for (uint32_t j = 0; j < valence[v]; j++) triScores[begin[j]] += delta;
+		}
+		if (newCache.size() > FORSYTH_CACHE_SIZE) newCache.resize(FORSYTH_CACHE_SIZE);
+
+		// the next triangle is the best one that touches the cache
+		bestTri = INVALID_INDEX;
+		float bestScore = -std::numeric_limits<float>::max();
+		for (uint32_t v : newCache) {
+			const uint32_t* begin = adjacency.data() + adjacencyOffsets[v];
+			for (uint32_t j = 0; j < valence[v]; j++) {
+				if (triScores[begin[j]] > bestScore) {
+					bestScore = triScores[begin[j]];
+					bestTri = begin[j];
+				}
+			}
+		}
+		std::swap(cache, newCache);
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::optimizeOverdraw(uint32_t* indices, size_t indexCount, const std::vector<Vertex>& vertices) {
+	const size_t triCount = indexCount / 3;
+	if (triCount == 0) return;
+
+	// hard boundaries: the cache starts over (all three vertices missed), so the
+	// clusters can be reordered without hurting the cache
+	std::vector<size_t> clusters;
+	{
+		FifoCache cache{ vertices.size(), STATS_CACHE_SIZE };
+		std::vector<size_t> hardClusters;
+		for (size_t t = 0; t < triCount; t++) {
+			int misses = 0;
+			for (int k = 0; k < 3; k++) misses += cache.access(indices[3 * t + k]) ? 1 : 0;
+			if (t == 0 || misses == 3) hardClusters.push_back(t);
+		}
+		hardClusters.push_back(triCount);
+
+		// soft boundaries: split hard clusters further wherever the running acmr is still
+		// close to the acmr of the whole cluster
+		for (size_t c = 0; c + 1 < hardClusters.size(); c++) {
+			const size_t begin = hardClusters[c], end = hardClusters[c + 1];
+			cache.reset();
+			size_t clusterMisses{ 0 };
+			for (size_t t = begin; t < end; t++) {
+				for (int k = 0; k < 3; k++) clusterMisses += cache.access(indices[3 * t + k]) ? 1 : 0;
+			}
+			const float threshold = OVERDRAW_THRESHOLD * static_cast<float>(clusterMisses) / static_cast<float>(end - begin);
+
+			cache.reset();
+			clusters.push_back(begin);
+			size_t runningMisses{ 0 }, runningTris{ 0 };
+			for (size_t t = begin; t < end; t++) {
+				for (int k = 0; k < 3; k++) runningMisses += cache.access(indices[3 * t + k]) ? 1 : 0;
+				runningTris++;
+				if (t + 1 < end && static_cast<float>(runningMisses) / static_cast<float>(runningTris) <= threshold) {
+					clusters.push_back(t + 1);
+					cache.reset();
+					runningMisses = runningTris = 0;
+				}
+			}
+		}
+		clusters.push_back(triCount);
+	}
+	const size_t clusterCount = clusters.size() - 1;
+	if (clusterCount <= 1) return;
+
+	// area weighted centroid of the mesh and of every cluster
+	glm::vec3 meshCentroid{ 0.f };
+	float meshArea{ 0.f };
+	std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3{ 0.f });
+	std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3{ 0.f });
+	for (size_t c = 0; c < clusterCount; c++) {
+		float clusterArea{ 0.f };
+		for (size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+			const glm::vec3& p0 = vertices[indices[3 * t + 0]].position;
+			const glm::vec3& p1 = vertices[indices[3 * t + 1]].position;
+			const glm::vec3& p2 = vertices[indices[3 * t + 2]].position;
+			const glm::vec3 normal = frontNormal(p0, p1, p2);
+			const float area = glm::length(normal);
+			clusterCentroids[c] += (p0 + p1 + p2) * (area / 3.f);
+			clusterNormals[c] += normal;
+			clusterArea += area;
+		}
+		meshCentroid += clusterCentroids[c];
+		meshArea += clusterArea;
+		if (clusterArea > 0.f) clusterCentroids[c] /= clusterArea;
+	}
+	if (meshArea > 0.f) meshCentroid /= meshArea;
+
+	std::vector<float> sortKeys(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++) {
+		const float length = glm::length(clusterNormals[c]);
+		const glm::vec3 normal = length > 0.f ? clusterNormals[c] / length : glm::vec3{ 0.f };
+		sortKeys[c] = glm::dot(clusterCentroids[c] - meshCentroid, normal);
+	}
+	std::vector<uint32_t> order(clusterCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		return sortKeys[a] > sortKeys[b];
+	});
+
+	std::vector<uint32_t> output;
+	output.reserve(triCount * 3);
+	for (uint32_t c : order) {
+		output.insert(output.end(), indices + 3 * clusters[c], indices + 3 * clusters[c + 1]);
+	}
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::optimizeVertexFetch(Mesh* mesh) {
+	std::vector<uint32_t> remap(mesh->vertices.size(), INVALID_INDEX);
+	std::vector<Vertex> vertices;
+	vertices.reserve(mesh->vertices.size());
+	for (auto& index : mesh->indices) {
+		if (remap[index] == INVALID_INDEX) {
+			remap[index] = static_cast<uint32_t>(vertices.size());
+			vertices.push_back(mesh->vertices[index]);
+		}
+		index = remap[index];
+	}
+	mesh->vertices = std::move(vertices);
+}
+
+std::vector<Meshlet> MeshOptimizer::buildMeshlets(uint32_t* indices, size_t indexCount, const std::vector<Vertex>& vertices) {
+	std::vector<Meshlet> meshlets;
+	const size_t triangleCount = indexCount / 3;
+	const size_t vertexCount = vertices.size();
+	if (triangleCount == 0 || vertexCount == 0) return meshlets;
+
+	// vertex to triangle adjacency and the number of triangles left around each vertex
+	std::vector<uint32_t> liveCounts(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++) liveCounts[indices[i]]++;
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++) adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveCounts[v];
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	{
+		std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t t = 0; t < triangleCount; t++) {
+			for (size_t j = 0; j < 3; j++) adjacency[cursor[indices[t * 3 + j]]++] = static_cast<uint32_t>(t);
+		}
+	}
+	std::vector<glm::vec3> faceNormals(triangleCount);
+	std::vector<glm::vec3> faceCenters(triangleCount);
+	for (size_t t = 0; t < triangleCount; t++) {
+		const glm::vec3& p0 = vertices[indices[t * 3 + 0]].position;
+		const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+		const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+		const glm::vec3 normal = frontNormal(p0, p1, p2);
+		const float length = glm::length(normal);
+		faceNormals[t] = length > 0.f ? normal / length : glm::vec3{ 0.f };
+		faceCenters[t] = (p0 + p1 + p2) / 3.f;
+	}
+
+	// vertex v is in the current meshlet if marks[v] equals its number plus one
+	std::vector<uint32_t> marks(vertexCount, 0);
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> reordered;
+	reordered.reserve(triangleCount * 3);
+	// the input triangle of each emitted one
+	std::vector<uint32_t> sources;
+	sources.reserve(triangleCount);
+	std::vector<uint32_t> unique;
+	unique.reserve(MESHLET_MAX_VERTICES);
+	glm::vec3 normalSum{ 0.f };
+	glm::vec3 centerSum{ 0.f };
+	uint32_t meshletTriangles{ 0 };
+	size_t seedCursor{ 0 };
+
+	auto finish = [&]() {
+		Meshlet meshlet{};
+		meshlet.indexOffset = meshlets.empty() ? 0 : meshlets.back().indexOffset + meshlets.back().indexCount;
+		meshlet.indexCount = static_cast<uint32_t>(reordered.size()) - meshlet.indexOffset;
+		meshlet.vertexCount = static_cast<uint32_t>(unique.size());
+		meshlets.push_back(meshlet);
+		unique.clear();
+		normalSum = glm::vec3{ 0.f };
+		centerSum = glm::vec3{ 0.f };
+		meshletTriangles = 0;
+	};
+
+	// grow each meshlet with the neighbor adding the fewest vertices. ties go to the one
+	// closest to the meshlet, weighted by how far its normal is off so the cones stay narrow
+	for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+		const uint32_t mark = static_cast<uint32_t>(meshlets.size()) + 1;
+		uint32_t best = INVALID_INDEX;
+		uint32_t bestExtra{ 4 };
+		float bestScore{ std::numeric_limits<float>::max() };
+		if (!unique.empty()) {
+			const float sumLength = glm::length(normalSum);
+			const glm::vec3 axis = sumLength > 0.f ? normalSum / sumLength : glm::vec3{ 0.f };
+			const glm::vec3 center = centerSum / static_cast<float>(meshletTriangles);
+			for (uint32_t v : unique) {
+				if (liveCounts[v] == 0) continue;
+				for (uint32_t j = adjacencyOffsets[v]; j < adjacencyOffsets[v + 1]; j++) {
+					const uint32_t t = adjacency[j];
+					if (emitted[t]) continue;
+					uint32_t extra{ 0 };
+					bool closesVertex{ false };
+					for (size_t k = 0; k < 3; k++) {
+						if (marks[indices[t * 3 + k]] != mark) extra++;
+						if (liveCounts[indices[t * 3 + k]] == 1) closesVertex = true;
+					}
+					const float spread = 1.f - glm::dot(axis, faceNormals[t]);
+					float score = glm::length(faceCenters[t] - center) * (1.f + MESHLET_CONE_WEIGHT * spread);
+					// the last triangle around a vertex goes first, or it would be left behind as an island
+					if (closesVertex) score = -1.f;
+					if (extra < bestExtra || (extra == bestExtra && score < bestScore)) {
+						best = t;
+						bestExtra = extra;
+						bestScore = score;
+					}
+				}
+			}
+			// a neighbor that doesn't fit starts the next meshlet, so that one stays close by
+			if (best == INVALID_INDEX ||
+				unique.size() + bestExtra > MESHLET_MAX_VERTICES ||
+				meshletTriangles + 1 > MESHLET_MAX_TRIANGLES) {
+				finish();
+			}
+		}
+		if (best == INVALID_INDEX) {
+			while (emitted[seedCursor]) seedCursor++;
+			best = static_cast<uint32_t>(seedCursor);
+		}
+
+		const uint32_t currentMark = static_cast<uint32_t>(meshlets.size()) + 1;
+		for (size_t k = 0; k < 3; k++) {
+			const uint32_t v = indices[best * 3 + k];
+			liveCounts[v]--;
+			reordered.push_back(v);
+			if (marks[v] == currentMark) continue;
+			marks[v] = currentMark;
+			unique.push_back(v);
+		}
+		normalSum += faceNormals[best];
+		centerSum += faceCenters[best];
+		meshletTriangles++;
+		emitted[best] = 1;
+		sources.push_back(best);
+	}
+	finish();
+
+	// growing by neighbors loses the order the triangles came in. the meshlets are drawn in the
+	// order of their first input triangle, which keeps optimizeOverdraw's outside first order,
+	// and the triangles of each are put back into vertex cache order
+	std::vector<uint32_t> firstSources(meshlets.size());
+	for (size_t m = 0; m < meshlets.size(); m++) {
+		auto first = sources.begin() + meshlets[m].indexOffset / 3;
+		firstSources[m] = *std::min_element(first, first + meshlets[m].indexCount / 3);
+	}
+	std::vector<uint32_t> order(meshlets.size());
+	std::iota(order.begin(), order.end(), 0u);
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return firstSources[a] < firstSources[b]; });
+
+	std::vector<Meshlet> sorted;
+	sorted.reserve(meshlets.size());
+	// a meshlet's vertices are numbered from 0 while it's optimized
+	std::vector<uint32_t> localIds(vertexCount, INVALID_INDEX);
+	std::vector<uint32_t> globalIds;
+	globalIds.reserve(MESHLET_MAX_VERTICES);
+	uint32_t offset{ 0 };
+	for (uint32_t m : order) {
+		Meshlet meshlet = meshlets[m];
+		uint32_t* range = indices + offset;
+		globalIds.clear();
+		for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+			const uint32_t v = reordered[meshlet.indexOffset + i];
+			if (localIds[v] == INVALID_INDEX) {
+				localIds[v] = static_cast<uint32_t>(globalIds.size());
+				globalIds.push_back(v);
+			}
+			range[i] = localIds[v];
+		}
+		optimizeVertexCache(range, meshlet.indexCount, globalIds.size());
+		for (uint32_t i = 0; i < meshlet.indexCount; i++) range[i] = globalIds[range[i]];
+		for (uint32_t v : globalIds) localIds[v] = INVALID_INDEX;
+
+		meshlet.indexOffset = offset;
+		offset += meshlet.indexCount;
+		computeMeshletBounds(&meshlet, indices, vertices);
+		sorted.push_back(meshlet);
+	}
+	return sorted;
+}
+
+}
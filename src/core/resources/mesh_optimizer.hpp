@@ -0,0 +1,48 @@
+#ifndef MESH_OPTIMIZER_HPP
+#define MESH_OPTIMIZER_HPP
+
+#include "naku.hpp"
+#include "resources/mesh.hpp"
+
+namespace naku {
+
+// reorders indices and vertices of a welded triangle mesh for the gpu. the mesh stays
+// visually identical, only the order of triangles and vertices changes.
+class MeshOptimizer {
+public:
+	struct CacheStats {
+		float acmr{ 0.f }; // average cache miss ratio. vertex shader runs per triangle, 0.5 ~ 3
+		float atvr{ 0.f }; // average transformed vertex ratio. vertex shader runs per vertex, >= 1
+	};
+
+	// size of the simulated fifo post-transform cache used for the stats
+	static constexpr uint32_t STATS_CACHE_SIZE = 16;
+	// soft cluster boundaries for overdraw may raise the acmr by this factor
+	static constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+	// meshlet limits, the ones mesh shading hardware prefers
+	static constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+	static constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+	// runs all passes below in order. returns the stats of the order the mesh came in
+	static CacheStats optimize(Mesh* mesh);
+
+	// tom forsyth's linear-speed vertex cache optimization
+	static void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+	// splits the cache optimized order into clusters and sorts them outside first,
+	// so the triangles facing away from the mesh center are drawn first and occlude the rest
+	static void optimizeOverdraw(uint32_t* indices, size_t indexCount, const std::vector<Vertex>& vertices);
+	// renumbers vertices in the order they are first used and drops unused ones
+	static void optimizeVertexFetch(Mesh* mesh);
+
+	// groups neighboring triangles into meshlets and reorders the triangles so that
+	// every meshlet is a range of the index buffer. the meshlets keep the order of the
+	// triangles they start with, each one in vertex cache order
+	static std::vector<Meshlet> buildMeshlets(uint32_t* indices, size_t indexCount, const std::vector<Vertex>& vertices);
+
+	static CacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount);
+};
+
+}
+
+#endif
@@ -0,0 +1,317 @@
+#include "resources/mesh_simplifier.hpp"
+#include "resources/mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+namespace naku {
+
+namespace {
+
+constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+
+// sum of the squared distances to a set of area weighted planes
+struct Quadric {
+	double a00{ 0. }, a11{ 0. }, a22{ 0. }, a01{ 0. }, a02{ 0. }, a12{ 0. };
+	double b0{ 0. }, b1{ 0. }, b2{ 0. };
+	double c{ 0. };
+	double weight{ 0. };
+
+	void addPlane(const glm::dvec3& n, double d, double w) {
+		a00 += w * n.x * n.x; a11 += w * n.y * n.y; a22 += w * n.z * n.z;
+		a01 += w * n.x * n.y; a02 += w * n.x * n.z; a12 += w * n.y * n.z;
+		b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+		c += w * d * d;
+		weight += w;
+	}
+	Quadric& operator+=(const Quadric& q) {
+		a00 += q.a00; a11 += q.a11; a22 += q.a22;
+		a01 += q.a01; a02 += q.a02; a12 += q.a12;
+		b0 += q.b0; b1 += q.b1; b2 += q.b2;
+		c += q.c;
+		weight += q.weight;
+		return *this;
+	}
+	// weighted mean of the squared distances from p to the planes
+	double error(const glm::dvec3& p) const {
+		if (weight <= 0.) return 0.;
+		const double r = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z
+			+ 2. * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z)
+			+ 2. * (b0 * p.x + b1 * p.y + b2 * p.z)
+			+ c;
+		return std::abs(r) / weight;
+	}
+};
+
+struct Collapse {
+	uint32_t v0; // removed vertex
+	uint32_t v1; // vertex it moves onto
+	double error;
+};
+
+bool positionLess(const glm::vec3& a, const glm::vec3& b) {
+	uint32_t ab[3], bb[3];
+	memcpy(ab, &a, sizeof(ab));
+	memcpy(bb, &b, sizeof(bb));
+	return std::lexicographical_compare(ab, ab + 3, bb, bb + 3);
+}
+
+bool positionEqual(const glm::vec3& a, const glm::vec3& b) {
+	return memcmp(&a, &b, sizeof(glm::vec3)) == 0;
+}
+
+// true if moving v0 onto v1 turns any remaining triangle around v0 upside down
+bool hasTriangleFlips(
+	uint32_t v0,
+	uint32_t v1,
+	const uint32_t* indices,
+	const std::vector<glm::dvec3>& positions,
+	const std::vector<uint32_t>& collapseRemap,
+	const uint32_t* triangles,
+	uint32_t triangleCount) {
+	for (uint32_t i = 0; i < triangleCount; i++) {
+		const uint32_t t = triangles[i];
+		uint32_t a = collapseRemap[indices[t * 3 + 0]];
+		uint32_t b = collapseRemap[indices[t * 3 + 1]];
+		uint32_t c = collapseRemap[indices[t * 3 + 2]];
+		// triangles on the collapsed edge disappear, degenerate ones are already gone
+		if (a == v1 || b == v1 || c == v1) continue;
+		if (a == b || b == c || a == c) continue;
+		// rotate the collapsed corner to the front
+		if (b == v0) std::swap(a, b), std::swap(b, c);
+		else if (c == v0) std::swap(a, c), std::swap(b, c);
+		if (a != v0) continue;
+
+		const glm::dvec3 before = glm::cross(positions[b] - positions[v0], positions[c] - positions[v0]);
+		const glm::dvec3 after = glm::cross(positions[b] - positions[v1], positions[c] - positions[v1]);
+		if (glm::dot(before, after) <= 0.) return true;
+	}
+	return false;
+}
+
+}
+
+size_t MeshSimplifier::simplify(
+	uint32_t* destination,
+	const uint32_t* indices,
+	size_t indexCount,
+	const std::vector<Vertex>& vertices,
+	size_t targetIndexCount,
+	float targetError,
+	float* resultError) {
+	std::copy(indices, indices + indexCount, destination);
+	if (resultError) *resultError = 0.f;
+	const size_t vertexCount = vertices.size();
+	if (indexCount < 3 || indexCount <= targetIndexCount || vertexCount == 0) return indexCount;
+
+	// normalized positions make the error independent of the size of the mesh
+	glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+	glm::vec3 boundsMax{ std::numeric_limits<float>::lowest() };
+	for (size_t i = 0; i < indexCount; i++) {
+		boundsMin = glm::min(boundsMin, vertices[indices[i]].position);
+		boundsMax = glm::max(boundsMax, vertices[indices[i]].position);
+	}
+	const glm::vec3 extent = boundsMax - boundsMin;
+	const float scale = std::max(extent.x, std::max(extent.y, extent.z));
+	const double invScale = scale > 0.f ? 1. / scale : 0.;
+	std::vector<glm::dvec3> positions(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++) {
+		positions[i] = glm::dvec3(vertices[i].position - boundsMin) * invScale;
+	}
+
+	// vertices split on uv or normal seams share a position. remap points all of them at one
+	// representative, and every representative of more than one vertex is locked.
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<uint8_t> locked(vertexCount, 0);
+	{
+		std::vector<uint32_t> order(vertexCount);
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+			if (positionEqual(vertices[a].position, vertices[b].position)) return a < b;
+			return positionLess(vertices[a].position, vertices[b].position);
+		});
+		for (size_t i = 0; i < vertexCount;) {
+			size_t j = i + 1;
+			while (j < vertexCount && positionEqual(vertices[order[i]].position, vertices[order[j]].position)) j++;
+			for (size_t k = i; k < j; k++) remap[order[k]] = order[i];
+			if (j - i > 1) locked[order[i]] = 1;
+			i = j;
+		}
+	}
+
+	// an edge of a closed manifold surface is used once in each direction.
+	// open and non-manifold edges lock both of their ends.
+	{
+		std::vector<uint64_t> edges;
+		edges.reserve(indexCount);
+		for (size_t i = 0; i < indexCount; i += 3) {
+			for (size_t e = 0; e < 3; e++) {
+				const uint64_t a = remap[indices[i + e]];
+				const uint64_t b = remap[indices[i + (e + 1) % 3]];
+				edges.push_back(a << 32 | b);
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		for (size_t i = 0; i < edges.size(); i++) {
+			const uint32_t a = static_cast<uint32_t>(edges[i] >> 32);
+			const uint32_t b = static_cast<uint32_t>(edges[i]);
+			const bool duplicate = (i > 0 && edges[i - 1] == edges[i]) || (i + 1 < edges.size() && edges[i + 1] == edges[i]);
+			const uint64_t reverse = static_cast<uint64_t>(b) << 32 | a;
+			const auto range = std::equal_range(edges.begin(), edges.end(), reverse);
+			if (a == b || duplicate || range.second - range.first != 1) {
+				locked[a] = 1;
+				locked[b] = 1;
+			}
+		}
+	}
+
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < indexCount; i += 3) {
+		const glm::dvec3& p0 = positions[indices[i + 0]];
+		const glm::dvec3& p1 = positions[indices[i + 1]];
+		const glm::dvec3& p2 = positions[indices[i + 2]];
+		glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+		const double length = glm::length(normal);
+		if (length <= 0.) continue;
+		normal /= length;
+		const double d = -glm::dot(normal, p0);
+		for (size_t j = 0; j < 3; j++) {
+			quadrics[remap[indices[i + j]]].addPlane(normal, d, length * 0.5);
+		}
+	}
+
+	const double maxError = static_cast<double>(targetError) * targetError;
+	double worstError{ 0. };
+	size_t currentCount = indexCount;
+
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+	std::vector<uint32_t> adjacency;
+	std::vector<uint32_t> collapseRemap(vertexCount);
+	std::vector<uint8_t> collapseLocked(vertexCount);
+	std::vector<uint32_t> bestTargets(vertexCount);
+	std::vector<double> bestErrors(vertexCount);
+	std::vector<Collapse> collapses;
+
+	while (currentCount > targetIndexCount) {
+		const size_t triangleCount = currentCount / 3;
+
+		// vertex to triangle adjacency of what is left
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (size_t i = 0; i < currentCount; i++) adjacencyOffsets[destination[i] + 1]++;
+		for (size_t v = 0; v < vertexCount; v++) adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+		adjacency.resize(currentCount);
+		{
+			std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t t = 0; t < triangleCount; t++) {
+				for (size_t j = 0; j < 3; j++) adjacency[cursor[destination[t * 3 + j]]++] = static_cast<uint32_t>(t);
+			}
+		}
+
+		// the cheapest outgoing edge of every unlocked vertex is a candidate
+		std::fill(bestTargets.begin(), bestTargets.end(), INVALID_INDEX);
+		for (size_t t = 0; t < triangleCount; t++) {
+			for (size_t e = 0; e < 3; e++) {
+				const uint32_t v0 = destination[t * 3 + e];
+				const uint32_t v1 = destination[t * 3 + (e + 1) % 3];
+				if (locked[v0] || remap[v0] != v0) continue;
+				const double error = quadrics[v0].error(positions[v1]);
+				if (error > maxError) continue;
+				if (bestTargets[v0] == INVALID_INDEX || error < bestErrors[v0]) {
+					bestTargets[v0] = v1;
+					bestErrors[v0] = error;
+				}
+			}
+		}
+		collapses.clear();
+		for (size_t v = 0; v < vertexCount; v++) {
+			if (bestTargets[v] != INVALID_INDEX) collapses.push_back({ static_cast<uint32_t>(v), bestTargets[v], bestErrors[v] });
+		}
+		if (collapses.empty()) break;
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+			return a.error < b.error;
+		});
+
+		// collapse the cheapest edges whose ends haven't been touched in this pass.
+		// an interior collapse removes two triangles.
+		std::iota(collapseRemap.begin(), collapseRemap.end(), 0);
+		std::fill(collapseLocked.begin(), collapseLocked.end(), 0);
+		const size_t triangleGoal = (currentCount - targetIndexCount) / 3;
+		size_t removed{ 0 };
+		for (const Collapse& collapse : collapses) {
+			if (removed >= triangleGoal) break;
+			if (collapseLocked[collapse.v0] || collapseLocked[collapse.v1]) continue;
+			const uint32_t* triangles = adjacency.data() + adjacencyOffsets[collapse.v0];
+			const uint32_t count = adjacencyOffsets[collapse.v0 + 1] - adjacencyOffsets[collapse.v0];
+			if (hasTriangleFlips(collapse.v0, collapse.v1, destination, positions, collapseRemap, triangles, count)) continue;
+
+			collapseRemap[collapse.v0] = collapse.v1;
+			quadrics[remap[collapse.v1]] += quadrics[collapse.v0];
+			collapseLocked[collapse.v0] = 1;
+			collapseLocked[collapse.v1] = 1;
+			worstError = std::max(worstError, collapse.error);
+			removed += 2;
+		}
+		if (removed == 0) break;
+
+		size_t writeCount{ 0 };
+		for (size_t i = 0; i < currentCount; i += 3) {
+			const uint32_t a = collapseRemap[destination[i + 0]];
+			const uint32_t b = collapseRemap[destination[i + 1]];
+			const uint32_t c = collapseRemap[destination[i + 2]];
+			if (a == b || b == c || a == c) continue;
+			destination[writeCount++] = a;
+			destination[writeCount++] = b;
+			destination[writeCount++] = c;
+		}
+		currentCount = writeCount;
+	}
+
+	if (resultError) *resultError = static_cast<float>(std::sqrt(worstError));
+	return currentCount;
+}
+
+void MeshSimplifier::generateLods(Mesh* mesh, uint32_t lodCount) {
+	mesh->lods.clear();
+	const size_t indexCount = mesh->indices.size();
+	if (lodCount == 0 || indexCount < 3 || mesh->vertices.empty()) return;
+
+	glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+	glm::vec3 boundsMax{ std::numeric_limits<float>::lowest() };
+	for (const Vertex& vertex : mesh->vertices) {
+		boundsMin = glm::min(boundsMin, vertex.position);
+		boundsMax = glm::max(boundsMax, vertex.position);
+	}
+	const glm::vec3 extent = boundsMax - boundsMin;
+	const float scale = std::max(extent.x, std::max(extent.y, extent.z));
+	const float radius = glm::length(extent) * 0.5f;
+	if (radius <= 0.f) return;
+
+	std::vector<MeshLod> lods{ { 0, static_cast<uint32_t>(indexCount), 0.f } };
+	std::vector<uint32_t> current(mesh->indices);
+	std::vector<uint32_t> next;
+	// each level is simplified from the previous one, so their errors add up
+	float error{ 0.f };
+	for (uint32_t i = 0; i < lodCount && error < MAX_LOD_ERROR; i++) {
+		const size_t targetCount = static_cast<size_t>(current.size() / 3 * LOD_RATIO) * 3;
+		next.resize(current.size());
+		float lodError{ 0.f };
+		const size_t count = simplify(
+			next.data(), current.data(), current.size(), mesh->vertices, targetCount, MAX_LOD_ERROR - error, &lodError);
+		if (count == 0 || count > current.size() * (1.f - MIN_LOD_REDUCTION)) break;
+		next.resize(count);
+		MeshOptimizer::optimizeVertexCache(next.data(), next.size(), mesh->vertices.size());
+
+		error += lodError;
+		lods.push_back({
+			static_cast<uint32_t>(mesh->indices.size()),
+			static_cast<uint32_t>(count),
+			error * scale / radius });
+		mesh->indices.insert(mesh->indices.end(), next.begin(), next.end());
+		current.swap(next);
+	}
+	if (lods.size() < 2) return;
+	mesh->lods = std::move(lods);
+}
+
+}
@@ -0,0 +1,39 @@
+#ifndef MESH_SIMPLIFIER_HPP
+#define MESH_SIMPLIFIER_HPP
+
+#include "naku.hpp"
+#include "resources/mesh.hpp"
+
+namespace naku {
+
+// quadric error edge collapse simplification of welded triangle meshes.
+// vertices only ever collapse onto their neighbors, so the vertex buffer is shared by all levels.
+// vertices on open borders and attribute seams are locked to keep the silhouette and the uv layout.
+class MeshSimplifier {
+public:
+	// each level aims at this fraction of the triangles of the previous one
+	static constexpr float LOD_RATIO = 0.5f;
+	// a level is dropped if it doesn't remove at least this fraction of the previous one
+	static constexpr float MIN_LOD_REDUCTION = 0.1f;
+	// largest error a level may reach, relative to the size of the mesh
+	static constexpr float MAX_LOD_ERROR = 0.05f;
+
+	// appends up to lodCount coarser levels to mesh->indices and fills in mesh->lods
+	static void generateLods(Mesh* mesh, uint32_t lodCount);
+
+	// writes the simplified triangles to destination, which must hold indexCount entries, and
+	// returns the new index count. stops at targetIndexCount or once the next collapse would exceed
+	// targetError, relative to the largest extent of the mesh. resultError receives the error reached.
+	static size_t simplify(
+		uint32_t* destination,
+		const uint32_t* indices,
+		size_t indexCount,
+		const std::vector<Vertex>& vertices,
+		size_t targetIndexCount,
+		float targetError,
+		float* resultError = nullptr);
+};
+
+}
+
+#endif
@@ -1,96 +1,420 @@
 #include "resources/model.hpp"
+#include "resources/mesh_cache.hpp"
+#include "resources/gltf_parser.hpp"
+#include "resources/mesh_optimizer.hpp"
+#include "resources/mesh_simplifier.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/upload_batch.hpp"
 
 namespace naku {
 
-Model::Model(Device& device, const std::string& name, const Mesh& Mesh)
-	: Resource{ device, name }, _filePath{Mesh.filePath} {
-	createVertexBuffer(Mesh.vertices);
-	createIndexBuffer(Mesh.indices);
+namespace {
+
+// returns true if the mesh was optimized, with the stats of the full detail level before
+// and after. runs on workers, the caller reports them
+bool processMesh(Mesh* mesh, const ModelOptions& options, MeshOptimizer::CacheStats* before, MeshOptimizer::CacheStats* after) {
+	// meshes that come with their own levels keep their triangle order
+	const bool optimized = options.optimize && mesh->lods.empty();
+	if (mesh->lods.empty()) {
+		if (optimized) *before = MeshOptimizer::optimize(mesh);
+		MeshSimplifier::generateLods(mesh, options.lodCount);
+	}
+	const size_t indexCount = mesh->lods.empty() ? mesh->indices.size() : mesh->lods[0].indexCount;
+	if (mesh->meshlets.empty())
+		mesh->meshlets = MeshOptimizer::buildMeshlets(mesh->indices.data(), indexCount, mesh->vertices);
+	// measured on the order that's drawn, after the meshlets took their ranges
+	if (optimized) *after = MeshOptimizer::analyzeVertexCache(mesh->indices.data(), indexCount, mesh->vertices.size());
+	return optimized;
+}
+
+}
+
+Model::Model(Device& device, const std::string& name, const Mesh& Mesh, const ModelOptions& options)
+	: Resource{ device, name }, _filePath{Mesh.filePath}, _vertexFormat{ options.vertexFormat } {
+	naku::Mesh processed = Mesh;
+	_optimized = processMesh(&processed, options, &_statsBefore, &_statsAfter);
+	createVertexBuffer(processed.vertices);
+	createIndexBuffer(processed.indices);
+	setLods(processed.lods);
+	setMeshlets(processed.meshlets);
+	computeUvDensity(processed.vertices.data(), processed.indices.data());
+}
+
+Model::Model(Device& device, const std::string& name, const std::string& ObjFilePath, const ModelOptions& options)
+	: Resource{ device, name }, _filePath{ ObjFilePath }, _vertexFormat{ options.vertexFormat } {
+	MeshCache cache{ ObjFilePath, nullptr, true, options.optimize, options.lodCount };
+	load(cache, [&](Mesh* mesh) { Mesh::loadObjFile(mesh, ObjFilePath, nullptr, true); }, options);
+}
+
+Model::Model(Device& device, const std::string& name, const GltfData& gltf, uint32_t mesh, uint32_t primitive, const ModelOptions& options)
+	: Resource{ device, name }, _filePath{ gltf.filePath }, _vertexFormat{ options.vertexFormat } {
+	// the file hash covers every primitive, the indices pick this one
+	const uint32_t key[2]{ mesh, primitive };
+	MeshCache cache{ hashMemory(key, sizeof(key), gltf.hash), 0, options.optimize, options.lodCount };
+	load(cache, [&](Mesh* pMesh) {
+		std::string warn;
+		if (!gltf.loadPrimitive(pMesh, mesh, primitive, &warn))
+			std::cerr << "Error: Failed to load " << name << " from " << gltf.filePath << ": " << warn;
+		else if (!warn.empty())
+			std::cerr << "Warning: " << gltf.filePath << ": " << warn;
+	}, options);
+}
+
+Model::Model(Device& device, const std::string& name, const MeshCache& cache, const ModelOptions& options)
+	: Resource{ device, name }, _vertexFormat{ options.vertexFormat } {
+	if (!cache.isValid())
+		throw std::runtime_error("Error: Model " + name + " has no valid mesh data.");
+	load(cache, nullptr, options);
 }
 
-Model::Model(Device& device, const std::string& name, const std::string& ObjFilePath)
-	: Resource{ device, name }, _filePath{ ObjFilePath } {
+void Model::load(const MeshCache& cache, const std::function<void(Mesh*)>& loadMesh, const ModelOptions& options) {
+	_cachePath = cache.cachePath();
+	// cached data is copied from the mapped file straight into the staging buffers
+	if (cache.isValid()) {
+		if (cache.vertexCount() >= 3) {
+			createVertexBuffer(cache.vertices(), cache.vertexCount());
+			createIndexBuffer(cache.indices(), cache.indexCount());
+			setLods(cache.lods(), cache.lodCount());
+			setMeshlets(cache.meshlets(), cache.meshletCount());
+			computeUvDensity(cache.vertices(), cache.indices());
+		}
+		return;
+	}
+
 	Mesh mesh{};
 
-	Mesh::loadObjFile(&mesh, ObjFilePath, nullptr, true);
+	loadMesh(&mesh);
+	_optimized = processMesh(&mesh, options, &_statsBefore, &_statsAfter);
+	cache.write(mesh);
 
 	if (mesh.vertices.size() >= 3) {
 		createVertexBuffer(mesh.vertices);
 		createIndexBuffer(mesh.indices);
+		setLods(mesh.lods);
+		setMeshlets(mesh.meshlets);
+		computeUvDensity(mesh.vertices.data(), mesh.indices.data());
 	}
-
 }
 
 Model::~Model() { }
 
+bool Model::cacheStats(MeshOptimizer::CacheStats* before, MeshOptimizer::CacheStats* after) const {
+	if (!_optimized) return false;
+	*before = _statsBefore;
+	*after = _statsAfter;
+	return true;
+}
+
 void Model::createVertexBuffer(const std::vector<Vertex>& vertices) {
-	_vertexCount = static_cast<uint32_t>(vertices.size());
+	createVertexBuffer(vertices.data(), static_cast<uint32_t>(vertices.size()));
+}
+
+void Model::createVertexBuffer(const Vertex* vertices, uint32_t vertexCount) {
+	_vertexCount = vertexCount;
 	assert(_vertexCount >= 3 && "vertices must be no less than 3.");
-	uint32_t vertexSize = sizeof(vertices[0]);
-	VkDeviceSize bufferSize = sizeof(vertices[0]) * _vertexCount;
+
+	_boundsMin = glm::vec3{ std::numeric_limits<float>::max() };
+	_boundsMax = glm::vec3{ std::numeric_limits<float>::lowest() };
+	for (uint32_t i = 0; i < _vertexCount; i++) {
+		_boundsMin = glm::min(_boundsMin, vertices[i].position);
+		_boundsMax = glm::max(_boundsMax, vertices[i].position);
+	}
+
+	ThreadPool& pool = ThreadPool::shared();
+	if (_vertexFormat == VertexFormat::PACKED) {
+		std::vector<PackedVertex> packed(_vertexCount);
+		pool.parallelFor(_vertexCount, [&](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++) packed[i] = PackedVertex::pack(vertices[i]);
+		}, 4096);
+		createDeviceLocalBuffer(_vertexBuffer, packed.data(), sizeof(PackedVertex), _vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+	}
+	else if (_vertexFormat == VertexFormat::QUANTIZED) {
+		// flat meshes have a zero extent along one axis, which would make the dequantization matrix singular
+		const glm::vec3 extent = glm::max(_boundsMax - _boundsMin, glm::vec3{ 1e-6f });
+		_dequantMat = glm::scale(glm::translate(glm::mat4{ 1.f }, _boundsMin), extent);
+		std::vector<QuantizedVertex> quantized(_vertexCount);
+		pool.parallelFor(_vertexCount, [&](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++) quantized[i] = QuantizedVertex::pack(vertices[i], _boundsMin, extent);
+		}, 4096);
+		createDeviceLocalBuffer(_vertexBuffer, quantized.data(), sizeof(QuantizedVertex), _vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+
+		// depth passes fetch positions from a tightly packed stream of their own
+		std::vector<std::array<uint16_t, 4>> positions(_vertexCount);
+		pool.parallelFor(_vertexCount, [&](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++) memcpy(positions[i].data(), quantized[i].position, sizeof(positions[i]));
+		}, 4096);
+		createDeviceLocalBuffer(_positionBuffer, positions.data(), positionStride(_vertexFormat), _vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+		return;
+	}
+	else {
+		createDeviceLocalBuffer(_vertexBuffer, vertices, sizeof(Vertex), _vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+	}
+
+	// depth passes fetch positions from a tightly packed stream of their own
+	std::vector<glm::vec3> positions(_vertexCount);
+	pool.parallelFor(_vertexCount, [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) positions[i] = vertices[i].position;
+	}, 4096);
+	createDeviceLocalBuffer(_positionBuffer, positions.data(), positionStride(_vertexFormat), _vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+}
+
+void Model::createIndexBuffer(const std::vector<uint32_t>& indices) {
+	createIndexBuffer(indices.data(), static_cast<uint32_t>(indices.size()));
+}
+
+void Model::createIndexBuffer(const uint32_t* indices, uint32_t indexCount) {
+	_indexCount = indexCount;
+	_hasIndexBuffer = _indexCount > 0;
+	if (!_hasIndexBuffer) return;
+
+	if (_vertexCount <= std::numeric_limits<uint16_t>::max() + 1u) {
+		_indexType = VK_INDEX_TYPE_UINT16;
+		std::vector<uint16_t> shortIndices(indices, indices + _indexCount);
+		createDeviceLocalBuffer(_indexBuffer, shortIndices.data(), sizeof(uint16_t), _indexCount, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+	}
+	else {
+		_indexType = VK_INDEX_TYPE_UINT32;
+		createDeviceLocalBuffer(_indexBuffer, indices, sizeof(uint32_t), _indexCount, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+	}
+}
+
+void Model::setLods(const std::vector<MeshLod>& lods) {
+	setLods(lods.data(), static_cast<uint32_t>(lods.size()));
+}
+
+void Model::setLods(const MeshLod* lods, uint32_t lodCount) {
+	// without levels the whole index buffer is the only one
+	if (lodCount == 0) {
+		_lods = { MeshLod{ 0, _indexCount, 0.f } };
+		return;
+	}
+	_lods.assign(lods, lods + lodCount);
+}
+
+void Model::setMeshlets(const std::vector<Meshlet>& meshlets) {
+	setMeshlets(meshlets.data(), static_cast<uint32_t>(meshlets.size()));
+}
+
+void Model::setMeshlets(const Meshlet* meshlets, uint32_t meshletCount) {
+	_meshlets.assign(meshlets, meshlets + meshletCount);
+	if (meshletCount == 0) return;
+	// read by culling compute passes next to the vertex and index buffers
+	createDeviceLocalBuffer(_meshletBuffer, meshlets, sizeof(Meshlet), meshletCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+}
+
+uint32_t Model::selectLod(
+	const glm::mat4& transformMat,
+	const glm::mat4& projView,
+	float viewportHeight,
+	float threshold,
+	uint32_t bias) const {
+	if (_lods.size() < 2) return 0;
+
+	// bounding sphere in world space
+	const glm::vec4 center = transformMat * glm::vec4(boundsCenter(), 1.f);
+	const float scale = std::max(
+		glm::length(glm::vec3(transformMat[0])),
+		std::max(glm::length(glm::vec3(transformMat[1])), glm::length(glm::vec3(transformMat[2]))));
+	const float radius = boundsRadius() * scale;
+
+	// the y row of projView scales world lengths to clip space. w is the view depth for
+	// perspective projections and 1 for orthographic ones, where the w row has no xyz part.
+	const glm::vec4 clip = projView * center;
+	const float yScale = glm::length(glm::vec3(projView[0][1], projView[1][1], projView[2][1]));
+	const float wScale = glm::length(glm::vec3(projView[0][3], projView[1][3], projView[2][3]));
+	// the nearest point of the sphere is used, so a camera inside the sphere gets full detail
+	const float depth = clip.w - radius * wScale;
+	if (depth <= 0.f) return 0;
+	const float projectedRadius = radius * yScale / depth * viewportHeight * 0.5f;
+
+	// errors are stored relative to the bounding radius
+	uint32_t level = 0;
+	while (level + 1 < _lods.size() && _lods[level + 1].error * projectedRadius <= threshold) level++;
+	return std::min(level + bias, static_cast<uint32_t>(_lods.size()) - 1);
+}
+
+float Model::uvPerPixel(const glm::mat4& transformMat, const glm::mat4& projView, float viewportHeight) const {
+	const glm::vec4 center = transformMat * glm::vec4(boundsCenter(), 1.f);
+	const float scale = std::max(
+		glm::length(glm::vec3(transformMat[0])),
+		std::max(glm::length(glm::vec3(transformMat[1])), glm::length(glm::vec3(transformMat[2]))));
+	const float radius = boundsRadius() * scale;
+
+	// frustum planes as in cmdDrawMeshlets, left unnormalized
+	const glm::mat4 m = glm::transpose(projView);
+	for (const glm::vec4& plane : { m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[2], m[3] - m[2] }) {
+		if (glm::dot(glm::vec3(plane), glm::vec3(center)) + plane.w < -radius * glm::length(glm::vec3(plane)))
+			return -1.f;
+	}
+
+	// the same projection of the nearest point of the bounding sphere as selectLod
+	const glm::vec4 clip = projView * center;
+	const float yScale = glm::length(glm::vec3(projView[0][1], projView[1][1], projView[2][1]));
+	const float wScale = glm::length(glm::vec3(projView[0][3], projView[1][3], projView[2][3]));
+	const float depth = clip.w - radius * wScale;
+	if (depth <= 0.f || scale <= 0.f) return 0.f;
+	const float worldPerPixel = depth / (yScale * viewportHeight * 0.5f);
+	return worldPerPixel * _uvDensity / scale;
+}
+
+void Model::computeUvDensity(const Vertex* vertices, const uint32_t* indices) {
+	// ratio of the summed areas, so tiny dense uv islands don't decide it alone
+	double area{ 0.0 }, uvArea{ 0.0 };
+	const uint32_t count = _hasIndexBuffer ? indexCount() : _vertexCount;
+	for (uint32_t i = 0; i + 2 < count; i += 3) {
+		const Vertex& a = vertices[_hasIndexBuffer ? indices[i] : i];
+		const Vertex& b = vertices[_hasIndexBuffer ? indices[i + 1] : i + 1];
+		const Vertex& c = vertices[_hasIndexBuffer ? indices[i + 2] : i + 2];
+		area += glm::length(glm::cross(b.position - a.position, c.position - a.position));
+		const glm::vec2 e1 = b.uv - a.uv, e2 = c.uv - a.uv;
+		uvArea += std::abs(e1.x * e2.y - e1.y * e2.x);
+	}
+	_uvDensity = area > 0.0 ? static_cast<float>(std::sqrt(uvArea / area)) : 0.f;
+}
+
+VkDeviceSize Model::memorySize() const {
+	VkDeviceSize size = 0;
+	for (const auto* buffer : { &_vertexBuffer, &_positionBuffer, &_indexBuffer, &_meshletBuffer })
+		if (*buffer) size += (*buffer)->getBufferSize();
+	return size;
+}
+
+void Model::createDeviceLocalBuffer(
+	std::unique_ptr<Buffer>& buffer,
+	const void* data,
+	uint32_t instanceSize,
+	uint32_t instanceCount,
+	VkBufferUsageFlags usage) {
+	VkDeviceSize bufferSize = static_cast<VkDeviceSize>(instanceSize) * instanceCount;
+
+	if (_device.unifiedMemory) {
+		// device memory is host visible, the data goes in without a staging copy or a submit.
+		// coherent host writes are visible to any later queue submission
+		buffer = std::make_unique<Buffer>(
+			_device,
+			instanceSize,
+			instanceCount,
+			usage,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		buffer->writeToBuffer(const_cast<void*>(data), bufferSize);
+		return;
+	}
+	if (_device.uploadBatch) {
+		buffer = std::make_unique<Buffer>(
+			_device,
+			instanceSize,
+			instanceCount,
+			usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		_device.uploadBatch->upload(*buffer, data, bufferSize);
+		return;
+	}
 
 	Buffer stagingBuffer{
 		_device,
-		vertexSize,
-		_vertexCount,
+		instanceSize,
+		instanceCount,
 		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 	};
 
 	//stagingBuffer.map();
-	stagingBuffer.writeToBuffer((void*)vertices.data());
+	stagingBuffer.writeToBuffer(const_cast<void*>(data));
 
-	_vertexBuffer = std::make_unique<Buffer>(
+	buffer = std::make_unique<Buffer>(
 		_device,
-		vertexSize,
-		_vertexCount,
-		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		instanceSize,
+		instanceCount,
+		usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-	stagingBuffer.copyTo(*_vertexBuffer, bufferSize);
+	stagingBuffer.copyTo(*buffer, bufferSize);
 }
 
-void Model::createIndexBuffer(const std::vector<uint32_t>& indices) {
-	_indexCount = static_cast<uint32_t>(indices.size());
-	_hasIndexBuffer = _indexCount > 0;
-	uint32_t indexSize = sizeof(indices[0]);
-	VkDeviceSize bufferSize = sizeof(indices[0]) * _indexCount;
-
+void Model::cmdBind(VkCommandBuffer commandBuffer) {
+	VkBuffer buffers[] = { _vertexBuffer->getBuffer() };
+	VkDeviceSize offsets[] = { 0 };
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
 	if (_hasIndexBuffer) {
-		Buffer stagingBuffer{
-			  _device,
-			  indexSize,
-			  _indexCount,
-			  VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		};
-
-		//stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)indices.data());
-
-		_indexBuffer = std::make_unique<Buffer>(
-			_device,
-			indexSize,
-			_indexCount,
-			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-		stagingBuffer.copyTo(*_indexBuffer, bufferSize);
+		vkCmdBindIndexBuffer(commandBuffer, _indexBuffer->getBuffer(), 0, _indexType);
 	}
 }
 
-void Model::cmdBind(VkCommandBuffer commandBuffer) {
-	VkBuffer buffers[] = { _vertexBuffer->getBuffer() };
+void Model::cmdBindPositions(VkCommandBuffer commandBuffer) {
+	VkBuffer buffers[] = { _positionBuffer->getBuffer() };
 	VkDeviceSize offsets[] = { 0 };
 	vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
 	if (_hasIndexBuffer) {
-		vkCmdBindIndexBuffer(commandBuffer, _indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+		vkCmdBindIndexBuffer(commandBuffer, _indexBuffer->getBuffer(), 0, _indexType);
+	}
+}
+
+void Model::cmdDrawMeshlets(
+	VkCommandBuffer commandBuffer,
+	const glm::mat4& transformMat,
+	const glm::mat4& projView,
+	const glm::vec3* viewPosition) {
+	if (_meshlets.size() < 2) {
+		cmdDraw(commandBuffer);
+		return;
+	}
+
+	// frustum planes of projView with a depth range of zero to one, pointing inwards
+	const glm::mat4 m = glm::transpose(projView);
+	std::array<glm::vec4, 6> planes{ m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[2], m[3] - m[2] };
+	for (glm::vec4& plane : planes) plane /= glm::length(glm::vec3(plane));
+
+	const glm::vec3 scales{
+		glm::length(glm::vec3(transformMat[0])),
+		glm::length(glm::vec3(transformMat[1])),
+		glm::length(glm::vec3(transformMat[2])) };
+	const float maxScale = std::max(scales.x, std::max(scales.y, scales.z));
+	const float minScale = std::min(scales.x, std::min(scales.y, scales.z));
+	// cones don't survive non-uniform scaling
+	const bool testCones = viewPosition && maxScale - minScale <= maxScale * 1e-3f;
+	const glm::mat3 rotMat = glm::mat3(transformMat) / maxScale;
+
+	// visible meshlets next to each other are drawn together, and short gaps are drawn
+	// through to keep the number of draws down
+	uint32_t runBegin{ 0 }, runEnd{ 0 }, lastVisible{ 0 };
+	bool hasRun{ false };
+	for (uint32_t i = 0; i < _meshlets.size(); i++) {
+		const Meshlet& meshlet = _meshlets[i];
+		const glm::vec3 center = glm::vec3(transformMat * glm::vec4(glm::vec3(meshlet.sphere), 1.f));
+		const float radius = meshlet.sphere.w * maxScale;
+
+		bool visible{ true };
+		for (const glm::vec4& plane : planes) {
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+				visible = false;
+				break;
+			}
+		}
+		if (visible && testCones && meshlet.cone.w < 1.f) {
+			const glm::vec3 axis = rotMat * glm::vec3(meshlet.cone);
+			const glm::vec3 toCenter = center - *viewPosition;
+			if (glm::dot(toCenter, axis) >= meshlet.cone.w * glm::length(toCenter) + radius) visible = false;
+		}
+		if (!visible) continue;
+
+		if (hasRun && i - lastVisible > MESHLET_MERGE_GAP + 1) {
+			vkCmdDrawIndexed(commandBuffer, runEnd - runBegin, 1, runBegin, 0, 0);
+			hasRun = false;
+		}
+		if (!hasRun) {
+			runBegin = meshlet.indexOffset;
+			hasRun = true;
+		}
+		runEnd = meshlet.indexOffset + meshlet.indexCount;
+		lastVisible = i;
 	}
+	if (hasRun) vkCmdDrawIndexed(commandBuffer, runEnd - runBegin, 1, runBegin, 0, 0);
 }
 
-void Model::cmdDraw(VkCommandBuffer commandBuffer) {
+void Model::cmdDraw(VkCommandBuffer commandBuffer, uint32_t lod) {
 	if (_hasIndexBuffer) {
-		vkCmdDrawIndexed(commandBuffer, _indexCount, 1, 0, 0, 0);
+		const MeshLod& range = _lods[std::min(lod, static_cast<uint32_t>(_lods.size()) - 1)];
+		vkCmdDrawIndexed(commandBuffer, range.indexCount, 1, range.indexOffset, 0, 0);
 	}
 	else {
 		vkCmdDraw(commandBuffer, _vertexCount, 1, 0, 0);
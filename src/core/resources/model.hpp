@@ -6,41 +6,141 @@
 #include "utils/buffer.hpp"
 #include "resources/resource.hpp"
 #include "resources/mesh.hpp"
+#include "resources/mesh_optimizer.hpp"
+
+#include <functional>
 
 namespace naku {
 
+class MeshCache;
+class GltfData;
+
+// how a model is processed before it is uploaded
+struct ModelOptions {
+	VertexFormat vertexFormat{ VertexFormat::FULL };
+	// reorder triangles and vertices with MeshOptimizer
+	bool optimize{ false };
+	// number of coarser levels of detail generated by MeshSimplifier
+	uint32_t lodCount{ 0 };
+};
+
 class Model : public Resource {
 public:
-	Model(Device& device, const std::string& name, const Mesh& Mesh);
-	Model(Device& device, const std::string& name, const std::string& ObjFilePath);
+	// culled meshlets between two visible ones are still drawn if there are at most this many
+	static constexpr uint32_t MESHLET_MERGE_GAP = 2;
+
+	Model(Device& device, const std::string& name, const Mesh& Mesh, const ModelOptions& options = {});
+	Model(Device& device, const std::string& name, const std::string& ObjFilePath, const ModelOptions& options = {});
+	// one primitive of a parsed gltf file
+	Model(Device& device, const std::string& name, const GltfData& gltf, uint32_t mesh, uint32_t primitive, const ModelOptions& options = {});
+	// a mesh processed already, like the ones of a scene package. throws if the cache isn't valid
+	Model(Device& device, const std::string& name, const MeshCache& cache, const ModelOptions& options = {});
 	~Model();
 	Model(const Model&) = delete;
 	Model& operator=(const Model&) = delete;
 	Model() = default;
 
 	void cmdBind(VkCommandBuffer commandBuffer);
-	void cmdDraw(VkCommandBuffer commandBuffer);
+	// binds the position only stream instead of the full vertices, for depth only pipelines
+	void cmdBindPositions(VkCommandBuffer commandBuffer);
+	void cmdDraw(VkCommandBuffer commandBuffer, uint32_t lod = 0);
+	// draws the full detail level without the meshlets outside the frustum of projView.
+	// meshlets facing away from viewPosition are skipped too, unless it's null.
+	void cmdDrawMeshlets(
+		VkCommandBuffer commandBuffer,
+		const glm::mat4& transformMat,
+		const glm::mat4& projView,
+		const glm::vec3* viewPosition = nullptr);
 
 	uint32_t vertexCount() const { return _vertexCount; }
-	uint32_t indexCount() const { return _indexCount; }
+	// indices of the full detail level
+	uint32_t indexCount() const { return _lods.empty() ? 0 : _lods[0].indexCount; }
+	uint32_t lodCount() const { return static_cast<uint32_t>(_lods.size()); }
+	const MeshLod& lod(uint32_t level) const { return _lods[level]; }
+	uint32_t meshletCount() const { return static_cast<uint32_t>(_meshlets.size()); }
+	const std::vector<Meshlet>& meshlets() const { return _meshlets; }
+	// std430 array of Meshlet, null if the model has no meshlets
+	Buffer* meshletBuffer() const { return _meshletBuffer.get(); }
+	// picks the coarsest level whose error stays below threshold pixels when drawn with transformMat
+	// into a viewport of viewportHeight pixels, then moves bias levels coarser
+	uint32_t selectLod(
+		const glm::mat4& transformMat,
+		const glm::mat4& projView,
+		float viewportHeight,
+		float threshold,
+		uint32_t bias = 0) const;
+	// uv units one pixel covers at the nearest point of the bounds when drawn with transformMat.
+	// a texture w texels wide needs no level finer than log2(w * uvPerPixel). 0 if the camera
+	// is inside the bounds, -1 if they're outside the frustum
+	float uvPerPixel(const glm::mat4& transformMat, const glm::mat4& projView, float viewportHeight) const;
+	// uv units per model space unit over the full detail level
+	float uvDensity() const { return _uvDensity; }
 
 	bool hasIndexBuffer() const { return _hasIndexBuffer; }
+	// models with less than 65536 vertices use 16 bit indices
+	VkIndexType indexType() const { return _indexType; }
+	VertexFormat vertexFormat() const { return _vertexFormat; }
+	// maps quantized positions back to model space. identity for the other formats.
+	const glm::mat4& dequantMat() const { return _dequantMat; }
+	const glm::vec3& boundsMin() const { return _boundsMin; }
+	const glm::vec3& boundsMax() const { return _boundsMax; }
+	glm::vec3 boundsCenter() const { return (_boundsMin + _boundsMax) * 0.5f; }
+	float boundsRadius() const { return glm::length(_boundsMax - _boundsMin) * 0.5f; }
 	std::string filePath() const { return _filePath; }
+	// the mesh cache file the model was loaded from or written to, empty if it has none
+	std::string cachePath() const { return _cachePath; }
+	// bytes of the vertex, index and meshlet buffers
+	VkDeviceSize memorySize() const;
+	// acmr/atvr of the full detail level as it was loaded and as it's drawn. false if this
+	// model didn't optimize its mesh, like one read from the cache
+	bool cacheStats(MeshOptimizer::CacheStats* before, MeshOptimizer::CacheStats* after) const;
 
 	VkDevice device() const { return _device.device(); };
 
 
 private:
 	std::string _filePath;
+	std::string _cachePath;
 	std::unique_ptr<Buffer> _vertexBuffer;
+	std::unique_ptr<Buffer> _positionBuffer;
 	uint32_t _vertexCount;
+	VertexFormat _vertexFormat{ VertexFormat::FULL };
+	glm::mat4 _dequantMat{ 1.f };
+	glm::vec3 _boundsMin{ 0.f };
+	glm::vec3 _boundsMax{ 0.f };
+	float _uvDensity{ 0.f };
+	bool _optimized{ false };
+	MeshOptimizer::CacheStats _statsBefore;
+	MeshOptimizer::CacheStats _statsAfter;
 
 	bool _hasIndexBuffer{ false };
 	std::unique_ptr<Buffer> _indexBuffer;
 	uint32_t _indexCount;
+	VkIndexType _indexType{ VK_INDEX_TYPE_UINT32 };
+	// ranges of the index buffer, finest first
+	std::vector<MeshLod> _lods;
+	// clusters of the full detail level
+	std::vector<Meshlet> _meshlets;
+	std::unique_ptr<Buffer> _meshletBuffer;
 
+	// uploads from the cache, or loads, processes and caches the mesh on a miss
+	void load(const MeshCache& cache, const std::function<void(Mesh*)>& loadMesh, const ModelOptions& options);
 	void createVertexBuffer(const std::vector<Vertex>& vertices);
+	void createVertexBuffer(const Vertex* vertices, uint32_t vertexCount);
 	void createIndexBuffer(const std::vector<uint32_t>& indices);
+	void createIndexBuffer(const uint32_t* indices, uint32_t indexCount);
+	void setLods(const std::vector<MeshLod>& lods);
+	void setLods(const MeshLod* lods, uint32_t lodCount);
+	void setMeshlets(const std::vector<Meshlet>& meshlets);
+	void setMeshlets(const Meshlet* meshlets, uint32_t meshletCount);
+	// needs the index buffer and levels set first
+	void computeUvDensity(const Vertex* vertices, const uint32_t* indices);
+	void createDeviceLocalBuffer(
+		std::unique_ptr<Buffer>& buffer,
+		const void* data,
+		uint32_t instanceSize,
+		uint32_t instanceCount,
+		VkBufferUsageFlags usage);
 };
 
 }
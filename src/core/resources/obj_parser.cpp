@@ -0,0 +1,315 @@
+#include "resources/obj_parser.hpp"
+
+#include "utils/mapped_file.hpp"
+#include "utils/thread_pool.hpp"
+
+#include <charconv>
+#include <atomic>
+#include <algorithm>
+
+namespace naku {
+
+namespace {
+
+// chunks smaller than this aren't worth a task
+constexpr size_t MIN_CHUNK_SIZE = 1 << 20;
+
+// bits of ObjChunk::relative. set when the index was negative in the file, so
+// it counts from the start of the chunk and still needs the chunk's base offset.
+constexpr uint8_t RELATIVE_VERTEX   = 1;
+constexpr uint8_t RELATIVE_NORMAL   = 2;
+constexpr uint8_t RELATIVE_TEXCOORD = 4;
+
+// set in ObjChunk::faceSizes for faces that are skipped. the size is kept to walk the corners.
+constexpr uint32_t DROPPED_FACE = 0x80000000u;
+
+struct ObjShapeMarker {
+	std::string name;
+	uint32_t firstFace;
+	uint32_t localIndexOffset{ 0 };
+};
+
+struct ObjChunk {
+	const char* begin;
+	const char* end;
+
+	std::vector<float> positions;
+	std::vector<float> colors;
+	std::vector<float> normals;
+	std::vector<float> texcoords;
+	std::vector<ObjIndex> corners;
+	std::vector<uint8_t> relative;
+	std::vector<uint32_t> faceSizes;
+	std::vector<ObjShapeMarker> shapes;
+
+	size_t vertexBase{ 0 };
+	size_t normalBase{ 0 };
+	size_t texcoordBase{ 0 };
+	size_t indexOffset{ 0 };
+	size_t indexCount{ 0 };
+};
+
+inline bool isSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline void skipSpace(const char*& p, const char* end) {
+	while (p < end && isSpace(*p)) p++;
+}
+
+inline bool parseFloat(const char*& p, const char* end, float& value) {
+	skipSpace(p, end);
+	if (p < end && *p == '+') p++;
+	auto result = std::from_chars(p, end, value);
+	if (result.ec != std::errc()) return false;
+	p = result.ptr;
+	return true;
+}
+
+inline bool parseInt(const char*& p, const char* end, int32_t& value) {
+	if (p < end && *p == '+') p++;
+	auto result = std::from_chars(p, end, value);
+	if (result.ec != std::errc()) return false;
+	p = result.ptr;
+	return true;
+}
+
+// converts an obj index to a zero based one. negative indices count back from the
+// attributes read so far in this chunk, which may reach into the previous chunks.
+// 0 isn't a valid obj index and maps to -1.
+inline int32_t resolveIndex(int32_t index, size_t localCount, uint8_t relativeBit, uint8_t& relative) {
+	if (index > 0) return index - 1;
+	if (index == 0) return -1;
+	relative |= relativeBit;
+	return static_cast<int32_t>(localCount) + index;
+}
+
+void parseChunk(ObjChunk& chunk) {
+	const char* p = chunk.begin;
+	const char* end = chunk.end;
+	while (p < end) {
+		const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+		if (!lineEnd) lineEnd = end;
+		skipSpace(p, lineEnd);
+
+		if (lineEnd - p >= 2 && p[0] == 'v' && isSpace(p[1])) {
+			p += 2;
+			float v[6]{ 0.f, 0.f, 0.f, 1.f, 1.f, 1.f };
+			int count = 0;
+			while (count < 6 && parseFloat(p, lineEnd, v[count])) count++;
+			if (count < 6) v[3] = v[4] = v[5] = 1.f;
+			chunk.positions.insert(chunk.positions.end(), v, v + 3);
+			chunk.colors.insert(chunk.colors.end(), v + 3, v + 6);
+		}
+		else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 'n' && isSpace(p[2])) {
+			p += 3;
+			float v[3]{ 0.f, 0.f, 0.f };
+			for (int i = 0; i < 3 && parseFloat(p, lineEnd, v[i]); i++) {}
+			chunk.normals.insert(chunk.normals.end(), v, v + 3);
+		}
+		else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 't' && isSpace(p[2])) {
+			p += 3;
+			float v[2]{ 0.f, 0.f };
+			for (int i = 0; i < 2 && parseFloat(p, lineEnd, v[i]); i++) {}
+			chunk.texcoords.insert(chunk.texcoords.end(), v, v + 2);
+		}
+		else if (lineEnd - p >= 2 && p[0] == 'f' && isSpace(p[1])) {
+			p += 2;
+			uint32_t faceSize = 0;
+			while (true) {
+				skipSpace(p, lineEnd);
+				int32_t v, vt{ 0 }, vn{ 0 };
+				if (!parseInt(p, lineEnd, v)) break;
+				if (p < lineEnd && *p == '/') {
+					p++;
+					if (p < lineEnd && *p != '/') parseInt(p, lineEnd, vt);
+					if (p < lineEnd && *p == '/') {
+						p++;
+						parseInt(p, lineEnd, vn);
+					}
+				}
+				ObjIndex index{};
+				uint8_t relative{ 0 };
+				index.vertex = resolveIndex(v, chunk.positions.size() / 3, RELATIVE_VERTEX, relative);
+				if (vt != 0) index.texcoord = resolveIndex(vt, chunk.texcoords.size() / 2, RELATIVE_TEXCOORD, relative);
+				if (vn != 0) index.normal = resolveIndex(vn, chunk.normals.size() / 3, RELATIVE_NORMAL, relative);
+				chunk.corners.push_back(index);
+				chunk.relative.push_back(relative);
+				faceSize++;
+			}
+			chunk.faceSizes.push_back(faceSize);
+		}
+		else if (lineEnd - p >= 1 && (p[0] == 'o' || p[0] == 'g') && (lineEnd - p == 1 || isSpace(p[1]))) {
+			p++;
+			skipSpace(p, lineEnd);
+			const char* nameEnd = lineEnd;
+			while (nameEnd > p && isSpace(nameEnd[-1])) nameEnd--;
+			chunk.shapes.push_back({ std::string(p, nameEnd), static_cast<uint32_t>(chunk.faceSizes.size()) });
+		}
+		p = lineEnd + 1;
+	}
+}
+
+inline float squaredDistance(const float* positions, int32_t a, int32_t b) {
+	const float dx = positions[3 * b + 0] - positions[3 * a + 0];
+	const float dy = positions[3 * b + 1] - positions[3 * a + 1];
+	const float dz = positions[3 * b + 2] - positions[3 * a + 2];
+	return dx * dx + dy * dy + dz * dz;
+}
+
+}
+
+bool ObjData::parse(ObjData* data, const std::string& objFilePath, std::string* warn) {
+	*data = ObjData{};
+
+	std::unique_ptr<MappedFile> file;
+	try {
+		file = std::make_unique<MappedFile>(objFilePath);
+	}
+	catch (const std::exception& e) {
+		if (warn) *warn += std::string(e.what()) + "\n";
+		return false;
+	}
+	const char* begin = file->data();
+	const char* end = begin + file->size();
+
+	// split the file into line aligned chunks
+	ThreadPool& pool = ThreadPool::shared();
+	const size_t chunkCount = std::max<size_t>(1, std::min<size_t>(pool.threadCount() * 4, file->size() / MIN_CHUNK_SIZE));
+	std::vector<ObjChunk> chunks;
+	chunks.reserve(chunkCount);
+	const char* chunkBegin = begin;
+	for (size_t i = 1; i <= chunkCount && chunkBegin < end; i++) {
+		const char* chunkEnd = (i == chunkCount) ? end : begin + file->size() / chunkCount * i;
+		if (chunkEnd < chunkBegin) chunkEnd = chunkBegin;
+		const char* newLine = static_cast<const char*>(memchr(chunkEnd, '\n', end - chunkEnd));
+		chunkEnd = newLine ? newLine + 1 : end;
+		ObjChunk chunk{};
+		chunk.begin = chunkBegin;
+		chunk.end = chunkEnd;
+		chunks.push_back(std::move(chunk));
+		chunkBegin = chunkEnd;
+	}
+
+	pool.parallelFor(chunks.size(), [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) parseChunk(chunks[i]);
+	});
+
+	size_t vertexCount{ 0 }, normalCount{ 0 }, texcoordCount{ 0 };
+	for (auto& chunk : chunks) {
+		chunk.vertexBase = vertexCount;
+		chunk.normalBase = normalCount;
+		chunk.texcoordBase = texcoordCount;
+		vertexCount += chunk.positions.size() / 3;
+		normalCount += chunk.normals.size() / 3;
+		texcoordCount += chunk.texcoords.size() / 2;
+	}
+	data->positions.resize(vertexCount * 3);
+	data->colors.resize(vertexCount * 3);
+	data->normals.resize(normalCount * 3);
+	data->texcoords.resize(texcoordCount * 2);
+
+	// gather attributes, resolve relative indices and drop broken faces
+	std::atomic<uint32_t> degeneratedFaces{ 0 }, invalidFaces{ 0 };
+	pool.parallelFor(chunks.size(), [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) {
+			ObjChunk& chunk = chunks[i];
+			std::copy(chunk.positions.begin(), chunk.positions.end(), data->positions.begin() + chunk.vertexBase * 3);
+			std::copy(chunk.colors.begin(), chunk.colors.end(), data->colors.begin() + chunk.vertexBase * 3);
+			std::copy(chunk.normals.begin(), chunk.normals.end(), data->normals.begin() + chunk.normalBase * 3);
+			std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), data->texcoords.begin() + chunk.texcoordBase * 2);
+
+			size_t corner{ 0 }, marker{ 0 };
+			for (uint32_t face = 0; face < chunk.faceSizes.size(); face++) {
+				while (marker < chunk.shapes.size() && chunk.shapes[marker].firstFace == face) {
+					chunk.shapes[marker++].localIndexOffset = static_cast<uint32_t>(chunk.indexCount);
+				}
+				uint32_t& faceSize = chunk.faceSizes[face];
+				bool valid = true;
+				for (uint32_t j = 0; j < faceSize; j++) {
+					ObjIndex& index = chunk.corners[corner + j];
+					const uint8_t relative = chunk.relative[corner + j];
+					if (relative & RELATIVE_VERTEX) index.vertex += static_cast<int32_t>(chunk.vertexBase);
+					if (relative & RELATIVE_NORMAL) index.normal += static_cast<int32_t>(chunk.normalBase);
+					if (relative & RELATIVE_TEXCOORD) index.texcoord += static_cast<int32_t>(chunk.texcoordBase);
+					if (index.vertex < 0 || index.vertex >= static_cast<int32_t>(vertexCount)) valid = false;
+					if (index.normal >= static_cast<int32_t>(normalCount)) index.normal = -1;
+					if (index.texcoord >= static_cast<int32_t>(texcoordCount)) index.texcoord = -1;
+				}
+				corner += faceSize;
+				if (faceSize < 3) {
+					degeneratedFaces++;
+					faceSize |= DROPPED_FACE;
+				}
+				else if (!valid) {
+					invalidFaces++;
+					faceSize |= DROPPED_FACE;
+				}
+				else chunk.indexCount += 3 * (faceSize - 2);
+			}
+			while (marker < chunk.shapes.size()) {
+				chunk.shapes[marker++].localIndexOffset = static_cast<uint32_t>(chunk.indexCount);
+			}
+		}
+	});
+	if (warn && degeneratedFaces > 0) *warn += std::to_string(degeneratedFaces.load()) + " degenerated faces skipped.\n";
+	if (warn && invalidFaces > 0) *warn += std::to_string(invalidFaces.load()) + " faces with invalid vertex index skipped.\n";
+
+	size_t indexCount{ 0 };
+	for (auto& chunk : chunks) {
+		chunk.indexOffset = indexCount;
+		indexCount += chunk.indexCount;
+	}
+	data->indices.resize(indexCount);
+
+	// triangulate. quads are split along the shorter diagonal like tinyobjloader does,
+	// larger polygons are fanned.
+	pool.parallelFor(chunks.size(), [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) {
+			ObjChunk& chunk = chunks[i];
+			ObjIndex* out = data->indices.data() + chunk.indexOffset;
+			const ObjIndex* in = chunk.corners.data();
+			for (size_t face = 0; face < chunk.faceSizes.size(); face++) {
+				const uint32_t faceSize = chunk.faceSizes[face];
+				if (faceSize & DROPPED_FACE) {
+					in += faceSize & ~DROPPED_FACE;
+					continue;
+				}
+				if (faceSize == 4) {
+					if (squaredDistance(data->positions.data(), in[0].vertex, in[2].vertex) <
+						squaredDistance(data->positions.data(), in[1].vertex, in[3].vertex)) {
+						*out++ = in[0]; *out++ = in[1]; *out++ = in[2];
+						*out++ = in[0]; *out++ = in[2]; *out++ = in[3];
+					}
+					else {
+						*out++ = in[0]; *out++ = in[1]; *out++ = in[3];
+						*out++ = in[1]; *out++ = in[2]; *out++ = in[3];
+					}
+				}
+				else {
+					for (uint32_t j = 1; j + 1 < faceSize; j++) {
+						*out++ = in[0]; *out++ = in[j]; *out++ = in[j + 1];
+					}
+				}
+				in += faceSize;
+			}
+		}
+	});
+
+	// a shape runs until the next o/g line. empty ones are dropped.
+	ObjShape shape{};
+	for (const auto& chunk : chunks) {
+		for (const auto& marker : chunk.shapes) {
+			const uint32_t offset = static_cast<uint32_t>(chunk.indexOffset) + marker.localIndexOffset;
+			shape.indexCount = offset - shape.indexOffset;
+			if (shape.indexCount > 0) data->shapes.push_back(shape);
+			shape.name = marker.name;
+			shape.indexOffset = offset;
+		}
+	}
+	shape.indexCount = static_cast<uint32_t>(indexCount) - shape.indexOffset;
+	if (shape.indexCount > 0) data->shapes.push_back(shape);
+	return true;
+}
+
+}
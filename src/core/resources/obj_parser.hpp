@@ -0,0 +1,38 @@
+#ifndef OBJ_PARSER_HPP
+#define OBJ_PARSER_HPP
+
+#include "naku.hpp"
+
+namespace naku {
+
+// zero based indices into the attribute arrays of ObjData. -1 if absent.
+struct ObjIndex {
+	int32_t vertex{ -1 };
+	int32_t normal{ -1 };
+	int32_t texcoord{ -1 };
+};
+
+struct ObjShape {
+	std::string name;
+	uint32_t indexOffset{ 0 };
+	uint32_t indexCount{ 0 };
+};
+
+// raw contents of an obj file. faces are triangulated, so every three
+// consecutive entries of indices form a triangle. only v/vn/vt/f/o/g are read.
+struct ObjData {
+	std::vector<float> positions; // xyz
+	std::vector<float> colors;    // rgb. white if the file has no vertex colors
+	std::vector<float> normals;   // xyz
+	std::vector<float> texcoords; // uv
+	std::vector<ObjIndex> indices;
+	std::vector<ObjShape> shapes;
+
+	// maps the file and parses line aligned chunks of it on the shared thread pool.
+	// returns false if the file can't be read. recoverable problems go to warn.
+	static bool parse(ObjData* data, const std::string& objFilePath, std::string* warn = nullptr);
+};
+
+}
+
+#endif
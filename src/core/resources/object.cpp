@@ -67,8 +67,25 @@ void Object::setId(ResId ID) {
 	(modelUbo + _id)->objId = _id;
 	(modelUbo + _id)->receiveShadow = 1;
 }
+void Object::detachModelInfo() {
+	if (_detachedInfo) return;
+	_detachedInfo = std::make_unique<ModelInfo>(*(modelUbo + _id));
+	_transformMat = &_detachedInfo->transformMat;
+	_normalMat = &_detachedInfo->normalMat;
+	_rotMat = &_detachedInfo->rotMat;
+}
+void Object::writeModelInfo(Buffer& buffer) {
+	// the gpu copy of a quantized model's transform also dequantizes its positions
+	if (model && model->vertexFormat() == VertexFormat::QUANTIZED) {
+		ModelInfo info = *getModelInfo();
+		info.transformMat = info.transformMat * model->dequantMat();
+		buffer.writeToBuffer(&info, sizeof(ModelInfo), _id * dynamicAlignment);
+	}
+	else buffer.writeToIndex(modelUbo + _id, _id);
+}
+
 void Object::writeToObjectBuffer(size_t frameIdx) {
-	modelUboBuffers[frameIdx]->writeToIndex(modelUbo + _id, _id);
+	writeModelInfo(*modelUboBuffers[frameIdx]);
 	if (MapHas(changedObjects, _id)) {
 		--changedObjects[_id];
 	}
@@ -76,12 +93,17 @@ void Object::writeToObjectBuffer(size_t frameIdx) {
 
 void Object::writeToObjectBuffer() {
 	for (int i=0;i< modelUboBuffers.size();i++)
-		modelUboBuffers[i]->writeToIndex(modelUbo + _id, _id);
+		writeModelInfo(*modelUboBuffers[i]);
 
 	if (MapHas(changedObjects, _id))
 		changedObjects.erase(_id);
 }
 
+void Object::writeAllToObjectBuffers(size_t count) {
+	for (auto& buffer : modelUboBuffers)
+		buffer->writeToBuffer(modelUbo, count * dynamicAlignment);
+}
+
 void Object::move(const glm::vec3& deltaPos) {
 	_position += deltaPos;
 	update();
@@ -104,6 +126,12 @@ void Object::setScale(const glm::vec3& newScale) {
 	_scale = newScale;
 	update();
 }
+void Object::setTransform(const glm::vec3& newPos, const glm::vec3& newRot, const glm::vec3& newScale) {
+	_position = newPos;
+	_rotation = glm::mod(newRot, glm::vec3(360.0f, 360.0f, 360.0f));
+	_scale = newScale;
+	update();
+}
 
 const glm::mat4& Object::getTransformMat(const glm::vec3& position, const glm::vec3& scale, const glm::vec3& rotation) {
 	const float c3 = glm::cos(glm::radians(rotation.z));
@@ -188,6 +216,29 @@ const glm::mat3& Object::getRotMat(const glm::vec3& rotation) {
 	};
 }
 
+void Object::decomposeTransformMat(const glm::mat4& transformMat, glm::vec3* position, glm::vec3* scale, glm::vec3* rotation) {
+	*position = glm::vec3{ transformMat[3] };
+	glm::vec3 axis[3]{ glm::vec3{ transformMat[0] }, glm::vec3{ transformMat[1] }, glm::vec3{ transformMat[2] } };
+	*scale = glm::vec3{ glm::length(axis[0]), glm::length(axis[1]), glm::length(axis[2]) };
+	// a mirroring transform is kept as a negative x scale. shear is lost.
+	if (glm::dot(glm::cross(axis[0], axis[1]), axis[2]) < 0.f) scale->x = -scale->x;
+	for (int i = 0; i < 3; i++)
+		if ((*scale)[i] != 0.f) axis[i] /= (*scale)[i];
+
+	// inverse of getRotMat, y * x * z order
+	const float s2 = glm::clamp(-axis[2].y, -1.f, 1.f);
+	rotation->x = glm::degrees(std::asin(s2));
+	// cos(x) is the length of the third column's xz, y and z are undefined when it vanishes
+	if (glm::length(glm::vec2{ axis[2].x, axis[2].z }) > 1e-6f) {
+		rotation->y = glm::degrees(std::atan2(axis[2].x, axis[2].z));
+		rotation->z = glm::degrees(std::atan2(axis[0].y, axis[1].y));
+	}
+	else {
+		rotation->y = glm::degrees(std::atan2(-axis[0].z, axis[0].x));
+		rotation->z = 0.f;
+	}
+}
+
 void Object::update() {
 	*_rotMat = getRotMat(_rotation);
 	*_transformMat = glm::mat4{
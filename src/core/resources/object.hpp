@@ -22,7 +22,7 @@ public:
 
 	static ModelInfo* modelUbo;
 	ModelInfo* getModelInfo() {
-		return modelUbo + _id;
+		return _detachedInfo ? _detachedInfo.get() : modelUbo + _id;
 	}
 	static std::vector<std::unique_ptr<Buffer>> modelUboBuffers;
 	static void prepareObjectUbo(Device& device);
@@ -48,6 +48,9 @@ public:
 	Object() = delete;
 	Object& operator=(const Object&&) = delete;
 	virtual void setId(ResId ID);
+	// moves the matrices out of modelUbo once the object is removed, its id is handed out
+	// again and anything still holding it must not write over the next one
+	void detachModelInfo();
 	Object* parent{nullptr};
 	std::vector<Object> children;
 
@@ -70,6 +73,8 @@ public:
 	static const glm::mat4& getTransformMat(const glm::vec3& position, const glm::vec3& scale, const glm::vec3& rotation);
 	static const glm::mat3& getNormalMat(const glm::vec3& scale, const glm::vec3& rotation);
 	static const glm::mat3& getRotMat(const glm::vec3& rotation);
+	// splits a transform into the position, scale and rotation in degrees that getTransformMat rebuilds it from
+	static void decomposeTransformMat(const glm::mat4& transformMat, glm::vec3* position, glm::vec3* scale, glm::vec3* rotation);
 
 	Type type() const { return _type; }
 	bool isActive() const { return _active; }
@@ -83,6 +88,8 @@ public:
 	virtual void rotate(const glm::vec3& axisAngle);
 	virtual void setRotation(const glm::vec3& newRot);
 	virtual void setScale(const glm::vec3& newScale);
+	// all three with one update
+	virtual void setTransform(const glm::vec3& newPos, const glm::vec3& newRot, const glm::vec3& newScale);
 	virtual void move(float deltaPosX, float deltaPosY, float deltaPosZ) {
 		move(glm::vec3{ deltaPosX, deltaPosY, deltaPosZ });
 	}
@@ -113,6 +120,9 @@ public:
 
 	void writeToObjectBuffer();
 	void writeToObjectBuffer(size_t frameIdx);
+	void writeModelInfo(Buffer& buffer);
+	// copies the first count entries of modelUbo into every frame buffer as they are
+	static void writeAllToObjectBuffers(size_t count);
 
 	friend class Scene;
 	friend class GUI;
@@ -129,6 +139,7 @@ protected:
 	glm::mat4* _transformMat{nullptr};
 	glm::mat4* _normalMat{nullptr};
 	glm::mat4* _rotMat{nullptr};
+	std::unique_ptr<ModelInfo> _detachedInfo;
 
 	static size_t _objectCount;
 };
@@ -33,35 +33,122 @@ public:
 	ResourceCollectionBase& operator=(const ResourceCollectionBase&&) = delete;
 
 	size_t size() const { return _baseMap.size(); }
+	// ids handed out so far, deleted ones included
+	ResId idCount() const { return _nextId; }
+	// removed ids are handed out again, lowest first. for resources whose ids index buffers
+	// of a fixed size
+	bool reuseIds{ false };
 
 	ResId push(const std::string& name, std::shared_ptr<void> pRes) {
 		if (MapHas(_name2id, name)) {
 			std::cerr << "Error: " << _typeName << ": " << name << " already exists." << std::endl;
 			return ERROR_RES_ID;
 		}
-		_name2id.emplace(name, _nextId);
-		_id2name.emplace(_nextId, name);
-		_baseMap.emplace(_nextId, pRes);
-		return _nextId++;
+		ResId id = _nextId;
+		if (reuseIds && !_freeIds.empty()) {
+			id = *_freeIds.begin();
+			_freeIds.erase(_freeIds.begin());
+			_deleted.erase(id);
+		}
+		else _nextId++;
+		_name2id.emplace(name, id);
+		_id2name.emplace(id, name);
+		_baseMap[id] = pRes;
+		return id;
 	}
 	bool exist(const ResId& id) const { if (id >= _nextId || MapHas(_deleted, id)) return false; return true; }
+	// puts another object behind an id, keeping its names, content hash and collections
+	void replace(const ResId& id, std::shared_ptr<void> pRes) {
+		if (exist(id)) _baseMap[id] = std::move(pRes);
+		else std::cerr << "Warning: " << _typeName << ": No. " << id << " isn't in storage." << std::endl;
+	}
 	bool exist(const std::string& name) const { return MapHas(_name2id, name); }
 	std::string name(const ResId& id) const { return _id2name.at(id); }
 	void remove(const ResId& id) {
 		if (exist(id)) {
-			_baseMap[id].reset();
+			_baseMap.erase(id);
 			_deleted.emplace(id, id);
+			if (reuseIds) _freeIds.insert(id);
 			_name2id.erase(_id2name[id]);
 			_id2name.erase(id);
+			for (auto& alias : _aliases[id]) _name2id.erase(alias);
+			_aliases.erase(id);
+			_holds.erase(id);
+			if (MapHas(_id2hash, id)) {
+				_hash2id.erase(_id2hash[id]);
+				_id2hash.erase(id);
+			}
 		}
 		else std::cerr << "Warning: " << _typeName << ": No. " << id << " isn't in storage." << std::endl;
 	}
+	// an alias only drops its own name, the resource stays for the others
 	void remove(const std::string& name) {
 		if (MapHas(_name2id, name)) {
-			remove(_name2id[name]);
+			ResId id = _name2id[name];
+			if (_id2name[id] != name) {
+				_name2id.erase(name);
+				_aliases[id].remove(name);
+			}
+			else remove(id);
 		}
 		else std::cerr << "Warning: " << _typeName << ": " << name << " isn't in storage." << std::endl;
 	}
+
+	// content addressing. resources pushed with a content hash are found by it, and identical
+	// payloads loaded under other names become aliases of the first one instead of copies.
+	ResId findContent(uint64_t hash) const {
+		auto it = _hash2id.find(hash);
+		return it == _hash2id.end() ? ERROR_RES_ID : it->second;
+	}
+	void setContent(ResId id, uint64_t hash) {
+		if (!exist(id)) return;
+		_hash2id[hash] = id;
+		_id2hash[id] = hash;
+	}
+	ResId alias(const std::string& name, ResId id) {
+		if (MapHas(_name2id, name)) {
+			std::cerr << "Error: " << _typeName << ": " << name << " already exists." << std::endl;
+			return ERROR_RES_ID;
+		}
+		if (!exist(id)) {
+			std::cerr << "Warning: " << _typeName << ": No. " << id << " isn't in storage." << std::endl;
+			return ERROR_RES_ID;
+		}
+		_name2id.emplace(name, id);
+		_aliases[id].push_back(name);
+		return id;
+	}
+	// names the resource is known by, its own included
+	uint32_t refCount(ResId id) const {
+		if (!exist(id)) return 0;
+		auto it = _aliases.find(id);
+		return 1 + (it == _aliases.end() ? 0 : static_cast<uint32_t>(it->second.size()));
+	}
+	// scenes using the resource. one that was held and isn't anymore is unused, whoever
+	// released it last frees it or leaves it to be taken up again
+	uint32_t hold(ResId id) {
+		if (!exist(id)) return 0;
+		return ++_holds[id];
+	}
+	uint32_t release(ResId id) {
+		auto it = _holds.find(id);
+		if (it == _holds.end() || it->second == 0) {
+			std::cerr << "Warning: " << _typeName << ": No. " << id << " isn't held." << std::endl;
+			return 0;
+		}
+		return --it->second;
+	}
+	uint32_t holdCount(ResId id) const {
+		auto it = _holds.find(id);
+		return it == _holds.end() ? 0 : it->second;
+	}
+	std::vector<ResId> unused() const {
+		std::vector<ResId> ids;
+		for (const auto& pair : _holds) {
+			if (pair.second == 0) ids.push_back(pair.first);
+		}
+		return ids;
+	}
 	void reName(const ResId& id, const std::string& name) {
 		if (exist(id)) {
 			if (MapHas(_name2id, name)) {
@@ -100,6 +187,11 @@ private:
 	std::unordered_map<std::string, ResId> _name2id;
 	std::unordered_map<ResId, std::string> _id2name;
 	std::unordered_map<ResId, ResId> _deleted;
+	std::set<ResId> _freeIds;
+	std::unordered_map<ResId, std::list<std::string>> _aliases;
+	std::unordered_map<uint64_t, ResId> _hash2id;
+	std::unordered_map<ResId, uint64_t> _id2hash;
+	std::unordered_map<ResId, uint32_t> _holds;
 
 	std::unordered_map<size_t, std::unordered_map<ResId, std::list<ResId>>> _collections;
 	std::unordered_map<ResId, std::unordered_map<size_t, std::list<ResId>>> _collected;
@@ -186,10 +278,51 @@ public:
 		return res.push(name, pRes);
 	}
 	template<typename T>
+	void replace(ResId id, std::shared_ptr<T> pRes) const {
+		_resources.at(typeid(T).hash_code())->replace(id, std::static_pointer_cast<void>(std::move(pRes)));
+	}
+	template<typename T>
+	ResId findContent(uint64_t hash) const {
+		return _resources.at(typeid(T).hash_code())->findContent(hash);
+	}
+	template<typename T>
+	void setContent(ResId id, uint64_t hash) const {
+		_resources.at(typeid(T).hash_code())->setContent(id, hash);
+	}
+	template<typename T>
+	ResId alias(const std::string& name, ResId id) const {
+		return _resources.at(typeid(T).hash_code())->alias(name, id);
+	}
+	template<typename T>
+	uint32_t refCount(ResId id) const {
+		return _resources.at(typeid(T).hash_code())->refCount(id);
+	}
+	template<typename T>
+	uint32_t hold(ResId id) const {
+		return _resources.at(typeid(T).hash_code())->hold(id);
+	}
+	template<typename T>
+	uint32_t release(ResId id) const {
+		return _resources.at(typeid(T).hash_code())->release(id);
+	}
+	template<typename T>
+	uint32_t holdCount(ResId id) const {
+		return _resources.at(typeid(T).hash_code())->holdCount(id);
+	}
+	template<typename T>
+	std::vector<ResId> unused() const {
+		return _resources.at(typeid(T).hash_code())->unused();
+	}
+	template<typename T>
 	size_t size() const {
 		ResourceCollection<T>& res = static_cast<ResourceCollection<T>&>(*_resources.at(typeid(T).hash_code()));
 		return res.size();
 	}
+	// ids handed out so far, for loops over ids that skip the removed ones with exist
+	template<typename T>
+	ResId idCount() const {
+		return _resources.at(typeid(T).hash_code())->idCount();
+	}
 	template<typename T>
 	bool exist(ResId id) const {
 		ResourceCollection<T>& res = static_cast<ResourceCollection<T>&>(*_resources.at(typeid(T).hash_code()));
@@ -213,20 +346,29 @@ public:
 		res1._collections[typeid(TT).hash_code()][id1].push_back(id2);
 		res2._collected[id2][typeid(T).hash_code()].push_back(id1);
 	}
+	// also drops it from the collections it's in and empties its own
 	template<typename T>
 	void removeItem(ResId id) const {
 		ResourceCollectionBase& res = *_resources.at(typeid(T).hash_code());
-		res.remove(id);
-		size_t type = typeid(T).hash_code();
-		for (auto& pair : res.collected) {
-			if (pair.first == id) {
-				for (auto& pair2 : pair.second) {
-					ResourceCollectionBase& res = *_resources.at(pair2.first);
-					for (ResId id2 : pair2.second)
-						res._collections[type][id2].remove(id);
-				}
+		const size_t type = typeid(T).hash_code();
+		auto collected = res._collected.find(id);
+		if (collected != res._collected.end()) {
+			for (auto& pair : collected->second) {
+				ResourceCollectionBase& owners = *_resources.at(pair.first);
+				for (ResId owner : pair.second)
+					owners._collections[type][owner].remove(id);
 			}
+			res._collected.erase(collected);
 		}
+		for (auto& pair : res._collections) {
+			auto members = pair.second.find(id);
+			if (members == pair.second.end()) continue;
+			ResourceCollectionBase& memberRes = *_resources.at(pair.first);
+			for (ResId member : members->second)
+				memberRes._collected[member][type].remove(id);
+			pair.second.erase(members);
+		}
+		res.remove(id);
 	}
 	template<typename T, typename TT>
 	void removeFromCollect(ResId id1, ResId id2) const {
@@ -0,0 +1,324 @@
+#include "resources/texture_cooker.hpp"
+#include "resources/ktx2.hpp"
+#include "utils/mapped_file.hpp"
+#include "utils/thread_pool.hpp"
+
+#include <stb_image.h>
+#include <stb_image_resize.h>
+
+namespace naku {
+
+namespace {
+
+// bc7 interpolation weights of 4 bit indices, out of 64
+constexpr int BC7_WEIGHTS[16]{ 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// little endian bit stream of one 128 bit block
+class BlockWriter {
+public:
+	BlockWriter(uint8_t* block) : _block{ block } { memset(_block, 0, 16); }
+	void write(uint32_t value, uint32_t bits) {
+		for (uint32_t i = 0; i < bits; i++, _position++)
+			if (value & (1u << i)) _block[_position >> 3] |= 1 << (_position & 7);
+	}
+private:
+	uint8_t* _block;
+	uint32_t _position{ 0 };
+};
+
+// mode 6 endpoint, 7 bits per channel plus a shared low bit
+struct Bc7Endpoint {
+	int q[4];
+	int p;
+	int value(int c) const { return (q[c] << 1) | p; }
+};
+
+Bc7Endpoint quantizeBc7(const float* color) {
+	Bc7Endpoint best{};
+	float bestError = std::numeric_limits<float>::max();
+	for (int p = 0; p < 2; p++) {
+		Bc7Endpoint e{};
+		e.p = p;
+		float error = 0.f;
+		for (int c = 0; c < 4; c++) {
+			e.q[c] = std::clamp(static_cast<int>(std::round((color[c] - p) * 0.5f)), 0, 127);
+			const float d = e.value(c) - color[c];
+			error += d * d;
+		}
+		if (error < bestError) {
+			bestError = error;
+			best = e;
+		}
+	}
+	return best;
+}
+
+// picks the closest palette entry for every texel and returns the squared error
+int indexBc7(const unsigned char* texels, const Bc7Endpoint& e0, const Bc7Endpoint& e1, int* indices) {
+	int palette[16][4];
+	for (int i = 0; i < 16; i++)
+		for (int c = 0; c < 4; c++)
+			palette[i][c] = ((64 - BC7_WEIGHTS[i]) * e0.value(c) + BC7_WEIGHTS[i] * e1.value(c) + 32) >> 6;
+	int total = 0;
+	for (int t = 0; t < 16; t++) {
+		int bestError = std::numeric_limits<int>::max();
+		for (int i = 0; i < 16; i++) {
+			int error = 0;
+			for (int c = 0; c < 4; c++) {
+				const int d = palette[i][c] - texels[t * 4 + c];
+				error += d * d;
+			}
+			if (error < bestError) {
+				bestError = error;
+				indices[t] = i;
+			}
+		}
+		total += bestError;
+	}
+	return total;
+}
+
+void downsample(const std::vector<unsigned char>& source, int width, int height, std::vector<unsigned char>* destination, int newWidth, int newHeight, TextureUsage usage) {
+	destination->resize(static_cast<size_t>(newWidth) * newHeight * 4);
+	stbir_resize_uint8(source.data(), width, height, 0, destination->data(), newWidth, newHeight, 0, 4);
+	if (usage != TextureUsage::NORMAL) return;
+	// averaged normals get shorter
+	for (size_t i = 0; i < destination->size(); i += 4) {
+		unsigned char* texel = destination->data() + i;
+		glm::vec3 n{ texel[0] / 127.5f - 1.f, texel[1] / 127.5f - 1.f, texel[2] / 127.5f - 1.f };
+		const float length = glm::length(n);
+		if (length <= 0.f) continue;
+		n /= length;
+		for (int c = 0; c < 3; c++)
+			texel[c] = static_cast<unsigned char>(std::clamp((n[c] + 1.f) * 127.5f + 0.5f, 0.f, 255.f));
+	}
+}
+
+std::vector<char> compressLevel(const std::vector<unsigned char>& pixels, int width, int height, TextureUsage usage) {
+	const uint32_t blockSize = Ktx2::blockSize(TextureCooker::format(usage));
+	const int blocksX = (width + 3) / 4;
+	const int blocksY = (height + 3) / 4;
+	std::vector<char> level(static_cast<size_t>(blocksX) * blocksY * blockSize);
+	ThreadPool::shared().parallelFor(blocksY, [&](size_t first, size_t last) {
+		unsigned char texels[64];
+		for (size_t by = first; by < last; by++) {
+			for (int bx = 0; bx < blocksX; bx++) {
+				// blocks over the edge repeat the last row and column
+				for (int y = 0; y < 4; y++) {
+					const int sy = std::min(static_cast<int>(by) * 4 + y, height - 1);
+					for (int x = 0; x < 4; x++) {
+						const int sx = std::min(bx * 4 + x, width - 1);
+						memcpy(texels + (y * 4 + x) * 4, pixels.data() + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+					}
+				}
+				uint8_t* block = reinterpret_cast<uint8_t*>(level.data()) + (by * blocksX + bx) * blockSize;
+				if (usage == TextureUsage::COLOR) TextureCooker::compressBC7(texels, block);
+				else if (usage == TextureUsage::NORMAL) TextureCooker::compressBC5(texels, block);
+				else TextureCooker::compressBC4(texels, 0, block);
+			}
+		}
+	}, 4);
+	return level;
+}
+
+}
+
+VkFormat TextureCooker::format(TextureUsage usage) {
+	switch (usage) {
+	case TextureUsage::NORMAL: return VK_FORMAT_BC5_UNORM_BLOCK;
+	case TextureUsage::MASK: return VK_FORMAT_BC4_UNORM_BLOCK;
+	default: return VK_FORMAT_BC7_UNORM_BLOCK;
+	}
+}
+
+std::string TextureCooker::cachePath(uint64_t sourceHash, TextureUsage usage) {
+	const uint32_t options[2]{ VERSION, static_cast<uint32_t>(usage) };
+	return std::string(TEXTURE_CACHE_DIR) + "/" + hashToString(hashMemory(options, sizeof(options), sourceHash)) + ".ktx2";
+}
+
+std::string TextureCooker::cook(const std::string& filePath, TextureUsage usage) {
+	try {
+		MappedFile source{ filePath };
+		const uint64_t sourceHash = source.hash();
+		const std::string path = cachePath(sourceHash, usage);
+		if (doesFileExist(path)) return path;
+
+		int width, height, channels;
+		unsigned char* pixels = stbi_load_from_memory(
+			reinterpret_cast<const stbi_uc*>(source.data()),
+			static_cast<int>(source.size()),
+			&width, &height, &channels, STBI_rgb_alpha);
+		if (!pixels) {
+			std::cerr << "Warning: Texture cooker: can not decode " << filePath << std::endl;
+			return "";
+		}
+		const std::string cooked = cook(pixels, width, height, usage, sourceHash);
+		stbi_image_free(pixels);
+		return cooked;
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Warning: Texture cooker: " << e.what() << std::endl;
+		return "";
+	}
+}
+
+std::string TextureCooker::cook(const unsigned char* pixels, int width, int height, TextureUsage usage, uint64_t sourceHash) {
+	const std::string path = cachePath(sourceHash, usage);
+	if (doesFileExist(path)) return path;
+
+	const auto levels = mipChain(pixels, width, height, usage, true);
+
+	// written to a temporary file first so a half written texture is never picked up.
+	// threads cooking the same source each write their own
+	const std::string tmpPath = path + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+	try {
+		std::filesystem::create_directories(TEXTURE_CACHE_DIR);
+		if (!Ktx2::write(tmpPath, format(usage), width, height, levels)) {
+			std::cerr << "Warning: Texture cooker: failed to write file: " << tmpPath << std::endl;
+			return "";
+		}
+		std::filesystem::rename(tmpPath, path);
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Warning: Texture cooker: " << e.what() << std::endl;
+		return "";
+	}
+	return path;
+}
+
+std::vector<std::vector<char>> TextureCooker::mipChain(const unsigned char* pixels, int width, int height, TextureUsage usage, bool compress) {
+	// mips are filtered from the previous level on the cpu instead of blitted at load time
+	std::vector<std::vector<char>> levels;
+	std::vector<unsigned char> level(pixels, pixels + static_cast<size_t>(width) * height * 4);
+	std::vector<unsigned char> next;
+	int w = width, h = height;
+	while (true) {
+		if (compress) levels.push_back(compressLevel(level, w, h, usage));
+		else levels.emplace_back(level.begin(), level.end());
+		if (w == 1 && h == 1) break;
+		const int nw = std::max(w / 2, 1), nh = std::max(h / 2, 1);
+		downsample(level, w, h, &next, nw, nh, usage);
+		level.swap(next);
+		w = nw;
+		h = nh;
+	}
+	return levels;
+}
+
+void TextureCooker::compressBC4(const unsigned char* texels, uint32_t channel, uint8_t* block) {
+	int lo = 255, hi = 0;
+	for (int i = 0; i < 16; i++) {
+		lo = std::min<int>(lo, texels[i * 4 + channel]);
+		hi = std::max<int>(hi, texels[i * 4 + channel]);
+	}
+	// hi > lo selects the 8 value palette: hi, lo, then 6 steps from hi to lo
+	block[0] = static_cast<uint8_t>(hi);
+	block[1] = static_cast<uint8_t>(lo);
+	uint64_t bits = 0;
+	if (hi > lo) {
+		const float scale = 7.f / (hi - lo);
+		for (int i = 0; i < 16; i++) {
+			const int step = static_cast<int>((texels[i * 4 + channel] - lo) * scale + 0.5f);
+			const uint64_t index = step == 7 ? 0 : step == 0 ? 1 : 8 - step;
+			bits |= index << (3 * i);
+		}
+	}
+	for (int i = 0; i < 6; i++) block[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+}
+
+void TextureCooker::compressBC5(const unsigned char* texels, uint8_t* block) {
+	compressBC4(texels, 0, block);
+	compressBC4(texels, 1, block + 8);
+}
+
+void TextureCooker::compressBC7(const unsigned char* texels, uint8_t* block) {
+	// mode 6: one subset, rgba endpoints and 16 interpolated colors. endpoints start on the
+	// principal axis of the block's colors and are refined by least squares once.
+	float mean[4]{};
+	for (int t = 0; t < 16; t++)
+		for (int c = 0; c < 4; c++) mean[c] += texels[t * 4 + c] / 16.f;
+	float covariance[4][4]{};
+	for (int t = 0; t < 16; t++) {
+		float d[4];
+		for (int c = 0; c < 4; c++) d[c] = texels[t * 4 + c] - mean[c];
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++) covariance[i][j] += d[i] * d[j];
+	}
+	float axis[4]{ 1.f, 1.f, 1.f, 1.f };
+	for (int iteration = 0; iteration < 8; iteration++) {
+		float next[4]{};
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++) next[i] += covariance[i][j] * axis[j];
+		float length = 0.f;
+		for (int c = 0; c < 4; c++) length = std::max(length, std::abs(next[c]));
+		if (length <= 0.f) break;
+		for (int c = 0; c < 4; c++) axis[c] = next[c] / length;
+	}
+	float axisLength2 = 0.f;
+	for (int c = 0; c < 4; c++) axisLength2 += axis[c] * axis[c];
+	float tMin = 0.f, tMax = 0.f;
+	for (int t = 0; t < 16; t++) {
+		float proj = 0.f;
+		for (int c = 0; c < 4; c++) proj += (texels[t * 4 + c] - mean[c]) * axis[c];
+		proj /= axisLength2;
+		tMin = std::min(tMin, proj);
+		tMax = std::max(tMax, proj);
+	}
+	float color0[4], color1[4];
+	for (int c = 0; c < 4; c++) {
+		color0[c] = std::clamp(mean[c] + axis[c] * tMin, 0.f, 255.f);
+		color1[c] = std::clamp(mean[c] + axis[c] * tMax, 0.f, 255.f);
+	}
+
+	Bc7Endpoint e0 = quantizeBc7(color0), e1 = quantizeBc7(color1);
+	int indices[16];
+	int error = indexBc7(texels, e0, e1, indices);
+
+	if (error > 0) {
+		float a = 0.f, b = 0.f, d = 0.f, x0[4]{}, x1[4]{};
+		for (int t = 0; t < 16; t++) {
+			const float w = BC7_WEIGHTS[indices[t]] / 64.f;
+			a += (1.f - w) * (1.f - w);
+			b += (1.f - w) * w;
+			d += w * w;
+			for (int c = 0; c < 4; c++) {
+				x0[c] += (1.f - w) * texels[t * 4 + c];
+				x1[c] += w * texels[t * 4 + c];
+			}
+		}
+		const float det = a * d - b * b;
+		if (std::abs(det) > 1e-6f) {
+			for (int c = 0; c < 4; c++) {
+				color0[c] = std::clamp((d * x0[c] - b * x1[c]) / det, 0.f, 255.f);
+				color1[c] = std::clamp((a * x1[c] - b * x0[c]) / det, 0.f, 255.f);
+			}
+			const Bc7Endpoint r0 = quantizeBc7(color0), r1 = quantizeBc7(color1);
+			int refined[16];
+			const int refinedError = indexBc7(texels, r0, r1, refined);
+			if (refinedError < error) {
+				e0 = r0;
+				e1 = r1;
+				memcpy(indices, refined, sizeof(indices));
+			}
+		}
+	}
+
+	// the first index is stored without its high bit
+	if (indices[0] >= 8) {
+		std::swap(e0, e1);
+		for (int& index : indices) index = 15 - index;
+	}
+
+	BlockWriter writer{ block };
+	writer.write(1 << 6, 7);
+	for (int c = 0; c < 4; c++) {
+		writer.write(e0.q[c], 7);
+		writer.write(e1.q[c], 7);
+	}
+	writer.write(e0.p, 1);
+	writer.write(e1.p, 1);
+	writer.write(indices[0], 3);
+	for (int t = 1; t < 16; t++) writer.write(indices[t], 4);
+}
+
+}
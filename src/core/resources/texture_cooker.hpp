@@ -0,0 +1,40 @@
+#ifndef TEXTURE_COOKER_HPP
+#define TEXTURE_COOKER_HPP
+
+#include "naku.hpp"
+
+namespace naku {
+
+// what a texture holds decides how it's compressed
+enum class TextureUsage {
+	COLOR = 0,  // bc7, rgba
+	NORMAL = 1, // bc5, xy of a tangent space normal. the shaders rebuild z
+	MASK = 2,   // bc4, the red channel. metalness, roughness, occlusion
+};
+
+// turns source images into block compressed ktx2 files with a full mip chain. cooked files
+// are cached like meshes, named after the content hash of the source and the usage.
+class TextureCooker {
+public:
+	static constexpr uint32_t VERSION = 1;
+
+	// path of the cooked ktx2 of an image file, cooked first if it isn't cached yet. empty on failure.
+	static std::string cook(const std::string& filePath, TextureUsage usage);
+	// same for decoded rgba8 pixels. sourceHash must change whenever the pixels do.
+	static std::string cook(const unsigned char* pixels, int width, int height, TextureUsage usage, uint64_t sourceHash);
+	// where the cooked file of a source goes, whether it exists or not
+	static std::string cachePath(uint64_t sourceHash, TextureUsage usage);
+	static VkFormat format(TextureUsage usage);
+	// every level of rgba8 pixels, finest first. compressed to format(usage), or left as
+	// VK_FORMAT_R8G8B8A8_UNORM like the images the gpu blits mips for
+	static std::vector<std::vector<char>> mipChain(const unsigned char* pixels, int width, int height, TextureUsage usage, bool compress);
+
+	// each one reads the 4x4 rgba8 texels of a block, row by row
+	static void compressBC4(const unsigned char* texels, uint32_t channel, uint8_t* block);
+	static void compressBC5(const unsigned char* texels, uint8_t* block);
+	static void compressBC7(const unsigned char* texels, uint8_t* block);
+};
+
+}
+
+#endif
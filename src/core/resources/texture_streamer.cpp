@@ -0,0 +1,510 @@
+#include "resources/texture_streamer.hpp"
+#include "resources/hdr_decoder.hpp"
+#include "utils/engine.hpp"
+#include "utils/mapped_file.hpp"
+
+#include <stb_image.h>
+
+namespace naku {
+
+TextureStreamer::TextureStreamer(Engine& engine)
+	: _engine{ engine },
+	_pool{ std::max(std::thread::hardware_concurrency() / 2, 1u) },
+	_cancelled{ std::make_shared<std::atomic<bool>>(false) } {}
+
+TextureStreamer::~TextureStreamer() {
+	// queued decodes return right away, running ones are waited for
+	_cancelled->store(true);
+	for (auto& job : _jobs) {
+		if (job.decoded.valid()) job.decoded.wait();
+		if (job.fence != VK_NULL_HANDLE) {
+			vkWaitForFences(_engine.device(), 1, &job.fence, VK_TRUE, UINT64_MAX);
+			_engine.pDevice->releaseSingleTimeCommands(job.commandBuffer, job.fence);
+		}
+	}
+}
+
+void TextureStreamer::request(
+	std::shared_ptr<Material> pMaterial,
+	uint32_t binding,
+	const std::string& textureName,
+	bool anisotropic,
+	const std::string& imageName,
+	Decoder decoder) {
+	if (_engine.resources.exist<Image2D>(imageName)) {
+		auto pImage = _engine.resources.get<Image2D>(imageName);
+		pMaterial->changeTexture(binding, std::make_shared<Texture>(*_engine.pDevice, textureName, pImage, anisotropic));
+		return;
+	}
+	Binding target{ pMaterial, binding, textureName, anisotropic };
+	for (auto& job : _jobs) {
+		if (job.imageName == imageName) {
+			job.bindings.push_back(target);
+			return;
+		}
+	}
+
+	_jobs.emplace_back();
+	Job& job = _jobs.back();
+	job.imageName = imageName;
+	job.bindings.push_back(target);
+	submit(job, decoder);
+}
+
+void TextureStreamer::submit(Job& job, Decoder decoder) {
+	job.payload = std::make_shared<Payload>();
+	auto payload = job.payload;
+	auto cancelled = _cancelled;
+	job.decoded = _pool.submit([payload, cancelled, decoder]() {
+		if (cancelled->load()) return false;
+		return decoder(payload.get());
+	});
+}
+
+uint32_t TextureStreamer::droppedLevels(ResId image) const {
+	auto itr = _residents.find(image);
+	return itr == _residents.end() ? 0 : itr->second.droppedLevels;
+}
+
+TextureStreamer::Decoder TextureStreamer::fileDecoder(const std::string& filePath, TextureUsage usage, bool compress) {
+	// hashed like Engine::createImage does, so both find each other's images
+	return [filePath, usage, compress](Payload* payload) {
+		const uint64_t fileHash = MappedFile{ filePath }.hash();
+		payload->hash = fileHash;
+		if (strEndWith(filePath, ".ktx2")) {
+			payload->ktx2 = std::make_unique<Ktx2>(filePath);
+			return true;
+		}
+		if (HdrDecoder::isHdr(filePath)) {
+			std::string warn;
+			if (!HdrDecoder::decode(filePath, &payload->hdrPixels, &payload->width, &payload->height, &warn)) {
+				std::cerr << "Warning: Can not load image file at: " << filePath << ": " << warn;
+				return false;
+			}
+			return true;
+		}
+		if (compress) {
+			const std::string cookedPath = TextureCooker::cook(filePath, usage);
+			if (!cookedPath.empty()) {
+				const uint32_t usageKey = static_cast<uint32_t>(usage);
+				payload->ktx2 = std::make_unique<Ktx2>(cookedPath);
+				payload->hash = hashMemory(&usageKey, sizeof(usageKey), fileHash);
+				return true;
+			}
+		}
+		int channels;
+		unsigned char* pixels = stbi_load(filePath.c_str(), &payload->width, &payload->height, &channels, STBI_rgb_alpha);
+		if (!pixels) {
+			std::cerr << "Warning: Can not load image file at: " << filePath << std::endl;
+			return false;
+		}
+		payload->pixels.assign(pixels, pixels + static_cast<size_t>(payload->width) * payload->height * 4);
+		stbi_image_free(pixels);
+		return true;
+	};
+}
+
+void TextureStreamer::update() {
+	VkDeviceSize budget = uploadBudget;
+	// textures that show nothing yet go before the ones getting finer
+	for (int pass = 0; pass < 2; pass++) {
+		for (auto itr = _jobs.begin(); itr != _jobs.end();) {
+			const bool waiting = !itr->image || itr->residentLevel == itr->image->mipLevels();
+			if (waiting != (pass == 0)) {
+				itr++;
+				continue;
+			}
+			if (advance(*itr, &budget, false)) _jobs.erase(itr++);
+			else itr++;
+		}
+	}
+
+	_textureBytes = 0;
+	auto& images = _engine.resources.getResource<Image2D>();
+	for (ResId id = 0; id < images.idCount(); id++) {
+		if (images.exist(id)) _textureBytes += images[id]->memorySize();
+	}
+	if (_engine.textureBudget > 0) balance();
+}
+
+void TextureStreamer::balance() {
+	// one resize at a time, the sizes it changes are only known once it's done
+	for (const auto& job : _jobs) {
+		if (job.replaces != ERROR_RES_ID) return;
+	}
+
+	// an image was last used when the last material sampling it was drawn. the finest level
+	// it needs comes from the smallest uv footprint of a pixel among the materials drawn
+	// within the last second, a negative one if none was
+	struct Usage {
+		float lastUsed{ -1.f };
+		float uvPerPixel{ -1.f };
+	};
+	std::unordered_map<const Image2D*, Usage> usages;
+	const float recent = _engine.runningTime - 1.f;
+	auto& materials = _engine.resources.getResource<Material>();
+	for (ResId id = 0; id < materials.idCount(); id++) {
+		if (!materials.exist(id)) continue;
+		auto pMaterial = materials[id];
+		for (const auto& pTex : pMaterial->_textures) {
+			Usage& usage = usages[pTex->_pImage.get()];
+			usage.lastUsed = std::max(usage.lastUsed, pMaterial->lastUsed);
+			if (pMaterial->lastUsed >= recent && (usage.uvPerPixel < 0.f || pMaterial->uvPerPixel < usage.uvPerPixel))
+				usage.uvPerPixel = pMaterial->uvPerPixel;
+		}
+	}
+
+	// over budget, the image with the most levels nobody needs drops them all, else the least
+	// recently drawn one loses a level. under it, the most recently drawn image missing a level
+	// it needs gets one back. images keep the levels up to PLACEHOLDER_EXTENT
+	auto& images = _engine.resources.getResource<Image2D>();
+	ResId surplus{ ERROR_RES_ID }, evict{ ERROR_RES_ID }, restore{ ERROR_RES_ID };
+	uint32_t surplusRequired{ 0 };
+	VkDeviceSize surplusBytes{ 0 };
+	float evictUsed{ 0.f }, restoreUsed{ 0.f };
+	for (auto itr = _residents.begin(); itr != _residents.end();) {
+		if (!images.exist(itr->first)) {
+			_residents.erase(itr++);
+			continue;
+		}
+		auto pImage = images[itr->first];
+		const uint32_t dropped = itr->second.droppedLevels;
+		const uint32_t full = std::max(pImage->width(), pImage->height()) << dropped;
+		uint32_t maxDropped{ 0 };
+		while ((full >> maxDropped) > PLACEHOLDER_EXTENT && maxDropped + 1 < pImage->mipLevels() + dropped) maxDropped++;
+
+		auto found = usages.find(pImage.get());
+		const Usage usage = found == usages.end() ? Usage{} : found->second;
+		// level l has full >> l texels across, it's fine enough while a pixel covers one of them
+		uint32_t required = maxDropped;
+		if (usage.uvPerPixel >= 0.f) {
+			const float level = std::floor(std::log2(std::max(full * usage.uvPerPixel, 1.f)));
+			required = std::min(static_cast<uint32_t>(level), maxDropped);
+		}
+
+		if (required > dropped) {
+			// the bytes the drop frees, roughly
+			const VkDeviceSize bytes = pImage->memorySize() - (pImage->memorySize() >> (2 * (required - dropped)));
+			if (surplus == ERROR_RES_ID || bytes > surplusBytes) {
+				surplus = itr->first;
+				surplusRequired = required;
+				surplusBytes = bytes;
+			}
+		}
+		if (dropped < maxDropped && (evict == ERROR_RES_ID || usage.lastUsed < evictUsed)) {
+			evict = itr->first;
+			evictUsed = usage.lastUsed;
+		}
+		if (dropped > required && usage.lastUsed >= recent && (restore == ERROR_RES_ID || usage.lastUsed > restoreUsed)) {
+			restore = itr->first;
+			restoreUsed = usage.lastUsed;
+		}
+		itr++;
+	}
+
+	if (_textureBytes > _engine.textureBudget) {
+		if (surplus != ERROR_RES_ID) resize(surplus, surplusRequired);
+		else if (evict != ERROR_RES_ID) resize(evict, _residents[evict].droppedLevels + 1);
+	}
+	else if (restore != ERROR_RES_ID) {
+		// a level up takes about four times the memory. it only comes back if that fits,
+		// so it isn't dropped again on the next frame
+		const VkDeviceSize growth = images[restore]->memorySize() * 3;
+		if (_textureBytes + growth <= _engine.textureBudget)
+			resize(restore, _residents[restore].droppedLevels - 1);
+	}
+}
+
+void TextureStreamer::resize(ResId image, uint32_t droppedLevels) {
+	const Resident resident = _residents[image];
+	_jobs.emplace_back();
+	Job& job = _jobs.back();
+	job.imageName = _engine.resources.get<Image2D>(image)->name();
+	job.replaces = image;
+	job.firstLevel = droppedLevels;
+	submit(job, [resident](Payload* payload) {
+		payload->ktx2 = std::make_unique<Ktx2>(std::make_shared<MappedFile>(resident.ktx2Path), resident.offset, resident.size);
+		return true;
+	});
+}
+
+void TextureStreamer::finish() {
+	if (_jobs.empty()) return;
+	// bindings are written directly, nothing may be reading them
+	vkDeviceWaitIdle(_engine.device());
+	while (!_jobs.empty()) {
+		for (auto itr = _jobs.begin(); itr != _jobs.end();) {
+			VkDeviceSize budget = ~VkDeviceSize(0);
+			if (advance(*itr, &budget, true)) _jobs.erase(itr++);
+			else itr++;
+		}
+	}
+}
+
+bool TextureStreamer::advance(Job& job, VkDeviceSize* budget, bool immediate) {
+	if (!job.ready) {
+		if (!immediate && job.decoded.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return false;
+		job.ready = true;
+		if (finishDecoding(job, immediate)) return true;
+	}
+	if (job.fence != VK_NULL_HANDLE) {
+		if (immediate)
+			vkWaitForFences(_engine.device(), 1, &job.fence, VK_TRUE, UINT64_MAX);
+		else if (vkGetFenceStatus(_engine.device(), job.fence) != VK_SUCCESS)
+			return false;
+		if (completeUpload(job, immediate)) return true;
+	}
+	if (*budget > 0) uploadLevels(job, budget, !immediate && job.replaces == ERROR_RES_ID);
+	return false;
+}
+
+bool TextureStreamer::wanted(const Job& job) const {
+	if (job.replaces != ERROR_RES_ID) return true;
+	// a removed material may live on as garbage for a few frames
+	for (const auto& target : job.bindings) {
+		auto pMaterial = target.material.lock();
+		if (pMaterial && _engine.resources.exist<Material>(pMaterial->id())
+			&& _engine.resources.get<Material>(pMaterial->id()) == pMaterial) return true;
+	}
+	return false;
+}
+
+bool TextureStreamer::finishDecoding(Job& job, bool immediate) {
+	bool decoded = false;
+	try {
+		decoded = job.decoded.get();
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Warning: " << e.what() << std::endl;
+	}
+	// the scene was switched or reloaded meanwhile, nothing would ever free the image
+	if (!wanted(job)) return true;
+	if (job.replaces != ERROR_RES_ID && (!decoded || job.firstLevel >= job.payload->ktx2->levelCount())) {
+		std::cerr << "Warning: Mips of image " << job.imageName << " can not be read again, it keeps its size." << std::endl;
+		_residents.erase(job.replaces);
+		return true;
+	}
+	if (!decoded) {
+		std::cerr << "Warning: Image " << job.imageName << " can not be loaded, the default texture stays." << std::endl;
+		return true;
+	}
+	auto pShared = job.replaces == ERROR_RES_ID ? findShared(job) : nullptr;
+	if (pShared) {
+		bind(job, pShared, 0, immediate);
+		return true;
+	}
+
+	Device& device = *_engine.pDevice;
+	Payload& payload = *job.payload;
+	if (!payload.ktx2) {
+		// decoded pixels go up in one piece, their mips are blitted on the gpu
+		const bool hdr = !payload.hdrPixels.empty();
+		const void* pixels = hdr ? static_cast<const void*>(payload.hdrPixels.data()) : payload.pixels.data();
+		try {
+			job.image = Image2D::loadImageFromPixels(device, job.imageName, pixels, payload.width, payload.height, 4, hdr);
+		}
+		catch (const std::exception& e) {
+			std::cerr << "Error: Cannot load Image " << job.imageName << ": " << e.what() << std::endl;
+			return true;
+		}
+		registerImage(job, immediate);
+		return true;
+	}
+
+	const Ktx2& ktx2 = *payload.ktx2;
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(device.physicalDevice(), ktx2.format(), &formatProperties);
+	if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+		std::cerr << "Error: The format of " << job.imageName << " can not be sampled on this device." << std::endl;
+		return true;
+	}
+	auto imageCreateInfo = Image2D::getDefaultImageCreateInfo({
+		std::max(ktx2.width() >> job.firstLevel, 1u),
+		std::max(ktx2.height() >> job.firstLevel, 1u) });
+	imageCreateInfo.format = ktx2.format();
+	imageCreateInfo.mipLevels = ktx2.levelCount() - job.firstLevel;
+	job.image = std::make_shared<Image2D>(device, job.imageName, imageCreateInfo);
+	job.residentLevel = job.uploadingLevel = imageCreateInfo.mipLevels;
+	return false;
+}
+
+void TextureStreamer::uploadLevels(Job& job, VkDeviceSize* budget, bool placeholder) {
+	Device& device = *_engine.pDevice;
+	const Ktx2& ktx2 = *job.payload->ktx2;
+	const bool first = job.residentLevel == job.image->mipLevels();
+
+	// levels are stored coarsest first, so the next finer ones follow each other in the file.
+	// level i of the image is level firstLevel + i of the ktx2
+	std::vector<VkBufferImageCopy> regions;
+	VkDeviceSize size = 0;
+	uint32_t level = job.residentLevel;
+	while (level > 0) {
+		const uint32_t next = level - 1;
+		const uint32_t source = job.firstLevel + next;
+		const uint32_t width = std::max(ktx2.width() >> source, 1u);
+		const uint32_t height = std::max(ktx2.height() >> source, 1u);
+		if (!regions.empty()) {
+			if (first && placeholder && std::max(width, height) > PLACEHOLDER_EXTENT) break;
+			if (!first && size + ktx2.levelSize(source) > *budget) break;
+		}
+		VkBufferImageCopy region{};
+		region.bufferOffset = size;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = next;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageExtent = { width, height, 1 };
+		regions.push_back(region);
+		size += ktx2.levelSize(source);
+		level = next;
+	}
+
+	job.staging = std::make_unique<Buffer>(
+		device,
+		1,
+		static_cast<uint32_t>(size),
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	for (const auto& region : regions) {
+		const uint32_t i = job.firstLevel + region.imageSubresource.mipLevel;
+		job.staging->writeToBuffer(const_cast<char*>(ktx2.level(i)), ktx2.levelSize(i), region.bufferOffset);
+	}
+
+	VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+	if (first) {
+		Image2D::transitImageLayout(device,
+			commandBuffer,
+			job.image->image(),
+			job.image->format(),
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			0, job.image->mipLevels());
+	}
+	vkCmdCopyBufferToImage(
+		commandBuffer,
+		job.staging->getBuffer(),
+		job.image->image(),
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		static_cast<uint32_t>(regions.size()),
+		regions.data());
+	// only the new levels become readable, the finer ones wait in transfer layout
+	Image2D::transitImageLayout(device,
+		commandBuffer,
+		job.image->image(),
+		job.image->format(),
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		level, job.residentLevel - level);
+	job.commandBuffer = commandBuffer;
+	job.fence = device.submitSingleTimeCommands(commandBuffer);
+	job.uploadingLevel = level;
+	*budget -= std::min(*budget, size);
+}
+
+bool TextureStreamer::completeUpload(Job& job, bool immediate) {
+	_engine.pDevice->releaseSingleTimeCommands(job.commandBuffer, job.fence);
+	job.commandBuffer = VK_NULL_HANDLE;
+	job.fence = VK_NULL_HANDLE;
+	job.staging.reset();
+	job.residentLevel = job.uploadingLevel;
+	if (!wanted(job)) return true;
+	if (job.residentLevel > 0) {
+		if (job.replaces == ERROR_RES_ID) bind(job, job.image, job.residentLevel, immediate);
+		return false;
+	}
+	if (job.replaces != ERROR_RES_ID) {
+		// freed with the scene that used it while it was being resized
+		if (!_engine.resources.exist<Image2D>(job.replaces)) {
+			_residents.erase(job.replaces);
+			return true;
+		}
+		auto pOld = _engine.resources.get<Image2D>(job.replaces);
+		job.image->setId(job.replaces);
+		_engine.resources.replace<Image2D>(job.replaces, job.image);
+		rebind(pOld, job.image, immediate);
+		if (!immediate) _engine.addGarbage(pOld);
+		_residents[job.replaces].droppedLevels = job.firstLevel;
+		return true;
+	}
+	// the same content may have finished under another name in the meantime
+	if (auto pShared = findShared(job)) {
+		bind(job, pShared, 0, immediate);
+		return true;
+	}
+	registerImage(job, immediate);
+	return true;
+}
+
+void TextureStreamer::registerImage(Job& job, bool immediate) {
+	ResId id = _engine.resources.push<Image2D>(job.imageName, job.image);
+	job.image->setId(id);
+	_engine.resources.setContent<Image2D>(id, job.payload->hash);
+	if (job.payload->ktx2) {
+		const Ktx2& ktx2 = *job.payload->ktx2;
+		_residents[id] = { ktx2.filePath(), ktx2.offset(), ktx2.size(), 0 };
+	}
+	bind(job, job.image, 0, immediate);
+	// the cpu copy isn't needed anymore
+	job.payload.reset();
+}
+
+std::shared_ptr<Image2D> TextureStreamer::findShared(const Job& job) {
+	if (_engine.resources.exist<Image2D>(job.imageName))
+		return _engine.resources.get<Image2D>(job.imageName);
+	auto pShared = _engine.findSharedContent<Image2D>(job.imageName, job.payload->hash);
+	if (pShared) _engine.sharedContent.images++;
+	return pShared;
+}
+
+void TextureStreamer::bind(const Job& job, std::shared_ptr<Image2D> pImage, uint32_t baseMipLevel, bool immediate) {
+	for (const auto& target : job.bindings) {
+		auto pMaterial = target.material.lock();
+		if (!pMaterial) continue;
+		auto pTex = std::make_shared<Texture>(
+			*_engine.pDevice,
+			target.textureName,
+			pImage,
+			target.anisotropic,
+			VK_FILTER_LINEAR,
+			VK_SAMPLER_ADDRESS_MODE_REPEAT,
+			VK_SAMPLER_MIPMAP_MODE_LINEAR,
+			baseMipLevel);
+		swapTexture(*pMaterial, target.binding, pTex, immediate);
+	}
+}
+
+void TextureStreamer::rebind(const std::shared_ptr<Image2D>& pOld, const std::shared_ptr<Image2D>& pNew, bool immediate) {
+	// any material may sample it, the gui can bind images too
+	auto& materials = _engine.resources.getResource<Material>();
+	for (ResId id = 0; id < materials.idCount(); id++) {
+		if (!materials.exist(id)) continue;
+		auto pMaterial = materials[id];
+		for (uint32_t binding = 0; binding < pMaterial->_textures.size(); binding++) {
+			const auto& pTex = pMaterial->_textures[binding];
+			if (pTex->_pImage != pOld) continue;
+			auto pNewTex = std::make_shared<Texture>(
+				*_engine.pDevice,
+				pTex->_name,
+				pNew,
+				pTex->_anisotropic_filtering,
+				pTex->_filterType,
+				pTex->_addressType,
+				pTex->_mipmapMode);
+			swapTexture(*pMaterial, binding, pNewTex, immediate);
+		}
+	}
+}
+
+void TextureStreamer::swapTexture(Material& material, uint32_t binding, std::shared_ptr<Texture> pTex, bool immediate) {
+	if (immediate) {
+		material.changeTexture(binding, pTex);
+		return;
+	}
+	// swapped like the gui does, the old texture lives until frames using it are done
+	_engine.addGarbage(material._textures[binding]);
+	material.changeTexture(binding, pTex, false);
+	_engine.addLateUpdate(*material._writer, material._set);
+}
+
+}
@@ -0,0 +1,142 @@
+#ifndef TEXTURE_STREAMER_HPP
+#define TEXTURE_STREAMER_HPP
+
+#include "naku.hpp"
+#include "resources/material.hpp"
+#include "resources/ktx2.hpp"
+#include "resources/texture_cooker.hpp"
+#include "utils/thread_pool.hpp"
+
+#include <atomic>
+#include <functional>
+
+namespace naku {
+
+class Engine;
+
+// loads material textures in the background. a requested binding keeps the default texture
+// until its image is decoded, or cooked, on a worker thread. cooked images are then uploaded
+// coarsest mip first, a few levels per frame, and the binding is switched to the resident
+// mips after every step. no frame waits for the disk.
+// with a texture budget set on the engine it also manages residency. the renderers estimate
+// per material how many uv units a pixel covers, which gives the finest level each image
+// needs. while images take more than the budget, one is rebuilt without the levels finer than
+// that, or the least recently drawn one without its finest mip. dropped mips that are needed
+// are read from the ktx2 again once they fit back in.
+class TextureStreamer {
+public:
+	// what a worker hands back: a ktx2 with baked mips, or rgba pixels, 8 bit or half float
+	struct Payload {
+		std::unique_ptr<Ktx2> ktx2;
+		std::vector<unsigned char> pixels;
+		std::vector<uint16_t> hdrPixels;
+		int width{ 0 };
+		int height{ 0 };
+		uint64_t hash{ 0 }; // content the engine shares the image by, 0 if unknown
+	};
+	// runs on a worker. returns false if the image can't be loaded, the reason goes to cerr.
+	using Decoder = std::function<bool(Payload*)>;
+
+	// levels up to this size go up in the first step, so every texture shows something early
+	static constexpr uint32_t PLACEHOLDER_EXTENT = 64;
+
+	TextureStreamer(Engine& engine);
+	~TextureStreamer();
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// binds the image named imageName to a binding of the material once it's loaded.
+	// an image that already exists is bound right away, a pending one isn't decoded twice.
+	void request(
+		std::shared_ptr<Material> pMaterial,
+		uint32_t binding,
+		const std::string& textureName,
+		bool anisotropic,
+		const std::string& imageName,
+		Decoder decoder);
+	// loads an image file the way Engine::createImage with a usage does
+	static Decoder fileDecoder(const std::string& filePath, TextureUsage usage, bool compress);
+
+	// moves finished images along by at most uploadBudget bytes. called once per frame.
+	void update();
+	// blocks until every request is loaded, uploading without a budget
+	void finish();
+	size_t pendingCount() const { return _jobs.size(); }
+	// device memory of every loaded image, as of the last update
+	VkDeviceSize textureBytes() const { return _textureBytes; }
+	// levels dropped from an image to stay in budget
+	uint32_t droppedLevels(ResId image) const;
+
+	// bytes uploaded per frame. the first level of a frame goes up even if it's larger
+	VkDeviceSize uploadBudget{ 16ull << 20 };
+
+private:
+	struct Binding {
+		std::weak_ptr<Material> material;
+		uint32_t binding;
+		std::string textureName;
+		bool anisotropic;
+	};
+
+	struct Job {
+		std::string imageName;
+		std::vector<Binding> bindings;
+		std::shared_ptr<Payload> payload;
+		std::future<bool> decoded;
+		bool ready{ false };
+		// a resize rebuilds a registered image from level firstLevel of its ktx2 and takes its
+		// place once complete. its steps aren't shown on the way
+		ResId replaces{ ERROR_RES_ID };
+		uint32_t firstLevel{ 0 };
+
+		// a ktx2 is uploaded into an image that's registered once all its levels are resident
+		std::shared_ptr<Image2D> image;
+		uint32_t residentLevel{ 0 }; // finest level sampled, mipLevels while none is
+		uint32_t uploadingLevel{ 0 }; // finest level of the step in flight
+		std::unique_ptr<Buffer> staging;
+		VkCommandBuffer commandBuffer{ VK_NULL_HANDLE };
+		VkFence fence{ VK_NULL_HANDLE };
+	};
+
+	// a streamed image whose mips can be dropped and read again
+	struct Resident {
+		std::string ktx2Path;
+		// the ktx2 may be one of many in a scene package
+		size_t offset{ 0 };
+		size_t size{ 0 };
+		uint32_t droppedLevels{ 0 };
+	};
+
+	Engine& _engine;
+	// a pool of its own, so scene loading on the shared pool never queues behind decoding
+	ThreadPool _pool;
+	std::list<Job> _jobs;
+	std::shared_ptr<std::atomic<bool>> _cancelled;
+	std::unordered_map<ResId, Resident> _residents;
+	VkDeviceSize _textureBytes{ 0 };
+
+	void submit(Job& job, Decoder decoder);
+	// drops or restores levels of one image when the budget asks for it
+	void balance();
+	void resize(ResId image, uint32_t droppedLevels);
+
+	// false once every material it loads for is removed, a resize is always wanted
+	bool wanted(const Job& job) const;
+	// returns true when the job is done, one way or the other
+	bool advance(Job& job, VkDeviceSize* budget, bool immediate);
+	bool finishDecoding(Job& job, bool immediate);
+	// placeholder limits a first step to the levels up to PLACEHOLDER_EXTENT
+	void uploadLevels(Job& job, VkDeviceSize* budget, bool placeholder);
+	bool completeUpload(Job& job, bool immediate);
+	void registerImage(Job& job, bool immediate);
+	// the image with the same content, if one is loaded already
+	std::shared_ptr<Image2D> findShared(const Job& job);
+	void bind(const Job& job, std::shared_ptr<Image2D> pImage, uint32_t baseMipLevel, bool immediate);
+	// moves every material binding sampling pOld over to pNew
+	void rebind(const std::shared_ptr<Image2D>& pOld, const std::shared_ptr<Image2D>& pNew, bool immediate);
+	void swapTexture(Material& material, uint32_t binding, std::shared_ptr<Texture> pTex, bool immediate);
+};
+
+}
+
+#endif
@@ -0,0 +1,597 @@
+#include "resources/virtual_texture.hpp"
+#include "utils/engine.hpp"
+
+#include <thread>
+
+namespace naku {
+
+namespace {
+
+struct TileHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levels;
+	uint32_t pageSize;
+	uint32_t pageBorder;
+	uint32_t pageCount;
+};
+
+constexpr char TILE_MAGIC[4]{ 'N', 'K', 'V', 'T' };
+constexpr size_t PAGE_BYTES = VirtualTextures::PAGE_SIZE * VirtualTextures::PAGE_SIZE * 4;
+constexpr uint32_t RESIDENT = 0x80000000u;
+
+uint32_t pagesAcross(uint32_t texels) {
+	return (texels + VirtualTextures::PAGE_PAYLOAD - 1) / VirtualTextures::PAGE_PAYLOAD;
+}
+
+// levels go down until one page holds a whole level. returns the page count of all of them
+uint32_t pageLayout(uint32_t width, uint32_t height, uint32_t* levels, uint32_t* levelOffsets) {
+	uint32_t count = 0;
+	*levels = 0;
+	while (*levels < VirtualTextures::MAX_LEVELS) {
+		const uint32_t w = std::max(width >> *levels, 1u), h = std::max(height >> *levels, 1u);
+		levelOffsets[(*levels)++] = count;
+		count += pagesAcross(w) * pagesAcross(h);
+		if (std::max(w, h) <= VirtualTextures::PAGE_PAYLOAD) break;
+	}
+	return count;
+}
+
+void downsample(const std::vector<unsigned char>& src, uint32_t w, uint32_t h, std::vector<unsigned char>* dst, uint32_t nw, uint32_t nh) {
+	dst->resize(static_cast<size_t>(nw) * nh * 4);
+	for (uint32_t y = 0; y < nh; y++) {
+		const uint32_t y0 = std::min(y * 2, h - 1), y1 = std::min(y * 2 + 1, h - 1);
+		for (uint32_t x = 0; x < nw; x++) {
+			const uint32_t x0 = std::min(x * 2, w - 1), x1 = std::min(x * 2 + 1, w - 1);
+			for (uint32_t c = 0; c < 4; c++) {
+				const uint32_t sum =
+					src[(static_cast<size_t>(y0) * w + x0) * 4 + c] + src[(static_cast<size_t>(y0) * w + x1) * 4 + c] +
+					src[(static_cast<size_t>(y1) * w + x0) * 4 + c] + src[(static_cast<size_t>(y1) * w + x1) * 4 + c];
+				(*dst)[(static_cast<size_t>(y) * nw + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+// textures repeat, so do the borders of pages on the edges
+uint32_t wrap(int64_t texel, uint32_t size) {
+	const int64_t m = texel % size;
+	return static_cast<uint32_t>(m < 0 ? m + size : m);
+}
+
+uint64_t pageKey(int32_t slot, uint32_t entry) {
+	return (static_cast<uint64_t>(slot) << 32) | entry;
+}
+
+}
+
+VirtualTextures::VirtualTextures(Engine& engine)
+	: _engine{ engine },
+	_pool{ std::max(std::thread::hardware_concurrency() / 4, 1u) },
+	_pagePool{ 2 },
+	_cancelled{ std::make_shared<std::atomic<bool>>(false) } {
+	_setLayout = DescriptorSetLayout::Builder(*_engine.pDevice)
+		.addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT) // atlas
+		.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT) // page table
+		.addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT) // infos
+		.addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT) // feedback
+		.build();
+	_sets.resize(MAX_FRAMES_IN_FLIGHT);
+	for (auto& set : _sets)
+		_engine.pDescriptorSetPool->allocateDescriptorSet(_setLayout->getDescriptorSetLayout(), set);
+	// a single page until the first request, the pipelines bind the set either way
+	allocate(1, 32, 1);
+}
+
+VirtualTextures::~VirtualTextures() {
+	// queued decodes return right away, running ones are waited for
+	_cancelled->store(true);
+	for (auto& job : _jobs) {
+		if (job.done.valid()) job.done.wait();
+	}
+	for (auto& load : _loads) {
+		if (load.data.valid()) load.data.wait();
+	}
+}
+
+void VirtualTextures::request(
+	std::shared_ptr<Material> pMaterial,
+	uint32_t binding,
+	const std::string& textureName,
+	bool anisotropic,
+	const std::string& imageName,
+	TextureStreamer::Decoder decoder) {
+	if (_slotCapacity < MAX_SLOTS) {
+		const uint32_t maxPages = _engine.pDevice->properties.limits.maxImageDimension2D / PAGE_SIZE;
+		allocate(std::clamp(_engine.virtualTexturePages, 1u, std::min(maxPages, 1024u)), MAX_ENTRIES, MAX_SLOTS);
+	}
+
+	auto slot = _slotIds.find(imageName);
+	if (slot != _slotIds.end()) {
+		pMaterial->changeVirtualTexture(binding, slot->second);
+		return;
+	}
+	Binding target{ pMaterial, binding, textureName, anisotropic };
+	for (auto& job : _jobs) {
+		if (job.imageName == imageName) {
+			job.bindings.push_back(target);
+			return;
+		}
+	}
+
+	_jobs.emplace_back();
+	Job& job = _jobs.back();
+	job.imageName = imageName;
+	job.bindings.push_back(target);
+	job.decoded = std::make_shared<Decoded>();
+	job.decoded->payload = std::make_shared<TextureStreamer::Payload>();
+	auto decoded = job.decoded;
+	auto cancelled = _cancelled;
+	job.done = _pool.submit([decoded, cancelled, decoder]() {
+		if (cancelled->load()) return false;
+		TextureStreamer::Payload& payload = *decoded->payload;
+		if (!decoder(&payload)) return false;
+		// anything but 8 bit pixels is left to the streamer
+		if (payload.pixels.empty()) return true;
+		const uint64_t hash = payload.hash != 0 ? payload.hash : hashMemory(payload.pixels.data(), payload.pixels.size());
+		const std::string path = cook(payload.pixels.data(), payload.width, payload.height, hash);
+		if (path.empty()) return true;
+		decoded->tiles = std::make_shared<MappedFile>(path);
+		payload.pixels.clear();
+		payload.pixels.shrink_to_fit();
+		return true;
+	});
+}
+
+std::string VirtualTextures::cook(const unsigned char* pixels, int width, int height, uint64_t sourceHash) {
+	const uint32_t options[2]{ VERSION, PAGE_SIZE };
+	const std::string path = std::string(TEXTURE_CACHE_DIR) + "/" + hashToString(hashMemory(options, sizeof(options), sourceHash)) + ".vtex";
+	if (doesFileExist(path)) return path;
+
+	TileHeader header{};
+	memcpy(header.magic, TILE_MAGIC, sizeof(TILE_MAGIC));
+	header.version = VERSION;
+	header.width = static_cast<uint32_t>(width);
+	header.height = static_cast<uint32_t>(height);
+	header.pageSize = PAGE_SIZE;
+	header.pageBorder = PAGE_BORDER;
+	uint32_t levelOffsets[MAX_LEVELS];
+	header.pageCount = pageLayout(header.width, header.height, &header.levels, levelOffsets);
+
+	// pages follow each other in page table order: by level, then row by row
+	const std::string tmpPath = path + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+	try {
+		std::filesystem::create_directories(TEXTURE_CACHE_DIR);
+		std::ofstream file(tmpPath, std::ios::binary);
+		if (!file) {
+			std::cerr << "Warning: Virtual textures: failed to write file: " << tmpPath << std::endl;
+			return "";
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		std::vector<unsigned char> level(pixels, pixels + static_cast<size_t>(width) * height * 4);
+		std::vector<unsigned char> next;
+		std::vector<unsigned char> page(PAGE_BYTES);
+		uint32_t w = header.width, h = header.height;
+		for (uint32_t l = 0; l < header.levels; l++) {
+			if (l > 0) {
+				const uint32_t nw = std::max(header.width >> l, 1u), nh = std::max(header.height >> l, 1u);
+				downsample(level, w, h, &next, nw, nh);
+				level.swap(next);
+				w = nw;
+				h = nh;
+			}
+			for (uint32_t py = 0; py < pagesAcross(h); py++) {
+				for (uint32_t px = 0; px < pagesAcross(w); px++) {
+					for (uint32_t ty = 0; ty < PAGE_SIZE; ty++) {
+						const uint32_t sy = wrap(static_cast<int64_t>(py) * PAGE_PAYLOAD + ty - PAGE_BORDER, h);
+						for (uint32_t tx = 0; tx < PAGE_SIZE; tx++) {
+							const uint32_t sx = wrap(static_cast<int64_t>(px) * PAGE_PAYLOAD + tx - PAGE_BORDER, w);
+							memcpy(&page[(static_cast<size_t>(ty) * PAGE_SIZE + tx) * 4], &level[(static_cast<size_t>(sy) * w + sx) * 4], 4);
+						}
+					}
+					file.write(reinterpret_cast<const char*>(page.data()), page.size());
+				}
+			}
+		}
+		file.close();
+		if (!file) {
+			std::cerr << "Warning: Virtual textures: failed to write file: " << tmpPath << std::endl;
+			return "";
+		}
+		std::filesystem::rename(tmpPath, path);
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Warning: Virtual textures: " << e.what() << std::endl;
+		return "";
+	}
+	return path;
+}
+
+void VirtualTextures::allocate(uint32_t atlasSide, uint32_t entryCapacity, uint32_t slotCapacity) {
+	Device& device = *_engine.pDevice;
+	vkDeviceWaitIdle(device.device());
+	for (auto& load : _loads) {
+		if (load.data.valid()) load.data.wait();
+	}
+	_loads.clear();
+	_loading.clear();
+
+	_atlas = std::make_shared<Image2D>(
+		device,
+		"virtual texture atlas",
+		Image2D::getDefaultImageCreateInfo({ atlasSide * PAGE_SIZE, atlasSide * PAGE_SIZE }));
+	Image2D::transitImageLayout(device,
+		_atlas->image(),
+		_atlas->format(),
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	// pages are sampled at a single level, their borders keep bilinear filtering inside
+	_atlasTexture = std::make_unique<Texture>(
+		device,
+		"virtual texture atlas",
+		_atlas,
+		false,
+		VK_FILTER_LINEAR,
+		VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		VK_SAMPLER_MIPMAP_MODE_NEAREST);
+	_atlasSide = atlasSide;
+	_atlasPages.assign(static_cast<size_t>(atlasSide) * atlasSide, AtlasPage{});
+	_entryCapacity = entryCapacity;
+	_slotCapacity = slotCapacity;
+	_table.assign(entryCapacity, 0);
+
+	for (auto& frame : _frames) {
+		frame.pageTable = std::make_unique<Buffer>(
+			device,
+			sizeof(uint32_t),
+			entryCapacity + 4, // and the header
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		frame.infos = std::make_unique<Buffer>(
+			device,
+			sizeof(Info),
+			slotCapacity,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		frame.feedback = std::make_unique<Buffer>(
+			device,
+			sizeof(uint32_t),
+			(entryCapacity + 31) / 32,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+		memset(frame.feedback->getMappedMemory(), 0, frame.feedback->getBufferSize());
+		frame.staging = std::make_unique<Buffer>(
+			device,
+			PAGE_BYTES,
+			std::max(pagesPerFrame, 1u),
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		frame.stale = true;
+	}
+	writeSets();
+
+	// nothing is resident in the new atlas
+	for (int32_t id = 0; id < static_cast<int32_t>(_slots.size()); id++) {
+		Slot& slot = _slots[id];
+		slot.pages.assign(slot.entryCount, 0);
+		slot.dirty = true;
+		requestPage(id, slot.levelOffsets[slot.levels - 1]);
+	}
+}
+
+void VirtualTextures::writeSets() {
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+		DescriptorWriter(*_setLayout, *_engine.pDescriptorSetPool)
+			.writeImage(0, _atlasTexture->descriptorInfo())
+			.writeBuffer(1, _frames[i].pageTable->descriptorInfo())
+			.writeBuffer(2, _frames[i].infos->descriptorInfo())
+			.writeBuffer(3, _frames[i].feedback->descriptorInfo())
+			.overwrite(_sets[i]);
+	}
+}
+
+void VirtualTextures::update(VkCommandBuffer commandBuffer, uint32_t frameIdx) {
+	_frame++;
+	FrameResources& frame = _frames[frameIdx];
+
+	for (auto itr = _jobs.begin(); itr != _jobs.end();) {
+		if (complete(*itr)) _jobs.erase(itr++);
+		else itr++;
+	}
+
+	readFeedback(frame);
+	const std::vector<VkBufferImageCopy> regions = uploadPages(frame);
+
+	bool changed = false;
+	for (auto& slot : _slots) {
+		if (!slot.dirty) continue;
+		updateTable(slot);
+		changed = true;
+	}
+	if (changed) {
+		for (auto& f : _frames) f.stale = true;
+	}
+	// the frame picks which pixels ask for pages
+	glm::uvec4 header{ static_cast<uint32_t>(_frame), 0u, 0u, 0u };
+	frame.pageTable->writeToBuffer(&header, sizeof(header), 0);
+	if (frame.stale) {
+		frame.pageTable->writeToBuffer(_table.data(), _entryCount * sizeof(uint32_t), sizeof(header));
+		frame.infos->writeToBuffer(_infos.data(), _infos.size() * sizeof(Info), 0);
+		frame.stale = false;
+	}
+
+	if (regions.empty()) return;
+	// earlier frames may still sample the pages being replaced, the barrier waits for them
+	Image2D::transitImageLayout(*_engine.pDevice,
+		commandBuffer,
+		_atlas->image(),
+		_atlas->format(),
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	vkCmdCopyBufferToImage(
+		commandBuffer,
+		frame.staging->getBuffer(),
+		_atlas->image(),
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		static_cast<uint32_t>(regions.size()),
+		regions.data());
+	Image2D::transitImageLayout(*_engine.pDevice,
+		commandBuffer,
+		_atlas->image(),
+		_atlas->format(),
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+void VirtualTextures::cmdEndFrame(VkCommandBuffer commandBuffer) {
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		VK_PIPELINE_STAGE_HOST_BIT,
+		0,
+		1, &barrier,
+		0, nullptr,
+		0, nullptr);
+}
+
+void VirtualTextures::finish() {
+	for (auto& job : _jobs) {
+		if (job.done.valid()) job.done.wait();
+		complete(job);
+	}
+	_jobs.clear();
+}
+
+uint32_t VirtualTextures::residentPages() const {
+	uint32_t count = 0;
+	for (const auto& page : _atlasPages) {
+		if (page.slot >= 0) count++;
+	}
+	return count;
+}
+
+bool VirtualTextures::complete(Job& job) {
+	if (job.done.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+	bool decoded = false;
+	try {
+		decoded = job.done.get();
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Warning: Virtual textures: " << job.imageName << ": " << e.what() << std::endl;
+	}
+	if (!decoded) return true;
+
+	if (job.decoded->tiles) {
+		registerSlot(job);
+		return true;
+	}
+	// the streamer uploads what didn't cook, the payload decoded already
+	auto payload = job.decoded->payload;
+	for (const auto& binding : job.bindings) {
+		auto pMaterial = binding.material.lock();
+		if (!pMaterial) continue;
+		_engine.pTextureStreamer->request(pMaterial, binding.binding, binding.textureName, binding.anisotropic, job.imageName,
+			[payload](TextureStreamer::Payload* target) {
+				*target = std::move(*payload);
+				return true;
+			});
+	}
+	return true;
+}
+
+void VirtualTextures::registerSlot(Job& job) {
+	const MappedFile& tiles = *job.decoded->tiles;
+	TileHeader header{};
+	if (tiles.size() >= sizeof(header)) memcpy(&header, tiles.data(), sizeof(header));
+
+	Slot slot{};
+	slot.imageName = job.imageName;
+	slot.tiles = job.decoded->tiles;
+	slot.width = header.width;
+	slot.height = header.height;
+	slot.entryCount = pageLayout(header.width, header.height, &slot.levels, slot.levelOffsets);
+	if (memcmp(header.magic, TILE_MAGIC, sizeof(TILE_MAGIC)) != 0 ||
+		header.version != VERSION ||
+		header.pageSize != PAGE_SIZE ||
+		header.pageBorder != PAGE_BORDER ||
+		header.levels != slot.levels ||
+		header.pageCount != slot.entryCount ||
+		tiles.size() < sizeof(header) + slot.entryCount * PAGE_BYTES) {
+		std::cerr << "Warning: Virtual textures: invalid tile file: " << tiles.filePath() << std::endl;
+		return;
+	}
+	// each word of feedback bits belongs to a single slot
+	slot.tableOffset = (_entryCount + 31) / 32 * 32;
+	if (_slots.size() >= _slotCapacity || slot.tableOffset + slot.entryCount > _entryCapacity) {
+		std::cerr << "Warning: Virtual textures: page table is full, " << job.imageName << " is left out." << std::endl;
+		return;
+	}
+	_entryCount = slot.tableOffset + slot.entryCount;
+	slot.pages.assign(slot.entryCount, 0);
+
+	Info info{};
+	info.size = { slot.width, slot.height, slot.levels, 0u };
+	for (uint32_t l = 0; l < slot.levels; l++)
+		info.levelOffsets[l / 4][l % 4] = slot.tableOffset + slot.levelOffsets[l];
+	_infos.push_back(info);
+
+	const int32_t id = static_cast<int32_t>(_slots.size());
+	_slots.push_back(std::move(slot));
+	_slotIds[job.imageName] = id;
+	// the coarsest level is a single page, it comes first and stays
+	requestPage(id, _slots[id].levelOffsets[_slots[id].levels - 1]);
+
+	for (const auto& binding : job.bindings) {
+		if (auto pMaterial = binding.material.lock())
+			pMaterial->changeVirtualTexture(binding.binding, id);
+	}
+}
+
+void VirtualTextures::readFeedback(FrameResources& frame) {
+	// the bits were written the last time this frame was drawn, its fence has signaled since
+	frame.feedback->invalidate();
+	uint32_t* bits = static_cast<uint32_t*>(frame.feedback->getMappedMemory());
+	struct Want {
+		uint32_t level;
+		int32_t slot;
+		uint32_t entry;
+	};
+	std::vector<Want> wants;
+	for (int32_t id = 0; id < static_cast<int32_t>(_slots.size()); id++) {
+		Slot& slot = _slots[id];
+		const uint32_t endWord = (slot.tableOffset + slot.entryCount + 31) / 32;
+		for (uint32_t w = slot.tableOffset / 32; w < endWord; w++) {
+			uint32_t word = bits[w];
+			if (word == 0) continue;
+			bits[w] = 0;
+			for (uint32_t bit = 0; word != 0; bit++, word >>= 1) {
+				if ((word & 1u) == 0) continue;
+				const uint32_t entry = w * 32 + bit - slot.tableOffset;
+				// the page drawn in its place is in use too
+				const uint32_t mapped = _table[slot.tableOffset + entry];
+				if (mapped & RESIDENT)
+					_atlasPages[((mapped >> 10) & 1023u) * _atlasSide + (mapped & 1023u)].lastUsed = _frame;
+				if (slot.pages[entry] == 0) wants.push_back({ entryLevel(slot, entry), id, entry });
+			}
+		}
+	}
+
+	// coarse pages first, they cover more of the screen
+	std::sort(wants.begin(), wants.end(), [](const Want& a, const Want& b) { return a.level > b.level; });
+	for (const auto& want : wants) {
+		if (_loads.size() >= static_cast<size_t>(pagesPerFrame) * 4) break;
+		requestPage(want.slot, want.entry);
+	}
+}
+
+void VirtualTextures::requestPage(int32_t slot, uint32_t entry) {
+	if (_slots[slot].pages[entry] != 0 || !_loading.insert(pageKey(slot, entry)).second) return;
+	auto tiles = _slots[slot].tiles;
+	const size_t offset = sizeof(TileHeader) + entry * PAGE_BYTES;
+	_loads.push_back({ slot, entry, _pagePool.submit([tiles, offset]() {
+		// faulting the mapping in happens here, not on the frame
+		const unsigned char* data = reinterpret_cast<const unsigned char*>(tiles->data()) + offset;
+		return std::vector<unsigned char>(data, data + PAGE_BYTES);
+	}) });
+}
+
+std::vector<VkBufferImageCopy> VirtualTextures::uploadPages(FrameResources& frame) {
+	std::vector<VkBufferImageCopy> regions;
+	const size_t limit = std::min<size_t>(pagesPerFrame, frame.staging->getInstanceCount());
+	for (auto itr = _loads.begin(); itr != _loads.end() && regions.size() < limit;) {
+		if (itr->data.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			itr++;
+			continue;
+		}
+		_loading.erase(pageKey(itr->slot, itr->entry));
+		const std::vector<unsigned char> data = itr->data.get();
+		const int32_t page = findAtlasPage();
+		if (page < 0) {
+			// asked for again once a page frees up
+			_loads.erase(itr++);
+			continue;
+		}
+		AtlasPage& atlasPage = _atlasPages[page];
+		if (atlasPage.slot >= 0) {
+			_slots[atlasPage.slot].pages[atlasPage.entry] = 0;
+			_slots[atlasPage.slot].dirty = true;
+		}
+		atlasPage = { itr->slot, itr->entry, _frame };
+		_slots[itr->slot].pages[itr->entry] = page + 1;
+		_slots[itr->slot].dirty = true;
+
+		const VkDeviceSize offset = regions.size() * PAGE_BYTES;
+		frame.staging->writeToBuffer(const_cast<unsigned char*>(data.data()), PAGE_BYTES, offset);
+		VkBufferImageCopy region{};
+		region.bufferOffset = offset;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = 0;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = {
+			static_cast<int32_t>(page % _atlasSide * PAGE_SIZE),
+			static_cast<int32_t>(page / _atlasSide * PAGE_SIZE),
+			0 };
+		region.imageExtent = { PAGE_SIZE, PAGE_SIZE, 1 };
+		regions.push_back(region);
+		_loads.erase(itr++);
+	}
+	return regions;
+}
+
+int32_t VirtualTextures::findAtlasPage() const {
+	// a free page, else the least recently used one that this frame didn't ask for.
+	// the coarsest pages are never given up
+	int32_t found = -1;
+	for (int32_t i = 0; i < static_cast<int32_t>(_atlasPages.size()); i++) {
+		const AtlasPage& page = _atlasPages[i];
+		if (page.slot < 0) return i;
+		const Slot& slot = _slots[page.slot];
+		if (page.lastUsed >= _frame || page.entry == slot.levelOffsets[slot.levels - 1]) continue;
+		if (found < 0 || page.lastUsed < _atlasPages[found].lastUsed) found = i;
+	}
+	return found;
+}
+
+void VirtualTextures::updateTable(Slot& slot) {
+	// coarse to fine, so a page that isn't resident takes the entry of its parent
+	for (uint32_t level = slot.levels; level-- > 0;) {
+		const uint32_t across = pagesAcross(std::max(slot.width >> level, 1u));
+		const uint32_t down = pagesAcross(std::max(slot.height >> level, 1u));
+		const bool hasParent = level + 1 < slot.levels;
+		const uint32_t parentAcross = hasParent ? pagesAcross(std::max(slot.width >> (level + 1), 1u)) : 0;
+		const uint32_t parentDown = hasParent ? pagesAcross(std::max(slot.height >> (level + 1), 1u)) : 0;
+		for (uint32_t y = 0; y < down; y++) {
+			for (uint32_t x = 0; x < across; x++) {
+				const uint32_t entry = slot.levelOffsets[level] + y * across + x;
+				uint32_t value = 0;
+				if (slot.pages[entry] != 0) {
+					const uint32_t page = slot.pages[entry] - 1;
+					value = RESIDENT | (level << 20) | ((page / _atlasSide) << 10) | (page % _atlasSide);
+				}
+				else if (hasParent) {
+					const uint32_t parent = slot.levelOffsets[level + 1] +
+						std::min(y / 2, parentDown - 1) * parentAcross + std::min(x / 2, parentAcross - 1);
+					value = _table[slot.tableOffset + parent];
+				}
+				_table[slot.tableOffset + entry] = value;
+			}
+		}
+	}
+	slot.dirty = false;
+}
+
+uint32_t VirtualTextures::entryLevel(const Slot& slot, uint32_t entry) const {
+	uint32_t level = 0;
+	while (level + 1 < slot.levels && slot.levelOffsets[level + 1] <= entry) level++;
+	return level;
+}
+
+}
@@ -0,0 +1,171 @@
+#ifndef VIRTUAL_TEXTURE_HPP
+#define VIRTUAL_TEXTURE_HPP
+
+#include "naku.hpp"
+#include "resources/material.hpp"
+#include "resources/texture_streamer.hpp"
+#include "utils/mapped_file.hpp"
+#include "utils/thread_pool.hpp"
+
+#include <atomic>
+#include <unordered_set>
+
+namespace naku {
+
+class Engine;
+
+// software virtual texturing, for texture sets larger than device memory. an image is cooked
+// into a tile file of bordered pages over all its mips, and only the pages the last frames
+// sampled are kept in one atlas image. gbuffer.frag and transparent.frag find them through a
+// page table, falling back to the finest resident level, and set a feedback bit for every page
+// they want. the bits are read back once the frame's fence signals, the missing pages are
+// read from disk on a worker and copied into the atlas at the start of a later frame, in
+// place of the least recently used ones. no sparse residency, so it runs anywhere, lavapipe
+// included. the coarsest page of each image stays resident.
+class VirtualTextures {
+public:
+	// must match virtual_texture.glsl
+	static constexpr uint32_t PAGE_SIZE = 128;
+	static constexpr uint32_t PAGE_BORDER = 4; // texels repeated around a page for filtering
+	static constexpr uint32_t PAGE_PAYLOAD = PAGE_SIZE - 2 * PAGE_BORDER;
+	static constexpr uint32_t MAX_LEVELS = 16;
+	static constexpr uint32_t MAX_SLOTS = 1024;
+	static constexpr uint32_t MAX_ENTRIES = 1 << 20;
+	static constexpr uint32_t VERSION = 1;
+
+	VirtualTextures(Engine& engine);
+	~VirtualTextures();
+	VirtualTextures(const VirtualTextures&) = delete;
+	VirtualTextures& operator=(const VirtualTextures&) = delete;
+
+	// binds the image named imageName to a binding of the material as a virtual texture once
+	// it's decoded and cooked. images that don't decode to 8 bit pixels go to the texture
+	// streamer instead.
+	void request(
+		std::shared_ptr<Material> pMaterial,
+		uint32_t binding,
+		const std::string& textureName,
+		bool anisotropic,
+		const std::string& imageName,
+		TextureStreamer::Decoder decoder);
+	// path of the tile file of rgba8 pixels, cooked first if it isn't cached yet. empty on failure.
+	static std::string cook(const unsigned char* pixels, int width, int height, uint64_t sourceHash);
+
+	// reads the requests back, uploads the pages that arrived and writes the page table of the
+	// frame. records into its command buffer before the first pass.
+	void update(VkCommandBuffer commandBuffer, uint32_t frameIdx);
+	// makes the requests of the frame visible to the host. records after the last pass sampling
+	void cmdEndFrame(VkCommandBuffer commandBuffer);
+	// blocks until every request is bound. pages still come in as they're asked for
+	void finish();
+
+	DescriptorSetLayout& setLayout() const { return *_setLayout; }
+	VkDescriptorSet set(uint32_t frameIdx) const { return _sets[frameIdx]; }
+	size_t pendingCount() const { return _jobs.size(); }
+	uint32_t residentPages() const;
+	uint32_t atlasPages() const { return _atlasSide * _atlasSide; }
+
+	// pages copied into the atlas per frame at most
+	uint32_t pagesPerFrame{ 32 };
+
+private:
+	struct Binding {
+		std::weak_ptr<Material> material;
+		uint32_t binding;
+		std::string textureName;
+		bool anisotropic;
+	};
+
+	// what a worker hands back
+	struct Decoded {
+		std::shared_ptr<TextureStreamer::Payload> payload;
+		std::shared_ptr<MappedFile> tiles;
+	};
+
+	struct Job {
+		std::string imageName;
+		std::vector<Binding> bindings;
+		std::shared_ptr<Decoded> decoded;
+		std::future<bool> done;
+	};
+
+	// a virtual texture
+	struct Slot {
+		std::string imageName;
+		std::shared_ptr<MappedFile> tiles;
+		uint32_t width, height, levels;
+		uint32_t levelOffsets[MAX_LEVELS]; // from tableOffset
+		uint32_t tableOffset, entryCount;
+		std::vector<uint32_t> pages; // atlas page + 1 of each entry, 0 if it isn't resident
+		bool dirty{ true };
+	};
+
+	// gpu side, std430
+	struct Info {
+		glm::uvec4 size; // width, height, levels
+		glm::uvec4 levelOffsets[MAX_LEVELS / 4];
+	};
+
+	struct AtlasPage {
+		int32_t slot{ -1 };
+		uint32_t entry{ 0 };
+		uint64_t lastUsed{ 0 };
+	};
+
+	struct Load {
+		int32_t slot;
+		uint32_t entry;
+		std::future<std::vector<unsigned char>> data;
+	};
+
+	struct FrameResources {
+		std::unique_ptr<Buffer> pageTable;
+		std::unique_ptr<Buffer> infos;
+		std::unique_ptr<Buffer> feedback;
+		std::unique_ptr<Buffer> staging;
+		bool stale{ true }; // page table and infos are behind
+	};
+
+	Engine& _engine;
+	// decoding and cooking take long, page reads have a pool of their own so they never wait on it
+	ThreadPool _pool;
+	ThreadPool _pagePool;
+	std::shared_ptr<std::atomic<bool>> _cancelled;
+	std::list<Job> _jobs;
+	std::vector<Slot> _slots;
+	std::unordered_map<std::string, int32_t> _slotIds;
+	uint32_t _entryCount{ 0 };
+	std::vector<uint32_t> _table;
+	std::vector<Info> _infos;
+
+	std::unique_ptr<DescriptorSetLayout> _setLayout;
+	std::vector<VkDescriptorSet> _sets;
+	std::array<FrameResources, MAX_FRAMES_IN_FLIGHT> _frames;
+	std::shared_ptr<Image2D> _atlas;
+	std::unique_ptr<Texture> _atlasTexture;
+	uint32_t _atlasSide{ 0 };
+	uint32_t _entryCapacity{ 0 };
+	uint32_t _slotCapacity{ 0 };
+	std::vector<AtlasPage> _atlasPages;
+	std::list<Load> _loads;
+	std::unordered_set<uint64_t> _loading;
+	uint64_t _frame{ 0 };
+
+	// recreates the atlas and the buffers, waiting for the device first
+	void allocate(uint32_t atlasSide, uint32_t entryCapacity, uint32_t slotCapacity);
+	void writeSets();
+	bool complete(Job& job);
+	void registerSlot(Job& job);
+	void readFeedback(FrameResources& frame);
+	void requestPage(int32_t slot, uint32_t entry);
+	// copies arrived pages into the atlas, returns the regions to record
+	std::vector<VkBufferImageCopy> uploadPages(FrameResources& frame);
+	// an atlas page to overwrite, -1 if every page is in use
+	int32_t findAtlasPage() const;
+	void updateTable(Slot& slot);
+	uint32_t entryLevel(const Slot& slot, uint32_t entry) const;
+};
+
+}
+
+#endif
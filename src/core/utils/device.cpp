@@ -174,6 +174,31 @@ void Device::createLogicalDevice() {
 	coreFeatures.samplerAnisotropy = VK_TRUE;
 	coreFeatures.independentBlend = VK_TRUE;
 	coreFeatures.imageCubeArray = VK_TRUE;
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(_physicalDevice, &supportedFeatures);
+	textureCompressionBC = supportedFeatures.textureCompressionBC == VK_TRUE;
+	coreFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+	fragmentStoresAndAtomics = supportedFeatures.fragmentStoresAndAtomics == VK_TRUE;
+	coreFeatures.fragmentStoresAndAtomics = supportedFeatures.fragmentStoresAndAtomics;
+
+	// a small host visible window into vram, as discrete gpus have, doesn't count
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &memoryProperties);
+	uint32_t largestHeap = 0;
+	VkDeviceSize largestSize = 0;
+	for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+		if ((memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) &&
+			memoryProperties.memoryHeaps[i].size > largestSize) {
+			largestHeap = i;
+			largestSize = memoryProperties.memoryHeaps[i].size;
+		}
+	}
+	const VkMemoryPropertyFlags unified = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+		if (memoryProperties.memoryTypes[i].heapIndex == largestHeap &&
+			(memoryProperties.memoryTypes[i].propertyFlags & unified) == unified)
+			unifiedMemory = true;
+	}
 	VkPhysicalDeviceExtendedDynamicStateFeaturesEXT dynamicStateFeatures = {};
 	dynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
 	dynamicStateFeatures.extendedDynamicState = true;
@@ -474,4 +499,28 @@ void Device::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
 	vkFreeCommandBuffers(_device, _commandPool, 1, &commandBuffer);
 }
 
+VkFence Device::submitSingleTimeCommands(VkCommandBuffer commandBuffer) {
+	vkEndCommandBuffer(commandBuffer);
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	VkFence fence;
+	if (vkCreateFence(_device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+		throw std::runtime_error("Error: Failed to create fence.");
+	}
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	vkQueueSubmit(_graphicsQueue, 1, &submitInfo, fence);
+	return fence;
+}
+
+void Device::releaseSingleTimeCommands(VkCommandBuffer commandBuffer, VkFence fence) {
+	vkDestroyFence(_device, fence, nullptr);
+	vkFreeCommandBuffers(_device, _commandPool, 1, &commandBuffer);
+}
+
 }  // namespace naku
\ No newline at end of file
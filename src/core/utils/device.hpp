@@ -6,6 +6,8 @@
 
 namespace naku {
 
+class UploadBatch;
+
 struct SwapChainSupportDetails {
 	VkSurfaceCapabilitiesKHR capabilities;
 	std::vector<VkSurfaceFormatKHR> formats;
@@ -66,8 +68,21 @@ public:
 
 	VkCommandBuffer beginSingleTimeCommands();
 	void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+	// submits without waiting for the queue. once the returned fence signals the commands are
+	// done, and releaseSingleTimeCommands frees them with the fence.
+	VkFence submitSingleTimeCommands(VkCommandBuffer commandBuffer);
+	void releaseSingleTimeCommands(VkCommandBuffer commandBuffer, VkFence fence);
 
 	VkPhysicalDeviceProperties properties;
+	// BC1-BC7 can be sampled, enabled when the device supports it
+	bool textureCompressionBC{ false };
+	// fragment shaders may write storage buffers, which virtual texture feedback needs
+	bool fragmentStoresAndAtomics{ false };
+	// the largest device local heap is host visible too, as on integrated gpus and lavapipe.
+	// uploads then write device memory directly instead of copying through a staging buffer
+	bool unifiedMemory{ false };
+	// while one is open, device local buffers are filled through it instead of a submit each
+	UploadBatch* uploadBatch{ nullptr };
 
 private:
 	void createInstance();
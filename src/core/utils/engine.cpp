@@ -8,6 +8,14 @@
 #include "render_systems/present_renderer.hpp"
 #include "render_systems/transparent_renderer.hpp"
 #include "render_systems/shadowmap_renderer.hpp"
+#include "resources/environment.hpp"
+#include "resources/gltf_parser.hpp"
+#include "resources/hdr_decoder.hpp"
+#include "resources/mesh_cache.hpp"
+#include "resources/texture_streamer.hpp"
+#include "resources/virtual_texture.hpp"
+#include "utils/mapped_file.hpp"
+#include "utils/thread_pool.hpp"
 
 #include <vector>
 #include <chrono>
@@ -23,10 +31,35 @@ Engine::Engine(uint32_t w, uint32_t h, std::string w_name, float dpi) {
 	prepareResources();
 	prepareDescriptorPool();
 	prepareUbos();
+	pTextureStreamer = std::make_unique<TextureStreamer>(*this);
+	pVirtualTextures = std::make_unique<VirtualTextures>(*this);
+	pEnvironment = std::make_shared<Environment>(*this);
 }
 
 Engine::~Engine() {}
 
+bool Engine::loadEnvironment(const std::string& filePath) {
+	try {
+		pEnvironment = std::make_shared<Environment>(*this, filePath);
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return false;
+	}
+	globalUbo.environmentMap.y = static_cast<float>(pEnvironment->levels() - 1);
+	globalUbo.environmentMap.z = 1.f;
+	memcpy(globalUbo.sh, pEnvironment->sh(), sizeof(globalUbo.sh));
+	return true;
+}
+
+void Engine::resetEnvironment() {
+	if (!pEnvironment->loaded()) return;
+	pEnvironment = std::make_shared<Environment>(*this);
+	globalUbo.environmentMap.y = static_cast<float>(pEnvironment->levels() - 1);
+	globalUbo.environmentMap.z = 0.f;
+	memcpy(globalUbo.sh, pEnvironment->sh(), sizeof(globalUbo.sh));
+}
+
 void Engine::prepareResources() {
 	resources.addResource<Image2D>();
 	resources.addResource<Model>();
@@ -35,6 +68,7 @@ void Engine::prepareResources() {
 	resources.addResource<Object>();
 	resources.addResource<Camera>();
 	resources.addResource<Light>();
+	resources.getResource<Object>().reuseIds = true;
 
 	resources.createCollect<Shader, Material>();
 	resources.createCollect<Material, Object>();
@@ -144,7 +178,7 @@ void Engine::arrangeLights() {
 
 	//TODO: avoid clearing map every frame
 	lightMap.clear();
-	for (ResId id = 0; id < Lights.size(); id++) {
+	for (ResId id = 0; id < Lights.idCount(); id++) {
 		if (!Lights.exist(id)) continue;
 		auto light = Lights[id];
 		lightMap.emplace(light->importance, light);
@@ -194,12 +228,9 @@ int Engine::run() {
 	// lock the up direction when looking around
 	globalUp = pMainCamera->upDir();
 	// update and write all transforms
-	Object::changedObjects.clear();
-	for (ResId id = 0; id < resources.getResource<Object>().size(); id++) {
-		auto obj = resources.get<Object>(id);
-		obj->update();
-		obj->writeToObjectBuffer();
-	}
+	for (ResId id = 0; id < resources.idCount<Object>(); id++)
+		if (resources.exist<Object>(id)) resources.get<Object>(id)->update();
+	writeObjects();
 
 	//renderer.createRenderer(renderer.gbufferRenderer, *renderer.gbufferPass, 0);
 	//renderer.createRenderer(renderer.presentRenderer, *renderer.gbufferPass, 1);
@@ -218,6 +249,7 @@ int Engine::run() {
 		runningTime = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - r_start).count();
 
 		glfwPollEvents();
+		if (onFrame) onFrame();
 
 		if (auto commandBuffer = renderer.beginFrame()) {
 			frameIdx = renderer.getFrameIndex();
@@ -238,6 +270,8 @@ int Engine::run() {
 				}
 				else itr++;
 			}
+			pTextureStreamer->update();
+			pVirtualTextures->update(commandBuffer, frameIdx);
 
 			setupGUI(guiSystem);
 
@@ -246,6 +280,11 @@ int Engine::run() {
 				for (auto pair = Object::changedObjects.begin(); pair != Object::changedObjects.end();) {
 					auto& id = pair->first;
 					auto obj = resources.get<Object>(id);
+					// removed since it changed
+					if (!obj) {
+						Object::changedObjects.erase(pair++);
+						continue;
+					}
 					obj->writeToObjectBuffer(frameIdx);
 					if (Object::changedObjects[id] <= 0) {
 						Object::changedObjects.erase(pair++);
@@ -305,6 +344,7 @@ int Engine::run() {
 				renderer.transparentRenderer->render(frameInfo, *it->second);
 			}
 			renderer.endRenderPass(commandBuffer);
+			pVirtualTextures->cmdEndFrame(commandBuffer);
 			renderer.beginRenderPass(commandBuffer, *renderer.postPass, !showGUI, false);
 			renderer.presentRenderer->render(frameInfo, alpha, gamma, presentAttachment);
 
@@ -334,6 +374,37 @@ int Engine::run() {
 
 namespace naku { //resources
 
+namespace {
+
+// 0 if the file can't be read, which turns sharing off for it
+uint64_t hashFile(const std::string& filePath, uint64_t seed = 0) {
+	try {
+		return MappedFile{ filePath }.hash(seed);
+	}
+	catch (const std::exception&) {
+		return 0;
+	}
+}
+
+uint64_t hashModelOptions(const ModelOptions& options, uint64_t seed) {
+	const uint32_t values[3]{ static_cast<uint32_t>(options.vertexFormat), options.optimize, options.lodCount };
+	return hashMemory(values, sizeof(values), seed);
+}
+
+}
+
+template<typename T>
+std::shared_ptr<T> Engine::findSharedContent(const std::string& name, uint64_t hash) {
+	if (hash == 0) return nullptr;
+	ResId id = resources.findContent<T>(hash);
+	if (id == ERROR_RES_ID || resources.alias<T>(name, id) == ERROR_RES_ID) return nullptr;
+	auto p = resources.get<T>(id);
+	sharedContent.bytes += p->memorySize();
+	return p;
+}
+
+template std::shared_ptr<Image2D> Engine::findSharedContent<Image2D>(const std::string& name, uint64_t hash);
+
 std::shared_ptr<Image2D> Engine::createImage(const std::string& filePath) {
 	auto name = getFileName(filePath);
 	return createImage(name, filePath);
@@ -344,10 +415,17 @@ std::shared_ptr<Image2D> Engine::createImage(const std::string& name, const std:
 		std::cerr << "Warning: Image " << name << " already exists." << std::endl;
 		return resources.get<Image2D>(name);
 	}
+	const uint64_t hash = hashFile(filePath);
+	if (auto shared = findSharedContent<Image2D>(name, hash)) {
+		sharedContent.images++;
+		return shared;
+	}
 	try {
 		auto p = Image2D::loadImageFromFile(*pDevice, name, filePath);
+		if (!p) return nullptr;
 		ResId id = resources.push<Image2D>(name, p);
 		p->setId(id);
+		resources.setContent<Image2D>(id, hash);
 		return resources.get<Image2D>(id);
 	}
 	catch (const std::exception& e) {
@@ -356,6 +434,56 @@ std::shared_ptr<Image2D> Engine::createImage(const std::string& name, const std:
 	}
 }
 
+std::shared_ptr<Image2D> Engine::createImage(const std::string& name, const void* pixels, int width, int height, int channels) {
+	if (resources.exist<Image2D>(name)) {
+		std::cerr << "Warning: Image " << name << " already exists." << std::endl;
+		return resources.get<Image2D>(name);
+	}
+	const uint64_t hash = hashMemory(pixels, static_cast<size_t>(width) * height * channels, channels);
+	if (auto shared = findSharedContent<Image2D>(name, hash)) {
+		sharedContent.images++;
+		return shared;
+	}
+	try {
+		auto p = Image2D::loadImageFromPixels(*pDevice, name, pixels, width, height, channels);
+		ResId id = resources.push<Image2D>(name, p);
+		p->setId(id);
+		resources.setContent<Image2D>(id, hash);
+		return resources.get<Image2D>(id);
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Error: Cannot load Image " << name << std::endl;
+		return nullptr;
+	}
+}
+
+std::shared_ptr<Image2D> Engine::createImage(const std::string& name, const std::string& filePath, TextureUsage usage) {
+	// hdr images keep their range in half floats rather than be squeezed into 8 bit blocks
+	if (!compressTextures || !pDevice->textureCompressionBC || strEndWith(filePath, ".ktx2") || HdrDecoder::isHdr(filePath))
+		return createImage(name, filePath);
+	if (resources.exist<Image2D>(name)) {
+		std::cerr << "Warning: Image " << name << " already exists." << std::endl;
+		return resources.get<Image2D>(name);
+	}
+	// the same file cooked for another usage is another payload
+	const uint32_t usageKey = static_cast<uint32_t>(usage);
+	const uint64_t sourceHash = hashFile(filePath);
+	const uint64_t hash = sourceHash == 0 ? 0 : hashMemory(&usageKey, sizeof(usageKey), sourceHash);
+	if (auto shared = findSharedContent<Image2D>(name, hash)) {
+		sharedContent.images++;
+		return shared;
+	}
+	std::string cookedPath = TextureCooker::cook(filePath, usage);
+	std::shared_ptr<Image2D> p;
+	if (!cookedPath.empty()) p = Image2D::loadImageFromKtx2(*pDevice, name, cookedPath);
+	// the source still loads if cooking fails
+	if (!p) return createImage(name, filePath);
+	ResId id = resources.push<Image2D>(name, p);
+	p->setId(id);
+	resources.setContent<Image2D>(id, hash);
+	return resources.get<Image2D>(id);
+}
+
 std::shared_ptr<Shader> Engine::createShader(
 	const std::string& filePath,
 	VkShaderStageFlagBits stage) {
@@ -399,13 +527,14 @@ std::shared_ptr<Object> Engine::createObject(const std::string& name, Object::Ty
 		std::cerr << "Warning: Object " << name << " already exists." << std::endl;
 		return resources.get<Object>(name);
 	}
+	// ids index the transform buffers, removed ones are taken again before new ones
 	if (resources.size<Object>() >= MAX_OBJECT_NUM) {
 		throw std::runtime_error("Error: Failed to create object. Objects' number reach the limit.");
 	}
 	auto pObject = std::make_shared<Object>(*pDevice, name, type);
 	ResId id = resources.push<Object>(name, pObject);
 	pObject->setId(id);
-	pObject->writeToObjectBuffer();
+	if (!deferObjectWrites) pObject->writeToObjectBuffer();
 	return pObject;
 }
 
@@ -464,7 +593,7 @@ std::shared_ptr<Light> Engine::createLight(const std::string& name, Light::Type
 	pLight->setObjId(objId);
 	ResId lightId = resources.push<Light>(name, pLight);
 	pLight->setId(lightId);
-	pLight->writeToObjectBuffer();
+	if (!deferObjectWrites) pLight->writeToObjectBuffer();
 	return pLight;
 }
 
@@ -473,23 +602,212 @@ std::shared_ptr<Model> Engine::createModel(const std::string& name, const Mesh&
 		std::cerr << "Warning: Model " << name << " already exists." << std::endl;
 		return resources.get<Model>(name);
 	}
-	auto pModel = std::make_shared<Model>(*pDevice, name, Mesh);
+	auto pModel = std::make_shared<Model>(*pDevice, name, Mesh, modelOptions);
 	ResId id = resources.push<Model>(name, pModel);
 	pModel->setId(id);
 	return pModel;
 }
 
 std::shared_ptr<Model> Engine::createModel(const std::string& name, const std::string objFilePath) {
+	auto pending = requestModel(name, objFilePath);
+	return finishModel(pending);
+}
+
+std::shared_ptr<Model> Engine::createModel(const std::string& name, const GltfData& gltf, uint32_t mesh, uint32_t primitive) {
+	auto pending = requestModel(name, gltf, mesh, primitive);
+	return finishModel(pending);
+}
+
+namespace {
+
+// workers may only fill buffers through an upload batch, the queue is the main thread's
+template<typename F>
+std::shared_future<std::shared_ptr<Model>> startLoading(Device& device, F&& load) {
+	if (device.uploadBatch)
+		return ThreadPool::shared().submit(std::forward<F>(load)).share();
+	std::promise<std::shared_ptr<Model>> loaded;
+	loaded.set_value(load());
+	return loaded.get_future().share();
+}
+
+}
+
+Engine::PendingModel Engine::requestModel(const std::string& name, const std::string& objFilePath) {
+	PendingModel pending{ name };
+	if (resources.exist<Model>(name)) {
+		std::cerr << "Warning: Model " << name << " already exists." << std::endl;
+		pending.pModel = resources.get<Model>(name);
+		return pending;
+	}
+	const uint64_t sourceHash = hashFile(objFilePath);
+	pending.hash = sourceHash == 0 ? 0 : hashModelOptions(modelOptions, sourceHash);
+	if ((pending.pModel = findSharedContent<Model>(name, pending.hash))) {
+		sharedContent.models++;
+		return pending;
+	}
+	if (pending.hash != 0 && MapHas(loadingModels, pending.hash)) {
+		pending.loading = loadingModels[pending.hash];
+		return pending;
+	}
+	pending.loading = startLoading(*pDevice, [pDevice = pDevice.get(), name, objFilePath, options = modelOptions]() {
+		return std::make_shared<Model>(*pDevice, name, objFilePath, options);
+	});
+	if (pending.hash != 0) loadingModels[pending.hash] = pending.loading;
+	return pending;
+}
+
+Engine::PendingModel Engine::requestModel(const std::string& name, const GltfData& gltf, uint32_t mesh, uint32_t primitive) {
+	PendingModel pending{ name };
+	if (resources.exist<Model>(name)) {
+		std::cerr << "Warning: Model " << name << " already exists." << std::endl;
+		pending.pModel = resources.get<Model>(name);
+		return pending;
+	}
+	const uint32_t key[2]{ mesh, primitive };
+	pending.hash = hashModelOptions(modelOptions, hashMemory(key, sizeof(key), gltf.hash));
+	if ((pending.pModel = findSharedContent<Model>(name, pending.hash))) {
+		sharedContent.models++;
+		return pending;
+	}
+	if (MapHas(loadingModels, pending.hash)) {
+		pending.loading = loadingModels[pending.hash];
+		return pending;
+	}
+	pending.loading = startLoading(*pDevice, [pDevice = pDevice.get(), name, &gltf, mesh, primitive, options = modelOptions]() {
+		return std::make_shared<Model>(*pDevice, name, gltf, mesh, primitive, options);
+	});
+	loadingModels[pending.hash] = pending.loading;
+	return pending;
+}
+
+std::shared_ptr<Model> Engine::finishModel(PendingModel& pending) {
+	if (pending.pModel) return pending.pModel;
+	// the first request of a content registers it, the others become names of it
+	if ((pending.pModel = findSharedContent<Model>(pending.name, pending.hash))) {
+		sharedContent.models++;
+		return pending.pModel;
+	}
+	std::shared_ptr<Model> pModel;
+	try {
+		pModel = pending.loading.get();
+	}
+	catch (...) {
+		loadingModels.erase(pending.hash);
+		throw;
+	}
+	loadingModels.erase(pending.hash);
+	if (resources.exist<Model>(pending.name)) {
+		std::cerr << "Warning: Model " << pending.name << " already exists." << std::endl;
+		return pending.pModel = resources.get<Model>(pending.name);
+	}
+	ResId id = resources.push<Model>(pending.name, pModel);
+	pModel->setId(id);
+	resources.setContent<Model>(id, pending.hash);
+	return pending.pModel = pModel;
+}
+
+std::shared_ptr<Model> Engine::createModel(const std::string& name, const MeshCache& cache) {
 	if (resources.exist<Model>(name)) {
 		std::cerr << "Warning: Model " << name << " already exists." << std::endl;
 		return resources.get<Model>(name);
 	}
-	auto pModel = std::make_shared<naku::Model>(*pDevice, name, objFilePath);
+	const uint64_t hash = hashModelOptions(modelOptions, cache.key());
+	if (auto shared = findSharedContent<Model>(name, hash)) {
+		sharedContent.models++;
+		return shared;
+	}
+	auto pModel = std::make_shared<Model>(*pDevice, name, cache, modelOptions);
 	ResId id = resources.push<Model>(name, pModel);
 	pModel->setId(id);
+	resources.setContent<Model>(id, hash);
 	return pModel;
 }
 
+void Engine::writeObjects() {
+	auto& objects = resources.getResource<Object>();
+	Object::writeAllToObjectBuffers(objects.idCount());
+	// quantized models fold their dequantization into the copy, those are written again
+	for (ResId id = 0; id < objects.idCount(); id++) {
+		if (!objects.exist(id)) continue;
+		auto pObject = objects[id];
+		if (pObject->model && pObject->model->vertexFormat() == VertexFormat::QUANTIZED)
+			pObject->writeToObjectBuffer();
+	}
+	Object::changedObjects.clear();
+}
+
+void Engine::removeObject(const std::shared_ptr<Object>& pObject) {
+	const ResId id = pObject->Object::id();
+	if (resources.get<Object>(id) != pObject) return;
+	transparents.erase(id);
+	Object::changedObjects.erase(id);
+	resources.removeItem<Object>(id);
+	pObject->detachModelInfo();
+	addGarbage(pObject);
+}
+
+void Engine::removeLight(const std::shared_ptr<Light>& pLight) {
+	if (resources.get<Light>(pLight->id()) != pLight) return;
+	resources.removeItem<Light>(pLight->id());
+	removeObject(pLight);
+}
+
+void Engine::removeCamera(const std::shared_ptr<Camera>& pCamera) {
+	if (resources.get<Camera>(pCamera->id()) != pCamera) return;
+	resources.removeItem<Camera>(pCamera->id());
+	removeObject(pCamera);
+}
+
+void Engine::removeMaterial(const std::shared_ptr<Material>& pMaterial) {
+	if (resources.get<Material>(pMaterial->id()) != pMaterial) return;
+	for (size_t binding = 0; binding < static_cast<size_t>(MaterialTextures::SIZE); binding++) {
+		auto pTex = pMaterial->texture(binding);
+		if (pTex && pTex->image() && pTex->image() != Material::DefaultTexutreImage)
+			unsampledImages.emplace(pTex->image()->id(), pTex->image());
+	}
+	resources.removeItem<Material>(pMaterial->id());
+	addGarbage(pMaterial);
+}
+
+Engine::FreedContent Engine::freeUnused() {
+	FreedContent freed;
+	for (ResId id : resources.unused<Material>()) {
+		removeMaterial(resources.get<Material>(id));
+		freed.materials++;
+	}
+
+	for (ResId id : resources.unused<Model>()) {
+		auto pModel = resources.get<Model>(id);
+		freed.bytes += pModel->memorySize();
+		resources.removeItem<Model>(id);
+		addGarbage(pModel);
+		freed.models++;
+	}
+
+	// the images stay while any material left samples them, the next scene's included. that
+	// covers materials scenes removed themselves, replaced by one of the same name
+	auto images = std::move(unsampledImages);
+	unsampledImages.clear();
+	if (images.empty()) return freed;
+	auto& materials = resources.getResource<Material>();
+	for (ResId id = 0; id < materials.idCount(); id++) {
+		if (!materials.exist(id)) continue;
+		auto pMaterial = materials[id];
+		for (size_t binding = 0; binding < static_cast<size_t>(MaterialTextures::SIZE); binding++) {
+			auto pTex = pMaterial->texture(binding);
+			if (pTex && pTex->image()) images.erase(pTex->image()->id());
+		}
+	}
+	for (auto& pair : images) {
+		if (resources.get<Image2D>(pair.first) != pair.second) continue;
+		freed.bytes += pair.second->memorySize();
+		resources.removeItem<Image2D>(pair.first);
+		addGarbage(pair.second);
+		freed.images++;
+	}
+	return freed;
+}
+
 bool Engine::changeMaterial(ResId objId, ResId mtlId) {
 	if (!resources.exist<Material>(mtlId)) {
 		std::cerr << "Error: Failed to change material. Material doesn't exist." << std::endl;
@@ -8,6 +8,10 @@
 #include "resources/object.hpp"
 #include "resources/camera.hpp"
 #include "resources/light.hpp"
+#include "resources/texture_cooker.hpp"
+
+#include <future>
+#include <functional>
 
 namespace naku {
 
@@ -25,6 +29,8 @@ struct GlobalUbo { // ubo1
 	alignas(16) glm::vec3 camDir{ 1.f };
 	alignas(16) glm::vec3 clearColor{ 0.192f, 0.302f, 0.476f };
 	alignas(16) glm::vec4 environment{ 1.0f, 1.0f, 1.0f, 0.1f };
+	alignas(16) glm::vec4 environmentMap{ 1.f, 0.f, 0.f, 0.f }; // intensity, coarsest level, 1 if one is loaded
+	alignas(16) glm::vec4 sh[9]{}; // irradiance over pi of the environment map
 };
 
 struct LightUbo {
@@ -34,6 +40,9 @@ struct LightUbo {
 
 extern class GUI;
 extern class Renderer;
+class TextureStreamer;
+class VirtualTextures;
+class Environment;
 
 class Engine {
 // in order to ease the control of the engine, this class contains no privates
@@ -74,6 +83,9 @@ public:
 	// resources
 		std::shared_ptr<Image2D> createImage(const std::string& name, const std::string& filePath);
 		std::shared_ptr<Image2D> createImage(const std::string& filePath);
+		std::shared_ptr<Image2D> createImage(const std::string& name, const void* pixels, int width, int height, int channels);
+		// cooks the file into a block compressed ktx2 first when compressTextures is on
+		std::shared_ptr<Image2D> createImage(const std::string& name, const std::string& filePath, TextureUsage usage);
 		std::shared_ptr<Object> createObject(const std::string& name, Object::Type type);
 		std::shared_ptr<Light> createLight(const std::string& name, Light::Type type);
 		std::shared_ptr<Camera> createCamera(const std::string& name);
@@ -82,6 +94,24 @@ public:
 		uint32_t pointOffset{ 0 }, spotOffset{ 0 }, directionalOffset{ 0 };
 		std::shared_ptr<Model> createModel(const std::string& name, const Mesh & Mesh);
 		std::shared_ptr<Model> createModel(const std::string& name, const std::string objFilePath);
+		std::shared_ptr<Model> createModel(const std::string& name, const GltfData& gltf, uint32_t mesh, uint32_t primitive);
+		// a processed mesh, shared by the key of the cache
+		std::shared_ptr<Model> createModel(const std::string& name, const MeshCache& cache);
+		// createModel in two steps, so many models load at once. request finds a model with the
+		// same content or starts loading one, on the thread pool while an upload batch is open
+		// and in place otherwise. finish waits for it and registers it. both on the main thread
+		struct PendingModel {
+			std::string name;
+			uint64_t hash{ 0 };
+			std::shared_ptr<Model> pModel{ nullptr }; // shared, nothing to wait for
+			std::shared_future<std::shared_ptr<Model>> loading{};
+		};
+		PendingModel requestModel(const std::string& name, const std::string& objFilePath);
+		// gltf must stay alive until the request is finished
+		PendingModel requestModel(const std::string& name, const GltfData& gltf, uint32_t mesh, uint32_t primitive);
+		std::shared_ptr<Model> finishModel(PendingModel& pending);
+		// loads by content hash, requests of the same content wait for the same one
+		std::unordered_map<uint64_t, std::shared_future<std::shared_ptr<Model>>> loadingModels;
 		std::shared_ptr<Shader> createShader(
 			const std::string& name,
 			const std::string & filePath,
@@ -95,9 +125,46 @@ public:
 			std::shared_ptr<Shader> pVertShader,
 			std::shared_ptr<Shader> pFragShader);
 
+		// images and models with the same content as a loaded one are registered as another
+		// name of it instead of being loaded again. this counts what that saved.
+		struct SharedContent {
+			uint32_t images{ 0 };
+			uint32_t models{ 0 };
+			VkDeviceSize bytes{ 0 };
+		} sharedContent;
+		// the resource already holding content of this hash, now also known as name. null if none.
+		template<typename T>
+		std::shared_ptr<T> findSharedContent(const std::string& name, uint64_t hash);
+
+		// take resources out of the scene. frames in flight may still draw them, they're
+		// destroyed once those are done. objects using a material need another one first
+		void removeObject(const std::shared_ptr<Object>& pObject);
+		void removeLight(const std::shared_ptr<Light>& pLight);
+		void removeCamera(const std::shared_ptr<Camera>& pCamera);
+		// its images are left for freeUnused to check
+		void removeMaterial(const std::shared_ptr<Material>& pMaterial);
+		// images of removed materials, by id, until freeUnused looks at them
+		std::unordered_map<ResId, std::shared_ptr<Image2D>> unsampledImages;
+
+		// scenes hold the models and materials they use. freeUnused removes the ones no scene
+		// holds anymore, then the images that no material samples since, and counts them
+		struct FreedContent {
+			uint32_t models{ 0 };
+			uint32_t materials{ 0 };
+			uint32_t images{ 0 };
+			VkDeviceSize bytes{ 0 };
+		};
+		FreedContent freeUnused();
+
 		bool changeMaterial(ResId objId, ResId mtlId);
 		void changeMaterial(std::shared_ptr<Object> object, std::shared_ptr<Material> material);
 
+		// while set, created objects aren't written into the frame buffers one by one.
+		// whoever sets it calls writeObjects once done
+		bool deferObjectWrites{ false };
+		// writes the transforms of every object into all frame buffers in one copy each
+		void writeObjects();
+
 	int run();
 	void prepareUbos();
 	void prepareDescriptorPool();
@@ -137,8 +204,37 @@ public:
 	float alpha{ 1.0f };
 	float gamma{ 1.0f };
 	int presentAttachment{ 0 };
+	// processing of models created from now on. the packed vertex formats need the *_packed.vert shaders
+	ModelOptions modelOptions{ VertexFormat::FULL, true, 4 };
+	// largest error in pixels a level of detail may show on screen
+	float lodThreshold{ 1.f };
+	// shadow passes draw this many levels coarser than the main view would
+	uint32_t shadowLodBias{ 1 };
+	// textures loaded with a usage are cooked to BC4/BC5/BC7, if the device can sample them
+	bool compressTextures{ true };
+	// scene textures load in the background while frames are drawn. off, loading waits for them
+	bool streamTextures{ true };
+	// bytes of device memory images may take before streamed ones lose their finest mips. 0 for no limit
+	VkDeviceSize textureBudget{ 0 };
+	std::unique_ptr<TextureStreamer> pTextureStreamer;
+	// scene textures are sampled through a page table from one atlas holding only the pages
+	// drawn lately, for texture sets larger than device memory. needs fragmentStoresAndAtomics
+	bool virtualTexturing{ false };
+	// pages across the virtual texture atlas, of VirtualTextures::PAGE_SIZE texels each
+	uint32_t virtualTexturePages{ 32 };
+	std::unique_ptr<VirtualTextures> pVirtualTextures;
+	// image based lighting, one that lights nothing until a map is loaded. the opaque pass holds
+	// on to a replaced one until none of its frames sample it anymore
+	std::shared_ptr<Environment> pEnvironment;
+	// bakes or reads the lighting of a panorama from the cache. returns false and keeps the
+	// current one if the map can't be loaded
+	bool loadEnvironment(const std::string& filePath);
+	// back to the environment that lights nothing
+	void resetEnvironment();
 
 	bool showGUI{ true };
+	// called by run at the start of every frame, before anything is recorded
+	std::function<void()> onFrame;
 	
 };
 
@@ -0,0 +1,91 @@
+#include "utils/mapped_file.hpp"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace naku {
+
+MappedFile::MappedFile(const std::string& filePath) : _filePath{ filePath } {
+#if defined(_WIN32)
+	HANDLE file = CreateFileW(
+		u8str2wstr(filePath).c_str(),
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+		nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("failed to open file: " + filePath);
+	}
+	_file = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) {
+		CloseHandle(file);
+		throw std::runtime_error("failed to get file size: " + filePath);
+	}
+	_size = static_cast<size_t>(size.QuadPart);
+	// an empty file can't be mapped
+	if (_size == 0) return;
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		CloseHandle(file);
+		throw std::runtime_error("failed to map file: " + filePath);
+	}
+	_mapping = mapping;
+	_data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (_data == nullptr) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		throw std::runtime_error("failed to map file: " + filePath);
+	}
+#else
+	_fd = open(filePath.c_str(), O_RDONLY);
+	if (_fd < 0) {
+		throw std::runtime_error("failed to open file: " + filePath);
+	}
+	struct stat st;
+	if (fstat(_fd, &st) != 0) {
+		close(_fd);
+		throw std::runtime_error("failed to get file size: " + filePath);
+	}
+	_size = static_cast<size_t>(st.st_size);
+	// an empty file can't be mapped
+	if (_size == 0) return;
+
+	void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+	if (data == MAP_FAILED) {
+		close(_fd);
+		throw std::runtime_error("failed to map file: " + filePath);
+	}
+	madvise(data, _size, MADV_SEQUENTIAL);
+	_data = static_cast<const char*>(data);
+#endif
+}
+
+MappedFile::~MappedFile() {
+#if defined(_WIN32)
+	if (_data) UnmapViewOfFile(_data);
+	if (_mapping) CloseHandle(_mapping);
+	if (_file) CloseHandle(_file);
+#else
+	if (_data) munmap(const_cast<char*>(_data), _size);
+	if (_fd >= 0) close(_fd);
+#endif
+}
+
+}
@@ -0,0 +1,37 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include "naku.hpp"
+
+namespace naku {
+
+// read-only memory mapping of a whole file
+class MappedFile {
+public:
+	MappedFile(const std::string& filePath);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const char* data() const { return _data; }
+	size_t size() const { return _size; }
+	std::string filePath() const { return _filePath; }
+
+	uint64_t hash(uint64_t seed = 0) const { return hashMemory(_data, _size, seed); }
+
+private:
+	std::string _filePath;
+	const char* _data{ nullptr };
+	size_t _size{ 0 };
+
+#if defined(_WIN32)
+	void* _file{ nullptr };
+	void* _mapping{ nullptr };
+#else
+	int _fd{ -1 };
+#endif
+};
+
+}
+
+#endif
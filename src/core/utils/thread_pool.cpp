@@ -0,0 +1,89 @@
+#include "utils/thread_pool.hpp"
+
+#include <algorithm>
+
+namespace naku {
+
+static thread_local bool tl_isWorkerThread = false;
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+	if (threadCount == 0) {
+		threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	_workers.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; i++) {
+		_workers.emplace_back([this]() { workerLoop(); });
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock{ _mutex };
+		_stop = true;
+	}
+	_condition.notify_all();
+	for (auto& worker : _workers) {
+		worker.join();
+	}
+}
+
+ThreadPool& ThreadPool::shared() {
+	static ThreadPool pool{};
+	return pool;
+}
+
+bool ThreadPool::isWorkerThread() {
+	return tl_isWorkerThread;
+}
+
+void ThreadPool::workerLoop() {
+	tl_isWorkerThread = true;
+	while (true) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock{ _mutex };
+			_condition.wait(lock, [this]() { return _stop || !_tasks.empty(); });
+			if (_stop && _tasks.empty()) return;
+			task = std::move(_tasks.front());
+			_tasks.pop_front();
+		}
+		task();
+	}
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t, size_t)>& func, size_t minRangeSize) {
+	if (count == 0) return;
+	minRangeSize = std::max<size_t>(minRangeSize, 1);
+	size_t rangeCount = std::min<size_t>(threadCount(), (count + minRangeSize - 1) / minRangeSize);
+	if (rangeCount <= 1 || isWorkerThread()) {
+		func(0, count);
+		return;
+	}
+
+	const size_t rangeSize = (count + rangeCount - 1) / rangeCount;
+	std::vector<std::future<void>> futures;
+	futures.reserve(rangeCount);
+	// the calling thread takes the first range itself
+	for (size_t begin = rangeSize; begin < count; begin += rangeSize) {
+		size_t end = std::min(begin + rangeSize, count);
+		futures.push_back(submit([&func, begin, end]() { func(begin, end); }));
+	}
+	std::exception_ptr error;
+	try {
+		func(0, std::min(rangeSize, count));
+	}
+	catch (...) {
+		error = std::current_exception();
+	}
+	for (auto& future : futures) {
+		try {
+			future.get();
+		}
+		catch (...) {
+			if (!error) error = std::current_exception();
+		}
+	}
+	if (error) std::rethrow_exception(error);
+}
+
+}
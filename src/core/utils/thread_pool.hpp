@@ -0,0 +1,63 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include "naku.hpp"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <deque>
+
+namespace naku {
+
+// fixed size pool of worker threads for cpu side asset processing.
+// work submitted from inside a worker runs inline, so nested parallelFor
+// calls can't deadlock the pool.
+class ThreadPool {
+public:
+	ThreadPool(uint32_t threadCount = 0);
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	static ThreadPool& shared();
+
+	uint32_t threadCount() const { return static_cast<uint32_t>(_workers.size()); }
+	static bool isWorkerThread();
+
+	template<typename F>
+	auto submit(F&& func) -> std::future<decltype(func())> {
+		using R = decltype(func());
+		auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(func));
+		std::future<R> future = task->get_future();
+		if (isWorkerThread()) {
+			(*task)();
+			return future;
+		}
+		{
+			std::lock_guard<std::mutex> lock{ _mutex };
+			_tasks.emplace_back([task]() { (*task)(); });
+		}
+		_condition.notify_one();
+		return future;
+	}
+
+	// splits [0, count) into contiguous ranges and calls func(begin, end) on each of them.
+	// blocks until every range is done. exceptions thrown by func are rethrown here.
+	void parallelFor(size_t count, const std::function<void(size_t, size_t)>& func, size_t minRangeSize = 1);
+
+private:
+	void workerLoop();
+
+	std::vector<std::thread> _workers;
+	std::deque<std::function<void()>> _tasks;
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	bool _stop{ false };
+};
+
+}
+
+#endif
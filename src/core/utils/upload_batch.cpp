@@ -0,0 +1,62 @@
+#include "utils/upload_batch.hpp"
+
+namespace naku {
+
+UploadBatch::UploadBatch(Device& device) : _device{ device }, _previous{ device.uploadBatch } {
+	_device.uploadBatch = this;
+}
+
+UploadBatch::~UploadBatch() {
+	submit();
+	_device.uploadBatch = _previous;
+}
+
+void UploadBatch::upload(const Buffer& dst, const void* data, VkDeviceSize size) {
+	if (size == 0) return;
+	Buffer* block;
+	VkDeviceSize offset;
+	{
+		std::lock_guard<std::mutex> lock{ _mutex };
+		if (size > BLOCK_SIZE) {
+			_blocks.push_back(std::make_unique<Buffer>(
+				_device, size, 1, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+			block = _blocks.back().get();
+			offset = 0;
+		}
+		else {
+			offset = (_currentUsed + 15) & ~VkDeviceSize{ 15 };
+			if (!_current || offset + size > BLOCK_SIZE) {
+				_blocks.push_back(std::make_unique<Buffer>(
+					_device, BLOCK_SIZE, 1, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+					VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+				_current = _blocks.back().get();
+				offset = 0;
+			}
+			block = _current;
+			_currentUsed = offset + size;
+		}
+		_copies.push_back(Copy{ dst.getBuffer(), block->getBuffer(), VkBufferCopy{ offset, 0, size } });
+		_uploadedBytes += size;
+	}
+	// the range is this thread's alone, the copy doesn't need the lock
+	block->writeToBuffer(const_cast<void*>(data), size, offset);
+}
+
+void UploadBatch::submit() {
+	std::lock_guard<std::mutex> lock{ _mutex };
+	if (_copies.empty()) return;
+
+	VkCommandBuffer commandBuffer = _device.beginSingleTimeCommands();
+	for (const Copy& copy : _copies)
+		vkCmdCopyBuffer(commandBuffer, copy.src, copy.dst, 1, &copy.region);
+	_device.endSingleTimeCommands(commandBuffer);
+	_submitCount++;
+
+	_copies.clear();
+	_blocks.clear();
+	_current = nullptr;
+	_currentUsed = 0;
+}
+
+}
@@ -0,0 +1,56 @@
+#ifndef UPLOAD_BATCH_HPP
+#define UPLOAD_BATCH_HPP
+
+#include "naku.hpp"
+#include "utils/buffer.hpp"
+
+#include <mutex>
+
+namespace naku {
+
+// gathers the copies into device local buffers made while it's open, from any thread, into a
+// few large staging buffers. submit copies them all with one command buffer and one wait,
+// where each buffer would otherwise wait for the queue on its own. open while a scene loads,
+// the device hands it out to whatever fills buffers meanwhile.
+class UploadBatch {
+public:
+	// staging is allocated in blocks of this many bytes, larger uploads get a block of their own
+	static constexpr VkDeviceSize BLOCK_SIZE = 64 * 1024 * 1024;
+
+	// becomes the open batch of device until it's destroyed
+	UploadBatch(Device& device);
+	// submits what's left
+	~UploadBatch();
+	UploadBatch(const UploadBatch&) = delete;
+	UploadBatch& operator=(const UploadBatch&) = delete;
+
+	// copies data into staging right away, dst is filled by the next submit. thread safe
+	void upload(const Buffer& dst, const void* data, VkDeviceSize size);
+	// records every copy so far, submits and waits for them, then frees the staging.
+	// only on the thread that uses the queue
+	void submit();
+
+	uint32_t submitCount() const { return _submitCount; }
+	VkDeviceSize uploadedBytes() const { return _uploadedBytes; }
+
+private:
+	struct Copy {
+		VkBuffer dst;
+		VkBuffer src;
+		VkBufferCopy region;
+	};
+
+	Device& _device;
+	UploadBatch* _previous{ nullptr };
+	std::mutex _mutex;
+	std::vector<std::unique_ptr<Buffer>> _blocks;
+	Buffer* _current{ nullptr }; // the block being filled
+	VkDeviceSize _currentUsed{ 0 };
+	std::vector<Copy> _copies;
+	uint32_t _submitCount{ 0 };
+	VkDeviceSize _uploadedBytes{ 0 };
+};
+
+}
+
+#endif